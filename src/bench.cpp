@@ -0,0 +1,925 @@
+/**
+ * @file bench.cpp
+ * @brief Micro benchmarks for the B+ tree index. Build with "make bench" and run ./src/badgerdb_bench
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "btree.h"
+#include "node_search.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+
+using namespace badgerdb;
+
+// -----------------------------------------------------------------------------
+// Globals
+// -----------------------------------------------------------------------------
+
+// Number of nodes searched round robin, large enough that the key arrays do not all fit in L1
+const int benchNodes = 256;
+
+// Number of searches timed for each kernel and fill level
+const int benchSearches = 2000000;
+
+// Keeps the compiler from optimizing away the searches
+volatile int benchSink;
+
+// Name of the (empty) base relation of the indexes built by the benchmarks
+const std::string benchRelationName = "benchRel";
+
+// Number of keys inserted by the insert benchmarks
+const int benchInserts = 200000;
+
+// Number of keys looked up by the point lookup benchmark
+const int benchLookups = 200000;
+
+// Number of keys in the range of the range scan benchmark, how often it is scanned, and the batch size
+const int benchScanKeys = 50000;
+const int benchScanRepeats = 20;
+const int benchScanBatch = 1024;
+
+// Number of keys of the indexes scanned cold, and the number of leaves read ahead
+const int benchColdKeys = 1000000;
+const int benchReadAhead = 32;
+
+// Number of records in the relation the index build benchmark builds indexes on
+const int benchBuildRecords = 1000000;
+
+// Number of full packed leaves each unpack kernel unpacks
+const int benchUnpackLeaves = 20000;
+
+// Number of keys of the index looked up through resident levels, and the fill factor which spreads them over three
+// levels of nodes which still all fit in the buffer pool
+const int benchResidentKeys = 50000;
+const double benchResidentFill = 0.1;
+
+// Number of keys of the concurrent index, the numbers of threads which look up and insert into it, and the number of
+// lookups and inserts all threads make together
+const int benchConcurrentKeys = 200000;
+const int benchThreadCounts[] = {1, 2, 4, 8, 16, 32, 64};
+const int benchConcurrentLookups = 1000000;
+const int benchConcurrentInserts = 200000;
+
+// Number of entries of a micro-batch of the batch insert benchmark, which inserts benchInserts keys
+const int benchBatchSizes[] = {1, 100, 1000, 10000};
+
+BufMgr * bufMgr = new BufMgr(1000);
+
+// -----------------------------------------------------------------------------
+// Forward declarations
+// -----------------------------------------------------------------------------
+
+void benchNodeSearch();
+void benchNodeSearchCapacity(const char* nodeName, int capacity);
+double timeSearch(IntSearchFunction search, const std::vector<std::vector<int> >& nodes,
+                  const std::vector<int>& nodeOrder, const std::vector<int>& searchKeys);
+void benchRandomInserts();
+void benchBatchInserts();
+void timeBatchInserts(int batchSize, const std::vector<int>& keys);
+void benchPointLookups();
+void benchRangeScans();
+void benchColdScans();
+void timeColdScans(const char* buildName, const IndexOptions& options);
+void evictIndex(BTreeIndex& index, const std::string& indexName);
+void benchIndexBuild();
+void timeIndexBuild(const char* buildName, const IndexOptions& options);
+void benchPackedLeaves();
+void timePackedLeaves(const char* buildName, const IndexOptions& options);
+long scanAllKeys(BTreeIndex& index, std::vector<RecordId>& batch);
+void benchUnpackKernels();
+void benchResidentLevels();
+void timeResidentLevels(int residentLevels, const std::vector<int>& keys);
+void benchConcurrency();
+void timeConcurrency(int threadCount, const std::vector<int>& keys);
+void createEmptyRelation();
+void createRandomRelation(int recordCount);
+void removeBenchFiles(const std::string& indexName);
+
+int main(int argc, char **argv)
+{
+	benchNodeSearch();
+	benchRandomInserts();
+	benchBatchInserts();
+	benchPointLookups();
+	benchRangeScans();
+	benchColdScans();
+	benchIndexBuild();
+	benchPackedLeaves();
+	benchResidentLevels();
+	benchConcurrency();
+
+	delete bufMgr;
+	return 0;
+}
+
+/**
+  * Compare the in-node search kernels against the original linear loop for leaf and non-leaf
+  * nodes filled to different levels.
+  *
+ **/
+void benchNodeSearch()
+{
+	std::cout << "--------------------" << std::endl;
+	std::cout << "In-node search, ns per lower bound search (active kernel: "
+	          << searchKernelName(activeSearchKernel()) << ")" << std::endl;
+	benchNodeSearchCapacity("leaf", INTARRAYLEAFSIZE);
+	benchNodeSearchCapacity("non-leaf", INTARRAYNONLEAFSIZE);
+}
+
+/**
+  * Time every supported kernel on nodes of the given capacity filled to 10%, 25%, 50%, 75% and 100%.
+  * @param nodeName Name of the node kind, for output
+  * @param capacity Number of key slots in the node
+  *
+ **/
+void benchNodeSearchCapacity(const char* nodeName, int capacity)
+{
+	const int fillPercents[] = {10, 25, 50, 75, 100};
+	const SearchKernel kernels[] = {SEARCH_LINEAR, SEARCH_BINARY, SEARCH_SSE4, SEARCH_AVX2};
+
+	printf("%-9s %6s %6s", nodeName, "fill", "keys");
+	for(int k = 0; k < 4; k++){
+		printf(" %10s", searchKernelName(kernels[k]));
+	}
+	printf("\n");
+
+	srandom(564);
+	for(int f = 0; f < 5; f++){
+		int keyCount = std::max(1, capacity * fillPercents[f] / 100);
+
+		// Build sorted nodes with gaps between keys, so searches hit both present and absent keys
+		std::vector<std::vector<int> > nodes(benchNodes, std::vector<int>(keyCount));
+		for(int n = 0; n < benchNodes; n++){
+			for(int i = 0; i < keyCount; i++){
+				nodes[n][i] = (int)(random() % (keyCount * 4));
+			}
+			std::sort(nodes[n].begin(), nodes[n].end());
+		}
+		std::vector<int> nodeOrder(benchSearches);
+		std::vector<int> searchKeys(benchSearches);
+		for(int i = 0; i < benchSearches; i++){
+			nodeOrder[i] = (int)(random() % benchNodes);
+			searchKeys[i] = (int)(random() % (keyCount * 4));
+		}
+
+		printf("%-9s %5d%% %6d", "", fillPercents[f], keyCount);
+		for(int k = 0; k < 4; k++){
+			if(!searchKernelSupported(kernels[k])){
+				printf(" %10s", "n/a");
+				continue;
+			}
+			printf(" %10.2f", timeSearch(lowerBoundKernel(kernels[k]), nodes, nodeOrder, searchKeys));
+		}
+		printf("\n");
+	}
+}
+
+/**
+  * Run all searches with one kernel and return the average time of a search in nanoseconds.
+  * Results are checked against the linear kernel.
+  *
+ **/
+double timeSearch(IntSearchFunction search, const std::vector<std::vector<int> >& nodes,
+                  const std::vector<int>& nodeOrder, const std::vector<int>& searchKeys)
+{
+	IntSearchFunction reference = lowerBoundKernel(SEARCH_LINEAR);
+	for(int i = 0; i < 1000; i++){
+		const std::vector<int>& node = nodes[nodeOrder[i]];
+		if(search(&node[0], (int)node.size(), searchKeys[i]) != reference(&node[0], (int)node.size(), searchKeys[i])){
+			std::cout << "Search kernel returns a wrong position." << std::endl;
+			exit(1);
+		}
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int checksum = 0;
+	for(size_t i = 0; i < searchKeys.size(); i++){
+		const std::vector<int>& node = nodes[nodeOrder[i]];
+		checksum += search(&node[0], (int)node.size(), searchKeys[i]);
+	}
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	benchSink = checksum;
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / searchKeys.size();
+}
+
+/**
+  * Insert keys in random order one at a time through insertEntry, and report the buffer pool accesses
+  * (BufStats::accesses) and time per insert.
+  *
+ **/
+void benchRandomInserts()
+{
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Random inserts through insertEntry" << std::endl;
+
+	std::vector<int> keys(benchInserts);
+	for(int i = 0; i < benchInserts; i++){
+		keys[i] = i;
+	}
+	srandom(564);
+	for(int i = benchInserts - 1; i > 0; i--){
+		std::swap(keys[i], keys[random() % (i + 1)]);
+	}
+
+	createEmptyRelation();
+	std::string indexName;
+	{
+		BTreeIndex index(benchRelationName, indexName, bufMgr, 0, INTEGER);
+		bufMgr->clearBufStats();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(int i = 0; i < benchInserts; i++){
+			RecordId rid;
+			rid.page_number = i / 100 + 1;
+			rid.slot_number = i % 100;
+			rid.padding = 0;
+			index.insertEntry(&keys[i], rid);
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		BufStats& stats = bufMgr->getBufStats();
+		printf("%d inserts: %.2f buffer accesses/insert, %d disk reads, %.2f us/insert\n", benchInserts,
+		       (double)stats.accesses / benchInserts, stats.diskreads,
+		       std::chrono::duration<double, std::micro>(end - start).count() / benchInserts);
+	}
+	removeBenchFiles(indexName);
+}
+
+/**
+  * Insert the keys of benchRandomInserts in micro-batches of growing size through insertBatch, and report the time
+  * per entry of each size. Batches of one entry take one descent per entry, like insertEntry.
+  *
+ **/
+void benchBatchInserts()
+{
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Random inserts through insertBatch" << std::endl;
+
+	std::vector<int> keys(benchInserts);
+	for(int i = 0; i < benchInserts; i++){
+		keys[i] = i;
+	}
+	srandom(564);
+	for(int i = benchInserts - 1; i > 0; i--){
+		std::swap(keys[i], keys[random() % (i + 1)]);
+	}
+	for(size_t b = 0; b < sizeof(benchBatchSizes) / sizeof(benchBatchSizes[0]); b++){
+		timeBatchInserts(benchBatchSizes[b], keys);
+	}
+}
+
+/**
+  * Insert the keys into an empty index in batches of the given size, report the time and buffer pool accesses per
+  * entry, and remove the index.
+  *
+ **/
+void timeBatchInserts(int batchSize, const std::vector<int>& keys)
+{
+	createEmptyRelation();
+	std::string indexName;
+	{
+		BTreeIndex index(benchRelationName, indexName, bufMgr, 0, INTEGER);
+		std::vector<KeyRid> batch(batchSize);
+		bufMgr->clearBufStats();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(size_t i = 0; i < keys.size(); i += batchSize){
+			size_t count = std::min(keys.size() - i, (size_t)batchSize);
+			for(size_t j = 0; j < count; j++){
+				batch[j].key = &keys[i + j];
+				batch[j].rid.page_number = (i + j) / 100 + 1;
+				batch[j].rid.slot_number = (i + j) % 100;
+				batch[j].rid.padding = 0;
+				batch[j].included = NULL;
+			}
+			index.insertBatch(batch.data(), count);
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		BufStats& stats = bufMgr->getBufStats();
+		printf("batches of %5d: %.2f buffer accesses/insert, %d disk reads, %.2f us/insert\n", batchSize,
+		       (double)stats.accesses / keys.size(), stats.diskreads,
+		       std::chrono::duration<double, std::micro>(end - start).count() / keys.size());
+	}
+	removeBenchFiles(indexName);
+}
+
+/**
+  * Look up keys of which half are in the index, once through an equality scan, which throws on every miss and at
+  * the end of every scan, and once through lookup, and report the time per lookup.
+  *
+ **/
+void benchPointLookups()
+{
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Point lookups on " << benchInserts << " keys, half of them missing" << std::endl;
+	createRandomRelation(benchInserts);
+
+	std::vector<int> keys(benchLookups);
+	srandom(564);
+	for(int i = 0; i < benchLookups; i++){
+		keys[i] = random() % (2 * benchInserts);
+	}
+
+	std::string indexName;
+	{
+		BTreeIndex index(benchRelationName, indexName, bufMgr, 0, INTEGER);
+
+		int scanHits = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(int i = 0; i < benchLookups; i++){
+			try
+			{
+				index.startScan(&keys[i], GTE, &keys[i], LTE);
+				RecordId rid;
+				try
+				{
+					while(1){
+						index.scanNext(rid);
+						scanHits++;
+					}
+				}
+				catch(const IndexScanCompletedException &e)
+				{
+				}
+				index.endScan();
+			}
+			catch(const NoSuchKeyFoundException &e)
+			{
+			}
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		printf("%-9s %8.2f us/lookup, %d hits\n", "scan", std::chrono::duration<double, std::micro>(end - start).count() / benchLookups, scanHits);
+
+		int lookupHits = 0;
+		start = std::chrono::steady_clock::now();
+		for(int i = 0; i < benchLookups; i++){
+			RecordId rid;
+			if(index.lookup(&keys[i], rid)){
+				lookupHits++;
+			}
+		}
+		end = std::chrono::steady_clock::now();
+		printf("%-9s %8.2f us/lookup, %d hits\n", "lookup", std::chrono::duration<double, std::micro>(end - start).count() / benchLookups, lookupHits);
+	}
+	removeBenchFiles(indexName);
+}
+
+/**
+  * Scan a range of keys, once one entry at a time through scanNext and once in batches through scanNextBatch,
+  * and report the time per entry.
+  *
+ **/
+void benchRangeScans()
+{
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Range scans of " << benchScanKeys << " keys out of " << benchInserts << std::endl;
+	createRandomRelation(benchInserts);
+
+	std::string indexName;
+	{
+		BTreeIndex index(benchRelationName, indexName, bufMgr, 0, INTEGER);
+		int lowVal = benchInserts / 4;
+		int highVal = lowVal + benchScanKeys;
+
+		long entries = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(int i = 0; i < benchScanRepeats; i++){
+			index.startScan(&lowVal, GTE, &highVal, LT);
+			try
+			{
+				while(1){
+					RecordId rid;
+					index.scanNext(rid);
+					entries++;
+				}
+			}
+			catch(const IndexScanCompletedException &e)
+			{
+			}
+			index.endScan();
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		printf("%-9s %8.2f ns/entry, %ld entries\n", "scanNext", std::chrono::duration<double, std::nano>(end - start).count() / entries, entries);
+
+		std::vector<RecordId> batch(benchScanBatch);
+		entries = 0;
+		start = std::chrono::steady_clock::now();
+		for(int i = 0; i < benchScanRepeats; i++){
+			index.startScan(&lowVal, GTE, &highVal, LT);
+			size_t count;
+			while((count = index.scanNextBatch(batch.data(), batch.size())) > 0){
+				entries += count;
+			}
+			index.endScan();
+		}
+		end = std::chrono::steady_clock::now();
+		printf("%-9s %8.2f ns/entry, %ld entries\n", "batch", std::chrono::duration<double, std::nano>(end - start).count() / entries, entries);
+	}
+	removeBenchFiles(indexName);
+}
+
+/**
+  * Scan all keys of indexes none of whose pages are in memory, reading each leaf only when the scan gets to it and
+  * reading leaves ahead. The leaves of a bulk loaded index lie in key order in the file, those of an index built
+  * through inserts all over it.
+  *
+ **/
+void benchColdScans()
+{
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Cold scans of all " << benchColdKeys << " keys" << std::endl;
+	createRandomRelation(benchColdKeys);
+
+	IndexOptions options;
+	timeColdScans("bulk", options);
+	options.bulkLoad = false;
+	timeColdScans("inserts", options);
+}
+
+/**
+  * Build an index with the given options and time a cold scan of all its keys without and with read ahead.
+  * @param buildName Name of the build, for output
+  *
+ **/
+void timeColdScans(const char* buildName, const IndexOptions& options)
+{
+	std::string indexName;
+	{
+		BTreeIndex index(benchRelationName, indexName, bufMgr, 0, INTEGER, options);
+		std::vector<RecordId> batch(benchScanBatch);
+		int readAheads[] = {0, benchReadAhead};
+		for(int r = 0; r < 2; r++){
+			index.setReadAhead(readAheads[r]);
+			evictIndex(index, indexName);
+			bufMgr->clearBufStats();
+			int lowVal = 0;
+			int highVal = benchColdKeys;
+			long entries = 0;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			index.startScan(&lowVal, GTE, &highVal, LT);
+			size_t count;
+			while((count = index.scanNextBatch(batch.data(), batch.size())) > 0){
+				entries += count;
+			}
+			index.endScan();
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			BufStats& stats = bufMgr->getBufStats();
+			printf("%-9s read ahead %2d %8.2f ms, %ld entries, %d disk reads, %d leaves read ahead, %d used\n",
+			       buildName, readAheads[r], std::chrono::duration<double, std::milli>(end - start).count(), entries,
+			       stats.diskreads, stats.prefetches, stats.prefetchHits);
+		}
+	}
+	try
+	{
+		File::remove(indexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+}
+
+/**
+  * Drop the pages of the index from the buffer pool and, as far as the operating system lets it, from the page
+  * cache, so that a scan afterwards waits for the disk.
+  *
+ **/
+void evictIndex(BTreeIndex& index, const std::string& indexName)
+{
+	bufMgr->flushFile(index.getIndexFile());
+	int fd = open(indexName.c_str(), O_RDONLY);
+	if(fd >= 0){
+		fsync(fd);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+}
+
+/**
+  * Build an INTEGER index on a relation of records in random key order, once through insertEntry and once
+  * through a bulk load at different fill factors, and report build time, index size and tree height.
+  *
+ **/
+void benchIndexBuild()
+{
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Index build on " << benchBuildRecords << " records in random order" << std::endl;
+	createRandomRelation(benchBuildRecords);
+
+	IndexOptions options;
+	options.bulkLoad = false;
+	timeIndexBuild("inserts", options);
+	options.bulkLoad = true;
+	options.fillFactor = 1.0;
+	timeIndexBuild("bulk 1.0", options);
+	options.fillFactor = 0.9;
+	timeIndexBuild("bulk 0.9", options);
+	options.fillFactor = 0.7;
+	timeIndexBuild("bulk 0.7", options);
+
+	// The same bulk load with a sort memory of a small part of the entries, so sorted runs are spilled and merged
+	options.fillFactor = 0.9;
+	options.sortMemory = 1024 * 1024;
+	options.sortThreads = 1;
+	timeIndexBuild("spill 1T", options);
+	options.sortThreads = 0;
+	timeIndexBuild("spill all", options);
+
+	removeBenchFiles("");
+}
+
+/**
+  * Build an index on the benchmark relation with the given options, print its build time, size and height
+  * and remove it.
+  *
+ **/
+void timeIndexBuild(const char* buildName, const IndexOptions& options)
+{
+	std::string indexName;
+	int height;
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		BTreeIndex index(benchRelationName, indexName, bufMgr, 0, INTEGER, options);
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		Page* header_page;
+		bufMgr->readPage(index.getIndexFile(), 1, header_page);
+		height = reinterpret_cast<IndexMetaInfo*>(header_page)->height;
+		bufMgr->unPinPage(index.getIndexFile(), 1, false);
+
+		printf("%-9s %8.1f ms", buildName, std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	// The index file is complete once the index is closed
+	struct stat fileStat;
+	stat(indexName.c_str(), &fileStat);
+	printf(" %8ld index pages, height %d\n", (long)(fileStat.st_size / Page::SIZE), height);
+	File::remove(indexName);
+}
+
+/**
+  * Compare a bulk loaded index with packed leaves against one with plain leaves on the same relation: its size, a
+  * cold scan of all keys, the same scan repeated with whatever pages the buffer pool kept, and point lookups. A scan
+  * of packed leaves unpacks every leaf it reads, and reads fewer leaves for it. Then time the unpack kernels alone.
+  *
+ **/
+void benchPackedLeaves()
+{
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Packed leaves on " << benchColdKeys << " records in random order (active unpack kernel: "
+	          << unpackKernelName(activeUnpackKernel()) << ")" << std::endl;
+	createRandomRelation(benchColdKeys);
+
+	IndexOptions options;
+	timePackedLeaves("plain", options);
+	options.packedLeaves = true;
+	timePackedLeaves("packed", options);
+	removeBenchFiles("");
+
+	benchUnpackKernels();
+}
+
+/**
+  * Build an index on the benchmark relation with the given options, print its size, the time and disk reads of its
+  * scans and the time of its point lookups, and remove it.
+  *
+ **/
+void timePackedLeaves(const char* buildName, const IndexOptions& options)
+{
+	std::string indexName;
+	{
+		BTreeIndex index(benchRelationName, indexName, bufMgr, 0, INTEGER, options);
+		std::vector<RecordId> batch(benchScanBatch);
+		evictIndex(index, indexName);
+		struct stat fileStat;
+		stat(indexName.c_str(), &fileStat);
+
+		bufMgr->clearBufStats();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		long entries = scanAllKeys(index, batch);
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		double coldMs = std::chrono::duration<double, std::milli>(end - start).count();
+		int coldReads = bufMgr->getBufStats().diskreads;
+
+		bufMgr->clearBufStats();
+		start = std::chrono::steady_clock::now();
+		for(int i = 0; i < benchScanRepeats; i++){
+			entries += scanAllKeys(index, batch);
+		}
+		end = std::chrono::steady_clock::now();
+		double repeatMs = std::chrono::duration<double, std::milli>(end - start).count() / benchScanRepeats;
+		int repeatReads = bufMgr->getBufStats().diskreads / benchScanRepeats;
+
+		srandom(91);
+		std::vector<int> keys(benchLookups);
+		for(int i = 0; i < benchLookups; i++){
+			keys[i] = random() % benchColdKeys;
+		}
+		int found = 0;
+		start = std::chrono::steady_clock::now();
+		for(int i = 0; i < benchLookups; i++){
+			RecordId rid;
+			found += index.lookup(&keys[i], rid);
+		}
+		end = std::chrono::steady_clock::now();
+		benchSink = found;
+
+		printf("%-7s %6ld index pages, cold scan %8.2f ms %6d disk reads, repeated scan %8.2f ms %6d disk reads, "
+		       "lookup %7.1f ns, %ld entries\n", buildName, (long)(fileStat.st_size / Page::SIZE), coldMs, coldReads,
+		       repeatMs, repeatReads, std::chrono::duration<double, std::nano>(end - start).count() / benchLookups,
+		       entries);
+	}
+	File::remove(indexName);
+}
+
+/**
+  * Scan all keys of the benchmark relation in batches.
+  * @return Number of entries scanned
+  *
+ **/
+long scanAllKeys(BTreeIndex& index, std::vector<RecordId>& batch)
+{
+	int lowVal = 0;
+	int highVal = benchColdKeys;
+	long entries = 0;
+	index.startScan(&lowVal, GTE, &highVal, LT);
+	size_t count;
+	while((count = index.scanNextBatch(batch.data(), batch.size())) > 0){
+		entries += count;
+	}
+	index.endScan();
+	return entries;
+}
+
+/**
+  * Time every supported unpack kernel on the values of a full packed leaf, for values of different widths.
+  *
+ **/
+void benchUnpackKernels()
+{
+	const int bitWidths[] = {8, 16, 25, 32};
+	const UnpackKernel kernels[] = {UNPACK_SCALAR, UNPACK_AVX2};
+	const int count = PackedLeafNode<int>::MAXENTRIES;
+	std::vector<unsigned char> packed(count * sizeof(std::uint32_t) + PACKEDSLACKBYTES);
+	srandom(17);
+	for(size_t i = 0; i < packed.size(); i++){
+		packed[i] = (unsigned char)random();
+	}
+	std::vector<std::uint32_t> values(count);
+
+	std::cout << "Unpack kernels, ns per value" << std::endl;
+	for(int w = 0; w < 4; w++){
+		printf("%2d bits", bitWidths[w]);
+		for(int k = 0; k < 2; k++){
+			if(!unpackKernelSupported(kernels[k])){
+				continue;
+			}
+			UnpackFunction unpack = unpackKernel(kernels[k]);
+			std::uint32_t sum = 0;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for(int i = 0; i < benchUnpackLeaves; i++){
+				unpack(packed.data(), bitWidths[w], count, values.data());
+				sum += values[i % count];
+			}
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			benchSink = (int)sum;
+			printf("  %s %6.3f", unpackKernelName(kernels[k]),
+			       std::chrono::duration<double, std::nano>(end - start).count() / ((double)benchUnpackLeaves * count));
+		}
+		printf("\n");
+	}
+}
+
+/**
+  * Look up random keys of an index of three levels with none, one and two of its upper levels resident, and report
+  * the buffer pool accesses, disk reads and time per lookup. The whole index fits in the buffer pool, so the time
+  * saved is that of the buffer pool accesses alone.
+  *
+ **/
+void benchResidentLevels()
+{
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Point lookups on " << benchResidentKeys << " keys by number of resident levels" << std::endl;
+	createRandomRelation(benchResidentKeys);
+
+	std::vector<int> keys(benchLookups);
+	srandom(564);
+	for(int i = 0; i < benchLookups; i++){
+		keys[i] = random() % benchResidentKeys;
+	}
+
+	std::string indexName;
+	{
+		IndexOptions options;
+		options.fillFactor = benchResidentFill;
+		BTreeIndex index(benchRelationName, indexName, bufMgr, 0, INTEGER, options);
+	}
+	for(int levels = 0; levels <= 2; levels++){
+		timeResidentLevels(levels, keys);
+	}
+	removeBenchFiles(indexName);
+}
+
+/**
+  * Open the index of benchResidentLevels with the given number of resident levels, and time lookups of the keys
+  * after one pass over them has warmed up the buffer pool and built the resident levels.
+  *
+ **/
+void timeResidentLevels(int residentLevels, const std::vector<int>& keys)
+{
+	IndexOptions options;
+	options.residentLevels = residentLevels;
+	std::string indexName;
+	BTreeIndex index(benchRelationName, indexName, bufMgr, 0, INTEGER, options);
+	RecordId rid;
+	for(size_t i = 0; i < keys.size(); i++){
+		index.lookup(&keys[i], rid);
+	}
+
+	bufMgr->clearBufStats();
+	int hits = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < keys.size(); i++){
+		hits += index.lookup(&keys[i], rid);
+	}
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	BufStats& stats = bufMgr->getBufStats();
+	printf("%d resident levels (%d nodes): %.2f buffer accesses/lookup, %.2f disk reads/lookup, %.3f us/lookup, %d hits\n",
+	       index.getResidentLevels(), index.getResidentNodes(), (double)stats.accesses / keys.size(),
+	       (double)stats.diskreads / keys.size(),
+	       std::chrono::duration<double, std::micro>(end - start).count() / keys.size(), hits);
+}
+
+/**
+  * Look up and insert keys of a concurrent index from a growing number of threads, and report the throughput of
+  * each. A machine with fewer cores than threads shows how the latches hold up under preemption rather than how the
+  * index scales.
+  *
+ **/
+void benchConcurrency()
+{
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Concurrent lookups and inserts on " << benchConcurrentKeys << " keys, "
+	          << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+	createRandomRelation(benchConcurrentKeys);
+
+	std::vector<int> keys(benchConcurrentLookups);
+	srandom(564);
+	for(int i = 0; i < benchConcurrentLookups; i++){
+		keys[i] = random() % benchConcurrentKeys;
+	}
+	for(size_t t = 0; t < sizeof(benchThreadCounts) / sizeof(benchThreadCounts[0]); t++){
+		timeConcurrency(benchThreadCounts[t], keys);
+	}
+	removeBenchFiles("");
+}
+
+/**
+  * Build a concurrent index on the benchmark relation, time the given threads looking up the keys, each a share of
+  * them, and then inserting the keys from benchConcurrentKeys on, each thread every threadCount-th of them, and
+  * remove the index.
+  *
+ **/
+void timeConcurrency(int threadCount, const std::vector<int>& keys)
+{
+	std::string indexName;
+	{
+		IndexOptions options;
+		options.concurrent = true;
+		BTreeIndex index(benchRelationName, indexName, bufMgr, 0, INTEGER, options);
+		RecordId rid;
+		for(size_t i = 0; i < keys.size(); i += 16){
+			index.lookup(&keys[i], rid);
+		}
+
+		std::atomic<int> hits(0);
+		std::vector<std::thread> threads;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(int t = 0; t < threadCount; t++){
+			threads.push_back(std::thread([&index, &keys, &hits, t, threadCount]() {
+				int found = 0;
+				RecordId rid;
+				for(size_t i = t; i < keys.size(); i += threadCount){
+					found += index.lookup(&keys[i], rid);
+				}
+				hits += found;
+			}));
+		}
+		for(int t = 0; t < threadCount; t++){
+			threads[t].join();
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		double lookupSeconds = std::chrono::duration<double>(end - start).count();
+
+		threads.clear();
+		start = std::chrono::steady_clock::now();
+		for(int t = 0; t < threadCount; t++){
+			threads.push_back(std::thread([&index, t, threadCount]() {
+				for(int key = benchConcurrentKeys + t; key < benchConcurrentKeys + benchConcurrentInserts; key += threadCount){
+					RecordId rid;
+					rid.page_number = key / 100 + 1;
+					rid.slot_number = key % 100;
+					rid.padding = 0;
+					index.insertEntry(&key, rid);
+				}
+			}));
+		}
+		for(int t = 0; t < threadCount; t++){
+			threads[t].join();
+		}
+		end = std::chrono::steady_clock::now();
+		double insertSeconds = std::chrono::duration<double>(end - start).count();
+
+		printf("%2d threads: %8.3f M lookups/s, %8.3f M inserts/s, %d hits\n", threadCount,
+		       keys.size() / lookupSeconds / 1e6, benchConcurrentInserts / insertSeconds / 1e6, hits.load());
+	}
+	File::remove(indexName);
+}
+
+/**
+  * Create an empty base relation, so the index constructor has nothing to insert.
+  *
+ **/
+void createEmptyRelation()
+{
+	try
+	{
+		File::remove(benchRelationName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	PageFile::create(benchRelationName);
+}
+
+/**
+  * Create a base relation of the given number of records, whose leading INTEGER is a permutation of
+  * 0 to recordCount - 1.
+  *
+ **/
+void createRandomRelation(int recordCount)
+{
+	createEmptyRelation();
+	PageFile relation = PageFile::open(benchRelationName);
+
+	std::vector<int> keys(recordCount);
+	for(int i = 0; i < recordCount; i++){
+		keys[i] = i;
+	}
+	srandom(564);
+	for(int i = recordCount - 1; i > 0; i--){
+		std::swap(keys[i], keys[random() % (i + 1)]);
+	}
+
+	PageId pageNumber;
+	Page page = relation.allocatePage(pageNumber);
+	for(int i = 0; i < recordCount; i++){
+		std::string record(reinterpret_cast<const char*>(&keys[i]), sizeof(int));
+		try
+		{
+			page.insertRecord(record);
+		}
+		catch(const InsufficientSpaceException &e)
+		{
+			relation.writePage(pageNumber, page);
+			page = relation.allocatePage(pageNumber);
+			page.insertRecord(record);
+		}
+	}
+	relation.writePage(pageNumber, page);
+}
+
+/**
+  * Remove the base relation and the given index file.
+  *
+ **/
+void removeBenchFiles(const std::string& indexName)
+{
+	try
+	{
+		if(!indexName.empty()){
+			File::remove(indexName);
+		}
+		File::remove(benchRelationName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+}
@@ -0,0 +1,90 @@
+/**
+ * @file bloom_filter.cpp
+ * @brief Blocked Bloom filter over the keys of an index, kept in pages of the index file. Every key sets its bits in
+ * one block of the size of a cache line, so a lookup reads a single block of a single page.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include "bloom_filter.h"
+
+namespace badgerdb
+{
+
+namespace
+{
+
+const int BLOOMBLOCKBITS = BLOOMBLOCKBYTES * 8;
+
+// Step from one bit of a key to the next, which differs between keys so they do not share all their bits
+std::uint32_t probeDelta(std::uint32_t h)
+{
+    return (h >> 17) | (h << 15);
+}
+
+}
+
+std::uint64_t bloomHash(const void* key, int length)
+{
+    // FNV-1a over the bytes, then the finalizer of MurmurHash3 so every bit of the key reaches both halves
+    const unsigned char* bytes = (const unsigned char*)key;
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for(int i = 0; i < length; i++){
+        h = (h ^ bytes[i]) * 0x100000001b3ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+int bloomProbes(int bitsPerKey)
+{
+    // bitsPerKey * ln 2 bits keep the false positive rate lowest
+    return std::max(1, std::min(16, (int)(bitsPerKey * 0.69 + 0.5)));
+}
+
+int bloomPageCount(std::int64_t keys, int bitsPerKey)
+{
+    std::int64_t bits = std::max<std::int64_t>(keys, 1) * bitsPerKey;
+    std::int64_t pages = (bits + Page::SIZE * 8 - 1) / (Page::SIZE * 8);
+    return (int)std::min<std::int64_t>(pages, MAXBLOOMPAGES);
+}
+
+std::int64_t bloomCapacity(int pageCount, int bitsPerKey)
+{
+    return (std::int64_t)pageCount * Page::SIZE * 8 / bitsPerKey;
+}
+
+void bloomSetBits(unsigned char* block, std::uint64_t hash, int probes)
+{
+    std::uint32_t h = (std::uint32_t)hash;
+    std::uint32_t delta = probeDelta(h);
+    for(int i = 0; i < probes; i++){
+        int bit = h % BLOOMBLOCKBITS;
+        block[bit / 8] |= (unsigned char)(1 << (bit % 8));
+        h += delta;
+    }
+}
+
+bool bloomTestBits(const unsigned char* block, std::uint64_t hash, int probes)
+{
+    std::uint32_t h = (std::uint32_t)hash;
+    std::uint32_t delta = probeDelta(h);
+    for(int i = 0; i < probes; i++){
+        int bit = h % BLOOMBLOCKBITS;
+        if((block[bit / 8] & (1 << (bit % 8))) == 0){
+            return false;
+        }
+        h += delta;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,93 @@
+/**
+ * @file bloom_filter.h
+ * @brief Blocked Bloom filter over the keys of an index, kept in pages of the index file. Every key sets its bits in
+ * one block of the size of a cache line, so a lookup reads a single block of a single page.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "types.h"
+#include "page.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of bytes of a block of a Bloom filter, one cache line.
+ */
+const int BLOOMBLOCKBYTES = 64;
+
+/**
+ * @brief Number of blocks of a Bloom filter page.
+ */
+const int BLOOMBLOCKSPERPAGE = Page::SIZE / BLOOMBLOCKBYTES;
+
+/**
+ * @brief Maximum number of pages of a Bloom filter, whose page numbers are kept in the meta page. A filter of this
+ * many pages and 10 bits per key holds millions of keys, more keys only make it return false positives more often.
+ */
+const int MAXBLOOMPAGES = 1024;
+
+/**
+ * @brief Maximum number of bits per key of a Bloom filter.
+ */
+const int MAXBLOOMBITSPERKEY = 64;
+
+/**
+ * @brief Structure for a page of a Bloom filter, which is nothing but blocks of bits.
+ */
+struct BloomFilterPage{
+  /**
+   * Bits of the blocks.
+   */
+	unsigned char blocks[ BLOOMBLOCKSPERPAGE ][ BLOOMBLOCKBYTES ];
+};
+
+static_assert(sizeof(BloomFilterPage) <= Page::SIZE, "Bloom filter pages must fit in a page.");
+
+/**
+ * @brief Hash of the bytes of a key, whose high half picks the block and whose low half the bits of the key.
+ */
+std::uint64_t bloomHash(const void* key, int length);
+
+/**
+ * @brief Number of bits a key sets in its block, for a filter with the given number of bits per key.
+ */
+int bloomProbes(int bitsPerKey);
+
+/**
+ * @brief Number of pages of a filter which holds the given number of keys at the given number of bits per key, at
+ * least 1 and at most MAXBLOOMPAGES.
+ */
+int bloomPageCount(std::int64_t keys, int bitsPerKey);
+
+/**
+ * @brief Number of keys a filter of the given number of pages holds at the given number of bits per key.
+ */
+std::int64_t bloomCapacity(int pageCount, int bitsPerKey);
+
+/**
+ * @brief Block of a filter with the given number of blocks where a key with the given hash goes.
+ */
+inline int bloomBlock(std::uint64_t hash, int blockCount)
+{
+	return (int)(((hash >> 32) * (std::uint64_t)blockCount) >> 32);
+}
+
+/**
+ * @brief Set the bits of a key with the given hash in its block.
+ */
+void bloomSetBits(unsigned char* block, std::uint64_t hash, int probes);
+
+/**
+ * @brief Check the bits of a key with the given hash in its block. False if the key is certainly not in the filter.
+ */
+bool bloomTestBits(const unsigned char* block, std::uint64_t hash, int probes);
+
+}
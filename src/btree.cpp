@@ -18,6 +18,8 @@
 
 #include "btree.h"
 #include "filescan.h"
+#include "node_search.h"
+#include "external_sort.h"
 #include "exceptions/bad_index_info_exception.h"
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/bad_scanrange_exception.h"
@@ -26,6 +28,8 @@
 #include "exceptions/index_scan_completed_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include <algorithm>
+#include <thread>
 
 
 //#define DEBUG
@@ -33,6 +37,263 @@
 namespace badgerdb
 {
 
+namespace
+{
+
+// Read a key of type T from a record or a caller buffer, which need not be aligned for T
+template <class T>
+T keyValue(const void* key)
+{
+    T value;
+    memcpy(&value, key, sizeof(T));
+    return value;
+}
+
+// A STRING key is read up to its terminating '\0', at most STRINGKEYMAXSIZE bytes, and padded with '\0'
+template <>
+PaddedStringKey keyValue<PaddedStringKey>(const void* key)
+{
+    PaddedStringKey value;
+    memset(value.bytes, 0, STRINGKEYMAXSIZE);
+    memcpy(value.bytes, key, stringKeyLength((const char*)key));
+    return value;
+}
+
+// Number of nodes, and number of entries of every node, when count entries are spread over as few nodes
+// as possible holding at most per_node entries each, as evenly as possible
+int evenNodeCount(size_t count, int per_node)
+{
+    return (int)((count + per_node - 1) / per_node);
+}
+
+int evenNodeSize(size_t count, int node_count, int node)
+{
+    return (int)(count / node_count) + (node < (int)(count % node_count) ? 1 : 0);
+}
+
+// Page number of child i of a non-leaf node
+template <class T>
+PageId childPageNo(const NonLeafNode<T>* node, int i)
+{
+    return node->pageNoArray[i];
+}
+
+PageId childPageNo(const StringNonLeafNode* node, int i)
+{
+    return (i == 0) ? node->leftmostPageNo : node->slots()[i - 1].pageNo;
+}
+
+// Replace the key at the given position of a STRING non-leaf node, keeping the children
+// Return false, with the node unchanged, if the node has no room for the new key
+bool replaceStringKey(StringNonLeafNode* node, int position, const std::string& key)
+{
+    std::vector<std::string> keys;
+    std::vector<PageId> children;
+    decodeStringNode(node, keys, children);
+    keys[position] = key;
+    return encodeStringNode(node, keys, children, 0, (int)keys.size());
+}
+
+// A STRING node underflows when less than a third of its data area is in use. Nodes of a split or a bulk load
+// are about half full, and the sizes of the keys decide how full a node is after borrowing
+template <class Node>
+bool stringNodeUnderflows(const Node* node)
+{
+    return stringNodeUsedBytes(node) < Node::DATASIZE / 3;
+}
+
+// Keys and record ids of a leaf node in a format which keeps one of each per entry, ENTRY_LIST or COVERING_LIST.
+// Return false for a POSTING_LIST or PACKED_LIST node
+template <class T>
+bool leafEntryArrays(const Page* page, const T*& keys, const RecordId*& rids)
+{
+    const LeafNode<T>* leaf_node = reinterpret_cast<const LeafNode<T>*>(page);
+    if(leaf_node->format == ENTRY_LIST){
+        keys = leaf_node->keyArray;
+        rids = leaf_node->ridArray;
+        return true;
+    }
+    if(leaf_node->format == COVERING_LIST){
+        const CoveringLeafNode<T>* covering_node = reinterpret_cast<const CoveringLeafNode<T>*>(page);
+        keys = covering_node->keys();
+        rids = covering_node->rids();
+        return true;
+    }
+    return false;
+}
+
+// Number of entries of a leaf node of any format, every record id of a posting list counting as an entry
+template <class T>
+int leafEntryCount(const Page* page)
+{
+    const LeafNode<T>* leaf_node = reinterpret_cast<const LeafNode<T>*>(page);
+    if(leaf_node->format != POSTING_LIST){
+        return leaf_node->keySize;
+    }
+    const PostingLeafNode<T>* posting_node = reinterpret_cast<const PostingLeafNode<T>*>(page);
+    return postingEntryIndex(posting_node, posting_node->keySize);
+}
+
+// Order of the entries of a batch by their keys alone, see BTreeIndex::insertBatchTyped
+template <class T>
+bool batchKeyLess(const std::pair<T, RecordId>& a, const std::pair<T, RecordId>& b)
+{
+    return a.first < b.first;
+}
+
+// True if a key repeats among the keySize entries of the leaf node and the entries [start, end) of the batch, both
+// sorted; without repeats posting lists never take fewer bytes, so the leaf node is not decoded to check
+template <class T>
+bool batchRepeatsKey(const LeafNode<T>* leaf_node, int keySize, const std::vector<std::pair<T, RecordId> >& batch,
+                     size_t start, size_t end)
+{
+    int i = 0;
+    size_t j = start;
+    bool have_last = false;
+    T last = T();
+    while(i < keySize || j < end){
+        T key;
+        if(j == end || (i < keySize && leaf_node->keyArray[i] < batch[j].first)){
+            key = leaf_node->keyArray[i++];
+        }
+        else{
+            key = batch[j++].first;
+        }
+        if(have_last && key == last){
+            return true;
+        }
+        last = key;
+        have_last = true;
+    }
+    return false;
+}
+
+// Position of the first entry of a leaf node of any format whose key is greater than or equal to (greater than
+// if upper) the given key, counting entries like leafEntryCount
+template <class T>
+int leafBound(const Page* page, T key, bool upper)
+{
+    const T* keys;
+    const RecordId* rids;
+    if(leafEntryArrays(page, keys, rids)){
+        int size = reinterpret_cast<const LeafNode<T>*>(page)->keySize;
+        return upper ? upperBound(keys, size, key) : lowerBound(keys, size, key);
+    }
+    if(reinterpret_cast<const LeafNode<T>*>(page)->format == PACKED_LIST){
+        const PackedLeafNode<T>* packed_node = reinterpret_cast<const PackedLeafNode<T>*>(page);
+        return upper ? packedUpperBound(packed_node, key) : packedLowerBound(packed_node, key);
+    }
+    const PostingLeafNode<T>* posting_node = reinterpret_cast<const PostingLeafNode<T>*>(page);
+    return postingEntryIndex(posting_node, upper ? postingUpperBound(posting_node, key) : postingLowerBound(posting_node, key));
+}
+
+// Posting lists are worth it for the postings [first, last) once they take at most half the bytes of an entry list,
+// and needed as soon as a key keeps its record ids in overflow pages
+template <class T>
+bool preferPostings(const std::vector<Posting<T> >& postings, int first, int last)
+{
+    for(int i = first; i < last; i++){
+        if(postings[i].overflowPageNo != Page::INVALID_NUMBER){
+            return true;
+        }
+    }
+    int entries = postingEntryCount(postings, first, last);
+    return entries > 0 && 2 * postingLeafBytes(postings, first, last) <= entries * (int)(sizeof(T) + sizeof(RecordId));
+}
+
+// Format of a leaf node holding the postings [first, last), which are written as posting lists if they are worth it
+// or do not fit in an entry list
+template <class T>
+LeafFormat leafFormat(const std::vector<Posting<T> >& postings, int first, int last)
+{
+    if(preferPostings(postings, first, last) || postingEntryCount(postings, first, last) > NodeCapacity<T>::LEAF){
+        return POSTING_LIST;
+    }
+    return ENTRY_LIST;
+}
+
+// True if the postings [first, last) fit in one leaf node of the format leafFormat chooses
+template <class T>
+bool leafFits(const std::vector<Posting<T> >& postings, int first, int last)
+{
+    return leafFormat(postings, first, last) == ENTRY_LIST ||
+           postingLeafBytes(postings, first, last) <= PostingLeafNode<T>::DATASIZE;
+}
+
+// Choose where to split postings which do not fit in one leaf node, postings [0, split) going to the left node and
+// [split, n) to the right one. The split closest to left_fill of the bytes is taken, unless one of its halves does
+// not fit
+template <class T>
+int chooseLeafSplit(const std::vector<Posting<T> >& postings, double left_fill)
+{
+    int n = (int)postings.size();
+    int split = choosePostingSplit(postings, left_fill);
+    for(int distance = 0; distance < n; distance++){
+        int candidates[2] = {split - distance, split + distance};
+        for(int i = 0; i < 2; i++){
+            int c = candidates[i];
+            if(c >= 1 && c < n && leafFits(postings, 0, c) && leafFits(postings, c, n)){
+                return c;
+            }
+        }
+    }
+    return split;
+}
+
+// Decode a leaf node of either format into postings. Record ids in overflow pages are not read
+template <class T>
+void decodeLeaf(const Page* page, std::vector<Posting<T> >& postings)
+{
+    const LeafNode<T>* leaf_node = reinterpret_cast<const LeafNode<T>*>(page);
+    if(leaf_node->format == ENTRY_LIST){
+        groupPostings(leaf_node->keyArray, leaf_node->ridArray, leaf_node->keySize, postings);
+    }
+    else{
+        decodePostingLeaf(reinterpret_cast<const PostingLeafNode<T>*>(page), postings);
+    }
+}
+
+// Write the postings [first, last), which fit, into a leaf node in the format leafFormat chooses, keeping its siblings
+template <class T>
+void encodeLeaf(Page* page, const std::vector<Posting<T> >& postings, int first, int last)
+{
+    if(leafFormat(postings, first, last) == POSTING_LIST){
+        encodePostingLeaf(reinterpret_cast<PostingLeafNode<T>*>(page), postings, first, last);
+        return;
+    }
+    LeafNode<T>* leaf_node = reinterpret_cast<LeafNode<T>*>(page);
+    int count = 0;
+    for(int i = first; i < last; i++){
+        for(size_t j = 0; j < postings[i].rids.size(); j++, count++){
+            leaf_node->keyArray[count] = postings[i].key;
+            leaf_node->ridArray[count] = postings[i].rids[j];
+        }
+    }
+    leaf_node->keySize = count;
+    leaf_node->format = ENTRY_LIST;
+}
+
+// A leaf node underflows when it holds less than half the entries which fit, in the PACKED_LIST format less than half
+// the entries which fit whatever they are, or in the POSTING_LIST format, when less than a third of its data area is
+// in use, like a STRING node
+template <class T>
+bool leafUnderflows(const Page* page)
+{
+    const LeafNode<T>* leaf_node = reinterpret_cast<const LeafNode<T>*>(page);
+    if(leaf_node->format == ENTRY_LIST){
+        return leaf_node->keySize < NodeCapacity<T>::MIDDLELEAF;
+    }
+    if(leaf_node->format == COVERING_LIST){
+        return leaf_node->keySize < reinterpret_cast<const CoveringLeafNode<T>*>(page)->capacity / 2;
+    }
+    if(leaf_node->format == PACKED_LIST){
+        return leaf_node->keySize < PackedLeafNode<T>::SAFEENTRIES / 2;
+    }
+    return postingNodeUsedBytes(reinterpret_cast<const PostingLeafNode<T>*>(page)) < PostingLeafNode<T>::DATASIZE / 3;
+}
+
+}
+
 // -----------------------------------------------------------------------------
 // BTreeIndex::BTreeIndex -- Constructor
 // -----------------------------------------------------------------------------
@@ -41,23 +302,128 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
 		std::string & outIndexName,
 		BufMgr *bufMgrIn,
 		const int attrByteOffset,
-		const Datatype attrType)
+		const Datatype attrType,
+		const IndexOptions& options)
+    : scanCursor(this)
 {
     // Add your code below. Please do not remove this line.
 
-    // generate index file name given relation name and attribute offset
+    // generate index file name given relation name and attribute offset, or the offsets of all key columns
     std::ostringstream idxStr;
 	idxStr << relationName << '.' << attrByteOffset;
+	for(size_t i = 1; i < options.keyColumns.size(); i++){
+	    idxStr << '.' << options.keyColumns[i].byteOffset;
+	}
 	outIndexName = idxStr.str();
 
 	//initialize members of BTreeIndex
 	this->bufMgr = bufMgrIn;
 	this->attrByteOffset = attrByteOffset;
 	this->attributeType = attrType;
-	this->leafOccupancy = INTARRAYLEAFSIZE;
-	this->nodeOccupancy = INTARRAYNONLEAFSIZE;
 	this->headerPageNum = (PageId)1;
-	this->scanExecuting = false;
+
+	// Included columns are stored beside every key, so leaves with them hold fewer entries
+	this->includedColumns = options.includedColumns;
+	this->includedBytes = 0;
+	for(size_t i = 0; i < includedColumns.size(); i++){
+	    if(includedColumns[i].byteOffset < 0 || includedColumns[i].length <= 0){
+	        throw BadIndexInfoException("Error: An included column must have a byte offset of at least 0 and a positive length!");
+	    }
+	    includedBytes += includedColumns[i].length;
+	}
+	if((int)includedColumns.size() > MAXINCLUDEDCOLUMNS || includedBytes > MAXINCLUDEDBYTES){
+	    throw BadIndexInfoException("Error: The included columns take too many bytes!");
+	}
+
+	// The node capacity depends on the key type, check that the key type is supported before touching the index file
+	switch(attrType){
+	case INTEGER:
+	    this->leafOccupancy = includedBytes > 0 ? CoveringLeafNode<int>::capacityFor(includedBytes) : NodeCapacity<int>::LEAF;
+	    this->nodeOccupancy = NodeCapacity<int>::NONLEAF;
+	    break;
+	case DOUBLE:
+	    this->leafOccupancy = includedBytes > 0 ? CoveringLeafNode<double>::capacityFor(includedBytes) : NodeCapacity<double>::LEAF;
+	    this->nodeOccupancy = NodeCapacity<double>::NONLEAF;
+	    break;
+	case INT64:
+	    this->leafOccupancy = includedBytes > 0 ? CoveringLeafNode<std::int64_t>::capacityFor(includedBytes)
+	                                            : NodeCapacity<std::int64_t>::LEAF;
+	    this->nodeOccupancy = NodeCapacity<std::int64_t>::NONLEAF;
+	    break;
+	case STRING:
+	    // Keys have variable length, a node holds at least this many keys of the maximum length
+	    this->leafOccupancy = StringLeafNode::DATASIZE / (sizeof(StringLeafSlot) + STRINGKEYMAXSIZE);
+	    this->nodeOccupancy = StringNonLeafNode::DATASIZE / (sizeof(StringNonLeafSlot) + STRINGKEYMAXSIZE);
+	    break;
+	default:
+	    throw BadIndexInfoException("Error: The attribute type is not supported by the index!");
+	}
+	if(attrType == STRING && includedBytes > 0){
+	    throw BadIndexInfoException("Error: An index on STRING keys cannot include columns!");
+	}
+	if(options.packedLeaves && (attrType == STRING || includedBytes > 0)){
+	    throw BadIndexInfoException("Error: Only an index on INTEGER, DOUBLE or INT64 keys without included columns can pack its leaves!");
+	}
+	this->packedLeaves = options.packedLeaves;
+
+	// A composite key is stored as the STRING of its encoded columns, whose fixed size parts must leave room for a
+	// byte of a last STRING column
+	this->keyColumns = options.keyColumns;
+	this->compositeKeyBytes = 0;
+	if(!keyColumns.empty()){
+	    if(attrType != STRING || attrByteOffset != keyColumns[0].byteOffset || (int)keyColumns.size() > MAXKEYCOLUMNS){
+	        throw BadIndexInfoException("Error: A composite key must be a STRING key at the offset of its first column!");
+	    }
+	    for(size_t i = 0; i < keyColumns.size(); i++){
+	        if(keyColumns[i].byteOffset < 0){
+	            throw BadIndexInfoException("Error: A key column must have a byte offset of at least 0!");
+	        }
+	        switch(keyColumns[i].type){
+	        case INTEGER:
+	            compositeKeyBytes += COMPOSITEINTSIZE;
+	            break;
+	        case DOUBLE:
+	            compositeKeyBytes += COMPOSITEDOUBLESIZE;
+	            break;
+	        case INT64:
+	            compositeKeyBytes += COMPOSITEINT64SIZE;
+	            break;
+	        case STRING:
+	            if(i + 1 != keyColumns.size()){
+	                throw BadIndexInfoException("Error: Only the last key column can be a STRING!");
+	            }
+	            compositeKeyBytes += 1;
+	            break;
+	        default:
+	            throw BadIndexInfoException("Error: The key column type is not supported by the index!");
+	        }
+	    }
+	    if(compositeKeyBytes > STRINGKEYMAXSIZE){
+	        throw BadIndexInfoException("Error: The key columns take too many bytes!");
+	    }
+	}
+	if(!(options.fillFactor > 0 && options.fillFactor <= 1)){
+	    throw BadIndexInfoException("Error: The fill factor must be greater than 0 and at most 1!");
+	}
+	if(!(options.splitFill > 0 && options.splitFill < 1 && options.rightmostSplitFill > 0 && options.rightmostSplitFill < 1)){
+	    throw BadIndexInfoException("Error: The split fill factors must be greater than 0 and less than 1!");
+	}
+	this->splitFill = options.splitFill;
+	this->rightmostSplitFill = options.rightmostSplitFill;
+	if(options.bloomBitsPerKey < 0 || options.bloomBitsPerKey > MAXBLOOMBITSPERKEY){
+	    throw BadIndexInfoException("Error: The bits per key of the Bloom filter must be between 0 and 64!");
+	}
+	this->bloomBitsPerKey = 0;
+	this->bloomProbeCount = 0;
+	this->bloomKeyCount = 0;
+	if(options.residentLevels < 0 || options.residentLevels > MAXTREEHEIGHT){
+	    throw BadIndexInfoException("Error: The number of resident levels must be between 0 and 32!");
+	}
+	this->residentLevelCount = attrType == STRING ? 0 : options.residentLevels;
+	if(options.concurrent && (attrType == STRING || options.bloomBitsPerKey > 0)){
+	    throw BadIndexInfoException("Error: Only an index on INTEGER, DOUBLE or INT64 keys without a Bloom filter can be concurrent!");
+	}
+	this->nodeVersions = options.concurrent ? new NodeVersions() : NULL;
 
 	// If the corresponding index file exists, open the file and check the meta data in its header page.
 	// If the meta data does not match the values received through constructor parameters, then throw
@@ -69,15 +435,44 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
         // Open the existing index file
         file = new BlobFile(outIndexName, false);
         bufMgr->readPage((BlobFile*)file, headerPageNum, header_page);
-        bufMgr->unPinPage((BlobFile*)file, headerPageNum, false);
         IndexMetaInfo* treeHeader = reinterpret_cast<IndexMetaInfo*>(header_page);
-        rootPageNum = treeHeader->rootPageNo;
 
         // Check the meta data of the existing index file
-        if(treeHeader->attrByteOffset != attrByteOffset || treeHeader->attrType != attrType ||
-           (strcmp(treeHeader->relationName, relationName.c_str()) != 0)){
-               throw BadIndexInfoException("Error: The index file is a bad file!");
-           }
+        bool badIndexInfo = treeHeader->attrByteOffset != attrByteOffset || treeHeader->attrType != attrType ||
+           (strcmp(treeHeader->relationName, relationName.c_str()) != 0) ||
+           treeHeader->includedCount != (int)includedColumns.size() || treeHeader->keyCount != (int)keyColumns.size();
+        for(int i = 0; !badIndexInfo && i < treeHeader->includedCount; i++){
+            badIndexInfo = treeHeader->includedColumns[i].byteOffset != includedColumns[i].byteOffset ||
+                           treeHeader->includedColumns[i].length != includedColumns[i].length;
+        }
+        for(int i = 0; !badIndexInfo && i < treeHeader->keyCount; i++){
+            badIndexInfo = treeHeader->keyColumns[i].byteOffset != keyColumns[i].byteOffset ||
+                           treeHeader->keyColumns[i].type != keyColumns[i].type;
+        }
+
+        // Keep the root page number and tree height in memory, so they need not be read from the header page again
+        rootPageNum = treeHeader->rootPageNo;
+        treeHeight = treeHeader->height;
+        firstLeafPageNum = treeHeader->firstLeafPageNo;
+        rootIsLeaf = (treeHeight == 1);
+        if(treeHeader->bloomBitsPerKey > 0){
+            bloomBitsPerKey = treeHeader->bloomBitsPerKey;
+            bloomProbeCount = bloomProbes(bloomBitsPerKey);
+            bloomPageNums.assign(treeHeader->bloomPageNo, treeHeader->bloomPageNo + treeHeader->bloomPageCount);
+            bloomKeyCount = treeHeader->bloomKeyCount;
+        }
+        bufMgr->unPinPage((BlobFile*)file, headerPageNum, false);
+
+        // Close the index file again before refusing it, since the destructor does not run
+        if(badIndexInfo || (nodeVersions != NULL && !bloomPageNums.empty())){
+            bufMgr->flushFile((BlobFile*)file);
+            delete file;
+            file = NULL;
+            delete nodeVersions;
+            nodeVersions = NULL;
+            throw BadIndexInfoException(badIndexInfo ? "Error: The index file is a bad file!"
+                                                     : "Error: A concurrent index cannot have a Bloom filter!");
+        }
         return;
 	}
 	else{
@@ -88,28 +483,89 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
 	// If the index file does not exist, allocate header page and first root page
 	bufMgr->allocPage((BlobFile*)file, headerPageNum, header_page);
 	bufMgr->allocPage((BlobFile*)file, rootPageNum, root_page);
-	initializeLeaf(root_page);
+	// An empty leaf looks the same for every fixed size key type, unless it is a covering leaf, whose capacity depends
+	// on the key type
+	if(attrType == STRING){
+	    initializeStringLeaf(reinterpret_cast<StringLeafNode*>(root_page));
+	}
+	else if(packedLeaves){
+	    initializePackedLeaf(reinterpret_cast<PackedLeafNode<int>*>(root_page));
+	}
+	else if(includedBytes > 0){
+	    switch(attrType){
+	    case INTEGER:
+	        initializeCoveringLeaf(reinterpret_cast<CoveringLeafNode<int>*>(root_page), includedBytes);
+	        break;
+	    case DOUBLE:
+	        initializeCoveringLeaf(reinterpret_cast<CoveringLeafNode<double>*>(root_page), includedBytes);
+	        break;
+	    default:
+	        initializeCoveringLeaf(reinterpret_cast<CoveringLeafNode<std::int64_t>*>(root_page), includedBytes);
+	        break;
+	    }
+	}
+	else{
+	    initializeLeaf<int>(root_page);
+	}
+	treeHeight = 1;
+	rootIsLeaf = true;
+	firstLeafPageNum = rootPageNum;
 	IndexMetaInfo* treeHeader = reinterpret_cast<IndexMetaInfo*>(header_page);
 	treeHeader->attrByteOffset = attrByteOffset;
 	treeHeader->attrType = attrType;
 	strcpy(treeHeader->relationName, relationName.c_str());
 	treeHeader->rootPageNo = rootPageNum;
+	treeHeader->height = treeHeight;
+	treeHeader->firstLeafPageNo = firstLeafPageNum;
+	treeHeader->includedCount = (int)includedColumns.size();
+	for(size_t i = 0; i < includedColumns.size(); i++){
+	    treeHeader->includedColumns[i] = includedColumns[i];
+	}
+	treeHeader->keyCount = (int)keyColumns.size();
+	for(size_t i = 0; i < keyColumns.size(); i++){
+	    treeHeader->keyColumns[i] = keyColumns[i];
+	}
+	treeHeader->bloomBitsPerKey = 0;
+	treeHeader->bloomPageCount = 0;
+	treeHeader->bloomKeyCount = 0;
 
 	// Unpin header page and root page and set dirty bits
 	bufMgr->unPinPage((BlobFile*)file, headerPageNum, true);
 	bufMgr->unPinPage((BlobFile*)file, rootPageNum, true);
 
-	{
+	// Sort the key&rid pairs of the relation and build the tree bottom-up. Sorted runs which do not fit in the
+	// sort memory go to a temporary file next to the index file. The sort does not carry included columns, so a
+	// covering index is built by inserts
+	if(options.bulkLoad && includedBytes == 0){
+	    std::string runFileName = outIndexName + ".sort";
+	    switch(attrType){
+	    case INTEGER:
+	        bulkLoadRelation<int>(relationName, runFileName, options);
+	        break;
+	    case DOUBLE:
+	        bulkLoadRelation<double>(relationName, runFileName, options);
+	        break;
+	    case INT64:
+	        bulkLoadRelation<std::int64_t>(relationName, runFileName, options);
+	        break;
+	    default:
+	        bulkLoadRelation<PaddedStringKey>(relationName, runFileName, options);
+	        break;
+	    }
+	}
+	else{
 	    // Scan the relation file to insert key&rid pairs
 	    FileScan fscan(relationName, bufMgrIn);
+	    std::vector<char> included(includedBytes);
+	    std::string encoded;
 	    try{
 	        RecordId scanRid;
 	        while(1){
                 fscan.scanNext(scanRid);
                 std::string recordStr = fscan.getRecord();
                 const char *record = recordStr.c_str();
-                int key = *((int*)(record + attrByteOffset));
-                insertEntry(&key, scanRid);
+                copyIncludedColumns(record, included.data());
+                insertEntry(recordKey(record, encoded), scanRid, included.data());
 	        }
 
 	    }
@@ -119,249 +575,876 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
 
 	}
 	// Close the relation file automatically
+
+	// The Bloom filter is built from the leaves once they hold the entries of the relation
+	if(options.bloomBitsPerKey > 0){
+	    bloomBitsPerKey = options.bloomBitsPerKey;
+	    bloomProbeCount = bloomProbes(bloomBitsPerKey);
+	    rebuildBloomFilter();
+	}
 }
 
 // -----------------------------------------------------------------------------
-// Helper Function: BTreeIndex::initializeNonLeaf
+// Helper Function: BTreeIndex::bulkLoadRelation
 // -----------------------------------------------------------------------------
-void BTreeIndex::initializeNonLeaf(Page* page){
-    // This function imply initializes a non-leaf node through setting its level to 0, and the number of keys to be 0
-    NonLeafNodeInt* non_leaf_node = reinterpret_cast<NonLeafNodeInt*>(page);
-    non_leaf_node->level = 0;
-    non_leaf_node->keySize = 0;
+template <class T>
+void BTreeIndex::bulkLoadRelation(const std::string& relationName, const std::string& runFileName, const IndexOptions& options){
+    ExternalSorter<T> sorter(bufMgr, runFileName, options.sortMemory, options.sortThreads);
+    readRelationEntries(relationName, sorter);
+    sorter.finish();
+    bulkLoad(sorter, options.fillFactor);
 }
 
 // -----------------------------------------------------------------------------
-// Helper Function: BTreeIndex::initializeLeaf
+// Helper Function: BTreeIndex::readRelationEntries
 // -----------------------------------------------------------------------------
-void BTreeIndex::initializeLeaf(Page* page){
-    // This function simply initializes a leaf node through setting the PageId of its right sibling to be an invalid page number
-    // and the number of keys to be zero
-    LeafNodeInt* leaf_node = reinterpret_cast<LeafNodeInt*>(page);
-    leaf_node->rightSibPageNo = Page::INVALID_NUMBER;
-    leaf_node->keySize = 0;
+template <class T>
+void BTreeIndex::readRelationEntries(const std::string& relationName, ExternalSorter<T>& sorter){
+    // Scan the relation file to collect key&rid pairs, the sorter spills them to sorted runs as needed
+    FileScan fscan(relationName, bufMgr);
+    std::string encoded;
+    try{
+        RecordId scanRid;
+        while(1){
+            fscan.scanNext(scanRid);
+            std::string recordStr = fscan.getRecord();
+            RIDKeyPair<T> entry;
+            entry.set(scanRid, keyValue<T>(recordKey(recordStr.c_str(), encoded)));
+            sorter.add(entry);
+        }
+    }
+    // Reach the end of the relation file
+    catch(const EndOfFileException &e){
+    }
 }
 
-
 // -----------------------------------------------------------------------------
-// Helper Function: BTreeIndex::findLeafNode
+// Helper Function: BTreeIndex::bulkLoad
 // -----------------------------------------------------------------------------
-void BTreeIndex::findLeafNode(int key, PageId& page_num, int& position, int& total_key){
-    // This function gets the entry and page for insertion
-
-    // Set up the root page number through the meta info from header page
-    Page* header_page;
-    IndexMetaInfo* treeHeader;
-    bufMgr->readPage((BlobFile*)file, headerPageNum, header_page);
-    bufMgr->unPinPage((BlobFile*)file, headerPageNum, false);
-    treeHeader = reinterpret_cast<IndexMetaInfo*>(header_page);
-    rootPageNum = treeHeader->rootPageNo;
-
-
-    // If the root page number is still 2, then the root node is the only (leaf) node in the tree.
-    // Treat the root page as a leaf node and locate the entry for insertion.
-    if(rootPageNum == (PageId)2){
-
-        // Return the page number of the root page, which is 2
-        page_num = rootPageNum;
-        Page* root_page;
-        bufMgr->readPage((BlobFile*)file, rootPageNum, root_page);
-        bufMgr->unPinPage((BlobFile*)file, rootPageNum, false);
-        LeafNodeInt* leaf_node = reinterpret_cast<LeafNodeInt*>(root_page);
+template <class T>
+void BTreeIndex::bulkLoad(ExternalSorter<T>& sorted, double fill_factor){
+    size_t entry_count = sorted.size();
+    if(entry_count == 0){
+        return;
+    }
 
-        // Return the total number of keys in the root (leaf) node
-        total_key = leaf_node->keySize;
+    // Spread the entries evenly over as few leaves as the fill factor allows. The empty root leaf becomes the
+    // first leaf, the next leaves are allocated one after the other, so leaves sit in key order in the file.
+    // Between two neighbouring nodes of a level, the last key of the left node is pushed up, like in a split.
+    // A leaf whose keys repeat enough to be worth posting lists goes on taking entries in that format, up to the
+    // fill factor in bytes, and the entries left are spread evenly again. Packed leaves start out with the entries
+    // which fit whatever they are, and go on taking entries up to the fill factor in bytes and in entries likewise
+    const int leaf_size = packedLeaves ? (int)PackedLeafNode<T>::SAFEENTRIES : NodeCapacity<T>::LEAF;
+    int per_leaf = std::max(1, (int)(leaf_size * fill_factor));
+    int posting_limit = (int)(PostingLeafNode<T>::DATASIZE * fill_factor);
+    int packed_limit = (int)(PackedLeafNode<T>::DATASIZE * fill_factor);
+    int packed_entries = std::max(per_leaf, (int)(PackedLeafNode<T>::MAXENTRIES * fill_factor));
+    std::vector<PageId> level_pages;
+    std::vector<T> level_keys;
 
-        // Locate the entry for insertion from left to right, assuming the keys are sorted
-        int i;
-        for(i = 0; i < leaf_node->keySize; i++){
-            if(leaf_node->keyArray[i] >= key){
-                break;
+    PageId leaf_num = rootPageNum;
+    PageId left_num = Page::INVALID_NUMBER;
+    Page* leaf_page;
+    bufMgr->readPage((BlobFile*)file, leaf_num, leaf_page);
+    RIDKeyPair<T> entry;
+    size_t remaining = entry_count;
+    bool pending = false;
+    std::vector<T> keys;
+    std::vector<RecordId> rids;
+    std::vector<Posting<T> > postings;
+    while(1){
+        LeafNode<T>* leaf_node = reinterpret_cast<LeafNode<T>*>(leaf_page);
+        initializeLeaf<T>(leaf_page);
+        leaf_node->leftSibPageNo = left_num;
+        int count = evenNodeSize(remaining, evenNodeCount(remaining, per_leaf), 0);
+        keys.resize(count);
+        rids.resize(count);
+        for(int i = 0; i < count; i++){
+            if(!pending){
+                sorted.next(entry);
+            }
+            pending = false;
+            keys[i] = entry.key;
+            rids[i] = entry.rid;
+        }
+        remaining -= count;
+        if(packedLeaves){
+            fillPackedLeaf(sorted, keys, rids, packed_limit, packed_entries, remaining, entry, pending);
+            encodePackedLeaf(reinterpret_cast<PackedLeafNode<T>*>(leaf_page), keys.data(), rids.data(), (int)keys.size());
+        }
+        else{
+            groupPostings(keys.data(), rids.data(), count, postings);
+            if(preferPostings(postings, 0, (int)postings.size())){
+                fillLeafPostings(sorted, postings, posting_limit, remaining, entry, pending);
             }
+            spillPostings(postings);
+            encodeLeaf(leaf_page, postings, 0, (int)postings.size());
+        }
+        level_pages.push_back(leaf_num);
+        if(remaining == 0){
+            break;
         }
+        level_keys.push_back(packedLeaves ? keys.back() : postings.back().key);
 
-        // Return the location of the entry
-        position = i;
-        return;
+        // Allocate the right sibling before the leaf is unpinned, so the leaf can link to it
+        PageId sibling_num;
+        Page* sibling_page;
+        bufMgr->allocPage((BlobFile*)file, sibling_num, sibling_page);
+        leaf_node->rightSibPageNo = sibling_num;
+        leaf_node->highKey = level_keys.back();
+        bufMgr->unPinPage((BlobFile*)file, leaf_num, true);
+        left_num = leaf_num;
+        leaf_num = sibling_num;
+        leaf_page = sibling_page;
     }
+    bufMgr->unPinPage((BlobFile*)file, leaf_num, true);
 
-    // If the root page number is not 2, it means the root node is non-leaf node, which must be non-empty
-    // Treat the root page as an non-leaf node, and try to find the location for insertion recursively from
-    // root to bottom
-    PageId temp_num = rootPageNum;
-    while(1){
-        Page* temp_page;
-        bufMgr->readPage((BlobFile*)file, temp_num, temp_page);
-        bufMgr->unPinPage((BlobFile*)file, temp_num, false);
-        NonLeafNodeInt* non_leaf_node = reinterpret_cast<NonLeafNodeInt*>(temp_page);
-        int i;
-        for(i = 0; i < non_leaf_node->keySize; i++){
-            if(non_leaf_node->keyArray[i] >= key){
+    // Build the non-leaf levels from the pages and keys of the level below, until a level has one node. Every
+    // node has at least three children, so no node of an even spread is left with a single child. Like a leaf, a
+    // node links to its right sibling, allocated before the node is unpinned
+    int per_node = std::max(3, (int)(NodeCapacity<T>::NONLEAF * fill_factor) + 1);
+    int level = 1;
+    while(level_pages.size() > 1){
+        std::vector<PageId> upper_pages;
+        std::vector<T> upper_keys;
+        int node_count = evenNodeCount(level_pages.size(), per_node);
+        size_t child = 0;
+        PageId node_num;
+        Page* node_page;
+        bufMgr->allocPage((BlobFile*)file, node_num, node_page);
+        for(int node = 0; node < node_count; node++){
+            NonLeafNode<T>* non_leaf_node = reinterpret_cast<NonLeafNode<T>*>(node_page);
+            initializeNonLeaf<T>(node_page);
+            non_leaf_node->level = level;
+            int children = evenNodeSize(level_pages.size(), node_count, node);
+            non_leaf_node->keySize = children - 1;
+            for(int i = 0; i < children; i++, child++){
+                non_leaf_node->pageNoArray[i] = level_pages[child];
+                if(i + 1 < children){
+                    non_leaf_node->keyArray[i] = level_keys[child];
+                }
+            }
+            upper_pages.push_back(node_num);
+            if(node + 1 == node_count){
+                bufMgr->unPinPage((BlobFile*)file, node_num, true);
                 break;
             }
+            upper_keys.push_back(level_keys[child - 1]);
+            PageId sibling_num;
+            Page* sibling_page;
+            bufMgr->allocPage((BlobFile*)file, sibling_num, sibling_page);
+            non_leaf_node->rightSibPageNo = sibling_num;
+            non_leaf_node->highKey = upper_keys.back();
+            bufMgr->unPinPage((BlobFile*)file, node_num, true);
+            node_num = sibling_num;
+            node_page = sibling_page;
         }
-        temp_num = non_leaf_node->pageNoArray[i];
-
-        // If the non-leaf node is above leaf node, treat its child as a leaf nodes
-        // The temp_num currently store the page number of the leaf node
-        if(non_leaf_node->level == 1){
-            page_num = temp_num;
-            Page* leaf_page;
-            bufMgr->readPage((BlobFile*)file, temp_num, leaf_page);
-            bufMgr->unPinPage((BlobFile*)file, temp_num, false);
-            LeafNodeInt* leaf_node = reinterpret_cast<LeafNodeInt*>(leaf_page);
+        level_pages.swap(upper_pages);
+        level_keys.swap(upper_keys);
+        level = 0;
+        treeHeight++;
+    }
 
-            // Return the total number of keys in the leaf node before insertion
-            total_key = leaf_node->keySize;
+    // The node of the top level is the root, write it back to the header page
+    rootPageNum = level_pages[0];
+    rootIsLeaf = (treeHeight == 1);
+    resident.clear();
+    writeMetaInfo();
+}
 
-            int j;
-            for(j = 0; j < leaf_node->keySize; j++){
-                if(leaf_node->keyArray[j] >= key){
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::fillLeafPostings
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::fillLeafPostings(ExternalSorter<T>& sorted, std::vector<Posting<T> >& postings, int limit,
+                                  size_t& remaining, RIDKeyPair<T>& entry, bool& pending){
+    // The bytes are counted like postingLeafBytes as entries come in. Only the last posting grows, and once its
+    // record ids take more than INLINEBYTES it only takes its slot in the node, its record ids going to overflow
+    // pages a chunk at a time
+    const size_t chunk = PostingOverflowPage::DATASIZE;
+    int bytes = postingLeafBytes(postings, 0, (int)postings.size());
+    int last_bytes = ridListBytes(postings.back().rids.data(), (int)postings.back().rids.size());
+    bool last_spilled = last_bytes > PostingLeafNode<T>::INLINEBYTES;
+    PageId last_overflow_num = Page::INVALID_NUMBER;
+    while(remaining > 0){
+        sorted.next(entry);
+        Posting<T>& last = postings.back();
+        if(!(last.key < entry.key)){
+            if(!last_spilled){
+                int grown = last_bytes + ridDeltaBytes(last.rids.back(), entry.rid);
+                last_spilled = grown > PostingLeafNode<T>::INLINEBYTES;
+                int added = last_spilled ? -last_bytes : grown - last_bytes;
+                if(bytes + added > limit){
+                    pending = true;
                     break;
                 }
+                bytes += added;
+                last_bytes = grown;
             }
+            last.rids.push_back(entry.rid);
+            last.ridCount++;
+            remaining--;
+            if(last_spilled && last.rids.size() >= chunk){
+                appendOverflowRids(last.overflowPageNo, last_overflow_num, last.rids.data(), (int)last.rids.size());
+                last.rids.clear();
+            }
+            continue;
+        }
 
-            // Return the entry
-            position = j;
-            return;
+        // A new key takes a slot and its first record id
+        int added = sizeof(PostingSlot<T>) + ridListBytes(&entry.rid, 1);
+        if(bytes + added > limit){
+            pending = true;
+            break;
+        }
+        if(last_spilled && last.overflowPageNo != Page::INVALID_NUMBER){
+            appendOverflowRids(last.overflowPageNo, last_overflow_num, last.rids.data(), (int)last.rids.size());
+            last.rids.clear();
         }
+        Posting<T> posting;
+        posting.key = entry.key;
+        posting.ridCount = 1;
+        posting.overflowPageNo = Page::INVALID_NUMBER;
+        posting.rids.push_back(entry.rid);
+        postings.push_back(posting);
+        bytes += added;
+        last_bytes = added - sizeof(PostingSlot<T>);
+        last_spilled = false;
+        last_overflow_num = Page::INVALID_NUMBER;
+        remaining--;
     }
-}
 
+    // Write out the rest of the record ids of a last key whose first chunks are already in overflow pages, the
+    // entry which did not fit being left pending
+    Posting<T>& last = postings.back();
+    if(last_spilled && last.overflowPageNo != Page::INVALID_NUMBER){
+        appendOverflowRids(last.overflowPageNo, last_overflow_num, last.rids.data(), (int)last.rids.size());
+        last.rids.clear();
+    }
+}
 
 // -----------------------------------------------------------------------------
-// Helper Function: BTreeIndex::findParentNode
+// Helper Function: BTreeIndex::fillPackedLeaf
 // -----------------------------------------------------------------------------
-void BTreeIndex::findParentNode(PageId child_page_num, int key, PageId& parent_page_num, int& position, int& total_key){
-    // This function gets the entry to insert the pushing-up key from a child node, assuming the child node splits
-
-    // Set up the root page number through the meta info from header page
-    Page* header_page;
-    IndexMetaInfo* treeHeader;
-    bufMgr->readPage((BlobFile*)file, headerPageNum, header_page);
-    bufMgr->unPinPage((BlobFile*)file, headerPageNum, false);
-    treeHeader = reinterpret_cast<IndexMetaInfo*>(header_page);
-    rootPageNum = treeHeader->rootPageNo;
+template <class T>
+void BTreeIndex::fillPackedLeaf(ExternalSorter<T>& sorted, std::vector<T>& keys, std::vector<RecordId>& rids, int limit,
+                                int max_entries, size_t& remaining, RIDKeyPair<T>& entry, bool& pending){
+    // The bounds of the entries grow as entries come in, and tell the bytes of the leaf with the next entry
+    PackedBounds<T> bounds;
+    for(size_t i = 0; i < keys.size(); i++){
+        bounds.add(keys[i], rids[i]);
+    }
+    while(remaining > 0 && (int)keys.size() < max_entries){
+        sorted.next(entry);
+        PackedBounds<T> grown = bounds;
+        grown.add(entry.key, entry.rid);
+        if(grown.bytes() > limit){
+            pending = true;
+            break;
+        }
+        bounds = grown;
+        keys.push_back(entry.key);
+        rids.push_back(entry.rid);
+        remaining--;
+    }
+}
 
-    //If the child node is already the root node, return a invalid page number and exit
-    if(child_page_num == rootPageNum){
-        parent_page_num = Page::INVALID_NUMBER;
-        position = 0;
-        total_key = 0;
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::bulkLoad (STRING)
+// -----------------------------------------------------------------------------
+void BTreeIndex::bulkLoad(ExternalSorter<PaddedStringKey>& sorted, double fill_factor){
+    if(sorted.size() == 0){
         return;
     }
 
-    //if child node is not root node, then find the parent node recursively from root to bottom
-    PageId temp_num = rootPageNum;
-    while(1){
-        Page* temp_page;
-        NonLeafNodeInt* non_leaf_node;
-        bufMgr->readPage((BlobFile*)file, temp_num, temp_page);
-        bufMgr->unPinPage((BlobFile*)file, temp_num, false);
-        non_leaf_node = reinterpret_cast<NonLeafNodeInt*>(temp_page);
-        int i;
-        for(i = 0; i < non_leaf_node->keySize; i++){
-            if(non_leaf_node->keyArray[i] > key){
-                break;
-            }
+    // Fill the leaves from left to right with as many keys as fit in the fill factor of the data area. The empty
+    // root leaf becomes the first leaf, and the last key of every leaf but the last one is pushed up. The keys
+    // of the leaf being filled are kept until the next key does not fit anymore, with the common prefix of the
+    // leaf being the common prefix of its first and last key
+    int leaf_limit = (int)(StringLeafNode::DATASIZE * fill_factor);
+    std::vector<PageId> level_pages;
+    std::vector<std::string> level_keys;
+    std::vector<std::string> keys;
+    std::vector<RecordId> rids;
+    int key_bytes = 0;
+    PageId leaf_num = rootPageNum;
+    PageId left_num = Page::INVALID_NUMBER;
+    Page* leaf_page;
+    bufMgr->readPage((BlobFile*)file, leaf_num, leaf_page);
+    RIDKeyPair<PaddedStringKey> entry;
+    while(sorted.next(entry)){
+        std::string key(entry.key.bytes, entry.key.length());
+        int key_count = (int)keys.size() + 1;
+        int new_bytes = key_bytes + (int)(sizeof(StringLeafSlot) + key.size());
+        int prefix_length = keys.empty() ? 0 : commonPrefixLength(keys[0], key);
+        if(!keys.empty() && new_bytes - (key_count - 1) * prefix_length > leaf_limit){
+            StringLeafNode* leaf_node = reinterpret_cast<StringLeafNode*>(leaf_page);
+            initializeStringLeaf(leaf_node);
+            leaf_node->leftSibPageNo = left_num;
+            encodeStringNode(leaf_node, keys, rids, 0, (int)keys.size());
+            level_pages.push_back(leaf_num);
+            level_keys.push_back(keys.back());
+            PageId sibling_num;
+            Page* sibling_page;
+            bufMgr->allocPage((BlobFile*)file, sibling_num, sibling_page);
+            leaf_node->rightSibPageNo = sibling_num;
+            bufMgr->unPinPage((BlobFile*)file, leaf_num, true);
+            left_num = leaf_num;
+            leaf_num = sibling_num;
+            leaf_page = sibling_page;
+            keys.clear();
+            rids.clear();
+            new_bytes = (int)(sizeof(StringLeafSlot) + key.size());
         }
+        keys.push_back(key);
+        rids.push_back(entry.rid);
+        key_bytes = new_bytes;
+    }
+    StringLeafNode* last_leaf = reinterpret_cast<StringLeafNode*>(leaf_page);
+    initializeStringLeaf(last_leaf);
+    last_leaf->leftSibPageNo = left_num;
+    encodeStringNode(last_leaf, keys, rids, 0, (int)keys.size());
+    level_pages.push_back(leaf_num);
+    bufMgr->unPinPage((BlobFile*)file, leaf_num, true);
 
-        //if the temp node is the parent of the current node, return the information of the parent node and exit
-        if(non_leaf_node->pageNoArray[i] == child_page_num){
-            parent_page_num = temp_num;
-            total_key = non_leaf_node->keySize;
-            position = i;
-            return;
-        }
-        else{
-            // If the temp node is not the parent, then goes one depth down
-            temp_num = non_leaf_node->pageNoArray[i];
-        }
+    // Build the non-leaf levels. A node takes the children from its first child on, and the keys between them as
+    // long as the keys fit; the key after its last child is pushed up. The limit leaves room for at least three keys
+    int node_limit = std::max((int)(StringNonLeafNode::DATASIZE * fill_factor),
+                              3 * (int)(sizeof(StringNonLeafSlot) + STRINGKEYMAXSIZE) + STRINGKEYMAXSIZE);
+    int level = 1;
+    while(level_pages.size() > 1){
+        std::vector<PageId> upper_pages;
+        std::vector<std::string> upper_keys;
+        int child_count = (int)level_pages.size();
+        int child = 0;
+
+        // The child on the right of key i of the level is child i + 1
+        std::vector<PageId> children(level_pages.begin() + 1, level_pages.end());
+        while(child < child_count){
+            int key_count = stringKeysFitting<StringNonLeafNode>(level_keys, child, child_count - 1, node_limit);
+
+            // Leave at least two children for the next node, so it does not end up without keys
+            if(child + key_count + 1 == child_count - 1){
+                key_count--;
+            }
 
+            PageId node_num;
+            Page* node_page;
+            bufMgr->allocPage((BlobFile*)file, node_num, node_page);
+            StringNonLeafNode* non_leaf_node = reinterpret_cast<StringNonLeafNode*>(node_page);
+            initializeStringNonLeaf(non_leaf_node, level);
+            non_leaf_node->leftmostPageNo = level_pages[child];
+            encodeStringNode(non_leaf_node, level_keys, children, child, child + key_count);
+            bufMgr->unPinPage((BlobFile*)file, node_num, true);
+            upper_pages.push_back(node_num);
+            child += key_count + 1;
+            if(child < child_count){
+                upper_keys.push_back(level_keys[child - 1]);
+            }
+        }
+        level_pages.swap(upper_pages);
+        level_keys.swap(upper_keys);
+        level = 0;
+        treeHeight++;
     }
 
+    rootPageNum = level_pages[0];
+    rootIsLeaf = (treeHeight == 1);
+    writeMetaInfo();
 }
 
-
 // -----------------------------------------------------------------------------
-// Helper Function: BTreeIndex::modifyLeafNode
+// Helper Function: BTreeIndex::initializeNonLeaf
 // -----------------------------------------------------------------------------
-void BTreeIndex::modifyLeafNode(PageId page_num, int key, RecordId rid, int position, int total_key,
-                        PageId& left_node_num, PageId& right_node_num, int& push_up_key){
-    // This function modifies a specific leaf node when a pair of key&rid inserts into a given position
+template <class T>
+void BTreeIndex::initializeNonLeaf(Page* page){
+    // This function imply initializes a non-leaf node through setting its level to 0, and the number of keys to be 0,
+    // with no right sibling
+    NonLeafNode<T>* non_leaf_node = reinterpret_cast<NonLeafNode<T>*>(page);
+    non_leaf_node->level = 0;
+    non_leaf_node->keySize = 0;
+    non_leaf_node->rightSibPageNo = Page::INVALID_NUMBER;
+    non_leaf_node->highKey = T();
+}
 
-    // If the leaf node is not full before insertion, do not split, just insert, increment its size and exit
-    if(total_key < INTARRAYLEAFSIZE){
-        Page* leaf_page;
-        LeafNodeInt* leaf_node;
-        bufMgr->readPage((BlobFile*)file, page_num, leaf_page);
-        leaf_node = reinterpret_cast<LeafNodeInt*>(leaf_page);
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::initializeLeaf
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::initializeLeaf(Page* page){
+    // This function simply initializes a leaf node through setting the PageId of its right sibling to be an invalid page number
+    // and the number of keys to be zero, in the ENTRY_LIST format
+    LeafNode<T>* leaf_node = reinterpret_cast<LeafNode<T>*>(page);
+    leaf_node->rightSibPageNo = Page::INVALID_NUMBER;
+    leaf_node->leftSibPageNo = Page::INVALID_NUMBER;
+    leaf_node->highKey = T();
+    leaf_node->keySize = 0;
+    leaf_node->format = ENTRY_LIST;
+}
 
-        // Shift keys and rids to the right of the given position one position to the right
-        for(int i = total_key; i > position; i--){
-            leaf_node->keyArray[i] = leaf_node->keyArray[i-1];
-            leaf_node->ridArray[i] = leaf_node->ridArray[i-1];
-        }
-        leaf_node->keyArray[position] = key;
-        leaf_node->ridArray[position] = rid;
-        leaf_node->keySize = leaf_node->keySize + 1;
-        bufMgr->unPinPage((BlobFile*)file, page_num, true);
 
-        left_node_num = page_num;
-        right_node_num = Page::INVALID_NUMBER;
-        push_up_key = -1;
-        return;
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::setLeftSibling
+// -----------------------------------------------------------------------------
+template <class Leaf>
+void BTreeIndex::setLeftSibling(PageId page_num, PageId left_num){
+    // The node of a concurrent index is locked meanwhile, the node on its left being locked by the caller
+    Page* page;
+    if(nodeVersions != NULL){
+        nodeVersions->lock(page_num);
     }
+    bufMgr->readPage((BlobFile*)file, page_num, page);
+    reinterpret_cast<Leaf*>(page)->leftSibPageNo = left_num;
+    bufMgr->unPinPage((BlobFile*)file, page_num, true);
+    if(nodeVersions != NULL){
+        nodeVersions->unlock(page_num);
+    }
+}
 
-    //if the leaf node is full before insertion, then split
-    else{
-        Page* left_page;
-        Page* right_page;
-        LeafNodeInt* left_node;
-        LeafNodeInt* right_node;
-        PageId temp_right_num;
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::linkSplitLeaf
+// -----------------------------------------------------------------------------
+template <class T, class Leaf>
+void BTreeIndex::linkSplitLeaf(PageId left_num, Leaf* left_node, PageId right_num, Leaf* right_node){
+    // The old right sibling may be a leaf node of another format, which has the same sibling links
+    right_node->rightSibPageNo = left_node->rightSibPageNo;
+    right_node->leftSibPageNo = left_num;
+    right_node->highKey = left_node->highKey;
+    left_node->rightSibPageNo = right_num;
+    if(right_node->rightSibPageNo != Page::INVALID_NUMBER){
+        setLeftSibling<LeafNode<T> >(right_node->rightSibPageNo, right_num);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::descendToLeaf
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::descendToLeaf(T key, NodePath* path, PageId& page_num, Page*& leaf_page, bool upper){
+    // This function walks from the root to the leaf which should hold the given key, recording the
+    // non-leaf nodes it passes through, and returns the leaf page still pinned
+
+    if(path != NULL){
+        path->depth = 0;
+    }
+
+    // If the root node is a non-leaf node, it must be non-empty. Go one level down at a time, following
+    // the first key greater than or equal to the given key (greater than it if upper), until the non-leaf
+    // node above the leaf nodes is passed. Otherwise the root node is the only (leaf) node in the tree.
+    // The top levels are searched in their resident copies, if there are any, and only the levels below them are
+    // read from the buffer pool
+    PageId temp_num = rootPageNum;
+    if(!rootIsLeaf){
+        int depth = residentLevelCount > 0 ? descendResidentLevels(key, path, temp_num, upper) : 0;
+        while(depth < treeHeight - 1){
+            Page* temp_page;
+            bufMgr->readPage((BlobFile*)file, temp_num, temp_page);
+            NonLeafNode<T>* non_leaf_node = reinterpret_cast<NonLeafNode<T>*>(temp_page);
+            int i = upper ? upperBound(non_leaf_node->keyArray, non_leaf_node->keySize, key)
+                          : lowerBound(non_leaf_node->keyArray, non_leaf_node->keySize, key);
+            if(path != NULL){
+                PathEntry& entry = path->entries[path->depth++];
+                entry.pageNo = temp_num;
+                entry.position = i;
+                entry.keySize = non_leaf_node->keySize;
+            }
+            PageId child_num = non_leaf_node->pageNoArray[i];
+            int level = non_leaf_node->level;
+            bufMgr->unPinPage((BlobFile*)file, temp_num, false);
+            temp_num = child_num;
+            depth++;
+
+            // If the non-leaf node is above leaf node, its child is the leaf node
+            if(level == 1){
+                break;
+            }
+        }
+    }
+
+    // Return the leaf node pinned
+    page_num = temp_num;
+    bufMgr->readPage((BlobFile*)file, page_num, leaf_page);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::buildResidentLevels
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::buildResidentLevels(){
+    // Read the levels from the root down into temporary arrays, one level at a time as long as it fits along with
+    // the levels above it. The children of the nodes of a level, in order, are the nodes of the next level. The
+    // build of a concurrent index gives up as soon as a writer holds one of the nodes, or the header page recording
+    // the root and the height, and leaves the copies unbuilt. Writers then wait for residentLatch while holding
+    // nodes, but the build never waits for them
+    std::uint64_t header_version = 0;
+    if(nodeVersions != NULL){
+        header_version = nodeVersions->read(headerPageNum);
+        if(NodeVersions::locked(header_version)){
+            return;
+        }
+    }
+    std::vector<PageId> level_pages;
+    std::vector<PageId> node_pages;
+    std::vector<int> key_sizes;
+    std::vector<T> keys;
+    std::vector<PageId> children;
+    int max_levels = rootIsLeaf ? 0 : std::min(residentLevelCount, treeHeight - 1);
+    int levels = 0;
+    int bottom_start = 0;
+    level_pages.push_back(rootPageNum);
+    while(levels < max_levels && node_pages.size() + level_pages.size() <= (size_t)MAXRESIDENTNODES){
+        std::vector<PageId> child_pages;
+        bottom_start = (int)node_pages.size();
+        for(size_t i = 0; i < level_pages.size(); i++){
+            std::uint64_t version = 0;
+            if(nodeVersions != NULL){
+                version = nodeVersions->read(level_pages[i]);
+                if(NodeVersions::locked(version)){
+                    return;
+                }
+            }
+            Page* page;
+            bufMgr->readPage((BlobFile*)file, level_pages[i], page);
+            const NonLeafNode<T>* non_leaf_node = reinterpret_cast<const NonLeafNode<T>*>(page);
+            int key_size = std::max(0, std::min(non_leaf_node->keySize, (int)NodeCapacity<T>::NONLEAF));
+            node_pages.push_back(level_pages[i]);
+            key_sizes.push_back(key_size);
+            keys.insert(keys.end(), non_leaf_node->keyArray, non_leaf_node->keyArray + key_size);
+            children.insert(children.end(), non_leaf_node->pageNoArray, non_leaf_node->pageNoArray + key_size + 1);
+            child_pages.insert(child_pages.end(), non_leaf_node->pageNoArray, non_leaf_node->pageNoArray + key_size + 1);
+            bufMgr->unPinPage((BlobFile*)file, level_pages[i], false);
+            if(nodeVersions != NULL && !nodeVersions->validate(level_pages[i], version)){
+                return;
+            }
+        }
+        level_pages.swap(child_pages);
+        levels++;
+    }
+
+    // Copy them into place. The children of a node above the bottom level come right after those of the node
+    // before it, starting with the node after the root. Concurrent readers may search the copies any time, so
+    // their room is made once for all
+    int node_count = (int)node_pages.size();
+    if(nodeVersions != NULL){
+        if(!nodeVersions->validate(headerPageNum, header_version)){
+            return;
+        }
+        resident.reserve(sizeof(T), NodeCapacity<T>::NONLEAF);
+    }
+    resident.reset(sizeof(T), NodeCapacity<T>::NONLEAF, node_count, levels);
+    int next_child = 1;
+    size_t key_offset = 0;
+    size_t child_offset = 0;
+    for(int node = 0; node < node_count; node++){
+        int first_child = -1;
+        if(node < bottom_start){
+            first_child = next_child;
+            next_child += key_sizes[node] + 1;
+        }
+        resident.setNode(node, node_pages[node], first_child, keys.data() + key_offset, key_sizes[node],
+                         children.data() + child_offset);
+        key_offset += key_sizes[node];
+        child_offset += key_sizes[node] + 1;
+    }
+    resident.finish();
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::descendResidentLevels
+// -----------------------------------------------------------------------------
+template <class T>
+int BTreeIndex::descendResidentLevels(T key, NodePath* path, PageId& page_num, bool upper){
+    if(!resident.built()){
+        buildResidentLevels<T>();
+    }
+
+    // Follow the same keys as descendToLeaf does in the pages, going from a copy to the copy of its child
+    int node = 0;
+    for(int depth = 0; depth < resident.levels(); depth++){
+        const T* keys = resident.keys<T>(node);
+        int key_size = resident.keySize(node);
+        int i = upper ? upperBound(keys, key_size, key) : lowerBound(keys, key_size, key);
+        if(path != NULL){
+            PathEntry& entry = path->entries[path->depth++];
+            entry.pageNo = resident.pageNo(node);
+            entry.position = i;
+            entry.keySize = key_size;
+        }
+        page_num = resident.childPageNos(node)[i];
+        node = resident.child(node, i);
+    }
+    return resident.levels();
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::updateResidentNode
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::updateResidentNode(PageId page_num, const NonLeafNode<T>* node, bool split){
+    // A concurrent insert holding the node waits for a build of the copies to finish or give up
+    std::unique_lock<std::mutex> guard(residentLatch, std::defer_lock);
+    if(nodeVersions != NULL){
+        guard.lock();
+    }
+
+    // The copies of the children of a node above the bottom resident level follow each other, so a child it gains
+    // or loses has no place among them, and neither has a node the split gives keys to
+    int position = resident.find(page_num);
+    if(position < 0){
+        return;
+    }
+    if(resident.onBottomLevel(position) && !split){
+        resident.patchNode(position, node->keyArray, node->keySize, node->pageNoArray);
+    }
+    else{
+        resident.clear();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::refreshResidentNode
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::refreshResidentNode(PageId page_num){
+    if(resident.find(page_num) < 0){
+        return;
+    }
+    Page* page;
+    bufMgr->readPage((BlobFile*)file, page_num, page);
+    updateResidentNode(page_num, reinterpret_cast<const NonLeafNode<T>*>(page), false);
+    bufMgr->unPinPage((BlobFile*)file, page_num, false);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::descendOptimistic
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::descendOptimistic(T key, NodePath* path, PageId& page_num){
+    // The root and the height only change while the header page, which records them, is locked. The resident
+    // copies are searched like one node with a version of its own, built by whoever gets hold of residentLatch
+    // first. A node read while a writer changes it may be torn, so the sizes and positions read are kept within
+    // bounds until the version shows whether they count
+    PageId temp_num;
+    int height;
+    int depth;
+    while(1){
+        std::uint64_t header_version = nodeVersions->read(headerPageNum);
+        if(NodeVersions::locked(header_version)){
+            std::this_thread::yield();
+            continue;
+        }
+        temp_num = rootPageNum;
+        height = treeHeight;
+        depth = 0;
+        if(path != NULL){
+            path->depth = 0;
+        }
+        bool resident_read = false;
+        bool resident_valid = true;
+        std::uint64_t resident_version = 0;
+        if(height > 1 && residentLevelCount > 0){
+            if(!resident.built() && residentLatch.try_lock()){
+                if(!resident.built()){
+                    buildResidentLevels<T>();
+                }
+                residentLatch.unlock();
+            }
+            resident_version = resident.version();
+            if(!ResidentLevels::changing(resident_version) && resident.built()){
+                int levels = std::min(resident.levels(), MAXTREEHEIGHT);
+                int node = 0;
+                for(; depth < levels; depth++){
+                    int key_size = std::max(0, std::min(resident.keySize(node), resident.keyCapacity()));
+                    int i = lowerBound(resident.keys<T>(node), key_size, key);
+                    if(path != NULL){
+                        PathEntry& entry = path->entries[path->depth++];
+                        entry.pageNo = resident.pageNo(node);
+                        entry.position = i;
+                        entry.keySize = key_size;
+                    }
+                    temp_num = resident.childPageNos(node)[i];
+                    node = resident.child(node, i);
+                    if(depth + 1 < levels && (node < 0 || node >= resident.capacity())){
+                        resident_valid = false;
+                        break;
+                    }
+                }
+                resident_read = true;
+            }
+        }
+        if(resident_valid && (!resident_read || resident.validate(resident_version)) &&
+           nodeVersions->validate(headerPageNum, header_version)){
+            break;
+        }
+    }
+
+    // Then every node is read until its version shows no writer changed it meanwhile, and only that node is read
+    // again otherwise. A node keeps the keys up to its high key, so once a key is above it, it went to a node on the
+    // right, which the right link leads to. Keys never move left, so the node a parent led to still has the key or
+    // links on to it, and the parent needs no validating after that
+    while(depth < height - 1){
+        std::uint64_t version = nodeVersions->read(temp_num);
+        if(NodeVersions::locked(version)){
+            std::this_thread::yield();
+            continue;
+        }
+        Page* temp_page;
+        bufMgr->readPage((BlobFile*)file, temp_num, temp_page);
+        const NonLeafNode<T>* non_leaf_node = reinterpret_cast<const NonLeafNode<T>*>(temp_page);
+        int key_size = std::max(0, std::min(non_leaf_node->keySize, (int)NodeCapacity<T>::NONLEAF));
+        int i = lowerBound(non_leaf_node->keyArray, key_size, key);
+        PageId child_num = non_leaf_node->pageNoArray[i];
+        PageId sibling_num = non_leaf_node->rightSibPageNo;
+        bool beyond = sibling_num != Page::INVALID_NUMBER && non_leaf_node->highKey < key;
+        int level = non_leaf_node->level;
+        bufMgr->unPinPage((BlobFile*)file, temp_num, false);
+        if(!nodeVersions->validate(temp_num, version)){
+            continue;
+        }
+        if(beyond){
+            temp_num = sibling_num;
+            continue;
+        }
+        if(path != NULL){
+            PathEntry& entry = path->entries[path->depth++];
+            entry.pageNo = temp_num;
+            entry.position = i;
+            entry.keySize = key_size;
+        }
+        temp_num = child_num;
+        depth++;
+        if(level == 1){
+            break;
+        }
+    }
+    page_num = temp_num;
+}
+
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::findLeafNode
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::findLeafNode(T key, PageId& page_num, int& position, int& total_key){
+    // This function gets the entry and page for insertion
+    Page* leaf_page;
+    descendToLeaf(key, NULL, page_num, leaf_page);
+
+    // Return the total number of keys in the leaf node before insertion, and the entry for insertion,
+    // the first key greater than or equal to the given key
+    total_key = leafEntryCount<T>(leaf_page);
+    position = leafBound(leaf_page, key, false);
+    bufMgr->unPinPage((BlobFile*)file, page_num, false);
+}
+
+template void BTreeIndex::findLeafNode<int>(int key, PageId& page_num, int& position, int& total_key);
+template void BTreeIndex::findLeafNode<double>(double key, PageId& page_num, int& position, int& total_key);
+template void BTreeIndex::findLeafNode<std::int64_t>(std::int64_t key, PageId& page_num, int& position, int& total_key);
+
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::modifyLeafNode
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::modifyLeafNode(PageId page_num, Page* leaf_page, T key, RecordId rid, int position, int total_key,
+                        PageId& left_node_num, PageId& right_node_num, T& push_up_key, double left_fill){
+    const int leaf_size = NodeCapacity<T>::LEAF;
+
+    // This function modifies a specific leaf node when a pair of key&rid inserts into a given position.
+    // The leaf page is already pinned by the caller and gets unpinned here
+    left_node_num = page_num;
+    if(reinterpret_cast<LeafNode<T>*>(leaf_page)->format == POSTING_LIST){
+        insertPostingEntry(page_num, leaf_page, key, rid, right_node_num, push_up_key, left_fill);
+        return;
+    }
+    if(reinterpret_cast<LeafNode<T>*>(leaf_page)->format == PACKED_LIST){
+        insertPackedEntry(page_num, leaf_page, key, rid, position, right_node_num, push_up_key, left_fill);
+        return;
+    }
+
+    // If the leaf node is not full before insertion, do not split, just insert, increment its size and exit
+    if(total_key < leaf_size){
+        LeafNode<T>* leaf_node;
+        leaf_node = reinterpret_cast<LeafNode<T>*>(leaf_page);
+
+        // Shift keys and rids to the right of the given position one position to the right
+        for(int i = total_key; i > position; i--){
+            leaf_node->keyArray[i] = leaf_node->keyArray[i-1];
+            leaf_node->ridArray[i] = leaf_node->ridArray[i-1];
+        }
+        leaf_node->keyArray[position] = key;
+        leaf_node->ridArray[position] = rid;
+        leaf_node->keySize = leaf_node->keySize + 1;
+        bufMgr->unPinPage((BlobFile*)file, page_num, true);
+
+        left_node_num = page_num;
+        right_node_num = Page::INVALID_NUMBER;
+        return;
+    }
+
+    // If the leaf node is full before insertion, and its keys repeat so much that posting lists take at most half the
+    // bytes, it turns into a POSTING_LIST leaf instead of splitting
+    std::vector<Posting<T> > postings;
+    decodeLeaf<T>(leaf_page, postings);
+    addPostingEntry(postings, key, rid);
+    if(preferPostings(postings, 0, (int)postings.size())){
+        writeLeafPostings(page_num, leaf_page, postings, right_node_num, push_up_key, left_fill);
+        return;
+    }
+
+    //if the leaf node is full before insertion, then split
+    {
+        Page* left_page = leaf_page;
+        Page* right_page;
+        LeafNode<T>* left_node;
+        LeafNode<T>* right_node;
+        PageId temp_right_num;
 
-        bufMgr->readPage((BlobFile*)file, page_num, left_page);
         bufMgr->allocPage((BlobFile*)file, temp_right_num, right_page);//allocate a new page as the right node after the splitting
 
-        initializeLeaf(right_page);
-        left_node = reinterpret_cast<LeafNodeInt*>(left_page);
-        right_node = reinterpret_cast<LeafNodeInt*>(right_page);
+        initializeLeaf<T>(right_page);
+        left_node = reinterpret_cast<LeafNode<T>*>(left_page);
+        right_node = reinterpret_cast<LeafNode<T>*>(right_page);
 
-        right_node->rightSibPageNo = left_node->rightSibPageNo;
-        left_node->rightSibPageNo = temp_right_num;
+        linkSplitLeaf<T>(page_num, left_node, temp_right_num, right_node);
+        PageId left_sibling_num = left_node->leftSibPageNo;
 
         left_node_num = page_num;
         right_node_num = temp_right_num;
 
         // Store the keys are rids including inserted key&rid pair into temporary arrays
-        int temp_key_array[INTARRAYLEAFSIZE+1];
-        RecordId temp_rid_array[INTARRAYLEAFSIZE+1];
+        T temp_key_array[leaf_size+1];
+        RecordId temp_rid_array[leaf_size+1];
         for(int i = 0; i < position; i++){
             temp_key_array[i] = left_node->keyArray[i];
             temp_rid_array[i] = left_node->ridArray[i];
         }
         temp_key_array[position] = key;
         temp_rid_array[position] = rid;
-        for(int i = position+1; i < INTARRAYLEAFSIZE+1; i++){
+        for(int i = position+1; i < leaf_size+1; i++){
             temp_key_array[i] = left_node->keyArray[i-1];
             temp_rid_array[i] = left_node->ridArray[i-1];
         }
-        push_up_key = temp_key_array[MIDDLELEAF];
+        // The left node keeps left_fill of the entries, half of them rounded up for an even split, and at least one
+        // entry goes to each node
+        int left_count = std::min(leaf_size, std::max(1, (int)(left_fill * leaf_size) + 1));
+        push_up_key = temp_key_array[left_count - 1];
 
         // Redistribute keys and rids into left and right nodes
-        initializeLeaf(left_page);
+        initializeLeaf<T>(left_page);
         left_node->rightSibPageNo = temp_right_num;
-        left_node->keySize = MIDDLELEAF + 1;
+        left_node->leftSibPageNo = left_sibling_num;
+        left_node->highKey = push_up_key;
+        left_node->keySize = left_count;
         for(int i = 0; i < left_node->keySize; i++){
             left_node->keyArray[i] = temp_key_array[i];
             left_node->ridArray[i] = temp_rid_array[i];
         }
 
-        right_node->keySize = INTARRAYLEAFSIZE - MIDDLELEAF;
+        right_node->keySize = leaf_size + 1 - left_count;
         for(int i = 0; i < right_node->keySize; i++){
-            right_node->keyArray[i] = temp_key_array[i+MIDDLELEAF+1];
-            right_node->ridArray[i] = temp_rid_array[i+MIDDLELEAF+1];
+            right_node->keyArray[i] = temp_key_array[i+left_count];
+            right_node->ridArray[i] = temp_rid_array[i+left_count];
         }
 
         // Unpin right and left node and set dirty bits
@@ -372,21 +1455,396 @@ void BTreeIndex::modifyLeafNode(PageId page_num, int key, RecordId rid, int posi
 
 }
 
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::copyIncludedColumns
+// -----------------------------------------------------------------------------
+void BTreeIndex::copyIncludedColumns(const char* record, char* included) const
+{
+    for(size_t i = 0; i < includedColumns.size(); i++){
+        memcpy(included, record + includedColumns[i].byteOffset, includedColumns[i].length);
+        included += includedColumns[i].length;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::recordKey
+// -----------------------------------------------------------------------------
+const char* BTreeIndex::recordKey(const char* record, std::string& encoded) const
+{
+    if(keyColumns.empty()){
+        return record + attrByteOffset;
+    }
+    encoded.clear();
+    for(size_t i = 0; i < keyColumns.size(); i++){
+        const char* value = record + keyColumns[i].byteOffset;
+        switch(keyColumns[i].type){
+        case INTEGER:
+            appendCompositeInt(encoded, keyValue<int>(value));
+            break;
+        case DOUBLE:
+            appendCompositeDouble(encoded, keyValue<double>(value));
+            break;
+        case INT64:
+            appendCompositeInt64(encoded, keyValue<std::int64_t>(value));
+            break;
+        default:
+            appendCompositeString(encoded, value);
+            break;
+        }
+    }
+    return encoded.c_str();
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::extendPrefixBound
+// -----------------------------------------------------------------------------
+void BTreeIndex::extendPrefixBound(std::string& bound) const
+{
+    if(!keyColumns.empty() && (int)bound.size() < compositeKeyBytes){
+        bound.resize(STRINGKEYMAXSIZE, (char)0xFF);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::insertCoveringLeafEntry
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::insertCoveringLeafEntry(PageId page_num, Page* leaf_page, T key, RecordId rid, const char* included,
+                                         int position, PageId& right_node_num, T& push_up_key, double left_fill){
+    CoveringLeafNode<T>* left_node = reinterpret_cast<CoveringLeafNode<T>*>(leaf_page);
+    const int leaf_size = left_node->capacity;
+    if(left_node->keySize < leaf_size){
+        insertCoveringEntry(left_node, position, key, rid, included);
+        bufMgr->unPinPage((BlobFile*)file, page_num, true);
+        right_node_num = Page::INVALID_NUMBER;
+        return;
+    }
+
+    // Otherwise split, the left node keeping left_fill of the entries with the new one
+    Page* right_page;
+    bufMgr->allocPage((BlobFile*)file, right_node_num, right_page);
+    CoveringLeafNode<T>* right_node = reinterpret_cast<CoveringLeafNode<T>*>(right_page);
+    initializeCoveringLeaf(right_node, left_node->includedBytes);
+    linkSplitLeaf<T>(page_num, left_node, right_node_num, right_node);
+
+    // The entries from the left count on move to the right node, one less if the new entry goes to the left node
+    int left_count = std::min(leaf_size, std::max(1, (int)(left_fill * leaf_size) + 1));
+    int moved_from = (position < left_count) ? left_count - 1 : left_count;
+    insertCoveringEntries(right_node, 0, left_node, moved_from, leaf_size);
+    removeCoveringEntries(left_node, moved_from, leaf_size);
+    if(position < left_count){
+        insertCoveringEntry(left_node, position, key, rid, included);
+    }
+    else{
+        insertCoveringEntry(right_node, position - left_count, key, rid, included);
+    }
+    push_up_key = left_node->keys()[left_count - 1];
+    left_node->highKey = push_up_key;
+    bufMgr->unPinPage((BlobFile*)file, page_num, true);
+    bufMgr->unPinPage((BlobFile*)file, right_node_num, true);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::insertPackedEntry
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::insertPackedEntry(PageId page_num, Page* leaf_page, T key, RecordId rid, int position,
+                                   PageId& right_node_num, T& push_up_key, double left_fill){
+    // Unpack the node with room for the entry at its position, and pack it again if it still fits
+    PackedLeafNode<T>* left_node = reinterpret_cast<PackedLeafNode<T>*>(leaf_page);
+    int n = left_node->keySize + 1;
+    std::vector<T> keys(n);
+    std::vector<RecordId> rids(n);
+    decodePackedLeaf(left_node, keys.data(), rids.data());
+    for(int i = n - 1; i > position; i--){
+        keys[i] = keys[i-1];
+        rids[i] = rids[i-1];
+    }
+    keys[position] = key;
+    rids[position] = rid;
+    if(encodePackedLeaf(left_node, keys.data(), rids.data(), n)){
+        bufMgr->unPinPage((BlobFile*)file, page_num, true);
+        right_node_num = Page::INVALID_NUMBER;
+        return;
+    }
+
+    // Otherwise split, at the split closest to left_fill whose halves both fit
+    Page* right_page;
+    bufMgr->allocPage((BlobFile*)file, right_node_num, right_page);
+    PackedLeafNode<T>* right_node = reinterpret_cast<PackedLeafNode<T>*>(right_page);
+    initializePackedLeaf(right_node);
+    linkSplitLeaf<T>(page_num, left_node, right_node_num, right_node);
+
+    int split = choosePackedSplit(keys.data(), rids.data(), n, left_fill);
+    encodePackedLeaf(left_node, keys.data(), rids.data(), split);
+    encodePackedLeaf(right_node, keys.data() + split, rids.data() + split, n - split);
+    push_up_key = keys[split - 1];
+    left_node->highKey = push_up_key;
+    bufMgr->unPinPage((BlobFile*)file, page_num, true);
+    bufMgr->unPinPage((BlobFile*)file, right_node_num, true);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::insertPostingEntry
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::insertPostingEntry(PageId page_num, Page* leaf_page, T key, RecordId rid, PageId& right_node_num,
+                                    T& push_up_key, double left_fill){
+    PostingLeafNode<T>* posting_node = reinterpret_cast<PostingLeafNode<T>*>(leaf_page);
+
+    // A key which keeps its record ids in overflow pages takes one more there, the node only counts it
+    int slot = postingLowerBound(posting_node, key);
+    if(slot < posting_node->keySize && !(key < posting_node->slots()[slot].key) &&
+       posting_node->slots()[slot].overflowPageNo != Page::INVALID_NUMBER){
+        insertOverflowRid(posting_node->slots()[slot].overflowPageNo, rid);
+        posting_node->slots()[slot].ridCount++;
+        bufMgr->unPinPage((BlobFile*)file, page_num, true);
+        right_node_num = Page::INVALID_NUMBER;
+        return;
+    }
+
+    // Otherwise the node is decoded and written back with the entry
+    std::vector<Posting<T> > postings;
+    decodePostingLeaf(posting_node, postings);
+    addPostingEntry(postings, key, rid);
+    writeLeafPostings(page_num, leaf_page, postings, right_node_num, push_up_key, left_fill);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::writeLeafPostings
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::writeLeafPostings(PageId page_num, Page* leaf_page, std::vector<Posting<T> >& postings,
+                                   PageId& right_node_num, T& push_up_key, double left_fill){
+    spillPostings(postings);
+    int n = (int)postings.size();
+    if(leafFits(postings, 0, n)){
+        encodeLeaf(leaf_page, postings, 0, n);
+        bufMgr->unPinPage((BlobFile*)file, page_num, true);
+        right_node_num = Page::INVALID_NUMBER;
+        return;
+    }
+
+    // Otherwise split. Every key stays in one of the nodes, and the last key of the left node is pushed up
+    Page* right_page;
+    bufMgr->allocPage((BlobFile*)file, right_node_num, right_page);
+    initializeLeaf<T>(right_page);
+    LeafNode<T>* left_node = reinterpret_cast<LeafNode<T>*>(leaf_page);
+    LeafNode<T>* right_node = reinterpret_cast<LeafNode<T>*>(right_page);
+    linkSplitLeaf<T>(page_num, left_node, right_node_num, right_node);
+
+    int split = chooseLeafSplit(postings, left_fill);
+    encodeLeaf(leaf_page, postings, 0, split);
+    encodeLeaf(right_page, postings, split, n);
+    push_up_key = postings[split - 1].key;
+    left_node->highKey = push_up_key;
+    bufMgr->unPinPage((BlobFile*)file, page_num, true);
+    bufMgr->unPinPage((BlobFile*)file, right_node_num, true);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::spillPostings
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::spillPostings(std::vector<Posting<T> >& postings){
+    for(size_t i = 0; i < postings.size(); i++){
+        Posting<T>& posting = postings[i];
+        if(posting.overflowPageNo == Page::INVALID_NUMBER &&
+           ridListBytes(posting.rids.data(), (int)posting.rids.size()) > PostingLeafNode<T>::INLINEBYTES){
+            PageId last_num = Page::INVALID_NUMBER;
+            appendOverflowRids(posting.overflowPageNo, last_num, posting.rids.data(), (int)posting.rids.size());
+            posting.rids.clear();
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::appendOverflowRids
+// -----------------------------------------------------------------------------
+void BTreeIndex::appendOverflowRids(PageId& first_page_num, PageId& last_page_num, const RecordId* rids, int count){
+    // Every page takes as many record ids as fit, and is linked to from the page before once it is written
+    int done = 0;
+    while(done < count){
+        PageId page_num;
+        Page* page;
+        bufMgr->allocPage((BlobFile*)file, page_num, page);
+        PostingOverflowPage* overflow_page = reinterpret_cast<PostingOverflowPage*>(page);
+        int n = std::max(1, ridsFitting(rids + done, count - done, PostingOverflowPage::DATASIZE));
+        overflow_page->ridCount = n;
+        overflow_page->byteCount = encodeRidList(rids + done, n, overflow_page->data);
+        overflow_page->nextPageNo = Page::INVALID_NUMBER;
+        overflow_page->lastRid = rids[done + n - 1];
+        bufMgr->unPinPage((BlobFile*)file, page_num, true);
+
+        if(first_page_num == Page::INVALID_NUMBER){
+            first_page_num = page_num;
+        }
+        else{
+            Page* last_page;
+            bufMgr->readPage((BlobFile*)file, last_page_num, last_page);
+            reinterpret_cast<PostingOverflowPage*>(last_page)->nextPageNo = page_num;
+            bufMgr->unPinPage((BlobFile*)file, last_page_num, true);
+        }
+        last_page_num = page_num;
+        done += n;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::readOverflowRids
+// -----------------------------------------------------------------------------
+void BTreeIndex::readOverflowRids(PageId page_num, std::vector<RecordId>& rids){
+    while(page_num != Page::INVALID_NUMBER){
+        Page* page;
+        bufMgr->readPage((BlobFile*)file, page_num, page);
+        const PostingOverflowPage* overflow_page = reinterpret_cast<const PostingOverflowPage*>(page);
+        decodeRidList(overflow_page->data, overflow_page->ridCount, rids);
+        PageId next_num = overflow_page->nextPageNo;
+        bufMgr->unPinPage((BlobFile*)file, page_num, false);
+        page_num = next_num;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::insertOverflowRid
+// -----------------------------------------------------------------------------
+void BTreeIndex::insertOverflowRid(PageId page_num, const RecordId rid){
+    // The record id goes to the first page whose last record id is not less than it, or to the last page
+    Page* page;
+    PostingOverflowPage* overflow_page;
+    while(1){
+        bufMgr->readPage((BlobFile*)file, page_num, page);
+        overflow_page = reinterpret_cast<PostingOverflowPage*>(page);
+        if(overflow_page->nextPageNo == Page::INVALID_NUMBER || !ridLess(overflow_page->lastRid, rid)){
+            break;
+        }
+        PageId next_num = overflow_page->nextPageNo;
+        bufMgr->unPinPage((BlobFile*)file, page_num, false);
+        page_num = next_num;
+    }
+    std::vector<RecordId> rids;
+    decodeRidList(overflow_page->data, overflow_page->ridCount, rids);
+    rids.insert(std::upper_bound(rids.begin(), rids.end(), rid, ridLess), rid);
+
+    // A page without room for it splits, the upper half of its record ids going to a new page after it
+    int count = (int)rids.size();
+    int keep = count;
+    if(ridListBytes(rids.data(), count) > PostingOverflowPage::DATASIZE){
+        keep = count / 2;
+        PageId new_num;
+        Page* new_page;
+        bufMgr->allocPage((BlobFile*)file, new_num, new_page);
+        PostingOverflowPage* new_overflow_page = reinterpret_cast<PostingOverflowPage*>(new_page);
+        new_overflow_page->ridCount = count - keep;
+        new_overflow_page->byteCount = encodeRidList(rids.data() + keep, count - keep, new_overflow_page->data);
+        new_overflow_page->nextPageNo = overflow_page->nextPageNo;
+        new_overflow_page->lastRid = rids.back();
+        bufMgr->unPinPage((BlobFile*)file, new_num, true);
+        overflow_page->nextPageNo = new_num;
+    }
+    overflow_page->ridCount = keep;
+    overflow_page->byteCount = encodeRidList(rids.data(), keep, overflow_page->data);
+    overflow_page->lastRid = rids[keep - 1];
+    bufMgr->unPinPage((BlobFile*)file, page_num, true);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::removeOverflowRid
+// -----------------------------------------------------------------------------
+bool BTreeIndex::removeOverflowRid(PageId& first_page_num, const RecordId rid){
+    // The record id can only be in the first page whose last record id is not less than it
+    PageId previous_num = Page::INVALID_NUMBER;
+    PageId page_num = first_page_num;
+    while(page_num != Page::INVALID_NUMBER){
+        Page* page;
+        bufMgr->readPage((BlobFile*)file, page_num, page);
+        PostingOverflowPage* overflow_page = reinterpret_cast<PostingOverflowPage*>(page);
+        PageId next_num = overflow_page->nextPageNo;
+        if(ridLess(overflow_page->lastRid, rid)){
+            bufMgr->unPinPage((BlobFile*)file, page_num, false);
+            previous_num = page_num;
+            page_num = next_num;
+            continue;
+        }
+
+        std::vector<RecordId> rids;
+        decodeRidList(overflow_page->data, overflow_page->ridCount, rids);
+        std::vector<RecordId>::iterator found = std::lower_bound(rids.begin(), rids.end(), rid, ridLess);
+        if(found == rids.end() || *found != rid){
+            bufMgr->unPinPage((BlobFile*)file, page_num, false);
+            return false;
+        }
+        rids.erase(found);
+        if(!rids.empty()){
+            overflow_page->ridCount = (int)rids.size();
+            overflow_page->byteCount = encodeRidList(rids.data(), (int)rids.size(), overflow_page->data);
+            overflow_page->lastRid = rids.back();
+            bufMgr->unPinPage((BlobFile*)file, page_num, true);
+            return true;
+        }
+
+        // Take the empty page out of the pages of the key
+        bufMgr->unPinPage((BlobFile*)file, page_num, false);
+        bufMgr->disposePage((BlobFile*)file, page_num);
+        if(previous_num == Page::INVALID_NUMBER){
+            first_page_num = next_num;
+        }
+        else{
+            Page* previous_page;
+            bufMgr->readPage((BlobFile*)file, previous_num, previous_page);
+            reinterpret_cast<PostingOverflowPage*>(previous_page)->nextPageNo = next_num;
+            bufMgr->unPinPage((BlobFile*)file, previous_num, true);
+        }
+        return true;
+    }
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::disposeOverflowRids
+// -----------------------------------------------------------------------------
+void BTreeIndex::disposeOverflowRids(PageId page_num){
+    while(page_num != Page::INVALID_NUMBER){
+        Page* page;
+        bufMgr->readPage((BlobFile*)file, page_num, page);
+        PageId next_num = reinterpret_cast<const PostingOverflowPage*>(page)->nextPageNo;
+        bufMgr->unPinPage((BlobFile*)file, page_num, false);
+        bufMgr->disposePage((BlobFile*)file, page_num);
+        page_num = next_num;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::readPostingOverflow
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::readPostingOverflow(Posting<T>& posting){
+    if(posting.overflowPageNo != Page::INVALID_NUMBER){
+        posting.rids.clear();
+        readOverflowRids(posting.overflowPageNo, posting.rids);
+        disposeOverflowRids(posting.overflowPageNo);
+        posting.overflowPageNo = Page::INVALID_NUMBER;
+    }
+}
+
 // -----------------------------------------------------------------------------
 // Helper Function: BTreeIndex::modifyNonLeafNode
 // -----------------------------------------------------------------------------
-void BTreeIndex::modifyNonLeafNode(PageId page_num, int key, PageId left_child_num, PageId right_child_num, int position, int total_key,
-                        PageId& left_node_num, PageId& right_node_num, int& push_up_key){
+template <class T>
+void BTreeIndex::modifyNonLeafNode(PageId page_num, T key, PageId right_child_num, int position, int total_key,
+                        PageId& left_node_num, PageId& right_node_num, T& push_up_key, double left_fill){
+    const int non_leaf_size = NodeCapacity<T>::NONLEAF;
+
     // This function modifies a specific non-leaf node when a pushing-up key is inserted into the node. Split the non-leaf node if
-    // necessary
+    // necessary. The child on the left of the key stays where it is
 
     // If the non-leaf node is not full before insertion, then just insert the key into the given position without
     // splitting and exit
-    if(total_key < INTARRAYNONLEAFSIZE){
+    if(total_key < non_leaf_size){
         Page* non_leaf_page;
-        NonLeafNodeInt* non_leaf_node;
+        NonLeafNode<T>* non_leaf_node;
         bufMgr->readPage((BlobFile*)file, page_num, non_leaf_page);
-        non_leaf_node = reinterpret_cast<NonLeafNodeInt*>(non_leaf_page);
+        non_leaf_node = reinterpret_cast<NonLeafNode<T>*>(non_leaf_page);
 
         // Shift one position to right
         for(int i = total_key; i > position; i--){
@@ -395,15 +1853,14 @@ void BTreeIndex::modifyNonLeafNode(PageId page_num, int key, PageId left_child_n
         }
         non_leaf_node->keyArray[position] = key;
         non_leaf_node->pageNoArray[position+1] = right_child_num;
-        non_leaf_node->pageNoArray[position] = left_child_num;
         // Increment the node size
         non_leaf_node->keySize = non_leaf_node->keySize+1;
+        updateResidentNode(page_num, non_leaf_node, false);
         // Unpin the node and set the dirty bit
         bufMgr->unPinPage((BlobFile*)file, page_num, true);
 
         left_node_num = page_num;
         right_node_num = Page::INVALID_NUMBER;
-        push_up_key = -1;
     }
     // If the non-leaf node is full before insertion, split it into left and right nodes, and push up
     // the middle key
@@ -411,52 +1868,62 @@ void BTreeIndex::modifyNonLeafNode(PageId page_num, int key, PageId left_child_n
        Page* left_non_leaf_page;
        Page* right_non_leaf_page;
        PageId temp_right_num;
-       NonLeafNodeInt* left_non_leaf_node;
-       NonLeafNodeInt* right_non_leaf_node;
+       NonLeafNode<T>* left_non_leaf_node;
+       NonLeafNode<T>* right_non_leaf_node;
        bufMgr->readPage((BlobFile*)file, page_num, left_non_leaf_page);
        bufMgr->allocPage((BlobFile*)file, temp_right_num, right_non_leaf_page); // allocate a new page as the right page
-       left_non_leaf_node = reinterpret_cast<NonLeafNodeInt*>(left_non_leaf_page);
-       right_non_leaf_node = reinterpret_cast<NonLeafNodeInt*>(right_non_leaf_page);
+       left_non_leaf_node = reinterpret_cast<NonLeafNode<T>*>(left_non_leaf_page);
+       right_non_leaf_node = reinterpret_cast<NonLeafNode<T>*>(right_non_leaf_page);
 
-       initializeNonLeaf(right_non_leaf_page);
+       initializeNonLeaf<T>(right_non_leaf_page);
        right_non_leaf_node->level = left_non_leaf_node->level;
+       right_non_leaf_node->rightSibPageNo = left_non_leaf_node->rightSibPageNo;
+       right_non_leaf_node->highKey = left_non_leaf_node->highKey;
 
        // Store keys and page-ids including the inserted key&pageId pair into temporary arrays
-       int temp_key_array[INTARRAYNONLEAFSIZE+1];
-       PageId temp_pageid_array[INTARRAYNONLEAFSIZE+2];
+       T temp_key_array[non_leaf_size+1];
+       PageId temp_pageid_array[non_leaf_size+2];
        for(int i = 0; i < position; i++){
            temp_key_array[i] = left_non_leaf_node->keyArray[i];
            temp_pageid_array[i] = left_non_leaf_node->pageNoArray[i];
        }
        temp_key_array[position] = key;
-       temp_pageid_array[position] = left_child_num;
+       temp_pageid_array[position] = left_non_leaf_node->pageNoArray[position];
        temp_pageid_array[position+1] = right_child_num;
-       for(int i = position+1; i < INTARRAYNONLEAFSIZE+1; i++){
+       for(int i = position+1; i < non_leaf_size+1; i++){
             temp_key_array[i] = left_non_leaf_node->keyArray[i-1];
             temp_pageid_array[i+1] = left_non_leaf_node->pageNoArray[i];
        }
 
-       // Return the page-id of the right page and the pushing-up key from splitting
-       push_up_key = temp_key_array[MIDDLENONLEAF];
+       // The left node keeps left_fill of the keys, half of them rounded down for an even split, and each node keeps
+       // at least one key. Return the page-id of the right page and the pushing-up key from splitting
+       int middle_non_leaf = std::min(non_leaf_size - 1, std::max(1, (int)(left_fill * non_leaf_size)));
+       push_up_key = temp_key_array[middle_non_leaf];
        left_node_num = page_num;
        right_node_num = temp_right_num;
 
-       // Redistribute keys and page-ids into left and right nodes, updates their node size
-       initializeNonLeaf(left_non_leaf_page);
+       // Redistribute keys and page-ids into left and right nodes, updates their node size. The left node links to
+       // the right one, whose high key it was
+       initializeNonLeaf<T>(left_non_leaf_page);
        left_non_leaf_node->level = right_non_leaf_node->level;
-       left_non_leaf_node->keySize = MIDDLENONLEAF;
+       left_non_leaf_node->rightSibPageNo = temp_right_num;
+       left_non_leaf_node->highKey = push_up_key;
+       left_non_leaf_node->keySize = middle_non_leaf;
        for(int i = 0; i < left_non_leaf_node->keySize; i++){
             left_non_leaf_node->keyArray[i] = temp_key_array[i];
             left_non_leaf_node->pageNoArray[i] = temp_pageid_array[i];
        }
-       left_non_leaf_node->pageNoArray[left_non_leaf_node->keySize] = temp_pageid_array[MIDDLENONLEAF];
-       right_non_leaf_node->keySize = INTARRAYNONLEAFSIZE-MIDDLENONLEAF;
-       right_non_leaf_node->pageNoArray[0] = temp_pageid_array[MIDDLENONLEAF+1];
+       left_non_leaf_node->pageNoArray[left_non_leaf_node->keySize] = temp_pageid_array[middle_non_leaf];
+       right_non_leaf_node->keySize = non_leaf_size-middle_non_leaf;
+       right_non_leaf_node->pageNoArray[0] = temp_pageid_array[middle_non_leaf+1];
        for(int i = 0; i < right_non_leaf_node->keySize; i++){
-            right_non_leaf_node->keyArray[i] = temp_key_array[i + MIDDLENONLEAF+1];
-            right_non_leaf_node->pageNoArray[i + 1] = temp_pageid_array[i+ MIDDLENONLEAF+2];
+            right_non_leaf_node->keyArray[i] = temp_key_array[i + middle_non_leaf+1];
+            right_non_leaf_node->pageNoArray[i + 1] = temp_pageid_array[i+ middle_non_leaf+2];
        }
 
+       // The right node is new, and is added to the copies along with the pushing-up key to the parent
+       updateResidentNode(page_num, left_non_leaf_node, true);
+
        // Unpin the left and right page and set dirty bits
        bufMgr->unPinPage((BlobFile*)file, page_num, true);
        bufMgr->unPinPage((BlobFile*)file, temp_right_num, true);
@@ -473,6 +1940,18 @@ BTreeIndex::~BTreeIndex()
     // Add your code below. Please do not remove this line.
 
     try{
+        // End the scans, of the index and of its cursors, so no page is left pinned, and detach the cursors
+        endOpenScans();
+        for(size_t i = 0; i < openCursors.size(); i++){
+            openCursors[i]->index = NULL;
+        }
+        openCursors.clear();
+
+        // Keep the number of entries added to the Bloom filter, which decides when it is built again
+        if(!bloomPageNums.empty()){
+            writeMetaInfo();
+        }
+
         bufMgr->flushFile((BlobFile*)file); // Flush index file
         delete file;                       // Delete file instance thereby closing the index file
         file = NULL;
@@ -480,6 +1959,7 @@ BTreeIndex::~BTreeIndex()
     catch(std::exception &e){             // Catch all possible exceptions inside the destructor
         std::cout<<"Error: fail to deallocate"<<std::endl;
     }
+    delete nodeVersions;
 
 }
 
@@ -487,297 +1967,2889 @@ BTreeIndex::~BTreeIndex()
 // BTreeIndex::insertEntry
 // -----------------------------------------------------------------------------
 
-void BTreeIndex::insertEntry(const void *key, const RecordId rid)
+void BTreeIndex::insertEntry(const void *key, const RecordId rid, const void *included)
 {
     // Add your code below. Please do not remove this line.
+    if(includedBytes > 0 && included == NULL){
+        throw BadIndexInfoException("Error: An entry of a covering index needs the bytes of its included columns!");
+    }
 
-    int target_key = *((int*)key);
-    int push_up_key;
-    PageId leaf_num;
-    PageId parent_num;
-    PageId left_child_num;
-    PageId right_child_num;
-    int position;
-    int total_key;
-
-    // Locate the leaf node to insert the key&rid pair and modify the leaf node
-    // return the page-id of the right page and pushing-up key if necessary
-    findLeafNode(target_key, leaf_num, position, total_key);
-    modifyLeafNode(leaf_num, target_key, rid, position, total_key, left_child_num, right_child_num, push_up_key);
+    // Read the key as the type of the indexed attribute and insert it into nodes laid out for that type
+    switch(attributeType){
+    case INTEGER:
+        if(nodeVersions != NULL){
+            insertConcurrent(keyValue<int>(key), rid, (const char*)included);
+        }
+        else{
+            insertEntryTyped(keyValue<int>(key), rid, (const char*)included);
+        }
+        break;
+    case DOUBLE:
+        if(nodeVersions != NULL){
+            insertConcurrent(keyValue<double>(key), rid, (const char*)included);
+        }
+        else{
+            insertEntryTyped(keyValue<double>(key), rid, (const char*)included);
+        }
+        break;
+    case INT64:
+        if(nodeVersions != NULL){
+            insertConcurrent(keyValue<std::int64_t>(key), rid, (const char*)included);
+        }
+        else{
+            insertEntryTyped(keyValue<std::int64_t>(key), rid, (const char*)included);
+        }
+        break;
+    case STRING:
+        insertEntryString((const char*)key, stringKeyLength((const char*)key), rid);
+        break;
+    default:
+        break;
+    }
+    if(!bloomPageNums.empty()){
+        bloomAdd(key);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertBatch
+// -----------------------------------------------------------------------------
+void BTreeIndex::insertBatch(const KeyRid* entries, size_t n)
+{
+    // The entries of a covering index carry included bytes, STRING keys are slotted, and a concurrent insert locks
+    // one leaf at a time, so those go through insertEntry one by one, as does a single entry, which shares nothing
+    if(n <= 1 || includedBytes > 0 || attributeType == STRING || nodeVersions != NULL){
+        for(size_t i = 0; i < n; i++){
+            insertEntry(entries[i].key, entries[i].rid, entries[i].included);
+        }
+        return;
+    }
+    switch(attributeType){
+    case INTEGER:
+        insertBatchTyped<int>(entries, n);
+        break;
+    case DOUBLE:
+        insertBatchTyped<double>(entries, n);
+        break;
+    case INT64:
+        insertBatchTyped<std::int64_t>(entries, n);
+        break;
+    default:
+        break;
+    }
+    if(!bloomPageNums.empty()){
+        for(size_t i = 0; i < n; i++){
+            bloomAdd(entries[i].key);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::insertEntryTyped
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::insertEntryTyped(T target_key, const RecordId rid, const char* included)
+{
+    T push_up_key = target_key;
+    PageId leaf_num;
+    PageId left_child_num;
+    PageId right_child_num;
+    NodePath path;
+    Page* leaf_page;
+
+    // Locate the leaf node to insert the key&rid pair, recording the ancestors on the way down, and
+    // modify the leaf node. Return the page-id of the right page and pushing-up key if necessary
+    descendToLeaf(target_key, &path, leaf_num, leaf_page);
+    insertLeafEntry(path, leaf_num, leaf_page, target_key, rid, included, left_child_num, right_child_num, push_up_key);
+    if(right_child_num != Page::INVALID_NUMBER){
+        stopReadAhead();
+    }
+    insertPushUpKey(path, left_child_num, right_child_num, push_up_key);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::insertPushUpKey
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::insertPushUpKey(const NodePath& path, PageId left_child_num, PageId right_child_num, T push_up_key)
+{
+    // If the node did split, insert the pushing-up keys into the recorded ancestors from the
+    // parent of the node upwards, until a node absorbs the key without splitting
+    for(int depth = path.depth - 1; depth >= 0 && right_child_num != Page::INVALID_NUMBER; depth--){
+        const PathEntry& parent = path.entries[depth];
+        T temp_key = push_up_key;
+        PageId temp_right_child_num = right_child_num;
+        modifyNonLeafNode(parent.pageNo, temp_key, temp_right_child_num, parent.position, parent.keySize,
+                          left_child_num, right_child_num, push_up_key, splitFillAt(path, depth, parent.position, parent.keySize));
+    }
+
+    // If page-id of the right page is invalid, the last modified node did not split, then finish the insert
+    if(right_child_num == Page::INVALID_NUMBER){
+        return;
+    }
+
+    // Otherwise the root did split, then allocate a new root page to insert the pushing-up key
+    addRoot(push_up_key, left_child_num, right_child_num);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::insertBatchTyped
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::insertBatchTyped(const KeyRid* entries, size_t n)
+{
+    // Sort the entries by key, those with the same key in their order in the batch
+    std::vector<std::pair<T, RecordId> > batch;
+    batch.reserve(n);
+    for(size_t i = 0; i < n; i++){
+        batch.push_back(std::make_pair(keyValue<T>(entries[i].key), entries[i].rid));
+    }
+    std::stable_sort(batch.begin(), batch.end(), batchKeyLess<T>);
+
+    // Every descent takes the entries of the leaf node it ends at
+    bool split = false;
+    for(size_t start = 0; start < batch.size(); ){
+        start += insertLeafBatch(batch, start, split);
+    }
+    if(split){
+        stopReadAhead();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::insertLeafBatch
+// -----------------------------------------------------------------------------
+template <class T>
+size_t BTreeIndex::insertLeafBatch(const std::vector<std::pair<T, RecordId> >& batch, size_t start, bool& split)
+{
+    const int leaf_size = NodeCapacity<T>::LEAF;
+    NodePath path;
+    PageId leaf_num;
+    Page* leaf_page;
+    descendToLeaf(batch[start].first, &path, leaf_num, leaf_page);
+    LeafNode<T>* leaf_node = reinterpret_cast<LeafNode<T>*>(leaf_page);
+
+    // The leaf node takes the entries up to its high key, which the descent would lead to it as well, and the
+    // rightmost leaf node all the rest
+    size_t end = batch.size();
+    if(leaf_node->rightSibPageNo != Page::INVALID_NUMBER){
+        end = std::upper_bound(batch.begin() + start, batch.end(), std::make_pair(leaf_node->highKey, RecordId()),
+                               batchKeyLess<T>) - batch.begin();
+    }
+    int total_key = leaf_node->keySize;
+    int count = (int)(end - start);
+    int position = leafBound(leaf_page, batch[start].first, false);
+    double left_fill = splitFillAt(path, path.depth, position, total_key);
+    int left_count = std::min(leaf_size, std::max(1, (int)(left_fill * leaf_size) + 1));
+
+    // A leaf node of another format, or one whose keys would rather turn into posting lists than split, takes the
+    // first entry alone like in insertEntryTyped
+    bool single = leaf_node->format != ENTRY_LIST || count == 1;
+    if(!single && total_key + count > leaf_size && batchRepeatsKey(leaf_node, total_key, batch, start, end)){
+        std::vector<Posting<T> > postings;
+        decodeLeaf<T>(leaf_page, postings);
+        for(size_t i = start; i < end; i++){
+            addPostingEntry(postings, batch[i].first, batch[i].second);
+        }
+        single = preferPostings(postings, 0, (int)postings.size());
+    }
+    if(single){
+        PageId left_child_num;
+        PageId right_child_num;
+        T push_up_key;
+        insertLeafEntry(path, leaf_num, leaf_page, batch[start].first, batch[start].second, (const char*)NULL,
+                        left_child_num, right_child_num, push_up_key);
+        split = split || right_child_num != Page::INVALID_NUMBER;
+        insertPushUpKey(path, left_child_num, right_child_num, push_up_key);
+        return 1;
+    }
+
+    // Entries which do not fit split the leaf node into as many nodes as they need, every node but the last keeping
+    // left_count of them like the left node of a split. The keys of the new nodes go into the parent at once if it
+    // has room for them, otherwise the entries are cut down to a single split, which goes up like in insertEntryTyped
+    int new_nodes = 0;
+    for(int remaining = total_key + count; remaining > leaf_size; remaining -= left_count){
+        new_nodes++;
+    }
+    int room = path.depth == 0 ? 1 : NodeCapacity<T>::NONLEAF - path.entries[path.depth - 1].keySize;
+    if(new_nodes > std::max(room, 1)){
+        count = leaf_size + left_count - total_key;
+        end = start + count;
+        new_nodes = 1;
+    }
+
+    // insertEntry puts an entry before the entries with its key already in the index, so of the entries with the
+    // same key the last one inserted comes first. The runs of entries with the same key are turned around to match
+    std::vector<std::pair<T, RecordId> > group(batch.begin() + start, batch.begin() + end);
+    for(int run = 0; run < count; ){
+        int run_end = run + 1;
+        while(run_end < count && !(group[run].first < group[run_end].first)){
+            run_end++;
+        }
+        std::reverse(group.begin() + run, group.begin() + run_end);
+        run = run_end;
+    }
+
+    // If the entries fit, merge them into the leaf node from the back, moving every entry once. An entry goes
+    // before the entries with its key already in the node, like in modifyLeafNode
+    if(new_nodes == 0){
+        int i = total_key - 1;
+        int j = count - 1;
+        for(int k = total_key + count - 1; j >= 0; k--){
+            if(i >= 0 && !(leaf_node->keyArray[i] < group[j].first)){
+                leaf_node->keyArray[k] = leaf_node->keyArray[i];
+                leaf_node->ridArray[k] = leaf_node->ridArray[i];
+                i--;
+            }
+            else{
+                leaf_node->keyArray[k] = group[j].first;
+                leaf_node->ridArray[k] = group[j].second;
+                j--;
+            }
+        }
+        leaf_node->keySize = total_key + count;
+        bufMgr->unPinPage((BlobFile*)file, leaf_num, true);
+        return count;
+    }
+
+    // Merge the entries of the node and the new ones into temporary arrays
+    int total = total_key + count;
+    std::vector<T> keys(total);
+    std::vector<RecordId> rids(total);
+    {
+        int i = 0;
+        int j = 0;
+        for(int k = 0; k < total; k++){
+            if(j < count && (i == total_key || !(leaf_node->keyArray[i] < group[j].first))){
+                keys[k] = group[j].first;
+                rids[k] = group[j].second;
+                j++;
+            }
+            else{
+                keys[k] = leaf_node->keyArray[i];
+                rids[k] = leaf_node->ridArray[i];
+                i++;
+            }
+        }
+    }
+
+    // Allocate the new nodes and link them in between the leaf node and its old right sibling, the last one taking
+    // over the high key
+    std::vector<PageId> node_nums(new_nodes + 1);
+    std::vector<Page*> node_pages(new_nodes + 1);
+    node_nums[0] = leaf_num;
+    node_pages[0] = leaf_page;
+    for(int n = 1; n <= new_nodes; n++){
+        bufMgr->allocPage((BlobFile*)file, node_nums[n], node_pages[n]);
+        initializeLeaf<T>(node_pages[n]);
+    }
+    PageId old_right_num = leaf_node->rightSibPageNo;
+    T old_high_key = leaf_node->highKey;
+    std::vector<T> push_up_keys(new_nodes);
+    int offset = 0;
+    for(int n = 0; n <= new_nodes; n++){
+        LeafNode<T>* node = reinterpret_cast<LeafNode<T>*>(node_pages[n]);
+        node->keySize = (n == new_nodes) ? total - offset : left_count;
+        for(int k = 0; k < node->keySize; k++){
+            node->keyArray[k] = keys[offset + k];
+            node->ridArray[k] = rids[offset + k];
+        }
+        offset += node->keySize;
+        if(n > 0){
+            node->leftSibPageNo = node_nums[n - 1];
+        }
+        if(n < new_nodes){
+            node->rightSibPageNo = node_nums[n + 1];
+            node->highKey = keys[offset - 1];
+            push_up_keys[n] = keys[offset - 1];
+        }
+        else{
+            node->rightSibPageNo = old_right_num;
+            node->highKey = old_high_key;
+        }
+    }
+    if(old_right_num != Page::INVALID_NUMBER){
+        setLeftSibling<LeafNode<T> >(old_right_num, node_nums[new_nodes]);
+    }
+    for(int n = 0; n <= new_nodes; n++){
+        bufMgr->unPinPage((BlobFile*)file, node_nums[n], true);
+    }
+    split = true;
+    if(new_nodes == 1){
+        insertPushUpKey(path, leaf_num, node_nums[1], push_up_keys[0]);
+    }
+    else{
+        const PathEntry& parent = path.entries[path.depth - 1];
+        insertNonLeafKeys(parent.pageNo, parent.position, push_up_keys.data(), node_nums.data() + 1, new_nodes);
+    }
+    return count;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::insertNonLeafKeys
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::insertNonLeafKeys(PageId page_num, int position, const T* keys, const PageId* child_nums, int count)
+{
+    Page* page;
+    bufMgr->readPage((BlobFile*)file, page_num, page);
+    NonLeafNode<T>* non_leaf_node = reinterpret_cast<NonLeafNode<T>*>(page);
+    int key_size = non_leaf_node->keySize;
+    memmove(&non_leaf_node->keyArray[position + count], &non_leaf_node->keyArray[position],
+            sizeof(T) * (key_size - position));
+    memmove(&non_leaf_node->pageNoArray[position + 1 + count], &non_leaf_node->pageNoArray[position + 1],
+            sizeof(PageId) * (key_size - position));
+    std::copy(keys, keys + count, &non_leaf_node->keyArray[position]);
+    std::copy(child_nums, child_nums + count, &non_leaf_node->pageNoArray[position + 1]);
+    non_leaf_node->keySize = key_size + count;
+    updateResidentNode(page_num, non_leaf_node, false);
+    bufMgr->unPinPage((BlobFile*)file, page_num, true);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::addRoot
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::addRoot(T key, PageId left_child_num, PageId right_child_num)
+{
+    Page* root_page;
+    PageId root_num;
+    NonLeafNode<T>* root_node;
+    bufMgr->allocPage((BlobFile*)file, root_num, root_page);
+    initializeNonLeaf<T>(root_page);
+    root_node = reinterpret_cast<NonLeafNode<T>*>(root_page);
+
+    // Update the data in the new root node, which is alone on its level
+    root_node->keySize = 1;
+    root_node->keyArray[0] = key;
+    root_node->pageNoArray[0] = left_child_num;
+    root_node->pageNoArray[1] = right_child_num;
+    if(rootIsLeaf){ // If the newly created root is a parent of a leaf node, then set level to 1, if not, set level to 0
+        root_node->level = 1;
+    }
+    else{
+        root_node->level = 0;
+    }
+    bufMgr->unPinPage((BlobFile*)file, root_num, true);
+
+    // The tree grows by one level, write the new root back to the header page. A concurrent descent building the
+    // copies meanwhile gives up, seeing the header page locked
+    rootPageNum = root_num;
+    treeHeight++;
+    rootIsLeaf = false;
+    {
+        std::unique_lock<std::mutex> guard(residentLatch, std::defer_lock);
+        if(nodeVersions != NULL){
+            guard.lock();
+        }
+        resident.clear();
+    }
+    writeMetaInfo();
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::insertLeafEntry
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::insertLeafEntry(const NodePath& path, PageId leaf_num, Page* leaf_page, T key, const RecordId rid,
+                                 const char* included, PageId& left_node_num, PageId& right_node_num, T& push_up_key)
+{
+    int total_key = leafEntryCount<T>(leaf_page);
+    int position = leafBound(leaf_page, key, false);
+    double left_fill = splitFillAt(path, path.depth, position, total_key);
+    if(includedBytes > 0){
+        left_node_num = leaf_num;
+        insertCoveringLeafEntry(leaf_num, leaf_page, key, rid, included, position, right_node_num, push_up_key,
+                                left_fill);
+    }
+    else{
+        modifyLeafNode(leaf_num, leaf_page, key, rid, position, total_key, left_node_num, right_node_num,
+                       push_up_key, left_fill);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::insertConcurrent
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::insertConcurrent(T key, const RecordId rid, const char* included)
+{
+    // The leaf node the descent ends at is locked, and the insert moves right from it while the key is above its
+    // high key, since it may have split after the descent read its parent
+    NodePath path;
+    PageId page_num;
+    Page* page;
+    descendOptimistic(key, &path, page_num);
+    nodeVersions->lock(page_num);
+    bufMgr->readPage((BlobFile*)file, page_num, page);
+    moveRightLocked<LeafNode<T> >(key, page_num, page);
+    PageId left_child_num;
+    PageId right_child_num;
+    T push_up_key;
+    insertLeafEntry(path, page_num, page, key, rid, included, left_child_num, right_child_num, push_up_key);
+    if(right_child_num != Page::INVALID_NUMBER){
+        stopReadAhead();
+    }
+
+    // A node which split is unlocked before its parent is locked, the new node being reachable through its right
+    // link meanwhile, so an insert holds at most two nodes at a time. The parent is the node of the path one level
+    // up, or a node on its right if that split too
+    int height = 0;
+    while(right_child_num != Page::INVALID_NUMBER){
+        nodeVersions->unlock(page_num);
+        int depth = path.depth - 1 - height;
+        while(depth < 0){
+            // The node was on the top level when the descent passed it. If it still is, it is the root, and a new
+            // root goes on top of it and its new sibling. Otherwise the root on its left split as well and adds the
+            // new root, or the tree grew meanwhile, so the path is found again
+            nodeVersions->lock(headerPageNum);
+            if(treeHeight - 1 == height && rootPageNum == page_num){
+                addRoot(push_up_key, page_num, right_child_num);
+                nodeVersions->unlock(headerPageNum);
+                return;
+            }
+            nodeVersions->unlock(headerPageNum);
+            std::this_thread::yield();
+            PageId leaf_num;
+            descendOptimistic(push_up_key, &path, leaf_num);
+            depth = path.depth - 1 - height;
+        }
+        PageId parent_num = path.entries[depth].pageNo;
+        nodeVersions->lock(parent_num);
+        bufMgr->readPage((BlobFile*)file, parent_num, page);
+        moveRightLocked<NonLeafNode<T> >(push_up_key, parent_num, page);
+        // The key goes next to the node which split. Keys equal to it may separate several children, and then the
+        // node is found among them, unless its own key is yet to be added by the split which made it
+        const NonLeafNode<T>* parent_node = reinterpret_cast<const NonLeafNode<T>*>(page);
+        int total_key = parent_node->keySize;
+        int position = lowerBound(parent_node->keyArray, total_key, push_up_key);
+        int last = upperBound(parent_node->keyArray, total_key, push_up_key);
+        for(int i = position; i <= last; i++){
+            if(parent_node->pageNoArray[i] == page_num){
+                position = i;
+                break;
+            }
+        }
+        bufMgr->unPinPage((BlobFile*)file, parent_num, false);
+        T temp_key = push_up_key;
+        PageId temp_right_child_num = right_child_num;
+        modifyNonLeafNode(parent_num, temp_key, temp_right_child_num, position, total_key, left_child_num,
+                          right_child_num, push_up_key, splitFillAt(path, depth, position, total_key));
+        page_num = parent_num;
+        height++;
+    }
+    nodeVersions->unlock(page_num);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::moveRightLocked
+// -----------------------------------------------------------------------------
+template <class Node, class T>
+void BTreeIndex::moveRightLocked(T key, PageId& page_num, Page*& page)
+{
+    // The right sibling is locked before the node is unlocked, so no split gets in between
+    while(1){
+        const Node* node = reinterpret_cast<const Node*>(page);
+        PageId sibling_num = node->rightSibPageNo;
+        if(sibling_num == Page::INVALID_NUMBER || !(node->highKey < key)){
+            return;
+        }
+        nodeVersions->lock(sibling_num);
+        bufMgr->unPinPage((BlobFile*)file, page_num, false);
+        nodeVersions->unlock(page_num);
+        page_num = sibling_num;
+        bufMgr->readPage((BlobFile*)file, page_num, page);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::writeMetaInfo
+// -----------------------------------------------------------------------------
+void BTreeIndex::writeMetaInfo(){
+    // This function writes the root page number and tree height kept in memory back to the header page.
+    // It is only needed when the root changes
+    Page* header_page;
+    bufMgr->readPage((BlobFile*)file, headerPageNum, header_page);
+    IndexMetaInfo* tree_header = reinterpret_cast<IndexMetaInfo*>(header_page);
+    tree_header->rootPageNo = rootPageNum;
+    tree_header->height = treeHeight;
+    tree_header->bloomBitsPerKey = bloomBitsPerKey;
+    tree_header->bloomPageCount = (int)bloomPageNums.size();
+    tree_header->bloomKeyCount = bloomKeyCount;
+    std::copy(bloomPageNums.begin(), bloomPageNums.end(), tree_header->bloomPageNo);
+    bufMgr->unPinPage((BlobFile*)file, headerPageNum, true);
+}
+
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::splitFillAt
+// -----------------------------------------------------------------------------
+double BTreeIndex::splitFillAt(const NodePath& path, int depth, int position, int total_key) const
+{
+    // A node is the rightmost one of its level if every recorded node above it was left through its last child
+    if(position < total_key){
+        return splitFill;
+    }
+    for(int d = 0; d < depth; d++){
+        if(path.entries[d].position != path.entries[d].keySize){
+            return splitFill;
+        }
+    }
+    return rightmostSplitFill;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::deleteEntry
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::deleteEntry(const void *key, const RecordId rid)
+{
+    // Scans keep leaf pages pinned, which may be merged away by the delete
+    endOpenScans();
+
+    // Read the key as the type of the indexed attribute and delete it from nodes laid out for that type
+    switch(attributeType){
+    case INTEGER:
+        deleteEntryTyped(keyValue<int>(key), rid);
+        break;
+    case DOUBLE:
+        deleteEntryTyped(keyValue<double>(key), rid);
+        break;
+    case INT64:
+        deleteEntryTyped(keyValue<std::int64_t>(key), rid);
+        break;
+    case STRING:
+        deleteEntryString((const char*)key, stringKeyLength((const char*)key), rid);
+        break;
+    default:
+        break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::deleteEntryTyped
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::deleteEntryTyped(T key, const RecordId rid)
+{
+    NodePath path;
+    PageId leaf_num;
+    Page* leaf_page;
+
+    // The entries with the key start in the leaf node the key descends to, and may go on in the leaf nodes on its
+    // right. Look for the entry with the rid among them, moving the recorded path along to the leaf node holding it
+    descendToLeaf(key, &path, leaf_num, leaf_page);
+    while(1){
+        int removed = removeLeafEntry(leaf_page, key, rid);
+        if(removed > 0){
+            break;
+        }
+        bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+        if(removed < 0 || !moveToNextLeaf<NonLeafNode<T> >(path, leaf_num)){
+            throw NoSuchKeyFoundException();
+        }
+        bufMgr->readPage((BlobFile*)file, leaf_num, leaf_page);
+    }
+    bool underflow = path.depth > 0 && leafUnderflows<T>(leaf_page);
+    bufMgr->unPinPage((BlobFile*)file, leaf_num, true);
+    if(!underflow){
+        return;
+    }
+
+    // Rebalance the leaf node, and the recorded ancestors from its parent upwards as long as a merge takes a key
+    // out of them
+    bool merged = rebalanceLeaf<T>(path);
+    refreshResidentNode<T>(path.entries[path.depth - 1].pageNo);
+    for(int depth = path.depth - 1; depth >= 0 && merged; depth--){
+        merged = rebalanceNonLeaf<T>(path, depth);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::removeLeafEntry
+// -----------------------------------------------------------------------------
+template <class T>
+int BTreeIndex::removeLeafEntry(Page* leaf_page, T key, const RecordId rid){
+    LeafNode<T>* leaf_node = reinterpret_cast<LeafNode<T>*>(leaf_page);
+    const T* keys;
+    const RecordId* rids;
+    if(leafEntryArrays(leaf_page, keys, rids)){
+        int position = lowerBound(keys, leaf_node->keySize, key);
+        while(position < leaf_node->keySize && !(key < keys[position]) && rids[position] != rid){
+            position++;
+        }
+        if(position == leaf_node->keySize){
+            return 0;
+        }
+        if(key < keys[position]){
+            return -1;
+        }
+        if(leaf_node->format == COVERING_LIST){
+            removeCoveringEntries(reinterpret_cast<CoveringLeafNode<T>*>(leaf_page), position, position + 1);
+            return 1;
+        }
+
+        // Remove the entry, shifting the entries on its right one position to the left
+        for(int i = position; i < leaf_node->keySize - 1; i++){
+            leaf_node->keyArray[i] = leaf_node->keyArray[i+1];
+            leaf_node->ridArray[i] = leaf_node->ridArray[i+1];
+        }
+        leaf_node->keySize--;
+        return 1;
+    }
+    if(leaf_node->format == PACKED_LIST){
+        // Find the entry by unpacking single values, then pack the node again without it, which always fits
+        PackedLeafNode<T>* packed_node = reinterpret_cast<PackedLeafNode<T>*>(leaf_page);
+        int position = packedLowerBound(packed_node, key);
+        while(position < packed_node->keySize && !(key < packedKey(packed_node, position)) &&
+              packedRid(packed_node, position) != rid){
+            position++;
+        }
+        if(position == packed_node->keySize){
+            return 0;
+        }
+        if(key < packedKey(packed_node, position)){
+            return -1;
+        }
+        std::vector<T> packed_keys(packed_node->keySize);
+        std::vector<RecordId> packed_rids(packed_node->keySize);
+        decodePackedLeaf(packed_node, packed_keys.data(), packed_rids.data());
+        packed_keys.erase(packed_keys.begin() + position);
+        packed_rids.erase(packed_rids.begin() + position);
+        encodePackedLeaf(packed_node, packed_keys.data(), packed_rids.data(), (int)packed_keys.size());
+        return 1;
+    }
+
+    // A key is in a posting list node once, and the rid can only be in the right sibling if the key is the last one
+    PostingLeafNode<T>* posting_node = reinterpret_cast<PostingLeafNode<T>*>(leaf_page);
+    int slot = postingLowerBound(posting_node, key);
+    if(slot == posting_node->keySize){
+        return 0;
+    }
+    if(key < posting_node->slots()[slot].key){
+        return -1;
+    }
+    int not_found = (slot == posting_node->keySize - 1) ? 0 : -1;
+    if(posting_node->slots()[slot].overflowPageNo != Page::INVALID_NUMBER){
+        if(!removeOverflowRid(posting_node->slots()[slot].overflowPageNo, rid)){
+            return not_found;
+        }
+        if(--posting_node->slots()[slot].ridCount > 0){
+            return 1;
+        }
+    }
+
+    // Otherwise the node is decoded and written back without the entry, as an entry list again if it fits and
+    // posting lists are no longer worth it
+    std::vector<Posting<T> > postings;
+    decodePostingLeaf(posting_node, postings);
+    Posting<T>& posting = postings[slot];
+    if(posting.ridCount > 0){
+        std::vector<RecordId>::iterator found = std::lower_bound(posting.rids.begin(), posting.rids.end(), rid, ridLess);
+        if(found == posting.rids.end() || *found != rid){
+            return not_found;
+        }
+        posting.rids.erase(found);
+        posting.ridCount--;
+    }
+    if(posting.ridCount == 0){
+        postings.erase(postings.begin() + slot);
+    }
+    encodeLeaf(leaf_page, postings, 0, (int)postings.size());
+    return 1;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::moveToNextLeaf
+// -----------------------------------------------------------------------------
+template <class NonLeaf>
+bool BTreeIndex::moveToNextLeaf(NodePath& path, PageId& page_num, bool backward){
+    // Go up to the lowest recorded node with a child on the right (left if backward) of the one followed
+    int depth = path.depth - 1;
+    while(depth >= 0 && path.entries[depth].position == (backward ? 0 : path.entries[depth].keySize)){
+        depth--;
+    }
+    if(depth < 0){
+        return false;
+    }
+
+    // Follow that child, then the leftmost (rightmost) children down to the leaf level, recording them like a descent
+    path.entries[depth].position += backward ? -1 : 1;
+    PageId child_num = Page::INVALID_NUMBER;
+    for(int d = depth; d < path.depth; d++){
+        PathEntry& entry = path.entries[d];
+        Page* page;
+        if(d > depth){
+            entry.pageNo = child_num;
+        }
+        bufMgr->readPage((BlobFile*)file, entry.pageNo, page);
+        const NonLeaf* non_leaf_node = reinterpret_cast<const NonLeaf*>(page);
+        entry.keySize = non_leaf_node->keySize;
+        if(d > depth){
+            entry.position = backward ? entry.keySize : 0;
+        }
+        child_num = childPageNo(non_leaf_node, entry.position);
+        bufMgr->unPinPage((BlobFile*)file, entry.pageNo, false);
+    }
+    page_num = child_num;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::rebalanceLeaf
+// -----------------------------------------------------------------------------
+template <class T>
+bool BTreeIndex::rebalanceLeaf(const NodePath& path){
+    const PathEntry& parent_entry = path.entries[path.depth - 1];
+    Page* parent_page;
+    bufMgr->readPage((BlobFile*)file, parent_entry.pageNo, parent_page);
+    NonLeafNode<T>* parent_node = reinterpret_cast<NonLeafNode<T>*>(parent_page);
+    if(parent_node->keySize == 0){
+        bufMgr->unPinPage((BlobFile*)file, parent_entry.pageNo, false);
+        return false;
+    }
+
+    // Pair the leaf node with its sibling on the left if it has one, otherwise with its sibling on the right. Key
+    // left_pos of the parent separates the two
+    int left_pos = (parent_entry.position > 0) ? parent_entry.position - 1 : 0;
+    PageId left_num = parent_node->pageNoArray[left_pos];
+    PageId right_num = parent_node->pageNoArray[left_pos + 1];
+    Page* left_page;
+    Page* right_page;
+    bufMgr->readPage((BlobFile*)file, left_num, left_page);
+    bufMgr->readPage((BlobFile*)file, right_num, right_page);
+    LeafNode<T>* left_node = reinterpret_cast<LeafNode<T>*>(left_page);
+    LeafNode<T>* right_node = reinterpret_cast<LeafNode<T>*>(right_page);
+    if(left_node->format == POSTING_LIST || right_node->format == POSTING_LIST){
+        return rebalancePostingLeaves(parent_entry.pageNo, parent_node, left_pos, left_num, left_page, right_num, right_page);
+    }
+    if(left_node->format == COVERING_LIST){
+        return rebalanceCoveringLeaves(parent_entry.pageNo, parent_node, left_pos, left_num, left_page, right_num, right_page);
+    }
+    if(left_node->format == PACKED_LIST){
+        return rebalancePackedLeaves(parent_entry.pageNo, parent_node, left_pos, left_num, left_page, right_num, right_page);
+    }
+
+    // If both fit in one node, move the entries of the right node into the left node, and take the right node out
+    // of the leaf level and out of the parent
+    if(left_node->keySize + right_node->keySize <= NodeCapacity<T>::LEAF){
+        for(int i = 0; i < right_node->keySize; i++){
+            left_node->keyArray[left_node->keySize + i] = right_node->keyArray[i];
+            left_node->ridArray[left_node->keySize + i] = right_node->ridArray[i];
+        }
+        left_node->keySize += right_node->keySize;
+        left_node->rightSibPageNo = right_node->rightSibPageNo;
+        left_node->highKey = right_node->highKey;
+        if(left_node->rightSibPageNo != Page::INVALID_NUMBER){
+            setLeftSibling<LeafNode<T> >(left_node->rightSibPageNo, left_num);
+        }
+        for(int i = left_pos; i < parent_node->keySize - 1; i++){
+            parent_node->keyArray[i] = parent_node->keyArray[i+1];
+            parent_node->pageNoArray[i+1] = parent_node->pageNoArray[i+2];
+        }
+        parent_node->keySize--;
+        bufMgr->unPinPage((BlobFile*)file, left_num, true);
+        bufMgr->unPinPage((BlobFile*)file, right_num, false);
+        bufMgr->unPinPage((BlobFile*)file, parent_entry.pageNo, true);
+        bufMgr->disposePage((BlobFile*)file, right_num);
+        return true;
+    }
+
+    // Otherwise move entries from the fuller node to the other one, so the left node holds half of the entries
+    // rounded up like after a split, and the last key of the left node separates them again
+    int total_key = left_node->keySize + right_node->keySize;
+    int left_count = (total_key + 1) / 2;
+    if(left_count > left_node->keySize){
+        int moved = left_count - left_node->keySize;
+        for(int i = 0; i < moved; i++){
+            left_node->keyArray[left_node->keySize + i] = right_node->keyArray[i];
+            left_node->ridArray[left_node->keySize + i] = right_node->ridArray[i];
+        }
+        for(int i = 0; i < right_node->keySize - moved; i++){
+            right_node->keyArray[i] = right_node->keyArray[i + moved];
+            right_node->ridArray[i] = right_node->ridArray[i + moved];
+        }
+    }
+    else{
+        int moved = left_node->keySize - left_count;
+        for(int i = right_node->keySize - 1; i >= 0; i--){
+            right_node->keyArray[i + moved] = right_node->keyArray[i];
+            right_node->ridArray[i + moved] = right_node->ridArray[i];
+        }
+        for(int i = 0; i < moved; i++){
+            right_node->keyArray[i] = left_node->keyArray[left_count + i];
+            right_node->ridArray[i] = left_node->ridArray[left_count + i];
+        }
+    }
+    left_node->keySize = left_count;
+    right_node->keySize = total_key - left_count;
+    parent_node->keyArray[left_pos] = left_node->keyArray[left_count - 1];
+    left_node->highKey = parent_node->keyArray[left_pos];
+    bufMgr->unPinPage((BlobFile*)file, left_num, true);
+    bufMgr->unPinPage((BlobFile*)file, right_num, true);
+    bufMgr->unPinPage((BlobFile*)file, parent_entry.pageNo, true);
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::rebalancePostingLeaves
+// -----------------------------------------------------------------------------
+template <class T>
+bool BTreeIndex::rebalancePostingLeaves(PageId parent_num, NonLeafNode<T>* parent_node, int left_pos, PageId left_num,
+                                        Page* left_page, PageId right_num, Page* right_page){
+    // Decode both nodes into one list of postings, where a key ending the left node and starting the right node
+    // becomes one posting again
+    std::vector<Posting<T> > postings;
+    std::vector<Posting<T> > right_postings;
+    decodeLeaf<T>(left_page, postings);
+    decodeLeaf<T>(right_page, right_postings);
+    if(!postings.empty() && !right_postings.empty() && !(postings.back().key < right_postings.front().key)){
+        Posting<T>& left = postings.back();
+        Posting<T>& right = right_postings.front();
+        readPostingOverflow(left);
+        readPostingOverflow(right);
+        std::vector<RecordId> rids(left.rids.size() + right.rids.size());
+        std::merge(left.rids.begin(), left.rids.end(), right.rids.begin(), right.rids.end(), rids.begin(), ridLess);
+        left.rids.swap(rids);
+        left.ridCount += right.ridCount;
+        right_postings.erase(right_postings.begin());
+    }
+    postings.insert(postings.end(), right_postings.begin(), right_postings.end());
+    spillPostings(postings);
+    int n = (int)postings.size();
+    LeafNode<T>* left_node = reinterpret_cast<LeafNode<T>*>(left_page);
+    LeafNode<T>* right_node = reinterpret_cast<LeafNode<T>*>(right_page);
+
+    // If they fit in one node, write them into the left node, and take the right node out of the leaf level and out
+    // of the parent, like rebalanceLeaf
+    if(leafFits(postings, 0, n)){
+        encodeLeaf(left_page, postings, 0, n);
+        left_node->rightSibPageNo = right_node->rightSibPageNo;
+        left_node->highKey = right_node->highKey;
+        if(left_node->rightSibPageNo != Page::INVALID_NUMBER){
+            setLeftSibling<LeafNode<T> >(left_node->rightSibPageNo, left_num);
+        }
+        for(int i = left_pos; i < parent_node->keySize - 1; i++){
+            parent_node->keyArray[i] = parent_node->keyArray[i+1];
+            parent_node->pageNoArray[i+1] = parent_node->pageNoArray[i+2];
+        }
+        parent_node->keySize--;
+        bufMgr->unPinPage((BlobFile*)file, left_num, true);
+        bufMgr->unPinPage((BlobFile*)file, right_num, false);
+        bufMgr->unPinPage((BlobFile*)file, parent_num, true);
+        bufMgr->disposePage((BlobFile*)file, right_num);
+        return true;
+    }
+
+    // Otherwise split them anew into halves of about equal bytes, and the last key of the left node separates them
+    int split = chooseLeafSplit(postings, 0.5);
+    encodeLeaf(left_page, postings, 0, split);
+    encodeLeaf(right_page, postings, split, n);
+    parent_node->keyArray[left_pos] = postings[split - 1].key;
+    left_node->highKey = parent_node->keyArray[left_pos];
+    bufMgr->unPinPage((BlobFile*)file, left_num, true);
+    bufMgr->unPinPage((BlobFile*)file, right_num, true);
+    bufMgr->unPinPage((BlobFile*)file, parent_num, true);
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::rebalanceCoveringLeaves
+// -----------------------------------------------------------------------------
+template <class T>
+bool BTreeIndex::rebalanceCoveringLeaves(PageId parent_num, NonLeafNode<T>* parent_node, int left_pos, PageId left_num,
+                                         Page* left_page, PageId right_num, Page* right_page){
+    CoveringLeafNode<T>* left_node = reinterpret_cast<CoveringLeafNode<T>*>(left_page);
+    CoveringLeafNode<T>* right_node = reinterpret_cast<CoveringLeafNode<T>*>(right_page);
+
+    // If both fit in one node, move the entries of the right node into the left node, and take the right node out
+    // of the leaf level and out of the parent, like rebalanceLeaf
+    if(left_node->keySize + right_node->keySize <= left_node->capacity){
+        insertCoveringEntries(left_node, left_node->keySize, right_node, 0, right_node->keySize);
+        left_node->rightSibPageNo = right_node->rightSibPageNo;
+        left_node->highKey = right_node->highKey;
+        if(left_node->rightSibPageNo != Page::INVALID_NUMBER){
+            setLeftSibling<LeafNode<T> >(left_node->rightSibPageNo, left_num);
+        }
+        for(int i = left_pos; i < parent_node->keySize - 1; i++){
+            parent_node->keyArray[i] = parent_node->keyArray[i+1];
+            parent_node->pageNoArray[i+1] = parent_node->pageNoArray[i+2];
+        }
+        parent_node->keySize--;
+        bufMgr->unPinPage((BlobFile*)file, left_num, true);
+        bufMgr->unPinPage((BlobFile*)file, right_num, false);
+        bufMgr->unPinPage((BlobFile*)file, parent_num, true);
+        bufMgr->disposePage((BlobFile*)file, right_num);
+        return true;
+    }
+
+    // Otherwise move entries from the fuller node to the other one, so the left node holds half of the entries
+    // rounded up, and the last key of the left node separates them again
+    int left_count = (left_node->keySize + right_node->keySize + 1) / 2;
+    if(left_count > left_node->keySize){
+        int moved = left_count - left_node->keySize;
+        insertCoveringEntries(left_node, left_node->keySize, right_node, 0, moved);
+        removeCoveringEntries(right_node, 0, moved);
+    }
+    else{
+        insertCoveringEntries(right_node, 0, left_node, left_count, left_node->keySize);
+        removeCoveringEntries(left_node, left_count, left_node->keySize);
+    }
+    parent_node->keyArray[left_pos] = left_node->keys()[left_count - 1];
+    left_node->highKey = parent_node->keyArray[left_pos];
+    bufMgr->unPinPage((BlobFile*)file, left_num, true);
+    bufMgr->unPinPage((BlobFile*)file, right_num, true);
+    bufMgr->unPinPage((BlobFile*)file, parent_num, true);
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::rebalancePackedLeaves
+// -----------------------------------------------------------------------------
+template <class T>
+bool BTreeIndex::rebalancePackedLeaves(PageId parent_num, NonLeafNode<T>* parent_node, int left_pos, PageId left_num,
+                                       Page* left_page, PageId right_num, Page* right_page){
+    PackedLeafNode<T>* left_node = reinterpret_cast<PackedLeafNode<T>*>(left_page);
+    PackedLeafNode<T>* right_node = reinterpret_cast<PackedLeafNode<T>*>(right_page);
+    int left_size = left_node->keySize;
+    int n = left_size + right_node->keySize;
+    std::vector<T> keys(n);
+    std::vector<RecordId> rids(n);
+    decodePackedLeaf(left_node, keys.data(), rids.data());
+    decodePackedLeaf(right_node, keys.data() + left_size, rids.data() + left_size);
+
+    // If both fit in one node, pack them into the left node, and take the right node out of the leaf level and out
+    // of the parent, like rebalanceLeaf
+    if(encodePackedLeaf(left_node, keys.data(), rids.data(), n)){
+        left_node->rightSibPageNo = right_node->rightSibPageNo;
+        left_node->highKey = right_node->highKey;
+        if(left_node->rightSibPageNo != Page::INVALID_NUMBER){
+            setLeftSibling<LeafNode<T> >(left_node->rightSibPageNo, left_num);
+        }
+        for(int i = left_pos; i < parent_node->keySize - 1; i++){
+            parent_node->keyArray[i] = parent_node->keyArray[i+1];
+            parent_node->pageNoArray[i+1] = parent_node->pageNoArray[i+2];
+        }
+        parent_node->keySize--;
+        bufMgr->unPinPage((BlobFile*)file, left_num, true);
+        bufMgr->unPinPage((BlobFile*)file, right_num, false);
+        bufMgr->unPinPage((BlobFile*)file, parent_num, true);
+        bufMgr->disposePage((BlobFile*)file, right_num);
+        return true;
+    }
+
+    // Otherwise split them anew closest to half of the entries, which at worst is where they were split before,
+    // and the last key of the left node separates them again
+    int split = choosePackedSplit(keys.data(), rids.data(), n, 0.5);
+    encodePackedLeaf(left_node, keys.data(), rids.data(), split);
+    encodePackedLeaf(right_node, keys.data() + split, rids.data() + split, n - split);
+    parent_node->keyArray[left_pos] = keys[split - 1];
+    left_node->highKey = parent_node->keyArray[left_pos];
+    bufMgr->unPinPage((BlobFile*)file, left_num, true);
+    bufMgr->unPinPage((BlobFile*)file, right_num, true);
+    bufMgr->unPinPage((BlobFile*)file, parent_num, true);
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::rebalanceNonLeaf
+// -----------------------------------------------------------------------------
+template <class T>
+bool BTreeIndex::rebalanceNonLeaf(const NodePath& path, int depth){
+    const int non_leaf_size = NodeCapacity<T>::NONLEAF;
+    const PathEntry& entry = path.entries[depth];
+    Page* page;
+    bufMgr->readPage((BlobFile*)file, entry.pageNo, page);
+    NonLeafNode<T>* non_leaf_node = reinterpret_cast<NonLeafNode<T>*>(page);
+    int key_size = non_leaf_node->keySize;
+    PageId only_child_num = non_leaf_node->pageNoArray[0];
+    bufMgr->unPinPage((BlobFile*)file, entry.pageNo, false);
+
+    // The root may hold as few keys as it likes, until its last child is the only one left
+    if(depth == 0){
+        if(key_size == 0){
+            collapseRoot(only_child_num);
+        }
+        return false;
+    }
+    if(key_size >= NodeCapacity<T>::MIDDLENONLEAF){
+        return false;
+    }
+
+    const PathEntry& parent_entry = path.entries[depth - 1];
+    Page* parent_page;
+    bufMgr->readPage((BlobFile*)file, parent_entry.pageNo, parent_page);
+    NonLeafNode<T>* parent_node = reinterpret_cast<NonLeafNode<T>*>(parent_page);
+    if(parent_node->keySize == 0){
+        bufMgr->unPinPage((BlobFile*)file, parent_entry.pageNo, false);
+        return false;
+    }
+    int left_pos = (parent_entry.position > 0) ? parent_entry.position - 1 : 0;
+    PageId left_num = parent_node->pageNoArray[left_pos];
+    PageId right_num = parent_node->pageNoArray[left_pos + 1];
+    Page* left_page;
+    Page* right_page;
+    bufMgr->readPage((BlobFile*)file, left_num, left_page);
+    bufMgr->readPage((BlobFile*)file, right_num, right_page);
+    NonLeafNode<T>* left_node = reinterpret_cast<NonLeafNode<T>*>(left_page);
+    NonLeafNode<T>* right_node = reinterpret_cast<NonLeafNode<T>*>(right_page);
+
+    // If both fit in one node, the separating key comes down from the parent between the keys of the two nodes
+    if(left_node->keySize + 1 + right_node->keySize <= non_leaf_size){
+        left_node->keyArray[left_node->keySize] = parent_node->keyArray[left_pos];
+        for(int i = 0; i < right_node->keySize; i++){
+            left_node->keyArray[left_node->keySize + 1 + i] = right_node->keyArray[i];
+        }
+        for(int i = 0; i <= right_node->keySize; i++){
+            left_node->pageNoArray[left_node->keySize + 1 + i] = right_node->pageNoArray[i];
+        }
+        left_node->keySize += 1 + right_node->keySize;
+        left_node->rightSibPageNo = right_node->rightSibPageNo;
+        left_node->highKey = right_node->highKey;
+        for(int i = left_pos; i < parent_node->keySize - 1; i++){
+            parent_node->keyArray[i] = parent_node->keyArray[i+1];
+            parent_node->pageNoArray[i+1] = parent_node->pageNoArray[i+2];
+        }
+        parent_node->keySize--;
+        updateResidentNode(parent_entry.pageNo, parent_node, false);
+        bufMgr->unPinPage((BlobFile*)file, left_num, true);
+        bufMgr->unPinPage((BlobFile*)file, right_num, false);
+        bufMgr->unPinPage((BlobFile*)file, parent_entry.pageNo, true);
+        bufMgr->disposePage((BlobFile*)file, right_num);
+        return true;
+    }
+
+    // Otherwise rotate keys through the parent: line up the keys of both nodes with the separating key between them,
+    // give the left node the first half, push the middle key up and give the right node the rest
+    T temp_key_array[2 * non_leaf_size + 1];
+    PageId temp_pageid_array[2 * non_leaf_size + 2];
+    int total_key = 0;
+    for(int i = 0; i < left_node->keySize; i++){
+        temp_key_array[total_key] = left_node->keyArray[i];
+        temp_pageid_array[total_key++] = left_node->pageNoArray[i];
+    }
+    temp_key_array[total_key] = parent_node->keyArray[left_pos];
+    temp_pageid_array[total_key++] = left_node->pageNoArray[left_node->keySize];
+    for(int i = 0; i < right_node->keySize; i++){
+        temp_key_array[total_key] = right_node->keyArray[i];
+        temp_pageid_array[total_key++] = right_node->pageNoArray[i];
+    }
+    temp_pageid_array[total_key] = right_node->pageNoArray[right_node->keySize];
+
+    int left_count = total_key / 2;
+    left_node->keySize = left_count;
+    for(int i = 0; i < left_count; i++){
+        left_node->keyArray[i] = temp_key_array[i];
+        left_node->pageNoArray[i] = temp_pageid_array[i];
+    }
+    left_node->pageNoArray[left_count] = temp_pageid_array[left_count];
+    parent_node->keyArray[left_pos] = temp_key_array[left_count];
+    left_node->highKey = parent_node->keyArray[left_pos];
+    right_node->keySize = total_key - left_count - 1;
+    for(int i = 0; i < right_node->keySize; i++){
+        right_node->keyArray[i] = temp_key_array[left_count + 1 + i];
+        right_node->pageNoArray[i] = temp_pageid_array[left_count + 1 + i];
+    }
+    right_node->pageNoArray[right_node->keySize] = temp_pageid_array[total_key];
+    updateResidentNode(parent_entry.pageNo, parent_node, false);
+    bufMgr->unPinPage((BlobFile*)file, left_num, true);
+    bufMgr->unPinPage((BlobFile*)file, right_num, true);
+    bufMgr->unPinPage((BlobFile*)file, parent_entry.pageNo, true);
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::collapseRoot
+// -----------------------------------------------------------------------------
+void BTreeIndex::collapseRoot(PageId child_num){
+    // The old root page goes to the free list of the index file, and the tree gets one level lower
+    bufMgr->disposePage((BlobFile*)file, rootPageNum);
+    rootPageNum = child_num;
+    treeHeight--;
+    rootIsLeaf = (treeHeight == 1);
+    resident.clear();
+    writeMetaInfo();
+}
+
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::lookup
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::lookup(const void* key, RecordId& outRid)
+{
+    return lookupEntries(key, &outRid, NULL) > 0;
+}
+
+size_t BTreeIndex::lookupAll(const void* key, std::vector<RecordId>& outRids)
+{
+    return lookupEntries(key, NULL, &outRids);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::lookupEntries
+// -----------------------------------------------------------------------------
+size_t BTreeIndex::lookupEntries(const void* key, RecordId* outRid, std::vector<RecordId>* outRids)
+{
+    // A key the Bloom filter rules out is not in the index, so the tree need not be descended
+    if(!bloomMayContain(key)){
+        return 0;
+    }
+    size_t found = 0;
+    switch(attributeType){
+    case INTEGER:
+        found = nodeVersions != NULL ? lookupConcurrent(keyValue<int>(key), outRid, outRids)
+                                     : lookupTyped(keyValue<int>(key), outRid, outRids);
+        break;
+    case DOUBLE:
+        found = nodeVersions != NULL ? lookupConcurrent(keyValue<double>(key), outRid, outRids)
+                                     : lookupTyped(keyValue<double>(key), outRid, outRids);
+        break;
+    case INT64:
+        found = nodeVersions != NULL ? lookupConcurrent(keyValue<std::int64_t>(key), outRid, outRids)
+                                     : lookupTyped(keyValue<std::int64_t>(key), outRid, outRids);
+        break;
+    case STRING:
+        found = lookupString((const char*)key, stringKeyLength((const char*)key), outRid, outRids);
+        break;
+    default:
+        break;
+    }
+    if(found == 0 && !bloomPageNums.empty()){
+        bloomStats.falsePositives++;
+    }
+    return found;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::bloomKeyHash
+// -----------------------------------------------------------------------------
+std::uint64_t BTreeIndex::bloomKeyHash(const void* key) const
+{
+    switch(attributeType){
+    case INTEGER:
+        return bloomHash(key, sizeof(int));
+    case DOUBLE:
+    {
+        // 0.0 and -0.0 are the same key with different bytes
+        double value = keyValue<double>(key);
+        if(value == 0){
+            value = 0;
+        }
+        return bloomHash(&value, sizeof(double));
+    }
+    case INT64:
+        return bloomHash(key, sizeof(std::int64_t));
+    default:
+        return bloomHash(key, stringKeyLength((const char*)key));
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::bloomMayContain
+// -----------------------------------------------------------------------------
+bool BTreeIndex::bloomMayContain(const void* key)
+{
+    if(bloomPageNums.empty()){
+        return true;
+    }
+    std::uint64_t hash = bloomKeyHash(key);
+    int block = bloomBlock(hash, (int)bloomPageNums.size() * BLOOMBLOCKSPERPAGE);
+    PageId page_num = bloomPageNums[block / BLOOMBLOCKSPERPAGE];
+    Page* page;
+    bufMgr->readPage((BlobFile*)file, page_num, page);
+    bool may_contain = bloomTestBits(reinterpret_cast<BloomFilterPage*>(page)->blocks[block % BLOOMBLOCKSPERPAGE], hash,
+                                     bloomProbeCount);
+    bufMgr->unPinPage((BlobFile*)file, page_num, false);
+    bloomStats.lookups++;
+    if(!may_contain){
+        bloomStats.rejected++;
+    }
+    return may_contain;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::bloomSetKey
+// -----------------------------------------------------------------------------
+void BTreeIndex::bloomSetKey(const void* key)
+{
+    std::uint64_t hash = bloomKeyHash(key);
+    int block = bloomBlock(hash, (int)bloomPageNums.size() * BLOOMBLOCKSPERPAGE);
+    PageId page_num = bloomPageNums[block / BLOOMBLOCKSPERPAGE];
+    Page* page;
+    bufMgr->readPage((BlobFile*)file, page_num, page);
+    bloomSetBits(reinterpret_cast<BloomFilterPage*>(page)->blocks[block % BLOOMBLOCKSPERPAGE], hash, bloomProbeCount);
+    bufMgr->unPinPage((BlobFile*)file, page_num, true);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::bloomAdd
+// -----------------------------------------------------------------------------
+void BTreeIndex::bloomAdd(const void* key)
+{
+    bloomSetKey(key);
+    bloomKeyCount++;
+    // A filter which cannot grow any more takes in the keys anyway, and lets more keys through
+    int pages = (int)bloomPageNums.size();
+    if(bloomKeyCount > bloomCapacity(pages, bloomBitsPerKey) && pages < MAXBLOOMPAGES){
+        rebuildBloomFilter();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::rebuildBloomFilter
+// -----------------------------------------------------------------------------
+void BTreeIndex::rebuildBloomFilter()
+{
+    // The new filter has room for as many inserts as there are entries before it fills up
+    std::int64_t entries = addLeafKeysToBloomFilter(false);
+    for(size_t i = 0; i < bloomPageNums.size(); i++){
+        bufMgr->disposePage((BlobFile*)file, bloomPageNums[i]);
+    }
+    bloomPageNums.assign(bloomPageCount(2 * entries, bloomBitsPerKey), (PageId)Page::INVALID_NUMBER);
+    for(size_t i = 0; i < bloomPageNums.size(); i++){
+        Page* page;
+        bufMgr->allocPage((BlobFile*)file, bloomPageNums[i], page);
+        memset(reinterpret_cast<BloomFilterPage*>(page), 0, sizeof(BloomFilterPage));
+        bufMgr->unPinPage((BlobFile*)file, bloomPageNums[i], true);
+    }
+    addLeafKeysToBloomFilter(true);
+    bloomKeyCount = entries;
+    writeMetaInfo();
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::addLeafKeysToBloomFilter
+// -----------------------------------------------------------------------------
+std::int64_t BTreeIndex::addLeafKeysToBloomFilter(bool add)
+{
+    switch(attributeType){
+    case INTEGER:
+        return addTypedLeafKeysToBloomFilter<int>(add);
+    case DOUBLE:
+        return addTypedLeafKeysToBloomFilter<double>(add);
+    case INT64:
+        return addTypedLeafKeysToBloomFilter<std::int64_t>(add);
+    default:
+        return addStringLeafKeysToBloomFilter(add);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::addTypedLeafKeysToBloomFilter
+// -----------------------------------------------------------------------------
+template <class T>
+std::int64_t BTreeIndex::addTypedLeafKeysToBloomFilter(bool add)
+{
+    std::int64_t entries = 0;
+    std::vector<Posting<T> > postings;
+    std::vector<T> packed_keys;
+    std::vector<RecordId> packed_rids;
+    PageId leaf_num = firstLeafPageNum;
+    while(leaf_num != Page::INVALID_NUMBER){
+        Page* leaf_page;
+        bufMgr->readPage((BlobFile*)file, leaf_num, leaf_page);
+        const T* keys;
+        const RecordId* rids;
+        if(!add){
+            entries += leafEntryCount<T>(leaf_page);
+        }
+        else if(leafEntryArrays(leaf_page, keys, rids)){
+            // The entries of a key are next to each other, its bits need only be set once
+            int size = reinterpret_cast<LeafNode<T>*>(leaf_page)->keySize;
+            for(int i = 0; i < size; i++){
+                if(i == 0 || keys[i] != keys[i - 1]){
+                    bloomSetKey(&keys[i]);
+                }
+            }
+        }
+        else if(reinterpret_cast<LeafNode<T>*>(leaf_page)->format == PACKED_LIST){
+            const PackedLeafNode<T>* packed_node = reinterpret_cast<const PackedLeafNode<T>*>(leaf_page);
+            packed_keys.resize(packed_node->keySize);
+            packed_rids.resize(packed_node->keySize);
+            decodePackedLeaf(packed_node, packed_keys.data(), packed_rids.data());
+            for(size_t i = 0; i < packed_keys.size(); i++){
+                if(i == 0 || packed_keys[i] != packed_keys[i - 1]){
+                    bloomSetKey(&packed_keys[i]);
+                }
+            }
+        }
+        else{
+            postings.clear();
+            decodePostingLeaf(reinterpret_cast<const PostingLeafNode<T>*>(leaf_page), postings);
+            for(size_t i = 0; i < postings.size(); i++){
+                bloomSetKey(&postings[i].key);
+            }
+        }
+        PageId sibling_num = reinterpret_cast<LeafNode<T>*>(leaf_page)->rightSibPageNo;
+        bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+        leaf_num = sibling_num;
+    }
+    return entries;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::addStringLeafKeysToBloomFilter
+// -----------------------------------------------------------------------------
+std::int64_t BTreeIndex::addStringLeafKeysToBloomFilter(bool add)
+{
+    std::int64_t entries = 0;
+    std::vector<std::string> keys;
+    std::vector<RecordId> rids;
+    PageId leaf_num = firstLeafPageNum;
+    while(leaf_num != Page::INVALID_NUMBER){
+        Page* leaf_page;
+        bufMgr->readPage((BlobFile*)file, leaf_num, leaf_page);
+        StringLeafNode* leaf_node = reinterpret_cast<StringLeafNode*>(leaf_page);
+        entries += leaf_node->keySize;
+        if(add){
+            keys.clear();
+            rids.clear();
+            decodeStringNode(leaf_node, keys, rids);
+            for(size_t i = 0; i < keys.size(); i++){
+                if(i == 0 || keys[i] != keys[i - 1]){
+                    bloomSetKey(keys[i].c_str());
+                }
+            }
+        }
+        PageId sibling_num = leaf_node->rightSibPageNo;
+        bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+        leaf_num = sibling_num;
+    }
+    return entries;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::singleKeyBounds
+// -----------------------------------------------------------------------------
+bool BTreeIndex::singleKeyBounds(const void* lowVal, const void* highVal) const
+{
+    switch(attributeType){
+    case INTEGER:
+        return keyValue<int>(lowVal) == keyValue<int>(highVal);
+    case DOUBLE:
+        return keyValue<double>(lowVal) == keyValue<double>(highVal);
+    case INT64:
+        return keyValue<std::int64_t>(lowVal) == keyValue<std::int64_t>(highVal);
+    default:
+    {
+        int length = stringKeyLength((const char*)lowVal);
+        if(!keyColumns.empty() && length < compositeKeyBytes){
+            return false;
+        }
+        return length == stringKeyLength((const char*)highVal) && memcmp(lowVal, highVal, length) == 0;
+    }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::lookupTyped
+// -----------------------------------------------------------------------------
+template <class T>
+size_t BTreeIndex::lookupTyped(T key, RecordId* outRid, std::vector<RecordId>* outRids)
+{
+    Page* leaf_page;
+    PageId leaf_num;
+    descendToLeaf(key, NULL, leaf_num, leaf_page);
+
+    // Entries with the key start at the first key greater than or equal to it, which may be in a sibling on the
+    // right, and may go on over several siblings
+    size_t found = 0;
+    while(1){
+        bool more;
+        found += lookupLeaf(leaf_page, key, outRid, outRids, more);
+        PageId sibling_num = reinterpret_cast<LeafNode<T>*>(leaf_page)->rightSibPageNo;
+        if(!more || sibling_num == Page::INVALID_NUMBER || (outRids == NULL && found > 0)){
+            break;
+        }
+        bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+        leaf_num = sibling_num;
+        bufMgr->readPage((BlobFile*)file, leaf_num, leaf_page);
+    }
+    bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+    return found;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::lookupLeaf
+// -----------------------------------------------------------------------------
+template <class T>
+size_t BTreeIndex::lookupLeaf(const Page* leaf_page, T key, RecordId* outRid, std::vector<RecordId>* outRids, bool& more)
+{
+    const LeafNode<T>* leaf_node = reinterpret_cast<const LeafNode<T>*>(leaf_page);
+    const T* entry_keys;
+    const RecordId* entry_rids;
+    if(leafEntryArrays(leaf_page, entry_keys, entry_rids)){
+        int position = lowerBound(entry_keys, leaf_node->keySize, key);
+        size_t found = 0;
+        while(position < leaf_node->keySize && !(key < entry_keys[position])){
+            found++;
+            if(outRids == NULL){
+                *outRid = entry_rids[position];
+                break;
+            }
+            outRids->push_back(entry_rids[position]);
+            position++;
+        }
+        more = (position == leaf_node->keySize);
+        return found;
+    }
+    if(leaf_node->format == PACKED_LIST){
+        // Only the keys the search probes and the entries with the key are unpacked
+        const PackedLeafNode<T>* packed_node = reinterpret_cast<const PackedLeafNode<T>*>(leaf_page);
+        int position = packedLowerBound(packed_node, key);
+        size_t found = 0;
+        while(position < packed_node->keySize && !(key < packedKey(packed_node, position))){
+            found++;
+            if(outRids == NULL){
+                *outRid = packedRid(packed_node, position);
+                break;
+            }
+            outRids->push_back(packedRid(packed_node, position));
+            position++;
+        }
+        more = (position == packed_node->keySize);
+        return found;
+    }
+
+    // A key is in a posting list node once, with all its entries in the node, and the entries may only go on in
+    // the right sibling if it is the last key
+    const PostingLeafNode<T>* posting_node = reinterpret_cast<const PostingLeafNode<T>*>(leaf_page);
+    int slot = postingLowerBound(posting_node, key);
+    more = (slot >= posting_node->keySize - 1);
+    if(slot == posting_node->keySize || key < posting_node->slots()[slot].key){
+        more = more && slot == posting_node->keySize;
+        return 0;
+    }
+    const PostingSlot<T>& posting_slot = posting_node->slots()[slot];
+    std::vector<RecordId> first;
+    std::vector<RecordId>& rids = (outRids == NULL) ? first : *outRids;
+    if(posting_slot.overflowPageNo == Page::INVALID_NUMBER){
+        decodeRidList(posting_node->ridData() + posting_slot.ridOffset, (outRids == NULL) ? 1 : posting_slot.ridCount, rids);
+    }
+    else if(outRids == NULL){
+        Page* page;
+        bufMgr->readPage((BlobFile*)file, posting_slot.overflowPageNo, page);
+        decodeRidList(reinterpret_cast<const PostingOverflowPage*>(page)->data, 1, rids);
+        bufMgr->unPinPage((BlobFile*)file, posting_slot.overflowPageNo, false);
+    }
+    else{
+        readOverflowRids(posting_slot.overflowPageNo, rids);
+    }
+    if(outRids == NULL){
+        *outRid = first[0];
+        return 1;
+    }
+    return posting_slot.ridCount;
+}
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::lookupConcurrent
+// -----------------------------------------------------------------------------
+template <class T>
+size_t BTreeIndex::lookupConcurrent(T key, RecordId* outRid, std::vector<RecordId>* outRids)
+{
+    // Entries with the key may go on over several leaves like in lookupTyped. Each leaf is read on its own, and the
+    // sibling followed is the one linked to when it was read, so entries a split moves meanwhile are found once
+    PageId leaf_num;
+    descendOptimistic(key, (NodePath*)NULL, leaf_num);
+    size_t found = 0;
+    while(1){
+        bool more;
+        PageId sibling_num;
+        found += lookupLeafConcurrent(leaf_num, key, outRid, outRids, more, sibling_num);
+        if(!more || sibling_num == Page::INVALID_NUMBER || (outRids == NULL && found > 0)){
+            return found;
+        }
+        leaf_num = sibling_num;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::lookupLeafConcurrent
+// -----------------------------------------------------------------------------
+template <class T>
+size_t BTreeIndex::lookupLeafConcurrent(PageId& page_num, T key, RecordId* outRid, std::vector<RecordId>* outRids,
+                                        bool& more, PageId& sibling_num)
+{
+    // The entries of a read which has to be done again are dropped
+    size_t start = (outRids == NULL) ? 0 : outRids->size();
+    while(1){
+        std::uint64_t version = nodeVersions->read(page_num);
+        if(NodeVersions::locked(version)){
+            std::this_thread::yield();
+            continue;
+        }
+        Page* leaf_page;
+        bufMgr->readPage((BlobFile*)file, page_num, leaf_page);
+        const LeafNode<T>* leaf_node = reinterpret_cast<const LeafNode<T>*>(leaf_page);
+        size_t found = 0;
+        bool beyond;
+        if(leaf_node->format == ENTRY_LIST){
+            // Like lookupLeaf, within bounds since the node may be torn, the entries counting once the version
+            // shows they are not
+            sibling_num = leaf_node->rightSibPageNo;
+            beyond = sibling_num != Page::INVALID_NUMBER && leaf_node->highKey < key;
+            int key_size = std::max(0, std::min(leaf_node->keySize, (int)NodeCapacity<T>::LEAF));
+            int position = beyond ? key_size : lowerBound(leaf_node->keyArray, key_size, key);
+            RecordId first;
+            while(position < key_size && !(key < leaf_node->keyArray[position])){
+                if(found++ == 0){
+                    first = leaf_node->ridArray[position];
+                }
+                if(outRids == NULL){
+                    break;
+                }
+                outRids->push_back(leaf_node->ridArray[position]);
+                position++;
+            }
+            more = (position == key_size);
+            bufMgr->unPinPage((BlobFile*)file, page_num, false);
+            if(!nodeVersions->validate(page_num, version)){
+                if(outRids != NULL){
+                    outRids->resize(start);
+                }
+                continue;
+            }
+            if(outRids == NULL && found > 0){
+                *outRid = first;
+            }
+        }
+        else{
+            // The other formats are read locked
+            nodeVersions->lock(page_num);
+            sibling_num = leaf_node->rightSibPageNo;
+            beyond = sibling_num != Page::INVALID_NUMBER && leaf_node->highKey < key;
+            if(!beyond){
+                found = lookupLeaf(leaf_page, key, outRid, outRids, more);
+            }
+            bufMgr->unPinPage((BlobFile*)file, page_num, false);
+            nodeVersions->unlock(page_num);
+        }
+
+        // A key above the high key went to a node on the right after the descent read the parent
+        if(!beyond){
+            return found;
+        }
+        page_num = sibling_num;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::findScanPage
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::findScanPage(T low_value, Operator low_op, PageId& page_num, int& entry, NodePath* path){
+    // This function is similar to BTreeIndex::findLeafNode, which finds the smallest entry in a
+    // leaf node that satisfies the low bound
+
+    // Locate the first entry greater than (GT) or greater than or equal to (GTE) the low value in the leaf
+    // node which should hold it
+    Page* leaf_page;
+    PageId leaf_num;
+    descendToLeaf(low_value, path, leaf_num, leaf_page);
+    LeafNode<T>* leaf_node = reinterpret_cast<LeafNode<T>*>(leaf_page);
+    entry = leafBound(leaf_page, low_value, low_op == GT);
+
+    // Keys equal to the low value may fill the leaf up to its end, then the first entry which satisfies
+    // the low bound is in a sibling on the right, after any more keys equal to a GT low value. The path follows along
+    while(entry == leafEntryCount<T>(leaf_page) && leaf_node->rightSibPageNo != Page::INVALID_NUMBER){
+        PageId sibling_num = leaf_node->rightSibPageNo;
+        PageId path_leaf_num;
+        if(path != NULL){
+            moveToNextLeaf<NonLeafNode<T> >(*path, path_leaf_num);
+        }
+        bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+        leaf_num = sibling_num;
+        bufMgr->readPage((BlobFile*)file, leaf_num, leaf_page);
+        leaf_node = reinterpret_cast<LeafNode<T>*>(leaf_page);
+        entry = (low_op == GT) ? leafBound(leaf_page, low_value, true) : 0;
+    }
+
+    // If there is no entry which satisfies the low bound, return an invalid page number, otherwise, return the
+    // page-id of the page where is entry is currently in
+    page_num = (entry == leafEntryCount<T>(leaf_page)) ? Page::INVALID_NUMBER : leaf_num;
+    bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::findScanPageDescending
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::findScanPageDescending(T high_value, Operator high_op, PageId& page_num, int& entry, NodePath* path){
+    // Locate the last entry less than (LT) or less than or equal to (LTE) the high value in the leaf node which
+    // should hold it
+    Page* leaf_page;
+    PageId leaf_num;
+    descendToLeaf(high_value, path, leaf_num, leaf_page, high_op == LTE);
+    LeafNode<T>* leaf_node = reinterpret_cast<LeafNode<T>*>(leaf_page);
+    entry = leafBound(leaf_page, high_value, high_op == LTE) - 1;
+
+    // All keys of the leaf may be beyond the high value, then the entry is the last entry of a sibling on the left.
+    // The path follows along
+    while(entry < 0 && leaf_node->leftSibPageNo != Page::INVALID_NUMBER){
+        PageId sibling_num = leaf_node->leftSibPageNo;
+        PageId path_leaf_num;
+        if(path != NULL){
+            moveToNextLeaf<NonLeafNode<T> >(*path, path_leaf_num, true);
+        }
+        bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+        leaf_num = sibling_num;
+        bufMgr->readPage((BlobFile*)file, leaf_num, leaf_page);
+        leaf_node = reinterpret_cast<LeafNode<T>*>(leaf_page);
+        entry = leafEntryCount<T>(leaf_page) - 1;
+    }
+
+    page_num = (entry < 0) ? Page::INVALID_NUMBER : leaf_num;
+    bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::scanLowValue, BTreeIndex::scanHighValue
+// -----------------------------------------------------------------------------
+template <>
+int& BTreeIndex::scanLowValue<int>(IndexCursor& cursor){ return cursor.lowValInt; }
+
+template <>
+double& BTreeIndex::scanLowValue<double>(IndexCursor& cursor){ return cursor.lowValDouble; }
+
+template <>
+std::int64_t& BTreeIndex::scanLowValue<std::int64_t>(IndexCursor& cursor){ return cursor.lowValInt64; }
+
+template <>
+int& BTreeIndex::scanHighValue<int>(IndexCursor& cursor){ return cursor.highValInt; }
+
+template <>
+double& BTreeIndex::scanHighValue<double>(IndexCursor& cursor){ return cursor.highValDouble; }
+
+template <>
+std::int64_t& BTreeIndex::scanHighValue<std::int64_t>(IndexCursor& cursor){ return cursor.highValInt64; }
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::startScan
+// -----------------------------------------------------------------------------
+void BTreeIndex::startScan(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm,
+				   const ScanOrder order)
+{
+    // Add your code below. Please do not remove this line.
+
+    startScan(scanCursor, lowValParm, lowOpParm, highValParm, highOpParm, order);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::startScan (cursor)
+// -----------------------------------------------------------------------------
+void BTreeIndex::startScan(IndexCursor& cursor,
+				   const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm,
+				   const ScanOrder order)
+{
+    // If another scan is already executing on the cursor, that needs to be ended here
+    if(cursor.scanExecuting == true){
+        endScan(cursor);
+    }
+
+    // Handle exceptions before scanning. The operator of a missing bound is not used
+    cursor.lowBounded = (lowValParm != NULL);
+    cursor.highBounded = (highValParm != NULL);
+    if(cursor.lowBounded && !(lowOpParm == GT || lowOpParm == GTE)){ // If lowOp does not contain one of their their expected values, throw BadOpcodesException
+        throw BadOpcodesException();
+    }
+    if(cursor.highBounded && !(highOpParm == LT || highOpParm == LTE)){ // If highOp does not contain one of their their expected values, throw BadOpcodesException
+        throw BadOpcodesException();
+    }
+    cursor.lowOp = lowOpParm;
+    cursor.highOp = highOpParm;
+    cursor.order = order;
+    cursor.readAheadPath.depth = 0;
+
+    // A scan of a single key is a lookup, which finds nothing without descending the tree if the Bloom filter rules
+    // the key out
+    bool single_key = !bloomPageNums.empty() && cursor.lowBounded && cursor.highBounded && lowOpParm == GTE &&
+                      highOpParm == LTE && singleKeyBounds(lowValParm, highValParm);
+    if(single_key && !bloomMayContain(lowValParm)){
+        throw NoSuchKeyFoundException();
+    }
+
+    try{
+        switch(attributeType){
+        case INTEGER:
+            startScanTyped<int>(cursor, lowValParm, highValParm);
+            break;
+        case DOUBLE:
+            startScanTyped<double>(cursor, lowValParm, highValParm);
+            break;
+        case INT64:
+            startScanTyped<std::int64_t>(cursor, lowValParm, highValParm);
+            break;
+        case STRING:
+            startScanString(cursor, lowValParm, highValParm);
+            break;
+        default:
+            break;
+        }
+    }
+    catch(const NoSuchKeyFoundException &e){
+        if(single_key){
+            bloomStats.falsePositives++;
+        }
+        throw;
+    }
+
+    // The path to the first leaf of the scan is where the leaves ahead are found
+    readAhead(cursor);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::startScanTyped
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::startScanTyped(IndexCursor& cursor, const void* lowValParm, const void* highValParm)
+{
+    // Set up the low and high values of the key type. The operators are kept as given, since GT and LT cannot
+    // be turned into GTE and LTE by adding or subtracting one for every key type
+    T& low_value = scanLowValue<T>(cursor);
+    T& high_value = scanHighValue<T>(cursor);
+    if(cursor.lowBounded){
+        low_value = keyValue<T>(lowValParm);
+    }
+    if(cursor.highBounded){
+        high_value = keyValue<T>(highValParm);
+    }
+    if(cursor.lowBounded && cursor.highBounded && high_value < low_value){ // If lowVal > highval, throw BadScanrangeException
+        throw BadScanrangeException();
+    }
+
+    // Find the entry in the B+ tree that satisfies the bound at the start of the scan, the first one or the last one
+    // of a descending scan. Without that bound, the scan starts at the leftmost or rightmost leaf
+    NodePath* path = cursor.readAheadLeaves > 0 ? &cursor.readAheadPath : NULL;
+    bool from_edge = (cursor.order == DESCENDING) ? !cursor.highBounded : !cursor.lowBounded;
+    if(from_edge){
+        cursor.currentPageNum = findScanEdge<NonLeafNode<T> >(cursor.order == DESCENDING, path);
+    }
+    else if(cursor.order == DESCENDING){
+        findScanPageDescending(high_value, cursor.highOp, cursor.currentPageNum, cursor.nextEntry, path);
+    }
+    else{
+        findScanPage(low_value, cursor.lowOp, cursor.currentPageNum, cursor.nextEntry, path);
+    }
+
+    // Pin the page for scanning, and check the entry against the bound at the end of the scan
+    if(cursor.currentPageNum != Page::INVALID_NUMBER){
+        bufMgr->readPage((BlobFile*)file, cursor.currentPageNum, cursor.currentPageData);
+        loadScanLeaf(cursor);
+        const T* keys;
+        const RecordId* rids;
+        int size = scanLeafEntries(cursor, keys, rids);
+        if(from_edge){
+            cursor.nextEntry = (cursor.order == DESCENDING) ? size - 1 : 0;
+        }
+        if(cursor.nextEntry < 0 || cursor.nextEntry >= size || pastScanRange(cursor, keys[cursor.nextEntry])){
+            moveScanToPage(cursor, Page::INVALID_NUMBER);
+        }
+    }
+    if(cursor.currentPageNum == Page::INVALID_NUMBER){ // Throw NoSuchKeyFoundException if there is no key in the B+ tree that satisfies the scan criteria
+        throw NoSuchKeyFoundException();
+    }
+    cursor.scanExecuting = true; // Set the scanExecuting to true since the scan is successfully started
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::scanNext
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::scanNext(RecordId& outRid, void* outIncluded)
+{
+    // Add your code below. Please do not remove this line.
+
+    scanNext(scanCursor, outRid, (char*)outIncluded);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::scanNext (cursor)
+// -----------------------------------------------------------------------------
+void BTreeIndex::scanNext(IndexCursor& cursor, RecordId& outRid, char* outIncluded)
+{
+    // Handle exception before return the next rid
+    if(cursor.scanExecuting == false){ // If no scan has been initialized, throw ScanNotInitializedException
+        throw ScanNotInitializedException();
+    }
+    if(cursor.currentPageNum == Page::INVALID_NUMBER){ // If no more records, satisfying the scan criteria, are left to be scanned, throw IndexScanCompletedException
+        throw IndexScanCompletedException();
+    }
+
+    switch(attributeType){
+    case INTEGER:
+        scanNextTyped<int>(cursor, outRid, outIncluded);
+        break;
+    case DOUBLE:
+        scanNextTyped<double>(cursor, outRid, outIncluded);
+        break;
+    case INT64:
+        scanNextTyped<std::int64_t>(cursor, outRid, outIncluded);
+        break;
+    case STRING:
+        scanNextString(cursor, outRid);
+        break;
+    default:
+        break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::scanNextTyped
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::scanNextTyped(IndexCursor& cursor, RecordId& outRid, char* outIncluded)
+{
+    LeafNode<T>* leaf_node = reinterpret_cast<LeafNode<T>*>(cursor.currentPageData);
+    const T* keys;
+    const RecordId* rids;
+    int size = scanLeafEntries(cursor, keys, rids);
+    if(pastScanRange(cursor, keys[cursor.nextEntry])){ // If no more records, satisfying the scan criteria, are left to be scanned, throw IndexScanCompletedException
+        throw IndexScanCompletedException();
+    }
+
+    // Return the rid of next entry, and its included bytes before the scan may move on and unpin the leaf
+    outRid = rids[cursor.nextEntry];
+    if(outIncluded != NULL && includedBytes > 0){
+        const CoveringLeafNode<T>* covering_node = reinterpret_cast<const CoveringLeafNode<T>*>(leaf_node);
+        memcpy(outIncluded, covering_node->included() + cursor.nextEntry * includedBytes, includedBytes);
+    }
+    if(cursor.order == DESCENDING){
+        // Move down to the previous entry, which may be the last one of the left sibling
+        if(cursor.nextEntry > 0){
+            cursor.nextEntry--;
+        }
+        else if(leaf_node->leftSibPageNo != Page::INVALID_NUMBER){
+            moveScanToPage(cursor, leaf_node->leftSibPageNo);
+            cursor.nextEntry = scanLeafEntries(cursor, keys, rids) - 1;
+        }
+        else{
+            moveScanToPage(cursor, Page::INVALID_NUMBER);
+        }
+        return;
+    }
+
+    // Update the next entry
+    if(size-1 > cursor.nextEntry){ // If the entry does not reach the end of the leaf node, just increment it
+        cursor.nextEntry++;
+    }
+    else if(size-1 == cursor.nextEntry && leaf_node->rightSibPageNo != Page::INVALID_NUMBER){
+        // If the entry reaches the end of the current leaf node, and there is a right sibling of the current leaf node,
+        // then update next entry to 0, and the current page to the right sibling
+        moveScanToPage(cursor, leaf_node->rightSibPageNo);
+    }
+    else{
+        // If the entry reaches the end of the current leaf node, and there is no right sibling of the current leaf node,
+        // unpin the leaf and set the current page number to an invalid number
+        moveScanToPage(cursor, Page::INVALID_NUMBER);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::scanNextBatch
+// -----------------------------------------------------------------------------
+
+size_t BTreeIndex::scanNextBatch(RecordId* out, size_t max, void* outIncluded)
+{
+    return scanNextBatch(scanCursor, out, max, (char*)outIncluded);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::scanNextBatch (cursor)
+// -----------------------------------------------------------------------------
+size_t BTreeIndex::scanNextBatch(IndexCursor& cursor, RecordId* out, size_t max, char* outIncluded)
+{
+    if(cursor.scanExecuting == false){ // If no scan has been initialized, throw ScanNotInitializedException
+        throw ScanNotInitializedException();
+    }
+
+    switch(attributeType){
+    case INTEGER:
+        return scanNextBatchTyped<int>(cursor, out, max, outIncluded);
+    case DOUBLE:
+        return scanNextBatchTyped<double>(cursor, out, max, outIncluded);
+    case INT64:
+        return scanNextBatchTyped<std::int64_t>(cursor, out, max, outIncluded);
+    case STRING:
+        return scanNextBatchString(cursor, out, max);
+    default:
+        return 0;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::scanNextBatchTyped
+// -----------------------------------------------------------------------------
+template <class T>
+size_t BTreeIndex::scanNextBatchTyped(IndexCursor& cursor, RecordId* out, size_t max, char* outIncluded)
+{
+    if(cursor.order == DESCENDING){
+        return scanNextBatchDescending<T>(cursor, out, max, outIncluded);
+    }
+    const int included_bytes = (outIncluded != NULL) ? includedBytes : 0;
+
+    const T& high_value = scanHighValue<T>(cursor);
+    size_t count = 0;
+    while(count < max && cursor.currentPageNum != Page::INVALID_NUMBER){
+        // The entries of the leaf which satisfy the high bound end at the first key greater than or equal to (LT),
+        // or greater than (LTE), the high value
+        LeafNode<T>* leaf_node = reinterpret_cast<LeafNode<T>*>(cursor.currentPageData);
+        const T* keys;
+        const RecordId* rids;
+        int size = scanLeafEntries(cursor, keys, rids);
+        int end_entry = !cursor.highBounded ? size
+                      : (cursor.highOp == LT) ? lowerBound(keys, size, high_value)
+                                              : upperBound(keys, size, high_value);
+        size_t run = std::min((size_t)std::max(end_entry - cursor.nextEntry, 0), max - count);
+        memcpy(out + count, rids + cursor.nextEntry, run * sizeof(RecordId));
+        if(included_bytes > 0){
+            const CoveringLeafNode<T>* covering_node = reinterpret_cast<const CoveringLeafNode<T>*>(leaf_node);
+            memcpy(outIncluded + count * included_bytes, covering_node->included() + cursor.nextEntry * included_bytes,
+                   run * included_bytes);
+        }
+        count += run;
+        cursor.nextEntry += (int)run;
+        if(cursor.nextEntry < end_entry){
+            break;
+        }
+
+        // Move on to the right sibling only if the high bound was not reached in this leaf
+        if(end_entry == size && leaf_node->rightSibPageNo != Page::INVALID_NUMBER){
+            moveScanToPage(cursor, leaf_node->rightSibPageNo);
+        }
+        else{
+            moveScanToPage(cursor, Page::INVALID_NUMBER);
+        }
+    }
+    return count;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::scanNextBatchDescending
+// -----------------------------------------------------------------------------
+template <class T>
+size_t BTreeIndex::scanNextBatchDescending(IndexCursor& cursor, RecordId* out, size_t max, char* outIncluded)
+{
+    const T& low_value = scanLowValue<T>(cursor);
+    const int included_bytes = (outIncluded != NULL) ? includedBytes : 0;
+    size_t count = 0;
+    while(count < max && cursor.currentPageNum != Page::INVALID_NUMBER){
+        // The entries of the leaf which satisfy the low bound begin at the first key greater than (GT), or greater
+        // than or equal to (GTE), the low value, and are copied out from the last one down
+        LeafNode<T>* leaf_node = reinterpret_cast<LeafNode<T>*>(cursor.currentPageData);
+        const T* keys;
+        const RecordId* rids;
+        int size = scanLeafEntries(cursor, keys, rids);
+        int begin_entry = !cursor.lowBounded ? 0
+                        : (cursor.lowOp == GT) ? upperBound(keys, size, low_value)
+                                               : lowerBound(keys, size, low_value);
+        const char* included = (included_bytes > 0) ? reinterpret_cast<const CoveringLeafNode<T>*>(leaf_node)->included() : NULL;
+        while(count < max && cursor.nextEntry >= begin_entry){
+            if(included_bytes > 0){
+                memcpy(outIncluded + count * included_bytes, included + cursor.nextEntry * included_bytes, included_bytes);
+            }
+            out[count++] = rids[cursor.nextEntry--];
+        }
+        if(cursor.nextEntry >= begin_entry){
+            break;
+        }
+
+        // Move on to the left sibling only if the low bound was not reached in this leaf
+        if(begin_entry == 0 && leaf_node->leftSibPageNo != Page::INVALID_NUMBER){
+            moveScanToPage(cursor, leaf_node->leftSibPageNo);
+            cursor.nextEntry = scanLeafEntries(cursor, keys, rids) - 1;
+        }
+        else{
+            moveScanToPage(cursor, Page::INVALID_NUMBER);
+        }
+    }
+    return count;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::moveScanToPage
+// -----------------------------------------------------------------------------
+void BTreeIndex::moveScanToPage(IndexCursor& cursor, PageId page_num)
+{
+    // Release the leaf the scan is done with before pinning the next one, so a scan of any length keeps a single
+    // leaf pinned
+    if(cursor.currentPageNum != Page::INVALID_NUMBER){
+        bufMgr->unPinPage((BlobFile*)file, cursor.currentPageNum, false);
+    }
+    cursor.nextEntry = 0;
+    cursor.currentPageNum = page_num;
+    if(cursor.currentPageNum == Page::INVALID_NUMBER){
+        cursor.readAheadPages.clear();
+        cursor.readAheadPath.depth = 0;
+        cursor.leafKeys.clear();
+        cursor.leafRids.clear();
+        return;
+    }
+
+    // The leaf is done with as a leaf read ahead, along with any read ahead before it which the scan did not get to.
+    // The reads of the next leaves are started before this one is waited for
+    std::deque<PageId>::iterator read_ahead = std::find(cursor.readAheadPages.begin(), cursor.readAheadPages.end(), page_num);
+    if(read_ahead != cursor.readAheadPages.end()){
+        cursor.readAheadPages.erase(cursor.readAheadPages.begin(), read_ahead + 1);
+    }
+    readAhead(cursor);
+    bufMgr->readPage((BlobFile*)file, cursor.currentPageNum, cursor.currentPageData);
+    loadScanLeaf(cursor);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::loadScanLeaf
+// -----------------------------------------------------------------------------
+void BTreeIndex::loadScanLeaf(IndexCursor& cursor)
+{
+    switch(attributeType){
+    case INTEGER:
+        loadScanLeafTyped<int>(cursor);
+        break;
+    case DOUBLE:
+        loadScanLeafTyped<double>(cursor);
+        break;
+    case INT64:
+        loadScanLeafTyped<std::int64_t>(cursor);
+        break;
+    default:
+        break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::loadScanLeafTyped
+// -----------------------------------------------------------------------------
+template <class T>
+void BTreeIndex::loadScanLeafTyped(IndexCursor& cursor)
+{
+    cursor.leafKeys.clear();
+    cursor.leafRids.clear();
+    const PostingLeafNode<T>* posting_node = reinterpret_cast<const PostingLeafNode<T>*>(cursor.currentPageData);
+    if(posting_node->format == PACKED_LIST){
+        // Unpack the whole node once per leaf, so the scan steps through it like through an entry list
+        const PackedLeafNode<T>* packed_node = reinterpret_cast<const PackedLeafNode<T>*>(cursor.currentPageData);
+        cursor.leafKeys.resize(packed_node->keySize * sizeof(T));
+        cursor.leafRids.resize(packed_node->keySize);
+        decodePackedLeaf(packed_node, reinterpret_cast<T*>(cursor.leafKeys.data()), cursor.leafRids.data());
+        return;
+    }
+    if(posting_node->format != POSTING_LIST){
+        return;
+    }
+
+    // Expand the postings into entries once per leaf, so the scan steps through them like through an entry list
+    for(int i = 0; i < posting_node->keySize; i++){
+        const PostingSlot<T>& slot = posting_node->slots()[i];
+        if(slot.overflowPageNo == Page::INVALID_NUMBER){
+            decodeRidList(posting_node->ridData() + slot.ridOffset, slot.ridCount, cursor.leafRids);
+        }
+        else{
+            readOverflowRids(slot.overflowPageNo, cursor.leafRids);
+        }
+    }
+    cursor.leafKeys.resize(cursor.leafRids.size() * sizeof(T));
+    T* keys = reinterpret_cast<T*>(cursor.leafKeys.data());
+    for(int i = 0, entry = 0; i < posting_node->keySize; i++){
+        for(int j = 0; j < posting_node->slots()[i].ridCount; j++){
+            keys[entry++] = posting_node->slots()[i].key;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::scanLeafEntries
+// -----------------------------------------------------------------------------
+template <class T>
+int BTreeIndex::scanLeafEntries(IndexCursor& cursor, const T*& keys, const RecordId*& rids)
+{
+    if(leafEntryArrays(cursor.currentPageData, keys, rids)){
+        return reinterpret_cast<const LeafNode<T>*>(cursor.currentPageData)->keySize;
+    }
+    keys = reinterpret_cast<const T*>(cursor.leafKeys.data());
+    rids = cursor.leafRids.data();
+    return (int)cursor.leafRids.size();
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::readAhead
+// -----------------------------------------------------------------------------
+void BTreeIndex::readAhead(IndexCursor& cursor)
+{
+    if(cursor.readAheadPath.depth == 0 || (int)cursor.readAheadPages.size() >= cursor.readAheadLeaves){
+        return;
+    }
+
+    switch(attributeType){
+    case INTEGER:
+        readAheadTyped<NonLeafNode<int> >(cursor);
+        break;
+    case DOUBLE:
+        readAheadTyped<NonLeafNode<double> >(cursor);
+        break;
+    case INT64:
+        readAheadTyped<NonLeafNode<std::int64_t> >(cursor);
+        break;
+    case STRING:
+        readAheadTyped<StringNonLeafNode>(cursor);
+        break;
+    default:
+        break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::readAheadTyped
+// -----------------------------------------------------------------------------
+template <class NonLeaf>
+void BTreeIndex::readAheadTyped(IndexCursor& cursor)
+{
+    NodePath& path = cursor.readAheadPath;
+    while((int)cursor.readAheadPages.size() < cursor.readAheadLeaves){
+        PageId page_num;
+        bool backward = cursor.order == DESCENDING;
+        if(!moveToNextLeaf<NonLeaf>(path, page_num, backward)){
+            path.depth = 0;
+            return;
+        }
+
+        // The keys of the leaf are not less than the key on its left in the lowest node where the path moved right.
+        // Once that key is beyond the high bound, so are the leaf and all leaves after it. Likewise, the keys are
+        // not greater than the key on the right in the lowest node where the path moved left
+        int depth = path.depth - 1;
+        while(path.entries[depth].position == (backward ? path.entries[depth].keySize : 0)){
+            depth--;
+        }
+        int separator = backward ? path.entries[depth].position : path.entries[depth].position - 1;
+        Page* page;
+        bufMgr->readPage((BlobFile*)file, path.entries[depth].pageNo, page);
+        bool past = pastScanRange(cursor, reinterpret_cast<const NonLeaf*>(page), separator);
+        bufMgr->unPinPage((BlobFile*)file, path.entries[depth].pageNo, false);
+        if(past){
+            path.depth = 0;
+            return;
+        }
+
+        bufMgr->prefetchPage((BlobFile*)file, page_num);
+        cursor.readAheadPages.push_back(page_num);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::pastScanRange
+// -----------------------------------------------------------------------------
+template <class T>
+bool BTreeIndex::pastScanRange(IndexCursor& cursor, const T& key)
+{
+    if(cursor.order == DESCENDING){
+        const T& low_value = scanLowValue<T>(cursor);
+        return cursor.lowBounded && (cursor.lowOp == GT ? !(low_value < key) : key < low_value);
+    }
+    const T& high_value = scanHighValue<T>(cursor);
+    return cursor.highBounded && (cursor.highOp == LT ? !(key < high_value) : high_value < key);
+}
+
+template <class Node>
+bool BTreeIndex::pastScanRangeString(IndexCursor& cursor, const Node* node, int position)
+{
+    if(cursor.order == DESCENDING){
+        if(!cursor.lowBounded){
+            return false;
+        }
+        int c = compareStringEntry(node, position, cursor.lowValString.data(), (int)cursor.lowValString.size());
+        return cursor.lowOp == GT ? c <= 0 : c < 0;
+    }
+    if(!cursor.highBounded){
+        return false;
+    }
+    int c = compareStringEntry(node, position, cursor.highValString.data(), (int)cursor.highValString.size());
+    return cursor.highOp == LT ? c >= 0 : c > 0;
+}
 
-    // If page-id of the right page is invalid, the leaf node did not split, then finish the insert
-    if(right_child_num == Page::INVALID_NUMBER){
-        return;
+template <class T>
+bool BTreeIndex::pastScanRange(IndexCursor& cursor, const NonLeafNode<T>* node, int position)
+{
+    return pastScanRange(cursor, node->keyArray[position]);
+}
+
+bool BTreeIndex::pastScanRange(IndexCursor& cursor, const StringNonLeafNode* node, int position)
+{
+    return pastScanRangeString(cursor, node, position);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::findScanEdge
+// -----------------------------------------------------------------------------
+template <class NonLeaf>
+PageId BTreeIndex::findScanEdge(bool rightmost, NodePath* path)
+{
+    if(path != NULL){
+        path->depth = 0;
     }
 
-    // If the right child number is valid, the leaf node did split, then recursively insert the pushing keys to its ancestors
-    else{
-        while(1){
+    // The leftmost leaf is kept in the meta page, only the path needs a descent to it
+    if(!rightmost && path == NULL){
+        return firstLeafPageNum;
+    }
 
-        // Get the page node of the leaf node
-        findParentNode(left_child_num, push_up_key, parent_num, position, total_key);
-
-        // If the page-id of the parent node is invalid, it means the current node is the root.
-        // then allocate a new root page to insert the pushing-up key from insertting
-        if(parent_num == Page::INVALID_NUMBER){
-            Page* root_page;
-            Page* header_page;
-            IndexMetaInfo* tree_header;
-            NonLeafNodeInt* root_node;
-            bufMgr->allocPage((BlobFile*)file, rootPageNum, root_page);
-            bufMgr->readPage((BlobFile*)file, headerPageNum, header_page);
-            tree_header = reinterpret_cast<IndexMetaInfo*>(header_page);
-            root_node = reinterpret_cast<NonLeafNodeInt*>(root_page);
-
-            // Update the meta data in header and data in the new root node
-            tree_header->rootPageNo = rootPageNum;
-            root_node->keySize = 1;
-            root_node->keyArray[0] = push_up_key;
-            root_node->pageNoArray[0] = left_child_num;
-            root_node->pageNoArray[1] = right_child_num;
-            if(left_child_num == leaf_num){ // If the newly created root is a parent of a leaf node, then set level to 1, if not, set level to 0
-                root_node->level = 1;
+    // Otherwise follow the leftmost or rightmost child of every non-leaf node from the root down
+    PageId page_num = rootPageNum;
+    if(!rootIsLeaf){
+        while(1){
+            Page* page;
+            bufMgr->readPage((BlobFile*)file, page_num, page);
+            const NonLeaf* non_leaf_node = reinterpret_cast<const NonLeaf*>(page);
+            int i = rightmost ? non_leaf_node->keySize : 0;
+            if(path != NULL){
+                PathEntry& entry = path->entries[path->depth++];
+                entry.pageNo = page_num;
+                entry.position = i;
+                entry.keySize = non_leaf_node->keySize;
             }
-            else{
-                root_node->level = 0;
+            PageId child_num = childPageNo(non_leaf_node, i);
+            int level = non_leaf_node->level;
+            bufMgr->unPinPage((BlobFile*)file, page_num, false);
+            page_num = child_num;
+            if(level == 1){
+                break;
             }
+        }
+    }
+    return page_num;
+}
 
-            // Unpin header and root node and set dirty bit
-            bufMgr->unPinPage((BlobFile*)file, headerPageNum, true);
-            bufMgr->unPinPage((BlobFile*)file, rootPageNum, true);
-            return;
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::descendToLeafString
+// -----------------------------------------------------------------------------
+void BTreeIndex::descendToLeafString(const char* key, int keyLength, NodePath* path, PageId& page_num, Page*& leaf_page,
+                                     bool upper){
+    // This function is BTreeIndex::descendToLeaf for the slotted STRING nodes, the child on the left of the first
+    // key greater than or equal to (greater than if upper) the given key is followed
 
-        }
+    if(path != NULL){
+        path->depth = 0;
+    }
 
-        // If the parent-id of parent node is valid, it means there is an existing parent node
-        // of the child node, then modify the parent node through inserting the pushing-up key
-        else{
-            int temp_key = push_up_key;
-            PageId temp_left_child_num = left_child_num;
-            PageId temp_right_child_num = right_child_num;
-            int temp_position = position;
-            int temp_total_key = total_key;
-            modifyNonLeafNode(parent_num, temp_key, temp_left_child_num, temp_right_child_num, temp_position, temp_total_key, left_child_num,
-                              right_child_num, push_up_key);
-            if(right_child_num == Page::INVALID_NUMBER){ // If modifying the parent node does not cause splitting, then return
-                return;
+    PageId temp_num = rootPageNum;
+    if(!rootIsLeaf){
+        while(1){
+            Page* temp_page;
+            bufMgr->readPage((BlobFile*)file, temp_num, temp_page);
+            StringNonLeafNode* non_leaf_node = reinterpret_cast<StringNonLeafNode*>(temp_page);
+            int i = upper ? stringUpperBound(non_leaf_node, key, keyLength) : stringLowerBound(non_leaf_node, key, keyLength);
+            if(path != NULL){
+                PathEntry& entry = path->entries[path->depth++];
+                entry.pageNo = temp_num;
+                entry.position = i;
+                entry.keySize = non_leaf_node->keySize;
             }
-            else{
-                continue; // If modifying the parent node causes splitting, recursively modify the parent node of this parent node
+            PageId child_num = (i == 0) ? non_leaf_node->leftmostPageNo : non_leaf_node->slots()[i-1].pageNo;
+            int level = non_leaf_node->level;
+            bufMgr->unPinPage((BlobFile*)file, temp_num, false);
+            temp_num = child_num;
+
+            // If the non-leaf node is above leaf node, its child is the leaf node
+            if(level == 1){
+                break;
             }
         }
-        }
     }
+
+    // Return the leaf node pinned
+    page_num = temp_num;
+    bufMgr->readPage((BlobFile*)file, page_num, leaf_page);
 }
 
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::insertEntryString
+// -----------------------------------------------------------------------------
+void BTreeIndex::insertEntryString(const char* key, int keyLength, const RecordId rid)
+{
+    PageId leaf_num;
+    Page* leaf_page;
+    NodePath path;
+
+    // Insert the key&rid pair into the leaf node which should hold it, if the leaf node has room for it
+    descendToLeafString(key, keyLength, &path, leaf_num, leaf_page);
+    StringLeafNode* leaf_node = reinterpret_cast<StringLeafNode*>(leaf_page);
+    int position = stringLowerBound(leaf_node, key, keyLength);
+    if(insertStringEntry(leaf_node, position, key, keyLength, rid)){
+        bufMgr->unPinPage((BlobFile*)file, leaf_num, true);
+        return;
+    }
+
+    // Otherwise split the leaf node, and insert the pushing-up keys into the recorded ancestors from the parent
+    // of the leaf upwards, until a node absorbs the key without splitting
+    stopReadAhead();
+    PageId left_child_num = leaf_num;
+    PageId right_child_num;
+    std::string push_up_key;
+    splitStringLeafNode(leaf_num, leaf_page, position, key, keyLength, rid, right_child_num, push_up_key,
+                        splitFillAt(path, path.depth, position, leaf_node->keySize));
+    for(int depth = path.depth - 1; depth >= 0 && right_child_num != Page::INVALID_NUMBER; depth--){
+        const PathEntry& parent = path.entries[depth];
+        left_child_num = parent.pageNo;
+        modifyStringNonLeafNode(parent.pageNo, parent.position, push_up_key, right_child_num, right_child_num,
+                                splitFillAt(path, depth, parent.position, parent.keySize));
+    }
+    if(right_child_num == Page::INVALID_NUMBER){
+        return;
+    }
+
+    // The root did split, then allocate a new root page to insert the pushing-up key
+    Page* root_page;
+    bufMgr->allocPage((BlobFile*)file, rootPageNum, root_page);
+    StringNonLeafNode* root_node = reinterpret_cast<StringNonLeafNode*>(root_page);
+    initializeStringNonLeaf(root_node, rootIsLeaf ? 1 : 0);
+    root_node->leftmostPageNo = left_child_num;
+    insertStringEntry(root_node, 0, push_up_key.data(), (int)push_up_key.size(), right_child_num);
+    bufMgr->unPinPage((BlobFile*)file, rootPageNum, true);
+
+    // The tree grows by one level, write the new root back to the header page
+    treeHeight++;
+    rootIsLeaf = false;
+    writeMetaInfo();
+}
 
 // -----------------------------------------------------------------------------
-// Helper Function: BTreeIndex::findScanPage
+// Helper Function: BTreeIndex::splitStringLeafNode
 // -----------------------------------------------------------------------------
-void BTreeIndex::findScanPage(int low_value, int high_value, PageId& page_num, int& entry){
-    // This function is similar to BTreeIndex::findLeafNode, which finds the smallest entry in a
-    // leaf node that greater or equal to the given low value
+void BTreeIndex::splitStringLeafNode(PageId page_num, Page* leaf_page, int position, const char* key, int keyLength, RecordId rid,
+                                     PageId& right_node_num, std::string& push_up_key, double left_fill){
+    // Decode the keys and rids including the inserted key&rid pair
+    StringLeafNode* left_node = reinterpret_cast<StringLeafNode*>(leaf_page);
+    std::vector<std::string> keys;
+    std::vector<RecordId> rids;
+    decodeStringNode(left_node, keys, rids);
+    keys.insert(keys.begin() + position, std::string(key, keyLength));
+    rids.insert(rids.begin() + position, rid);
+    int split = chooseStringLeafSplit(keys, left_fill);
 
+    // Allocate a new page as the right node after the splitting, and link it after the left node
+    Page* right_page;
+    bufMgr->allocPage((BlobFile*)file, right_node_num, right_page);
+    StringLeafNode* right_node = reinterpret_cast<StringLeafNode*>(right_page);
+    initializeStringLeaf(right_node);
+    right_node->rightSibPageNo = left_node->rightSibPageNo;
+    right_node->leftSibPageNo = page_num;
+    left_node->rightSibPageNo = right_node_num;
+    if(right_node->rightSibPageNo != Page::INVALID_NUMBER){
+        setLeftSibling<StringLeafNode>(right_node->rightSibPageNo, right_node_num);
+    }
+
+    // Redistribute keys and rids into left and right nodes, each re-encoded with its own common prefix
+    encodeStringNode(left_node, keys, rids, 0, split);
+    encodeStringNode(right_node, keys, rids, split, (int)keys.size());
+    push_up_key = keys[split - 1];
+
+    // Unpin right and left node and set dirty bits
+    bufMgr->unPinPage((BlobFile*)file, page_num, true);
+    bufMgr->unPinPage((BlobFile*)file, right_node_num, true);
+}
 
-    // If the low value is greater than the high value, then there is no page that an entry that satisfies the scan criteria
-    if(low_value > high_value){
-        page_num = Page::INVALID_NUMBER;
-        entry = -1;
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::modifyStringNonLeafNode
+// -----------------------------------------------------------------------------
+void BTreeIndex::modifyStringNonLeafNode(PageId page_num, int position, std::string& key, PageId right_child_num, PageId& right_node_num,
+                                         double left_fill){
+    Page* left_page;
+    bufMgr->readPage((BlobFile*)file, page_num, left_page);
+    StringNonLeafNode* left_node = reinterpret_cast<StringNonLeafNode*>(left_page);
+
+    // If the non-leaf node has room for the key, just insert it
+    if(insertStringEntry(left_node, position, key.data(), (int)key.size(), right_child_num)){
+        bufMgr->unPinPage((BlobFile*)file, page_num, true);
+        right_node_num = Page::INVALID_NUMBER;
         return;
     }
 
-    // Get the root page number through the meta data in header page
-    Page* header_page;
-    IndexMetaInfo* treeHeader;
-    bufMgr->readPage((BlobFile*)file, headerPageNum, header_page);
-    bufMgr->unPinPage((BlobFile*)file, headerPageNum, false);
-    treeHeader = reinterpret_cast<IndexMetaInfo*>(header_page);
-    rootPageNum = treeHeader->rootPageNo;
-
-
-    // If the root page number is still 2, then the root node is the only (leaf) node in the tree.
-    // So treat the root as a leaf node, and find the entry from leaf to right
-    if(rootPageNum == (PageId)2){
-        Page* root_page;
-        bufMgr->readPage((BlobFile*)file, rootPageNum, root_page);
-        bufMgr->unPinPage((BlobFile*)file, rootPageNum, false);
-        LeafNodeInt* leaf_node = reinterpret_cast<LeafNodeInt*>(root_page);
-
-        // Locate the entry in the root(leaf) node
-        int i;
-        for(i = 0; i < leaf_node->keySize; i++){
-            if(leaf_node->keyArray[i] >= low_value){
-                break;
-            }
-        }
-        entry = i;
+    // Otherwise decode the keys and children including the inserted key, and split around the key pushed up
+    std::vector<std::string> keys;
+    std::vector<PageId> children;
+    decodeStringNode(left_node, keys, children);
+    keys.insert(keys.begin() + position, key);
+    children.insert(children.begin() + position, right_child_num);
+    int split = chooseStringNonLeafSplit(keys, left_fill);
+
+    Page* right_page;
+    bufMgr->allocPage((BlobFile*)file, right_node_num, right_page);
+    StringNonLeafNode* right_node = reinterpret_cast<StringNonLeafNode*>(right_page);
+    initializeStringNonLeaf(right_node, left_node->level);
+
+    // The child on the right of the pushed-up key becomes the leftmost child of the right node
+    right_node->leftmostPageNo = children[split];
+    encodeStringNode(left_node, keys, children, 0, split);
+    encodeStringNode(right_node, keys, children, split + 1, (int)keys.size());
+    key = keys[split];
 
-        // If there is no entry in the root(leaf) node which is greater than or equal to the given low value,
-        // return an invalid page number, otherwise, return the page-id of the page where is entry is currently in
-        if(entry == leaf_node->keySize){
-            page_num = Page::INVALID_NUMBER;
+    // Unpin the left and right page and set dirty bits
+    bufMgr->unPinPage((BlobFile*)file, page_num, true);
+    bufMgr->unPinPage((BlobFile*)file, right_node_num, true);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::deleteEntryString
+// -----------------------------------------------------------------------------
+void BTreeIndex::deleteEntryString(const char* key, int keyLength, const RecordId rid)
+{
+    NodePath path;
+    PageId leaf_num;
+    Page* leaf_page;
+
+    // Look for the entry with the rid among the entries with the key, like BTreeIndex::deleteEntryTyped
+    descendToLeafString(key, keyLength, &path, leaf_num, leaf_page);
+    StringLeafNode* leaf_node = reinterpret_cast<StringLeafNode*>(leaf_page);
+    int position = stringLowerBound(leaf_node, key, keyLength);
+    while(1){
+        while(position < leaf_node->keySize && compareStringEntry(leaf_node, position, key, keyLength) == 0 &&
+              leaf_node->slots()[position].rid != rid){
+            position++;
         }
-        else{
-            page_num = rootPageNum;
+        if(position < leaf_node->keySize){
+            break;
+        }
+        bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+        if(!moveToNextLeaf<StringNonLeafNode>(path, leaf_num)){
+            throw NoSuchKeyFoundException();
         }
+        bufMgr->readPage((BlobFile*)file, leaf_num, leaf_page);
+        leaf_node = reinterpret_cast<StringLeafNode*>(leaf_page);
+        position = 0;
+    }
+    if(compareStringEntry(leaf_node, position, key, keyLength) != 0){
+        bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+        throw NoSuchKeyFoundException();
+    }
+
+    removeStringEntry(leaf_node, position);
+    bool underflow = path.depth > 0 && stringNodeUnderflows(leaf_node);
+    bufMgr->unPinPage((BlobFile*)file, leaf_num, true);
+    if(!underflow){
         return;
     }
 
-    // If the rootPageNum is not 2, it means the root node is a non-leaf node, which must be non-empty.
-    // Recursively find the entry from root to bottom
-    PageId temp_num = rootPageNum;
-    while(1){
-        Page* temp_page;
-        bufMgr->readPage((BlobFile*)file, temp_num, temp_page);
-        bufMgr->unPinPage((BlobFile*)file, temp_num, false);
-        NonLeafNodeInt* non_leaf_node = reinterpret_cast<NonLeafNodeInt*>(temp_page);
-        int i;
-        for(i = 0; i < non_leaf_node->keySize; i++){
-            if(non_leaf_node->keyArray[i] >= low_value){
-                break;
-            }
+    bool merged = rebalanceStringLeaf(path);
+    for(int depth = path.depth - 1; depth >= 0 && merged; depth--){
+        merged = rebalanceStringNonLeaf(path, depth);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::rebalanceStringLeaf
+// -----------------------------------------------------------------------------
+bool BTreeIndex::rebalanceStringLeaf(const NodePath& path){
+    const PathEntry& parent_entry = path.entries[path.depth - 1];
+    Page* parent_page;
+    bufMgr->readPage((BlobFile*)file, parent_entry.pageNo, parent_page);
+    StringNonLeafNode* parent_node = reinterpret_cast<StringNonLeafNode*>(parent_page);
+    if(parent_node->keySize == 0){
+        bufMgr->unPinPage((BlobFile*)file, parent_entry.pageNo, false);
+        return false;
+    }
+
+    // Pair the leaf node with a sibling like BTreeIndex::rebalanceLeaf, and decode the entries of both
+    int left_pos = (parent_entry.position > 0) ? parent_entry.position - 1 : 0;
+    PageId left_num = childPageNo(parent_node, left_pos);
+    PageId right_num = childPageNo(parent_node, left_pos + 1);
+    Page* left_page;
+    Page* right_page;
+    bufMgr->readPage((BlobFile*)file, left_num, left_page);
+    bufMgr->readPage((BlobFile*)file, right_num, right_page);
+    StringLeafNode* left_node = reinterpret_cast<StringLeafNode*>(left_page);
+    StringLeafNode* right_node = reinterpret_cast<StringLeafNode*>(right_page);
+    std::vector<std::string> keys;
+    std::vector<RecordId> rids;
+    std::vector<std::string> right_keys;
+    std::vector<RecordId> right_rids;
+    decodeStringNode(left_node, keys, rids);
+    decodeStringNode(right_node, right_keys, right_rids);
+    keys.insert(keys.end(), right_keys.begin(), right_keys.end());
+    rids.insert(rids.end(), right_rids.begin(), right_rids.end());
+
+    // If both fit in one node, merge them into the left node, and remove the separating key and the right node
+    // from the parent
+    if(stringNodeBytes<StringLeafNode>(keys, 0, (int)keys.size()) <= StringLeafNode::DATASIZE){
+        encodeStringNode(left_node, keys, rids, 0, (int)keys.size());
+        left_node->rightSibPageNo = right_node->rightSibPageNo;
+        if(left_node->rightSibPageNo != Page::INVALID_NUMBER){
+            setLeftSibling<StringLeafNode>(left_node->rightSibPageNo, left_num);
         }
-        temp_num = non_leaf_node->pageNoArray[i];
+        removeStringEntry(parent_node, left_pos);
+        bufMgr->unPinPage((BlobFile*)file, left_num, true);
+        bufMgr->unPinPage((BlobFile*)file, right_num, false);
+        bufMgr->unPinPage((BlobFile*)file, parent_entry.pageNo, true);
+        bufMgr->disposePage((BlobFile*)file, right_num);
+        return true;
+    }
 
-        // If the non-leaf node is above leaf nodes, check its children
-        if(non_leaf_node->level == 1){
+    // Otherwise divide the entries where both nodes are about equally full in bytes, like a split. The new
+    // separating key may be longer than the old one, then the entries stay where they are if the parent has no
+    // room for it
+    int split = chooseStringLeafSplit(keys);
+    bool moved = replaceStringKey(parent_node, left_pos, keys[split - 1]);
+    if(moved){
+        encodeStringNode(left_node, keys, rids, 0, split);
+        encodeStringNode(right_node, keys, rids, split, (int)keys.size());
+    }
+    bufMgr->unPinPage((BlobFile*)file, left_num, moved);
+    bufMgr->unPinPage((BlobFile*)file, right_num, moved);
+    bufMgr->unPinPage((BlobFile*)file, parent_entry.pageNo, moved);
+    return false;
+}
 
-            Page* leaf_page;
-            bufMgr->readPage((BlobFile*)file, temp_num, leaf_page);
-            bufMgr->unPinPage((BlobFile*)file, temp_num, false);
-            LeafNodeInt* leaf_node = reinterpret_cast<LeafNodeInt*>(leaf_page);
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::rebalanceStringNonLeaf
+// -----------------------------------------------------------------------------
+bool BTreeIndex::rebalanceStringNonLeaf(const NodePath& path, int depth){
+    const PathEntry& entry = path.entries[depth];
+    Page* page;
+    bufMgr->readPage((BlobFile*)file, entry.pageNo, page);
+    StringNonLeafNode* non_leaf_node = reinterpret_cast<StringNonLeafNode*>(page);
+    int key_size = non_leaf_node->keySize;
+    bool underflow = stringNodeUnderflows(non_leaf_node);
+    PageId only_child_num = non_leaf_node->leftmostPageNo;
+    bufMgr->unPinPage((BlobFile*)file, entry.pageNo, false);
 
-            // Locate the entry
-            int j;
-            for(j = 0; j < leaf_node->keySize; j++){
-                if(leaf_node->keyArray[j] >= low_value){
-                    break;
-                }
-            }
-            entry = j;
+    if(depth == 0){
+        if(key_size == 0){
+            collapseRoot(only_child_num);
+        }
+        return false;
+    }
+    if(!underflow){
+        return false;
+    }
 
-            // If there is no entry which is greater than or equal to the given low value,
-            // return an invalid page number, otherwise, return the page-id of the page
-            // where is entry is currently in
-            if(entry == leaf_node->keySize){
-                page_num = Page::INVALID_NUMBER;
-            }
-            else if(leaf_node->keyArray[entry] > high_value){
-                page_num = Page::INVALID_NUMBER;
-            }
-            else{
-                page_num = temp_num;
+    const PathEntry& parent_entry = path.entries[depth - 1];
+    Page* parent_page;
+    bufMgr->readPage((BlobFile*)file, parent_entry.pageNo, parent_page);
+    StringNonLeafNode* parent_node = reinterpret_cast<StringNonLeafNode*>(parent_page);
+    if(parent_node->keySize == 0){
+        bufMgr->unPinPage((BlobFile*)file, parent_entry.pageNo, false);
+        return false;
+    }
+    int left_pos = (parent_entry.position > 0) ? parent_entry.position - 1 : 0;
+    PageId left_num = childPageNo(parent_node, left_pos);
+    PageId right_num = childPageNo(parent_node, left_pos + 1);
+    Page* left_page;
+    Page* right_page;
+    bufMgr->readPage((BlobFile*)file, left_num, left_page);
+    bufMgr->readPage((BlobFile*)file, right_num, right_page);
+    StringNonLeafNode* left_node = reinterpret_cast<StringNonLeafNode*>(left_page);
+    StringNonLeafNode* right_node = reinterpret_cast<StringNonLeafNode*>(right_page);
+
+    // Line up the keys of both nodes with the separating key from the parent between them. The child on the right
+    // of the separating key is the leftmost child of the right node
+    std::vector<std::string> keys;
+    std::vector<PageId> children;
+    std::vector<std::string> right_keys;
+    std::vector<PageId> right_children;
+    decodeStringNode(left_node, keys, children);
+    decodeStringNode(right_node, right_keys, right_children);
+    keys.push_back(stringEntryKey(parent_node, left_pos));
+    children.push_back(right_node->leftmostPageNo);
+    keys.insert(keys.end(), right_keys.begin(), right_keys.end());
+    children.insert(children.end(), right_children.begin(), right_children.end());
+
+    if(stringNodeBytes<StringNonLeafNode>(keys, 0, (int)keys.size()) <= StringNonLeafNode::DATASIZE){
+        encodeStringNode(left_node, keys, children, 0, (int)keys.size());
+        removeStringEntry(parent_node, left_pos);
+        bufMgr->unPinPage((BlobFile*)file, left_num, true);
+        bufMgr->unPinPage((BlobFile*)file, right_num, false);
+        bufMgr->unPinPage((BlobFile*)file, parent_entry.pageNo, true);
+        bufMgr->disposePage((BlobFile*)file, right_num);
+        return true;
+    }
+
+    // Otherwise the key at the split moves up into the parent, if the parent has room for it
+    int split = chooseStringNonLeafSplit(keys);
+    bool moved = replaceStringKey(parent_node, left_pos, keys[split]);
+    if(moved){
+        encodeStringNode(left_node, keys, children, 0, split);
+        right_node->leftmostPageNo = children[split];
+        encodeStringNode(right_node, keys, children, split + 1, (int)keys.size());
+    }
+    bufMgr->unPinPage((BlobFile*)file, left_num, moved);
+    bufMgr->unPinPage((BlobFile*)file, right_num, moved);
+    bufMgr->unPinPage((BlobFile*)file, parent_entry.pageNo, moved);
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::lookupString
+// -----------------------------------------------------------------------------
+size_t BTreeIndex::lookupString(const char* key, int keyLength, RecordId* outRid, std::vector<RecordId>* outRids)
+{
+    // This function is BTreeIndex::lookupTyped for STRING keys
+    Page* leaf_page;
+    PageId leaf_num;
+    descendToLeafString(key, keyLength, NULL, leaf_num, leaf_page);
+    StringLeafNode* leaf_node = reinterpret_cast<StringLeafNode*>(leaf_page);
+    int position = stringLowerBound(leaf_node, key, keyLength);
+
+    size_t found = 0;
+    while(1){
+        if(position == leaf_node->keySize){
+            PageId sibling_num = leaf_node->rightSibPageNo;
+            if(sibling_num == Page::INVALID_NUMBER){
+                break;
             }
-            return;
+            bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+            leaf_num = sibling_num;
+            bufMgr->readPage((BlobFile*)file, leaf_num, leaf_page);
+            leaf_node = reinterpret_cast<StringLeafNode*>(leaf_page);
+            position = 0;
+            continue;
+        }
+        if(compareStringEntry(leaf_node, position, key, keyLength) != 0){
+            break;
         }
+        found++;
+        if(outRids == NULL){
+            *outRid = leaf_node->slots()[position].rid;
+            break;
+        }
+        outRids->push_back(leaf_node->slots()[position].rid);
+        position++;
     }
+    bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+    return found;
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::startScan
+// Helper Function: BTreeIndex::findScanPageString
 // -----------------------------------------------------------------------------
-void BTreeIndex::startScan(const void* lowValParm,
-				   const Operator lowOpParm,
-				   const void* highValParm,
-				   const Operator highOpParm)
-{
-    // Add your code below. Please do not remove this line.
+void BTreeIndex::findScanPageString(const std::string& low_value, Operator low_op, PageId& page_num, int& entry,
+                                    NodePath* path){
+    // This function is BTreeIndex::findScanPage for STRING keys
+    Page* leaf_page;
+    PageId leaf_num;
+    descendToLeafString(low_value.data(), (int)low_value.size(), path, leaf_num, leaf_page);
+    StringLeafNode* leaf_node = reinterpret_cast<StringLeafNode*>(leaf_page);
+    if(low_op == GT){
+        entry = stringUpperBound(leaf_node, low_value.data(), (int)low_value.size());
+    }
+    else{
+        entry = stringLowerBound(leaf_node, low_value.data(), (int)low_value.size());
+    }
 
-    // If another scan is already executing, that needs to be ended here
-    if(scanExecuting == true){
-        endScan();
+    // The first entry which satisfies the low bound may be the first entry of a sibling on the right
+    while(entry == leaf_node->keySize && leaf_node->rightSibPageNo != Page::INVALID_NUMBER){
+        PageId sibling_num = leaf_node->rightSibPageNo;
+        PageId path_leaf_num;
+        if(path != NULL){
+            moveToNextLeaf<StringNonLeafNode>(*path, path_leaf_num);
+        }
+        bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+        leaf_num = sibling_num;
+        bufMgr->readPage((BlobFile*)file, leaf_num, leaf_page);
+        leaf_node = reinterpret_cast<StringLeafNode*>(leaf_page);
+        entry = (low_op == GT) ? stringUpperBound(leaf_node, low_value.data(), (int)low_value.size()) : 0;
     }
 
-    num_pinned_page = 0; // Set the number of pinned page for scanning to 0
+    page_num = (entry == leaf_node->keySize) ? Page::INVALID_NUMBER : leaf_num;
+    bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+}
 
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::findScanPageDescendingString
+// -----------------------------------------------------------------------------
+void BTreeIndex::findScanPageDescendingString(const std::string& high_value, Operator high_op, PageId& page_num, int& entry,
+                                              NodePath* path){
+    // This function is BTreeIndex::findScanPageDescending for STRING keys
+    Page* leaf_page;
+    PageId leaf_num;
+    descendToLeafString(high_value.data(), (int)high_value.size(), path, leaf_num, leaf_page, high_op == LTE);
+    StringLeafNode* leaf_node = reinterpret_cast<StringLeafNode*>(leaf_page);
+    if(high_op == LT){
+        entry = stringLowerBound(leaf_node, high_value.data(), (int)high_value.size()) - 1;
+    }
+    else{
+        entry = stringUpperBound(leaf_node, high_value.data(), (int)high_value.size()) - 1;
+    }
 
-    // Handle exceptions before scanning
-    if(!(lowOpParm == GT || lowOpParm == GTE)){ // If lowOp does not contain one of their their expected values, throw BadOpcodesException
-        throw BadOpcodesException();
+    // The last entry which satisfies the high bound may be the last entry of a sibling on the left
+    while(entry < 0 && leaf_node->leftSibPageNo != Page::INVALID_NUMBER){
+        PageId sibling_num = leaf_node->leftSibPageNo;
+        PageId path_leaf_num;
+        if(path != NULL){
+            moveToNextLeaf<StringNonLeafNode>(*path, path_leaf_num, true);
+        }
+        bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+        leaf_num = sibling_num;
+        bufMgr->readPage((BlobFile*)file, leaf_num, leaf_page);
+        leaf_node = reinterpret_cast<StringLeafNode*>(leaf_page);
+        entry = leaf_node->keySize - 1;
     }
-    if(!(highOpParm == LT || highOpParm == LTE)){ // If highOp does not contain one of their their expected values, throw BadOpcodesException
-        throw BadOpcodesException();
+
+    page_num = (entry < 0) ? Page::INVALID_NUMBER : leaf_num;
+    bufMgr->unPinPage((BlobFile*)file, leaf_num, false);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::startScanString
+// -----------------------------------------------------------------------------
+void BTreeIndex::startScanString(IndexCursor& cursor, const void* lowValParm, const void* highValParm)
+{
+    // The bounds are '\0' terminated char strings, compared on their first STRINGKEYMAXSIZE bytes like the keys
+    if(cursor.lowBounded){
+        const char* low_str = (const char*)lowValParm;
+        cursor.lowValString.assign(low_str, stringKeyLength(low_str));
+    }
+    if(cursor.highBounded){
+        const char* high_str = (const char*)highValParm;
+        cursor.highValString.assign(high_str, stringKeyLength(high_str));
+    }
+    // A prefix of a composite key bounds the keys starting with it, so LTE and GT bounds go above all of them
+    if(cursor.lowBounded && cursor.lowOp == GT){
+        extendPrefixBound(cursor.lowValString);
     }
-    if(*(int*)lowValParm > *(int*)highValParm){ // If lowVal > highval, throw BadScanrangeException
+    if(cursor.highBounded && cursor.highOp == LTE){
+        extendPrefixBound(cursor.highValString);
+    }
+    if(cursor.lowBounded && cursor.highBounded && cursor.highValString < cursor.lowValString){ // If lowVal > highval, throw BadScanrangeException
         throw BadScanrangeException();
     }
 
-    // Set up lowValInt and highValInt according the given values and opcodes
-    if(lowOpParm == GT){
-        lowValInt = *(int *)lowValParm + 1;
-    }
-    else{
-        lowValInt = *(int *)lowValParm;
+    // Find the entry in the B+ tree that satisfies the bound at the start of the scan, or the leftmost or rightmost
+    // leaf without one
+    NodePath* path = cursor.readAheadLeaves > 0 ? &cursor.readAheadPath : NULL;
+    bool from_edge = (cursor.order == DESCENDING) ? !cursor.highBounded : !cursor.lowBounded;
+    if(from_edge){
+        cursor.currentPageNum = findScanEdge<StringNonLeafNode>(cursor.order == DESCENDING, path);
     }
-    if(highOpParm == LT){
-        highValInt = *(int *)highValParm - 1;
+    else if(cursor.order == DESCENDING){
+        findScanPageDescendingString(cursor.highValString, cursor.highOp, cursor.currentPageNum, cursor.nextEntry, path);
     }
     else{
-        highValInt = *(int *)highValParm;
+        findScanPageString(cursor.lowValString, cursor.lowOp, cursor.currentPageNum, cursor.nextEntry, path);
     }
-    lowOp = lowOpParm;
-    highOp = highOpParm;
-
-    // Find the entry in the B+ tree that satisfies the scan criteria
-    findScanPage(lowValInt, highValInt, currentPageNum, nextEntry);
-    if(currentPageNum != Page::INVALID_NUMBER){
-        // Pin the page for scanning
-        bufMgr->readPage((BlobFile*)file, currentPageNum, currentPageData);
 
-        page_nums[num_pinned_page] = currentPageNum; // Updates the page-ids of pages which are pinned for scanning
-        num_pinned_page++; // Increment the number of pinned pages
-        scanExecuting = true; // Set the scanExecuting to true since the scan is successfully started
+    // Pin the page for scanning, and check the entry against the bound at the end of the scan
+    if(cursor.currentPageNum != Page::INVALID_NUMBER){
+        bufMgr->readPage((BlobFile*)file, cursor.currentPageNum, cursor.currentPageData);
+        StringLeafNode* leaf_node = reinterpret_cast<StringLeafNode*>(cursor.currentPageData);
+        if(from_edge){
+            cursor.nextEntry = (cursor.order == DESCENDING) ? leaf_node->keySize - 1 : 0;
+        }
+        if(cursor.nextEntry < 0 || cursor.nextEntry >= leaf_node->keySize ||
+           pastScanRangeString(cursor, leaf_node, cursor.nextEntry)){
+            moveScanToPage(cursor, Page::INVALID_NUMBER);
+        }
     }
-    else{ // Throw NoSuchKeyFoundException if there is no key in the B+ tree that satisfies the scan criteria
+    if(cursor.currentPageNum == Page::INVALID_NUMBER){ // Throw NoSuchKeyFoundException if there is no key in the B+ tree that satisfies the scan criteria
         throw NoSuchKeyFoundException();
     }
+    cursor.scanExecuting = true; // Set the scanExecuting to true since the scan is successfully started
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::scanNext
+// Helper Function: BTreeIndex::scanNextString
 // -----------------------------------------------------------------------------
-
-void BTreeIndex::scanNext(RecordId& outRid)
+void BTreeIndex::scanNextString(IndexCursor& cursor, RecordId& outRid)
 {
-    // Add your code below. Please do not remove this line.
+    StringLeafNode* leaf_node = reinterpret_cast<StringLeafNode*>(cursor.currentPageData);
+    if(pastScanRangeString(cursor, leaf_node, cursor.nextEntry)){ // If no more records, satisfying the scan criteria, are left to be scanned, throw IndexScanCompletedException
+        throw IndexScanCompletedException();
+    }
 
-    // Handle exception before return the next rid
-    if(scanExecuting == false){ // If no scan has been initialized, throw ScanNotInitializedException
-        throw ScanNotInitializedException();
+    // Return the rid of next entry, and move to the next entry, which may be in the right sibling, or down to the
+    // previous entry of a descending scan, which may be in the left sibling
+    outRid = leaf_node->slots()[cursor.nextEntry].rid;
+    if(cursor.order == DESCENDING){
+        if(cursor.nextEntry > 0){
+            cursor.nextEntry--;
+        }
+        else if(leaf_node->leftSibPageNo != Page::INVALID_NUMBER){
+            moveScanToPage(cursor, leaf_node->leftSibPageNo);
+            cursor.nextEntry = reinterpret_cast<StringLeafNode*>(cursor.currentPageData)->keySize - 1;
+        }
+        else{
+            moveScanToPage(cursor, Page::INVALID_NUMBER);
+        }
+        return;
     }
-    if(currentPageNum == Page::INVALID_NUMBER){ // If no more records, satisfying the scan criteria, are left to be scanned, throw IndexScanCompletedException
-        throw IndexScanCompletedException();
+    if(leaf_node->keySize-1 > cursor.nextEntry){
+        cursor.nextEntry++;
     }
-    LeafNodeInt* leaf_node = reinterpret_cast<LeafNodeInt*>(currentPageData);
-    if(leaf_node->keyArray[nextEntry] > highValInt){ // If no more records, satisfying the scan criteria, are left to be scanned, throw IndexScanCompletedException
-        throw IndexScanCompletedException();
+    else if(leaf_node->rightSibPageNo != Page::INVALID_NUMBER){
+        moveScanToPage(cursor, leaf_node->rightSibPageNo);
     }
-
-    // Fetch the record id of the next index entry that matches the scan
     else{
-        // Return the rid of next entry
-        outRid = leaf_node->ridArray[nextEntry];
-
-        // Update the next entry
-        if(leaf_node->keySize-1 > nextEntry){ // If the entry does not reach the end of the leaf node, just increment it
-            nextEntry++;
-        }
-        else if(leaf_node->keySize-1 == nextEntry && leaf_node->rightSibPageNo != Page::INVALID_NUMBER){
-            // If the entry reaches the end of the current leaf node, and there is a right sibling of the current leaf node,
-            // then update next entry to 0, and the current page to the right sibling
-            nextEntry = 0;
-            currentPageNum = leaf_node->rightSibPageNo;
-            bufMgr->readPage((BlobFile*)file, currentPageNum, currentPageData);
-            page_nums[num_pinned_page] = currentPageNum;
-            num_pinned_page++;
+        moveScanToPage(cursor, Page::INVALID_NUMBER);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::scanNextBatchString
+// -----------------------------------------------------------------------------
+size_t BTreeIndex::scanNextBatchString(IndexCursor& cursor, RecordId* out, size_t max)
+{
+    // This function is BTreeIndex::scanNextBatchTyped for STRING keys, whose rids are copied out of the slots
+    if(cursor.order == DESCENDING){
+        return scanNextBatchDescendingString(cursor, out, max);
+    }
+
+    size_t count = 0;
+    while(count < max && cursor.currentPageNum != Page::INVALID_NUMBER){
+        StringLeafNode* leaf_node = reinterpret_cast<StringLeafNode*>(cursor.currentPageData);
+        int end_entry = !cursor.highBounded ? leaf_node->keySize
+                      : (cursor.highOp == LT) ? stringLowerBound(leaf_node, cursor.highValString.data(), (int)cursor.highValString.size())
+                                              : stringUpperBound(leaf_node, cursor.highValString.data(), (int)cursor.highValString.size());
+        const StringLeafSlot* slots = leaf_node->slots();
+        while(count < max && cursor.nextEntry < end_entry){
+            out[count++] = slots[cursor.nextEntry++].rid;
+        }
+        if(cursor.nextEntry < end_entry){
+            break;
+        }
+
+        if(end_entry == leaf_node->keySize && leaf_node->rightSibPageNo != Page::INVALID_NUMBER){
+            moveScanToPage(cursor, leaf_node->rightSibPageNo);
         }
         else{
-            // If the entry reaches the end of the current leaf node, and there is no right sibling of the current leaf node,
-            // Set the current page number to an invalid number
-            currentPageNum = Page::INVALID_NUMBER;
+            moveScanToPage(cursor, Page::INVALID_NUMBER);
+        }
+    }
+    return count;
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::scanNextBatchDescendingString
+// -----------------------------------------------------------------------------
+size_t BTreeIndex::scanNextBatchDescendingString(IndexCursor& cursor, RecordId* out, size_t max)
+{
+    // This function is BTreeIndex::scanNextBatchDescending for STRING keys
+    size_t count = 0;
+    while(count < max && cursor.currentPageNum != Page::INVALID_NUMBER){
+        StringLeafNode* leaf_node = reinterpret_cast<StringLeafNode*>(cursor.currentPageData);
+        int begin_entry = !cursor.lowBounded ? 0
+                        : (cursor.lowOp == GT) ? stringUpperBound(leaf_node, cursor.lowValString.data(), (int)cursor.lowValString.size())
+                                               : stringLowerBound(leaf_node, cursor.lowValString.data(), (int)cursor.lowValString.size());
+        const StringLeafSlot* slots = leaf_node->slots();
+        while(count < max && cursor.nextEntry >= begin_entry){
+            out[count++] = slots[cursor.nextEntry--].rid;
+        }
+        if(cursor.nextEntry >= begin_entry){
+            break;
+        }
+
+        if(begin_entry == 0 && leaf_node->leftSibPageNo != Page::INVALID_NUMBER){
+            moveScanToPage(cursor, leaf_node->leftSibPageNo);
+            cursor.nextEntry = reinterpret_cast<StringLeafNode*>(cursor.currentPageData)->keySize - 1;
+        }
+        else{
+            moveScanToPage(cursor, Page::INVALID_NUMBER);
         }
-        return;
     }
+    return count;
 }
 
 // -----------------------------------------------------------------------------
@@ -788,17 +4860,106 @@ void BTreeIndex::endScan()
 {
     // Add your code below. Please do not remove this line.
 
-    if(scanExecuting == false){// If no scan has been initialized, throw the ScanNotInitializedException and exit
+    endScan(scanCursor);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::endScan (cursor)
+// -----------------------------------------------------------------------------
+void BTreeIndex::endScan(IndexCursor& cursor)
+{
+    if(cursor.scanExecuting == false){// If no scan has been initialized, throw the ScanNotInitializedException and exit
         throw ScanNotInitializedException();
     }
 
     // Set the scanExecuting to false since the scan is ended
-    scanExecuting = false;
+    cursor.scanExecuting = false;
+
+    // Unpin the leaf the scan is on, none is pinned anymore if the scan was completed
+    moveScanToPage(cursor, Page::INVALID_NUMBER);
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::endOpenScans
+// -----------------------------------------------------------------------------
+void BTreeIndex::endOpenScans()
+{
+    for(size_t i = 0; i < openCursors.size(); i++){
+        if(openCursors[i]->scanExecuting == true){
+            endScan(*openCursors[i]);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Helper Function: BTreeIndex::stopReadAhead
+// -----------------------------------------------------------------------------
+void BTreeIndex::stopReadAhead()
+{
+    // The leaves already read ahead stay, they are still where the scans go next
+    for(size_t i = 0; i < openCursors.size(); i++){
+        openCursors[i]->readAheadPath.depth = 0;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// IndexCursor::IndexCursor
+// -----------------------------------------------------------------------------
+IndexCursor::IndexCursor(BTreeIndex* index)
+{
+    this->index = index;
+    this->scanExecuting = false;
+    this->currentPageNum = Page::INVALID_NUMBER;
+    this->currentPageData = NULL;
+    this->order = ASCENDING;
+    this->readAheadLeaves = 0;
+    this->readAheadPath.depth = 0;
+    index->openCursors.push_back(this);
+}
 
-    // Unpin the pinned pages
-    for(int i = 0; i < num_pinned_page; i++){
-        bufMgr->unPinPage((BlobFile*)file, page_nums[i], false);
+// -----------------------------------------------------------------------------
+// IndexCursor::~IndexCursor
+// -----------------------------------------------------------------------------
+IndexCursor::~IndexCursor()
+{
+    // The index ends the scan and forgets the cursor itself when it is destroyed first
+    if(index == NULL){
+        return;
+    }
+    try{
+        if(scanExecuting == true){
+            index->endScan(*this);
+        }
+    }
+    catch(std::exception &e){
+        std::cout << "Error: fail to end the scan of a cursor" << std::endl;
     }
+    std::vector<IndexCursor*>& cursors = index->openCursors;
+    cursors.erase(std::find(cursors.begin(), cursors.end(), this));
+}
+
+// -----------------------------------------------------------------------------
+// IndexCursor::startScan, IndexCursor::scanNext, IndexCursor::scanNextBatch, IndexCursor::endScan
+// -----------------------------------------------------------------------------
+void IndexCursor::startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+                            const ScanOrder order)
+{
+    index->startScan(*this, lowVal, lowOp, highVal, highOp, order);
+}
+
+void IndexCursor::scanNext(RecordId& outRid, void* outIncluded)
+{
+    index->scanNext(*this, outRid, (char*)outIncluded);
+}
+
+size_t IndexCursor::scanNextBatch(RecordId* out, size_t max, void* outIncluded)
+{
+    return index->scanNextBatch(*this, out, max, (char*)outIncluded);
+}
+
+void IndexCursor::endScan()
+{
+    index->endScan(*this);
 }
 
 }
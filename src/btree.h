@@ -23,15 +23,33 @@
 #include "string.h"
 #include <sstream>
 #include <cstring>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 #include "types.h"
 #include "page.h"
 #include "file.h"
 #include "buffer.h"
+#include "string_node.h"
+#include "posting_node.h"
+#include "covering_node.h"
+#include "packed_node.h"
+#include "composite_key.h"
+#include "bloom_filter.h"
+#include "resident_levels.h"
+#include "node_versions.h"
 
 namespace badgerdb
 {
 
+template <class T>
+class ExternalSorter;
+
+class BTreeIndex;
+
 /**
  * @brief Datatype enumeration type.
  */
@@ -39,7 +57,8 @@ enum Datatype
 {
 	INTEGER = 0,
 	DOUBLE = 1,
-	STRING = 2
+	STRING = 2,
+	INT64 = 3
 };
 
 /**
@@ -53,290 +72,1473 @@ enum Operator
 	GT		/* Greater Than */
 };
 
+/**
+ * @brief Order in which a scan returns the entries of its range. Passed to BTreeIndex::startScan() method.
+ */
+enum ScanOrder
+{
+	ASCENDING,	/* From the low value up */
+	DESCENDING	/* From the high value down */
+};
+
+
+/**
+ * @brief Number of key slots in B+Tree leaf and non-leaf nodes for a key of type T. Computed at compile time,
+ * so each key type gets nodes which fill a page.
+ */
+template <class T>
+struct NodeCapacity{
+  /**
+   * Number of key slots in a leaf node.
+   */
+	//                                      sibling ptrs             size and format   high key             key               rid
+	static const int LEAF = ( Page::SIZE - 2 * sizeof( PageId ) - 2 * sizeof(int) - sizeof( T )) / ( sizeof( T ) + sizeof( RecordId ) );
+
+  /**
+   * Number of key slots in a non-leaf node.
+   */
+	//                                         level     extra pageNo and sibling        size       high key              key       pageNo
+	static const int NONLEAF = ( Page::SIZE - sizeof( int ) - 2 * sizeof( PageId ) - sizeof(int) - sizeof( T )) / ( sizeof( T ) + sizeof( PageId ) );
+
+  /**
+   * Middle position in a leaf node.
+   */
+	static const int MIDDLELEAF = LEAF/2;
+
+  /**
+   * Middle position in a non-leaf node.
+   */
+	static const int MIDDLENONLEAF = NONLEAF/2;
+};
 
 /**
  * @brief Number of key slots in B+Tree leaf for INTEGER key.
  */
-//                                                  sibling ptr         size                key               rid
-const  int INTARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId ) - sizeof(int)) / ( sizeof( int ) + sizeof( RecordId ) );
+const  int INTARRAYLEAFSIZE = NodeCapacity<int>::LEAF;
+
+/**
+ * @brief Number of key slots in B+Tree non-leaf for INTEGER key.
+ */
+const  int INTARRAYNONLEAFSIZE = NodeCapacity<int>::NONLEAF;
+
+/**
+ * @brief Middle position in B+Tree leaf for INTEGER key.
+ */
+//
+const int MIDDLELEAF = NodeCapacity<int>::MIDDLELEAF;
+
+/**
+ * @brief Middle position in B+Tree non-leaf for INTEGER key.
+ */
+//
+const int MIDDLENONLEAF = NodeCapacity<int>::MIDDLENONLEAF;
+
+/**
+ * @brief Maximum height of a B+ Tree. Even with the smallest fanout a tree of this height holds far more keys
+ * than an index file can address.
+ */
+const int MAXTREEHEIGHT = 32;
+
+/**
+ * @brief Maximum number of included columns of a covering index, see IndexOptions::includedColumns.
+ */
+const int MAXINCLUDEDCOLUMNS = 8;
+
+/**
+ * @brief Maximum number of included bytes of an entry of a covering index, so a leaf still holds a few dozen entries.
+ */
+const int MAXINCLUDEDBYTES = 256;
+
+/**
+ * @brief Column of the relation stored beside every key in the leaves of a covering index.
+ */
+struct IncludedColumn{
+  /**
+   * Offset of the column inside the record.
+   */
+	int byteOffset;
+
+  /**
+   * Number of bytes of the column.
+   */
+	int length;
+};
+
+/**
+ * @brief Maximum number of key columns of a composite key, see IndexOptions::keyColumns.
+ */
+const int MAXKEYCOLUMNS = 8;
+
+/**
+ * @brief Attribute of the relation which is one part of a composite key.
+ */
+struct KeyColumn{
+  /**
+   * Offset of the attribute inside the record.
+   */
+	int byteOffset;
+
+  /**
+   * Type of the attribute.
+   */
+	Datatype type;
+};
+
+/**
+ * @brief Structure to store a key-rid pair. It is used to pass the pair to functions that
+ * add to or make changes to the leaf node pages of the tree. Is templated for the key member.
+ */
+template <class T>
+class RIDKeyPair{
+public:
+	RecordId rid;
+	T key;
+	void set( RecordId r, T k)
+	{
+		rid = r;
+		key = k;
+	}
+};
+
+/**
+ * @brief Structure to store a key page pair which is used to pass the key and page to functions that make
+ * any modifications to the non leaf pages of the tree.
+*/
+template <class T>
+class PageKeyPair{
+public:
+	PageId pageNo;
+	T key;
+	void set( int p, T k)
+	{
+		pageNo = p;
+		key = k;
+	}
+};
+
+/**
+ * @brief An entry of a batch inserted with BTreeIndex::insertBatch, taking the arguments of insertEntry.
+*/
+struct KeyRid{
+  /**
+   * Key to insert, pointer to integer/double/int64 (need not be aligned) or '\0' terminated char string.
+   */
+	const void* key;
+
+  /**
+   * Record ID of the record whose entry is inserted.
+   */
+	RecordId rid;
+
+  /**
+   * Bytes of the included columns of the record, needed by a covering index only, NULL otherwise.
+   */
+	const void* included;
+};
+
+/**
+ * @brief Structure to record a non-leaf node passed through on the way from the root to a leaf. Inserts use it
+ * to propagate a split to the parent node without descending from the root again.
+*/
+struct PathEntry{
+  /**
+   * Page number of the non-leaf node.
+   */
+	PageId pageNo;
+
+  /**
+   * Position of the child page number which was followed in pageNoArray.
+   */
+	int position;
+
+  /**
+   * Number of keys in the node when it was passed through.
+   */
+	int keySize;
+};
+
+/**
+ * @brief Structure to store the non-leaf nodes passed through on the way down to a leaf, from the root
+ * (entries[0]) to the parent of the leaf (entries[depth - 1]).
+*/
+struct NodePath{
+  /**
+   * Recorded non-leaf nodes.
+   */
+	PathEntry entries[ MAXTREEHEIGHT ];
+
+  /**
+   * Number of recorded non-leaf nodes, 0 if the root is a leaf.
+   */
+	int depth;
+};
+
+/**
+ * @brief Overloaded operator to compare the key values of two rid-key pairs
+ * and if they are the same compares to see if the first pair has
+ * a smaller rid, by page number and then slot number, so the entries of a key come out of a sort in posting list order.
+*/
+template <class T>
+bool operator<( const RIDKeyPair<T>& r1, const RIDKeyPair<T>& r2 )
+{
+	if( r1.key != r2.key )
+		return r1.key < r2.key;
+	else
+		return ridLess(r1.rid, r2.rid);
+}
+
+/**
+ * @brief The meta page, which holds metadata for Index file, is always first page of the btree index file and is cast
+ * to the following structure to store or retrieve information from it.
+ * Contains the relation name for which the index is created, the byte offset
+ * of the key value on which the index is made, the type of the key and the page no
+ * of the root page. Root page starts as page 2 but since a split can occur
+ * at the root the root page may get moved up and get a new page no.
+*/
+struct IndexMetaInfo{
+  /**
+   * Name of base relation.
+   */
+	char relationName[20];
+
+  /**
+   * Offset of attribute, over which index is built, inside the record stored in pages.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute over which index is built.
+   */
+	Datatype attrType;
+
+  /**
+   * Page number of root page of the B+ Tree inside the file index file.
+   */
+	PageId rootPageNo;
+
+  /**
+   * Number of levels in the B+ Tree, 1 if the root page is a leaf.
+   */
+	int height;
+
+  /**
+   * Page number of the leftmost leaf, where full scans start. It never changes: the first leaf of an index is the
+   * root page it is created with, and the node on the left keeps its page through splits, merges and bulk loads.
+   */
+	PageId firstLeafPageNo;
+
+  /**
+   * Number of included columns, 0 unless the index is a covering index.
+   */
+	int includedCount;
+
+  /**
+   * Included columns of a covering index, in the order their bytes are stored in an entry.
+   */
+	IncludedColumn includedColumns[ MAXINCLUDEDCOLUMNS ];
+
+  /**
+   * Number of key columns, 0 unless the key is a composite key.
+   */
+	int keyCount;
+
+  /**
+   * Key columns of a composite key, in the order they are compared.
+   */
+	KeyColumn keyColumns[ MAXKEYCOLUMNS ];
+
+  /**
+   * Bits per key of the Bloom filter, 0 if the index has none.
+   */
+	int bloomBitsPerKey;
+
+  /**
+   * Number of pages of the Bloom filter.
+   */
+	int bloomPageCount;
+
+  /**
+   * Number of entries added to the Bloom filter, as of the last write of the meta page.
+   */
+	std::int64_t bloomKeyCount;
+
+  /**
+   * Pages of the Bloom filter, in the order of their blocks.
+   */
+	PageId bloomPageNo[ MAXBLOOMPAGES ];
+};
+
+static_assert(sizeof(IndexMetaInfo) <= Page::SIZE, "The meta page must fit in a page.");
+
+/**
+ * @brief Options for building an index, passed to the BTreeIndex constructor. The build options only take effect
+ * when the index file does not exist yet and is built from the relation, the split options apply to every insert
+ * through the BTreeIndex object.
+*/
+struct IndexOptions{
+  /**
+   * Build the index bottom-up from the sorted entries of the relation, instead of inserting them one at a time.
+   */
+	bool bulkLoad;
+
+  /**
+   * Fraction of every node filled by a bulk load, greater than 0 and at most 1. Leaving room in the nodes keeps
+   * later inserts from splitting them right away.
+   */
+	double fillFactor;
+
+  /**
+   * Memory in bytes the sort of a bulk load may use. Once it is used up, sorted runs are written to a temporary
+   * file next to the index and merged afterwards, so relations larger than memory can be bulk loaded.
+   */
+	size_t sortMemory;
+
+  /**
+   * Number of threads sorting the runs of a bulk load, 0 to use all cores.
+   */
+	int sortThreads;
+
+  /**
+   * Fraction of the entries, or of the bytes for STRING keys and posting lists, the left node keeps when a node
+   * splits, greater than 0 and less than 1.
+   */
+	double splitFill;
+
+  /**
+   * splitFill for a node which splits because a key greater than all of its keys goes into the rightmost node of
+   * its level. Keys inserted in increasing order, like timestamps, then leave the nodes behind them this full instead
+   * of half full. 0.5 splits such a node evenly like any other.
+   */
+	double rightmostSplitFill;
+
+  /**
+   * Columns of the relation stored beside every key in the leaves, at most MAXINCLUDEDCOLUMNS of them taking at most
+   * MAXINCLUDEDBYTES together, which makes the index a covering index: a scan returns their bytes along with the
+   * record ids, so a query reading only the key and these columns never reads the records. Leaves then hold fewer
+   * entries and never turn into posting lists. An index file keeps the columns it was built with, and must be opened
+   * with the same ones. Only indexes on INTEGER, DOUBLE and INT64 keys can include columns, and a covering index is
+   * built by inserts, since the sort of a bulk load only carries keys and record ids.
+   */
+	std::vector<IncludedColumn> includedColumns;
+
+  /**
+   * Attributes of the relation making up a composite key, at most MAXKEYCOLUMNS of them, compared one after the
+   * other. Keys are encoded as STRING keys, see CompositeKey.
+   */
+	std::vector<KeyColumn> keyColumns;
+
+  /**
+   * Bits per key of a Bloom filter which lets point lookups skip keys not in the index, 0 for no filter, at most
+   * MAXBLOOMBITSPERKEY. Ignored when an existing index file is opened, which keeps the filter it was built with.
+   */
+	int bloomBitsPerKey;
+
+  /**
+   * Store the leaves bit-packed in the PACKED_LIST format, see packed_node.h.
+   */
+	bool packedLeaves;
+
+  /**
+   * Number of levels from the root down whose non-leaf nodes are kept decoded in memory, see ResidentLevels, at
+   * least 0 and at most MAXTREEHEIGHT. Indexes on STRING keys keep none.
+   */
+	int residentLevels;
+
+  /**
+   * Let several threads call lookup, lookupAll and insertEntry at once, see insertConcurrent; the other methods need
+   * the index to themselves. Only indexes on INTEGER, DOUBLE and INT64 keys without a Bloom filter can be concurrent.
+   */
+	bool concurrent;
+
+	IndexOptions() : bulkLoad(true), fillFactor(0.9), sortMemory(64 * 1024 * 1024), sortThreads(0), splitFill(0.5),
+	                 rightmostSplitFill(0.9), bloomBitsPerKey(0), packedLeaves(false), residentLevels(2),
+	                 concurrent(false) {}
+};
+
+/**
+ * @brief Lookups through the Bloom filter of an index since the index was opened, see
+ * BTreeIndex::getBloomFilterStats().
+*/
+struct BloomFilterStats{
+  /**
+   * Lookups which consulted the filter.
+   */
+	size_t lookups;
+
+  /**
+   * Lookups of keys the filter ruled out, which returned without descending the tree.
+   */
+	size_t rejected;
+
+  /**
+   * Lookups of keys the filter let through, but which the index does not hold.
+   */
+	size_t falsePositives;
+
+	BloomFilterStats() : lookups(0), rejected(0), falsePositives(0) {}
+
+  /**
+   * Fraction of the lookups of keys the index does not hold which the filter let through, 0 before there are any.
+   */
+	double falsePositiveRate() const
+	{
+		size_t misses = rejected + falsePositives;
+		return misses == 0 ? 0 : (double)falsePositives / misses;
+	}
+};
+
+/*
+Each node is a page, so once we read the page in we just cast the pointer to the page to this struct and use it to access the parts
+These structures basically are the format in which the information is stored in the pages for the index file depending on what kind of
+node they are. The level memeber of each non leaf structure seen below is set to 1 if the nodes
+at this level are just above the leaf nodes. Otherwise set to 0.
+Every node of a level links to the node on its right and records its high key, the key separating it from that node
+in their parents, like in the B-link tree of Lehman and Yao, so a node holds no key greater than its high key. A
+concurrent reader which reaches a node after keys moved out of it to a new node on its right follows the link.
+*/
+
+/**
+ * @brief Structure for all non-leaf nodes, templated on the type of the key.
+*/
+template <class T>
+struct NonLeafNode{
+
+  /**
+   * Number of keys in the node
+   */
+    int keySize;
+
+  /**
+   * Level of the node in the tree.
+   */
+	int level;
+
+  /**
+   * Page number of the node on the right side on the same level, an invalid page number for the rightmost node.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Greatest key the node may hold, the separator between it and its right sibling. Only set if it has one.
+   */
+	T highKey;
+
+  /**
+   * Stores keys.
+   */
+	T keyArray[ NodeCapacity<T>::NONLEAF ];
+
+  /**
+   * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
+   */
+	PageId pageNoArray[ NodeCapacity<T>::NONLEAF + 1 ];
+};
+
+
+/**
+ * @brief Structure for all leaf nodes in the ENTRY_LIST format, templated on the type of the key. A leaf whose keys
+ * repeat a lot is kept in the POSTING_LIST format of PostingLeafNode instead, which shares the header up to
+ * highKey, so the siblings and the high key of a leaf can be read through this structure whatever its format.
+*/
+template <class T>
+struct LeafNode{
+
+  /**
+   * Number of keys in the node
+   */
+    int keySize;
+
+  /**
+   * Format of the node, ENTRY_LIST for this structure.
+   */
+	LeafFormat format;
+
+  /**
+   * Page number of the leaf on the right side.
+	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side, followed by scans in descending order.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Greatest key the leaf may hold, the separator between it and its right sibling. Only set if it has one.
+   */
+	T highKey;
+
+  /**
+   * Stores keys.
+   */
+	T keyArray[ NodeCapacity<T>::LEAF ];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[ NodeCapacity<T>::LEAF ];
+};
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of INTEGER type.
+*/
+typedef NonLeafNode<int> NonLeafNodeInt;
+
+/**
+ * @brief Structure for all leaf nodes when the key is of INTEGER type.
+*/
+typedef LeafNode<int> LeafNodeInt;
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of DOUBLE type.
+*/
+typedef NonLeafNode<double> NonLeafNodeDouble;
+
+/**
+ * @brief Structure for all leaf nodes when the key is of DOUBLE type.
+*/
+typedef LeafNode<double> LeafNodeDouble;
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of INT64 type.
+*/
+typedef NonLeafNode<std::int64_t> NonLeafNodeInt64;
+
+/**
+ * @brief Structure for all leaf nodes when the key is of INT64 type.
+*/
+typedef LeafNode<std::int64_t> LeafNodeInt64;
+
+static_assert(sizeof(LeafNodeInt) <= Page::SIZE && sizeof(NonLeafNodeInt) <= Page::SIZE,
+              "INTEGER nodes must fit in a page.");
+static_assert(sizeof(LeafNodeDouble) <= Page::SIZE && sizeof(NonLeafNodeDouble) <= Page::SIZE,
+              "DOUBLE nodes must fit in a page.");
+static_assert(sizeof(LeafNodeInt64) <= Page::SIZE && sizeof(NonLeafNodeInt64) <= Page::SIZE,
+              "INT64 nodes must fit in a page.");
+
+
+/**
+ * @brief Cursor of a range scan of a BTreeIndex. A cursor owns the bounds and the position of its scan, so any
+ * number of cursors can scan the same index at the same time, each keeping the leaf it is on pinned. A cursor
+ * can run one scan after the other, startScan ending the scan it is running. Deleting an entry from the index
+ * ends the scans of all cursors, since the delete may merge away the leaves they are on. The cursor must not be
+ * used after the index is destroyed, which ends its scan.
+*/
+class IndexCursor {
+
+ public:
+
+  /**
+   * Constructor. The cursor is not scanning until startScan is called.
+   * @param index   Index to scan
+   */
+	IndexCursor(BTreeIndex* index);
+
+  /**
+   * Destructor. End the scan if one is executing. Does not throw.
+   */
+	~IndexCursor();
+
+	IndexCursor(const IndexCursor& other) = delete;
+	IndexCursor& operator=(const IndexCursor& other) = delete;
+
+  /**
+   * Begin a scan, like BTreeIndex::startScan, ending the scan of this cursor if one is executing.
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+   */
+	void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+	               const ScanOrder order = ASCENDING);
+
+  /**
+   * Fetch the record id of the next index entry that matches the scan, like BTreeIndex::scanNext.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+   */
+	void scanNext(RecordId& outRid, void* outIncluded = NULL);
+
+  /**
+   * Fetch the record ids of the next index entries that match the scan, like BTreeIndex::scanNextBatch.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+   */
+	size_t scanNextBatch(RecordId* out, size_t max, void* outIncluded = NULL);
+
+  /**
+   * Terminate the scan and unpin its pages.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+   */
+	void endScan();
+
+  /**
+   * True if a scan has been started and not ended.
+   */
+	bool isScanning() const { return scanExecuting; }
+
+  /**
+   * Read ahead the given number of leaves of the scan, 0 (the default) to read each leaf only when the scan gets
+   * to it. The leaves ahead come from the non-leaf nodes above the scan, their reads are started in the background
+   * through BufMgr::prefetchPage, and stop at the high bound of the scan. Takes effect at the next startScan.
+   * @param leaves  Number of leaves read ahead
+   */
+	void setReadAhead(int leaves) { readAheadLeaves = leaves; }
+
+ private:
+
+	friend class BTreeIndex;
+
+  /**
+   * Index scanned, NULL once the index is destroyed.
+   */
+	BTreeIndex* index;
+
+  /**
+   * True if a scan has been started on this cursor.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Index of next entry to be scanned in current leaf being scanned.
+   */
+	int			nextEntry;
+
+  /**
+   * Page number of current page being scanned, the only page the scan keeps pinned. An invalid page number once
+   * the scan is completed, then no page is pinned.
+   */
+	PageId	currentPageNum;
+
+  /**
+   * Current Page being scanned.
+   */
+	Page		*currentPageData;
+
+  /**
+   * Keys and record ids of the entries of the current page if it is a POSTING_LIST leaf, one of each per entry with
+   * the record ids of overflow pages read in, or a PACKED_LIST leaf, unpacked, so the scan goes through them like
+   * through an ENTRY_LIST leaf. The keys are stored as bytes, of the key type of the index. Empty on an ENTRY_LIST
+   * leaf.
+   */
+	std::vector<char>	leafKeys;
+	std::vector<RecordId>	leafRids;
+
+  /**
+   * Low INTEGER value for scan.
+   */
+	int			lowValInt;
+
+  /**
+   * Low DOUBLE value for scan.
+   */
+	double	lowValDouble;
+
+  /**
+   * Low INT64 value for scan.
+   */
+	std::int64_t	lowValInt64;
+
+  /**
+   * Low STRING value for scan.
+   */
+	std::string	lowValString;
+
+  /**
+   * High INTEGER value for scan.
+   */
+	int			highValInt;
+
+  /**
+   * High DOUBLE value for scan.
+   */
+	double	highValDouble;
+
+  /**
+   * High INT64 value for scan.
+   */
+	std::int64_t	highValInt64;
+
+  /**
+   * High STRING value for scan.
+   */
+	std::string highValString;
+
+  /**
+   * Low Operator. Can only be GT(>) or GTE(>=).
+   */
+	Operator	lowOp;
+
+  /**
+   * False if the scan has no low bound, the low value and operator are then not used.
+   */
+	bool		lowBounded;
+
+  /**
+   * False if the scan has no high bound.
+   */
+	bool		highBounded;
+
+  /**
+   * Order of the scan. A descending scan walks the leaves from right to left, nextEntry moving down.
+   */
+	ScanOrder	order;
+
+  /**
+   * High Operator. Can only be LT(<) or LTE(<=).
+   */
+	Operator	highOp;
+
+  /**
+   * Number of leaves read ahead of the scan, 0 for none.
+   */
+	int			readAheadLeaves;
+
+  /**
+   * Path to the last leaf read ahead, which is followed on to the next leaves. Depth 0 once there is nothing left
+   * to read ahead, or the tree changed shape under the scan.
+   */
+	NodePath	readAheadPath;
+
+  /**
+   * Leaves read ahead which the scan has not got to yet, in order.
+   */
+	std::deque<PageId>	readAheadPages;
+};
+
+
+/**
+ * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
+ * relation. The index runs one scan of its own through startScan, scanNext and endScan, and any number of
+ * scans through IndexCursor objects.
+*/
+class BTreeIndex {
+
+ private:
+
+	friend class IndexCursor;
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * page number of root page of B+ tree inside index file. Kept in memory and only written back
+   * to the meta page when the root changes.
+   */
+	PageId	rootPageNum;
+
+  /**
+   * Number of levels in the B+ tree, 1 if the root is a leaf. Written back to the meta page with the root.
+   */
+	int			treeHeight;
+
+  /**
+   * True if the root page is a leaf, i.e. the tree has a single node.
+   */
+	bool		rootIsLeaf;
+
+  /**
+   * Page number of the leftmost leaf, read from the meta page.
+   */
+	PageId	firstLeafPageNum;
+
+  /**
+   * Datatype of attribute over which index is built.
+   */
+	Datatype	attributeType;
+
+  /**
+   * Offset of attribute, over which index is built, inside records.
+   */
+	int 		attrByteOffset;
+
+  /**
+   * Number of keys in leaf node, depending upon the type of key.
+   */
+	int			leafOccupancy;
+
+  /**
+   * Number of keys in non-leaf node, depending upon the type of key.
+   */
+	int			nodeOccupancy;
+
+  /**
+   * Fractions the left node keeps when a node splits, IndexOptions::splitFill and IndexOptions::rightmostSplitFill.
+   */
+	double	splitFill;
+	double	rightmostSplitFill;
+
+  /**
+   * Included columns of a covering index, IndexOptions::includedColumns, and the number of bytes they take in an
+   * entry, 0 if the index has none.
+   */
+	std::vector<IncludedColumn> includedColumns;
+	int			includedBytes;
+
+  /**
+   * Key columns of a composite key, IndexOptions::keyColumns, empty if the key is a single attribute, and the number
+   * of encoded bytes of a key with all of them, counting one byte for a last STRING column.
+   */
+	std::vector<KeyColumn> keyColumns;
+	int			compositeKeyBytes;
+
+  /**
+   * True if new leaves are created in the PACKED_LIST format, IndexOptions::packedLeaves. Splits and merges keep the
+   * format of the leaves they change.
+   */
+	bool		packedLeaves;
+
+  /**
+   * Bloom filter of the index, IndexOptions::bloomBitsPerKey, with no pages if the index has none: the number of bits
+   * a key sets, the pages, the number of entries added since it was built and the lookups through it.
+   */
+	int			bloomBitsPerKey;
+	int			bloomProbeCount;
+	std::vector<PageId> bloomPageNums;
+	std::int64_t bloomKeyCount;
+	BloomFilterStats bloomStats;
+
+  /**
+   * Number of top levels kept in memory, IndexOptions::residentLevels, and their copies.
+   */
+	int			residentLevelCount;
+	ResidentLevels resident;
+
+  /**
+   * Version counters of the pages of a concurrent index, IndexOptions::concurrent, NULL if the index is not.
+   */
+	NodeVersions* nodeVersions;
+
+  /**
+   * Held while the resident copies of a concurrent index are built or changed, so one thread at a time changes them.
+   * Descents only try it to build the copies, and give the build up rather than wait for a node a writer holds.
+   */
+	std::mutex	residentLatch;
+
+
+	// MEMBERS SPECIFIC TO SCANNING
+
+  /**
+   * Cursors open on the index, each of which keeps a leaf page pinned while it scans.
+   */
+	std::vector<IndexCursor*> openCursors;
+
+  /**
+   * Cursor of the scan run through startScan, scanNext and endScan of the index itself.
+   */
+	IndexCursor scanCursor;
+
+
+  /**
+   * Get the low value member of the scan of a cursor for key type T, i.e. lowValInt, lowValDouble or lowValInt64.
+   */
+	template <class T>
+	T& scanLowValue(IndexCursor& cursor);
+
+  /**
+   * Get the high value member of the scan of a cursor for key type T, i.e. highValInt, highValDouble or highValInt64.
+   */
+	template <class T>
+	T& scanHighValue(IndexCursor& cursor);
+
+  /**
+   * startScan, scanNext, scanNextBatch and endScan run on the given cursor, the index's own one or one
+   * of an IndexCursor.
+   */
+	void startScan(IndexCursor& cursor, const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+	               const ScanOrder order);
+	void scanNext(IndexCursor& cursor, RecordId& outRid, char* outIncluded);
+	size_t scanNextBatch(IndexCursor& cursor, RecordId* out, size_t max, char* outIncluded);
+	void endScan(IndexCursor& cursor);
+
+  /**
+   * End the scans of all open cursors, which keep leaf pages pinned.
+   */
+	void endOpenScans();
+
+  /**
+   * Stop reading ahead for the scans of all open cursors, whose read ahead paths a split made out of date.
+   */
+	void stopReadAhead();
+
+  /**
+   * Read ahead leaves for the scan of the cursor until as many as its setting are ahead of it.
+   */
+	void readAhead(IndexCursor& cursor);
+
+  /**
+   * readAhead for an index whose non-leaf nodes are of type NonLeaf.
+   */
+	template <class NonLeaf>
+	void readAheadTyped(IndexCursor& cursor);
+
+  /**
+   * True if the key is past the end of the scan of the cursor: beyond the high bound of an ascending scan, or below
+   * the low bound of a descending scan. Always false if the scan has no bound at that end.
+   */
+	template <class T>
+	bool pastScanRange(IndexCursor& cursor, const T& key);
+
+  /**
+   * pastScanRange for the key at the given position of a STRING leaf or non-leaf node.
+   */
+	template <class Node>
+	bool pastScanRangeString(IndexCursor& cursor, const Node* node, int position);
+
+  /**
+   * True if the key at the given position of the non-leaf node is past the end of the scan of the cursor, so that
+   * no child on its right (on its left for a descending scan) holds an entry of the scan.
+   */
+	template <class T>
+	bool pastScanRange(IndexCursor& cursor, const NonLeafNode<T>* node, int position);
+	bool pastScanRange(IndexCursor& cursor, const StringNonLeafNode* node, int position);
+
+  /**
+   * Find the leftmost leaf, or the rightmost one, where a scan without a bound at its start begins. The leftmost
+   * leaf is known from the meta page, the tree is only descended along its edge to record the path when asked for.
+   * NonLeaf is the non-leaf node type of the index.
+   * @param rightmost True to find the rightmost leaf
+   * @param path Return the non-leaf nodes from the root to the parent of the leaf node, may be NULL
+   * @return Page number of the leaf
+   */
+	template <class NonLeaf>
+	PageId findScanEdge(bool rightmost, NodePath* path);
+
+  /**
+   * insertEntry for an index whose key is of type T.
+   */
+	template <class T>
+	void insertEntryTyped(T key, const RecordId rid, const char* included);
+
+  /**
+   * insertBatch for an index whose key is of type T.
+   */
+	template <class T>
+	void insertBatchTyped(const KeyRid* entries, size_t n);
+
+  /**
+   * Insert the entries of a sorted batch from start on which go into the same leaf node, after descending to it.
+   * @param split Set to true if a leaf node split
+   * @return Number of entries inserted, at least one
+   */
+	template <class T>
+	size_t insertLeafBatch(const std::vector<std::pair<T, RecordId> >& batch, size_t start, bool& split);
+
+  /**
+   * Insert the pushing-up key of a node which split into the recorded ancestors from its parent upwards, until a node
+   * absorbs the key without splitting, and add a new root if the root split.
+   * @param path The path to the node which split, ending at its parent
+   * @param right_child_num The page number of the node split off on the right, an invalid page number if none did
+   */
+	template <class T>
+	void insertPushUpKey(const NodePath& path, PageId left_child_num, PageId right_child_num, T push_up_key);
+
+  /**
+   * Insert the given keys, with the children on their right, into the non-leaf node in the given page at the given
+   * position, which has room for them, shifting the keys after it once.
+   */
+	template <class T>
+	void insertNonLeafKeys(PageId page_num, int position, const T* keys, const PageId* child_nums, int count);
+
+  /**
+   * Insert the entry into the leaf node at the end of the path, pinned in leaf_page, which is unpinned here.
+   * @param right_node_num Return the page number of the node split off on the right, an invalid page number if the
+   *                       leaf node did not split
+   */
+	template <class T>
+	void insertLeafEntry(const NodePath& path, PageId leaf_num, Page* leaf_page, T key, const RecordId rid,
+	                     const char* included, PageId& left_node_num, PageId& right_node_num, T& push_up_key);
+
+  /**
+   * insertEntryTyped for a concurrent index, after Lehman and Yao. The leaf node found by descendOptimistic is locked
+   * and takes the entry. A node which splits is unlocked before its parent is locked, so the insert holds at most two
+   * nodes at a time, and every node locked is moved right from while the key is above its high key.
+   */
+	template <class T>
+	void insertConcurrent(T key, const RecordId rid, const char* included);
+
+  /**
+   * Descend like descendToLeaf without pinning the leaf node, through the resident copies and then the pages. Every
+   * node is read again until its version shows no writer changed it meanwhile, and the descent moves right from a
+   * node whose high key is below the key.
+   * @param path Set to the nodes passed through, which may have split since
+   * @param page_num Return the page number of the leaf node, which may have split since too
+   */
+	template <class T>
+	void descendOptimistic(T key, NodePath* path, PageId& page_num);
+
+  /**
+   * Move right from the locked node pinned in page while the key is above its high key, locking every node before
+   * the one on its left is unlocked and unpinned.
+   * @param page_num The page number of the node, changed to that of the node which holds the key, then locked and pinned in page
+   */
+	template <class Node, class T>
+	void moveRightLocked(T key, PageId& page_num, Page*& page);
+
+  /**
+   * Copy the included columns of a record into the bytes of an entry, in the order of includedColumns.
+   */
+	void copyIncludedColumns(const char* record, char* included) const;
+
+  /**
+   * Key of a record, which is read at attrByteOffset, or encoded into the given buffer for a composite key.
+   */
+	const char* recordKey(const char* record, std::string& encoded) const;
+
+  /**
+   * Turn a scan bound on a composite key which holds fewer than all key columns into a bound above every key starting
+   * with it, by filling it up with bytes greater than any encoded byte. Used for LTE and GT bounds.
+   */
+	void extendPrefixBound(std::string& bound) const;
+
+  /**
+   * Insert a key&rid pair and its included bytes at the given position of a pinned COVERING_LIST leaf node, like
+   * modifyLeafNode. A full node splits, the left node keeping left_fill of the entries.
+   * @param right_node_num Return the PageId of the right leaf node if split, or an invalid PageId if not split
+   * @param push_up_key Return the key for pushing up if split, unchanged if not split
+   */
+	template <class T>
+	void insertCoveringLeafEntry(PageId page_num, Page* leaf_page, T key, RecordId rid, const char* included, int position,
+	                             PageId& right_node_num, T& push_up_key, double left_fill);
+
+  /**
+   * Insert a key&rid pair at the given position of a pinned PACKED_LIST leaf node, like modifyLeafNode. The node is
+   * unpacked and packed again with the entry, and splits if the entry does not fit, the left node keeping about
+   * left_fill of the entries.
+   * @param right_node_num Return the PageId of the right leaf node if split, or an invalid PageId if not split
+   * @param push_up_key Return the key for pushing up if split, unchanged if not split
+   */
+	template <class T>
+	void insertPackedEntry(PageId page_num, Page* leaf_page, T key, RecordId rid, int position, PageId& right_node_num,
+	                       T& push_up_key, double left_fill);
+
+  /**
+   * lookup and lookupAll. Return the first record id with the key in outRid if outRids is NULL, otherwise append
+   * all of them to outRids.
+   * @return Number of entries returned
+   */
+	size_t lookupEntries(const void* key, RecordId* outRid, std::vector<RecordId>* outRids);
+
+  /**
+   * Hash of a key of the index for the Bloom filter, pointer to integer/double/int64 or '\0' terminated char string.
+   */
+	std::uint64_t bloomKeyHash(const void* key) const;
+
+  /**
+   * Check a key against the Bloom filter. False if the index certainly does not hold the key, always true without
+   * a filter.
+   */
+	bool bloomMayContain(const void* key);
+
+  /**
+   * Set the bits of a key in the Bloom filter.
+   */
+	void bloomSetKey(const void* key);
+
+  /**
+   * Add the key of an inserted entry to the Bloom filter, building the filter again once it holds more entries than
+   * it was built for.
+   */
+	void bloomAdd(const void* key);
+
+  /**
+   * Build the Bloom filter again from the keys in the leaves, with room for twice as many entries, replacing the
+   * pages of the old one. Called once the inserts outgrow the filter; deletes leave their keys in it until then.
+   */
+	void rebuildBloomFilter();
+
+  /**
+   * Walk the leaves from left to right and add their keys to the Bloom filter.
+   * @param add False to only count the entries
+   * @return Number of entries of the leaves
+   */
+	std::int64_t addLeafKeysToBloomFilter(bool add);
+
+  /**
+   * addLeafKeysToBloomFilter for an index whose key is of type T.
+   */
+	template <class T>
+	std::int64_t addTypedLeafKeysToBloomFilter(bool add);
+
+  /**
+   * addLeafKeysToBloomFilter for an index whose key is of type STRING.
+   */
+	std::int64_t addStringLeafKeysToBloomFilter(bool add);
+
+  /**
+   * True if a scan with the bounds lowVal GTE and highVal LTE looks up a single key, which is not the case for a
+   * prefix of a composite key.
+   */
+	bool singleKeyBounds(const void* lowVal, const void* highVal) const;
+
+  /**
+   * lookupEntries for an index whose key is of type T.
+   */
+	template <class T>
+	size_t lookupTyped(T key, RecordId* outRid, std::vector<RecordId>* outRids);
+
+  /**
+   * Look up the entries with the key in a leaf node of either format, from the first key greater than or equal to
+   * it, like lookupEntries.
+   * @param more Return true if entries with the key may go on in the right sibling
+   * @return Number of entries returned
+   */
+	template <class T>
+	size_t lookupLeaf(const Page* leaf_page, T key, RecordId* outRid, std::vector<RecordId>* outRids, bool& more);
 
-/**
- * @brief Number of key slots in B+Tree non-leaf for INTEGER key.
- */
-//                                                     level     extra pageNo               size                key       pageNo
-const  int INTARRAYNONLEAFSIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) - sizeof(int)) / ( sizeof( int ) + sizeof( PageId ) );
+  /**
+   * lookupTyped for a concurrent index, which reads every leaf node with lookupLeafConcurrent.
+   */
+	template <class T>
+	size_t lookupConcurrent(T key, RecordId* outRid, std::vector<RecordId>* outRids);
 
-/**
- * @brief Middle position in B+Tree leaf for INTEGER key.
- */
-//
-const int MIDDLELEAF = INTARRAYLEAFSIZE/2;
+  /**
+   * lookupLeaf for the leaf node in the given page of a concurrent index. An ENTRY_LIST node is read without locking
+   * it. Nodes of the other formats, whose layouts a torn read could lead out of the page, are locked while they are
+   * read. The node is read again if it changed meanwhile, and the lookup moves right from it while the key is above
+   * its high key.
+   * @param page_num The page number of the node, changed to that of the node the entries are looked up in
+   * @param sibling_num Return the page number of the right sibling
+   * @return Number of entries returned
+   */
+	template <class T>
+	size_t lookupLeafConcurrent(PageId& page_num, T key, RecordId* outRid, std::vector<RecordId>* outRids, bool& more,
+	                            PageId& sibling_num);
 
-/**
- * @brief Middle position in B+Tree non-leaf for INTEGER key.
- */
-//
-const int MIDDLENONLEAF = INTARRAYNONLEAFSIZE/2;
+  /**
+   * deleteEntry for an index whose key is of type T.
+   */
+	template <class T>
+	void deleteEntryTyped(T key, const RecordId rid);
 
-/**
- * @brief Structure to store a key-rid pair. It is used to pass the pair to functions that
- * add to or make changes to the leaf node pages of the tree. Is templated for the key member.
- */
-template <class T>
-class RIDKeyPair{
-public:
-	RecordId rid;
-	T key;
-	void set( RecordId r, T k)
-	{
-		rid = r;
-		key = k;
-	}
-};
+  /**
+   * Remove the entry <key,rid> from a pinned leaf node of either format, which the key descends to or which is on the
+   * right of such a node.
+   * @return 1 if the entry was removed, 0 if it may be in the right sibling, -1 if the index does not hold it
+   */
+	template <class T>
+	int removeLeafEntry(Page* leaf_page, T key, const RecordId rid);
 
-/**
- * @brief Structure to store a key page pair which is used to pass the key and page to functions that make
- * any modifications to the non leaf pages of the tree.
-*/
-template <class T>
-class PageKeyPair{
-public:
-	PageId pageNo;
-	T key;
-	void set( int p, T k)
-	{
-		pageNo = p;
-		key = k;
-	}
-};
+  /**
+   * Insert a key&rid pair into a pinned POSTING_LIST leaf node, which splits if the postings do not fit anymore,
+   * like modifyLeafNode.
+   */
+	template <class T>
+	void insertPostingEntry(PageId page_num, Page* leaf_page, T key, RecordId rid, PageId& right_node_num, T& push_up_key,
+	                        double left_fill);
 
-/**
- * @brief Overloaded operator to compare the key values of two rid-key pairs
- * and if they are the same compares to see if the first pair has
- * a smaller rid.pageNo value.
-*/
-template <class T>
-bool operator<( const RIDKeyPair<T>& r1, const RIDKeyPair<T>& r2 )
-{
-	if( r1.key != r2.key )
-		return r1.key < r2.key;
-	else
-		return r1.rid.page_number < r2.rid.page_number;
-}
+  /**
+   * Write the postings of a pinned leaf node back to it, in the format leafFormat chooses for them, moving the
+   * record ids of keys with too many of them to overflow pages first. If they do not fit, the leaf splits into two
+   * nodes, the left one taking about left_fill of the bytes, and the last key of the left node is pushed up. The leaf
+   * page is unpinned.
+   * @param right_node_num Return the PageId of the right leaf node if split, or an invalid PageId if not split
+   * @param push_up_key Return the key for pushing up if split, unchanged if not split
+   */
+	template <class T>
+	void writeLeafPostings(PageId page_num, Page* leaf_page, std::vector<Posting<T> >& postings, PageId& right_node_num,
+	                       T& push_up_key, double left_fill);
 
-/**
- * @brief The meta page, which holds metadata for Index file, is always first page of the btree index file and is cast
- * to the following structure to store or retrieve information from it.
- * Contains the relation name for which the index is created, the byte offset
- * of the key value on which the index is made, the type of the key and the page no
- * of the root page. Root page starts as page 2 but since a split can occur
- * at the root the root page may get moved up and get a new page no.
-*/
-struct IndexMetaInfo{
   /**
-   * Name of base relation.
+   * rebalanceLeaf for two leaf nodes of which at least one is in the POSTING_LIST format. Both nodes and their parent
+   * are pinned, and unpinned before returning.
+   * @return True if the nodes merged
    */
-	char relationName[20];
+	template <class T>
+	bool rebalancePostingLeaves(PageId parent_num, NonLeafNode<T>* parent_node, int left_pos, PageId left_num,
+	                            Page* left_page, PageId right_num, Page* right_page);
 
   /**
-   * Offset of attribute, over which index is built, inside the record stored in pages.
+   * rebalanceLeaf for two leaf nodes in the COVERING_LIST format. Both nodes and their parent are pinned, and unpinned
+   * before returning.
+   * @return True if the nodes merged
    */
-	int attrByteOffset;
+	template <class T>
+	bool rebalanceCoveringLeaves(PageId parent_num, NonLeafNode<T>* parent_node, int left_pos, PageId left_num,
+	                             Page* left_page, PageId right_num, Page* right_page);
 
   /**
-   * Type of the attribute over which index is built.
+   * rebalanceLeaf for two leaf nodes in the PACKED_LIST format. Both nodes and their parent are pinned, and unpinned
+   * before returning.
+   * @return True if the nodes merged
    */
-	Datatype attrType;
+	template <class T>
+	bool rebalancePackedLeaves(PageId parent_num, NonLeafNode<T>* parent_node, int left_pos, PageId left_num,
+	                           Page* left_page, PageId right_num, Page* right_page);
 
   /**
-   * Page number of root page of the B+ Tree inside the file index file.
+   * Move the record ids of every posting whose encoded record ids take more than PostingLeafNode::INLINEBYTES to
+   * overflow pages.
    */
-	PageId rootPageNo;
-};
+	template <class T>
+	void spillPostings(std::vector<Posting<T> >& postings);
 
-/*
-Each node is a page, so once we read the page in we just cast the pointer to the page to this struct and use it to access the parts
-These structures basically are the format in which the information is stored in the pages for the index file depending on what kind of
-node they are. The level memeber of each non leaf structure seen below is set to 1 if the nodes
-at this level are just above the leaf nodes. Otherwise set to 0.
-*/
+  /**
+   * Append sorted record ids, none less than those already there, to the overflow pages of a key, in new pages
+   * chained after the last one.
+   * @param first_page_num First overflow page, an invalid page number to start the pages, set then
+   * @param last_page_num Last overflow page, updated as pages are added
+   */
+	void appendOverflowRids(PageId& first_page_num, PageId& last_page_num, const RecordId* rids, int count);
 
-/**
- * @brief Structure for all non-leaf nodes when the key is of INTEGER type.
-*/
-struct NonLeafNodeInt{
+  /**
+   * Append the record ids in the overflow pages starting at the given page to rids.
+   */
+	void readOverflowRids(PageId page_num, std::vector<RecordId>& rids);
 
   /**
-   * Number of keys in the node
+   * Insert a record id into the overflow pages starting at the given page, in order. A full page splits in two.
    */
-    int keySize;
+	void insertOverflowRid(PageId page_num, const RecordId rid);
 
   /**
-   * Level of the node in the tree.
+   * Remove a record id from the overflow pages of a key. A page left empty is taken out of the pages and freed.
+   * @param first_page_num First overflow page, updated if it is freed, invalid once the last record id is removed
+   * @return False if the record id is not in the pages
    */
-	int level;
+	bool removeOverflowRid(PageId& first_page_num, const RecordId rid);
 
   /**
-   * Stores keys.
+   * Free the overflow pages starting at the given page.
    */
-	int keyArray[ INTARRAYNONLEAFSIZE ];
+	void disposeOverflowRids(PageId page_num);
 
   /**
-   * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
+   * Read the record ids of a decoded posting which keeps them in overflow pages into the posting, and free the
+   * overflow pages, so the posting can be combined with another one of the same key and written anew.
    */
-	PageId pageNoArray[ INTARRAYNONLEAFSIZE + 1 ];
-};
+	template <class T>
+	void readPostingOverflow(Posting<T>& posting);
 
+  /**
+   * Move a path recorded by a descent to the next leaf node on the right, following the next child of the lowest
+   * recorded node which has one, then the leftmost children. NonLeaf is the non-leaf node type of the index.
+   * If backward, move to the next leaf node on the left instead, through the previous child and the rightmost ones.
+   * @return False if the path already ends at the rightmost (leftmost if backward) leaf node
+   */
+	template <class NonLeaf>
+	bool moveToNextLeaf(NodePath& path, PageId& page_num, bool backward = false);
 
-/**
- * @brief Structure for all leaf nodes when the key is of INTEGER type.
-*/
-struct LeafNodeInt{
+  /**
+   * Set the left sibling of a leaf node, of type Leaf, to the given page.
+   */
+	template <class Leaf>
+	void setLeftSibling(PageId page_num, PageId left_num);
 
   /**
-   * Number of keys in the node
+   * Link the right node of a leaf split in between the left node and its old right sibling, the right node taking
+   * over the high key of the left node. Leaf is the leaf node type of both nodes, T the key type.
    */
-    int keySize;
+	template <class T, class Leaf>
+	void linkSplitLeaf(PageId left_num, Leaf* left_node, PageId right_num, Leaf* right_node);
 
   /**
-   * Stores keys.
+   * Let an underflowing leaf node, at the end of the path, borrow entries from a sibling with the same parent, or
+   * merge with it if both fit in one node.
+   * @return True if the nodes merged, so the parent lost a key
    */
-	int keyArray[ INTARRAYLEAFSIZE ];
+	template <class T>
+	bool rebalanceLeaf(const NodePath& path);
 
   /**
-   * Stores RecordIds.
+   * Rebalance the non-leaf node at the given depth of the path like rebalanceLeaf, if it underflows. Keys are moved
+   * through the parent. The root is only replaced by its only child once it has no key left.
+   * @return True if the node merged with a sibling, so the parent lost a key
    */
-	RecordId ridArray[ INTARRAYLEAFSIZE ];
+	template <class T>
+	bool rebalanceNonLeaf(const NodePath& path, int depth);
 
   /**
-   * Page number of the leaf on the right side.
-	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   * Make the only child of the root the new root, and free the old root page. The tree gets one level lower.
    */
-	PageId rightSibPageNo;
-};
+	void collapseRoot(PageId child_num);
 
+  /**
+   * Copy the non-leaf nodes of the top residentLevelCount levels into resident, as many levels as fit in
+   * MAXRESIDENTNODES nodes and lie above the leaves.
+   */
+	template <class T>
+	void buildResidentLevels();
 
-/**
- * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
- * relation. This index supports only one scan at a time.
-*/
-class BTreeIndex {
+  /**
+   * Search the resident levels for the given key like descendToLeaf, building them first if they are not, recording
+   * the nodes passed through in path.
+   * @param page_num Return the page number of the child followed out of the bottom resident level
+   * @return Number of levels searched, 0 if none is resident
+   */
+	template <class T>
+	int descendResidentLevels(T key, NodePath* path, PageId& page_num, bool upper);
 
- private:
+  /**
+   * Bring the copy of a non-leaf node which changed up to date, if it is resident: a node of the bottom resident
+   * level is copied again, and a split of it or a change of a node above it clears the copies.
+   * @param split True if the node split, giving keys to a new node on its right
+   */
+	template <class T>
+	void updateResidentNode(PageId page_num, const NonLeafNode<T>* node, bool split);
 
   /**
-   * File object for the index file.
+   * updateResidentNode for a node which is not pinned, read through the buffer pool only if it is resident.
    */
-	File		*file;
+	template <class T>
+	void refreshResidentNode(PageId page_num);
 
   /**
-   * Buffer Manager Instance.
+   * Sort the key&rid pairs of all records of the relation, keys being of type T, within the memory budget of
+   * the options, and build the tree bottom-up from them.
    */
-	BufMgr	*bufMgr;
+	template <class T>
+	void bulkLoadRelation(const std::string& relationName, const std::string& runFileName, const IndexOptions& options);
 
   /**
-   * Page number of meta page.
+   * Add the key&rid pairs of all records of the relation, keys being of type T, to the sorter.
    */
-	PageId	headerPageNum;
+	template <class T>
+	void readRelationEntries(const std::string& relationName, ExternalSorter<T>& sorter);
 
   /**
-   * page number of root page of B+ tree inside index file.
+   * Build the tree bottom-up from the key&rid pairs of type T streamed in order by the finished sorter. The empty
+   * root leaf becomes the first leaf, leaves and non-leaf nodes are filled up to the fill factor from left to right,
+   * one level at a time.
    */
-	PageId	rootPageNum;
+	template <class T>
+	void bulkLoad(ExternalSorter<T>& sorted, double fill_factor);
 
   /**
-   * Datatype of attribute over which index is built.
+   * Keep adding the sorted entries to the postings of a leaf a bulk load writes in the POSTING_LIST format, until the
+   * postings take the given number of bytes. Record ids of a key moving to overflow pages are written out as they
+   * come, so a key with any number of entries is held in memory a chunk at a time.
+   * @param remaining Number of entries not yet in a leaf, the pending entry included, updated
+   * @param entry The entry read last, left pending if it did not fit
+   * @param pending True if entry is read but not yet in a leaf, updated
    */
-	Datatype	attributeType;
+	template <class T>
+	void fillLeafPostings(ExternalSorter<T>& sorted, std::vector<Posting<T> >& postings, int limit, size_t& remaining,
+	                      RIDKeyPair<T>& entry, bool& pending);
 
   /**
-   * Offset of attribute, over which index is built, inside records.
+   * Keep adding the sorted entries to the entries of a leaf a bulk load writes in the PACKED_LIST format, until they
+   * would take more than the given number of bytes or the leaf holds max_entries entries.
+   * @param remaining Number of entries not yet in a leaf, the pending entry included, updated
+   * @param entry The entry read last, left pending if it did not fit
+   * @param pending True if entry is read but not yet in a leaf, updated
    */
-	int 		attrByteOffset;
+	template <class T>
+	void fillPackedLeaf(ExternalSorter<T>& sorted, std::vector<T>& keys, std::vector<RecordId>& rids, int limit,
+	                    int max_entries, size_t& remaining, RIDKeyPair<T>& entry, bool& pending);
 
   /**
-   * Number of keys in leaf node, depending upon the type of key.
+   * bulkLoad for STRING keys, which fills the nodes up to the fill factor in bytes.
    */
-	int			leafOccupancy;
+	void bulkLoad(ExternalSorter<PaddedStringKey>& sorted, double fill_factor);
 
   /**
-   * Number of keys in non-leaf node, depending upon the type of key.
+   * startScan for an index whose key is of type T. The operators are already checked by startScan.
    */
-	int			nodeOccupancy;
+	template <class T>
+	void startScanTyped(IndexCursor& cursor, const void* lowVal, const void* highVal);
 
+  /**
+   * scanNext for an index whose key is of type T. The scan is already checked to be executing by scanNext.
+   */
+	template <class T>
+	void scanNextTyped(IndexCursor& cursor, RecordId& outRid, char* outIncluded);
 
-	// MEMBERS SPECIFIC TO SCANNING
+  /**
+   * scanNextBatch for an index whose key is of type T. The scan is already checked to be executing.
+   */
+	template <class T>
+	size_t scanNextBatchTyped(IndexCursor& cursor, RecordId* out, size_t max, char* outIncluded);
 
   /**
-   * Array of PageId to keep track of pinned pages, the size of the array is the same as the size of the
-   * buffer manager provided in the main.cpp
+   * scanNextBatchTyped for a descending scan, which copies the record ids of a leaf from the last one down and moves
+   * on to the left sibling.
    */
-	PageId page_nums[100];
+	template <class T>
+	size_t scanNextBatchDescending(IndexCursor& cursor, RecordId* out, size_t max, char* outIncluded);
 
   /**
-   * number of pinned pages, useful to keep track of pinned pages and unpin these pages at the end of scan
+   * Move the scan of a cursor on to the given leaf page, at its first entry, which a descending scan then moves to the
+   * last entry. The leaf the scan was on is unpinned
+   * and the given one pinned, or the scan is completed if the page number is invalid.
    */
-	int num_pinned_page;
+	void moveScanToPage(IndexCursor& cursor, PageId page_num);
 
   /**
-   * True if an index scan has been started.
+   * Read the entries of the leaf page the scan of a cursor is pinning into leafKeys and leafRids if it is a
+   * POSTING_LIST or PACKED_LIST leaf, and clear them otherwise.
    */
-	bool		scanExecuting;
+	void loadScanLeaf(IndexCursor& cursor);
 
   /**
-   * Index of next entry to be scanned in current leaf being scanned.
+   * loadScanLeaf for an index whose key is of type T.
    */
-	int			nextEntry;
+	template <class T>
+	void loadScanLeafTyped(IndexCursor& cursor);
 
   /**
-   * Page number of current page being scanned.
+   * Get the keys and record ids of the entries of the leaf page the scan of a cursor is on, from the page or from
+   * the entries read by loadScanLeaf.
+   * @return Number of entries
    */
-	PageId	currentPageNum;
+	template <class T>
+	int scanLeafEntries(IndexCursor& cursor, const T*& keys, const RecordId*& rids);
 
   /**
-   * Current Page being scanned.
+   * insertEntry for an index whose key is of type STRING.
    */
-	Page		*currentPageData;
+	void insertEntryString(const char* key, int keyLength, const RecordId rid);
 
   /**
-   * Low INTEGER value for scan.
+   * lookupEntries for an index whose key is of type STRING.
    */
-	int			lowValInt;
+	size_t lookupString(const char* key, int keyLength, RecordId* outRid, std::vector<RecordId>* outRids);
 
   /**
-   * Low DOUBLE value for scan.
+   * deleteEntry for an index whose key is of type STRING.
    */
-	double	lowValDouble;
+	void deleteEntryString(const char* key, int keyLength, const RecordId rid);
 
   /**
-   * Low STRING value for scan.
+   * rebalanceLeaf for STRING nodes, which hold entries of different sizes and are balanced in bytes.
    */
-	std::string	lowValString;
+	bool rebalanceStringLeaf(const NodePath& path);
 
   /**
-   * High INTEGER value for scan.
+   * rebalanceNonLeaf for STRING nodes.
    */
-	int			highValInt;
+	bool rebalanceStringNonLeaf(const NodePath& path, int depth);
 
   /**
-   * High DOUBLE value for scan.
+   * startScan for an index whose key is of type STRING. The operators are already checked by startScan.
    */
-	double	highValDouble;
+	void startScanString(IndexCursor& cursor, const void* lowVal, const void* highVal);
 
   /**
-   * High STRING value for scan.
+   * scanNext for an index whose key is of type STRING. The scan is already checked to be executing by scanNext.
    */
-	std::string highValString;
+	void scanNextString(IndexCursor& cursor, RecordId& outRid);
 
   /**
-   * Low Operator. Can only be GT(>) or GTE(>=).
+   * scanNextBatch for an index whose key is of type STRING. The scan is already checked to be executing.
    */
-	Operator	lowOp;
+	size_t scanNextBatchString(IndexCursor& cursor, RecordId* out, size_t max);
 
   /**
-   * High Operator. Can only be LT(<) or LTE(<=).
+   * scanNextBatchDescending for an index whose key is of type STRING.
    */
-	Operator	highOp;
+	size_t scanNextBatchDescendingString(IndexCursor& cursor, RecordId* out, size_t max);
 
 
  public:
@@ -344,38 +1546,123 @@ class BTreeIndex {
   /**
    * BTreeIndex Constructor.
 	 * Check to see if the corresponding index file exists. If so, open the file.
-	 * If not, create it and insert entries for every tuple in the base relation using FileScan class.
+	 * If not, create it and insert entries for every tuple in the base relation using FileScan class, either through
+	 * a bottom-up bulk load of the sorted entries or one at a time.
    *
    * @param relationName        Name of file.
    * @param outIndexName        Return the name of index file.
    * @param bufMgrIn						Buffer Manager Instance
    * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
-   * @param attrType						Datatype of attribute over which index is built
-   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+   * @param attrType						Datatype of attribute over which index is built. A STRING attribute is a '\0' terminated
+   *                                    char array, of which the first STRINGKEYMAXSIZE bytes are indexed
+   * @param options             How to build the index if the index file does not exist
+   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters,
+   *                                    or if attrType is not one of the Datatype values, or if the fill factor is out of range.
    */
 	BTreeIndex(const std::string & relationName, std::string & outIndexName,
-						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+						const IndexOptions& options = IndexOptions());
 
 
   /**
    * BTreeIndex Destructor.
-	 * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
+	 * End any initialized scan, of the index and of its cursors, flush index file, after unpinning any pinned pages, from the buffer manager
 	 * and delete file instance thereby closing the index file.
 	 * Destructor should not throw any exceptions. All exceptions should be caught in here itself.
 	 * */
 	~BTreeIndex();
 
 
+  /**
+   * Get the index file, so callers can read index pages through the buffer pool entries of the index.
+   * @return File object of the index file
+   */
+	File* getIndexFile() const { return file; }
+
+  /**
+   * Get the number of bytes the included columns take in an entry, 0 unless the index is a covering index.
+   */
+	int getIncludedBytes() const { return includedBytes; }
+
+  /**
+   * Get the lookups through the Bloom filter since the index was opened, whose falsePositiveRate() tells how well
+   * the filter works. All zero if the index has no filter.
+   */
+	const BloomFilterStats& getBloomFilterStats() const { return bloomStats; }
+
+  /**
+   * Get the number of pages of the Bloom filter, 0 if the index has none.
+   */
+	int getBloomFilterPages() const { return (int)bloomPageNums.size(); }
+
+  /**
+   * Get the number of top levels whose nodes are in memory, as of the last descent, and the number of those nodes.
+   */
+	int getResidentLevels() const { return resident.levels(); }
+	int getResidentNodes() const { return resident.nodeCount(); }
+
+
   /**
 	 * Insert a new entry using the pair <value,rid>.
 	 * Start from root to recursively find out the leaf to insert the entry in. The insertion may cause splitting of leaf node.
 	 * This splitting will require addition of new leaf page number entry into the parent non-leaf, which may in-turn get split.
 	 * This may continue all the way upto the root causing the root to get split. If root gets split, metapage needs to be changed accordingly.
 	 * Make sure to unpin pages as soon as you can.
-   * @param key			Key to insert, pointer to integer/double/char string
+   * @param key			Key to insert, pointer to integer/double/int64 (need not be aligned) or '\0' terminated char string
    * @param rid			Record ID of a record whose entry is getting inserted into the index.
+   * @param included	Bytes of the included columns of the record, one after the other in the order of
+   *              IndexOptions::includedColumns, getIncludedBytes() of them. Needed by a covering index only
+   * @throws  BadIndexInfoException If the index is a covering index and included is NULL
+	**/
+	void insertEntry(const void* key, const RecordId rid, const void* included = NULL);
+
+
+  /**
+	 * Insert a batch of entries, like insertEntry for each of them, in fewer descents. The entries are sorted by key,
+	 * and those which go into the same ENTRY_LIST leaf are merged into it at once, with one descent and one pin. A leaf
+	 * they overflow splits into as many leaves as they need in one pass, whose keys go into the parent at once if it
+	 * has room for them. Entries with the same key end up in the order insertEntry would have put them in.
+	 * Leaves of the other formats, STRING keys, covering indexes and concurrent indexes take the entries one at a
+	 * time, through insertEntry.
+   * @param entries	The entries to insert
+   * @param n			Number of entries
+   * @throws  BadIndexInfoException If the index is a covering index and an entry has no included bytes
 	**/
-	void insertEntry(const void* key, const RecordId rid);
+	void insertBatch(const KeyRid* entries, size_t n);
+
+
+  /**
+	 * Delete the entry <key,rid>, ending the executing scans of the index and of all its cursors first, since they
+	 * keep leaf pages pinned.
+	 * A node left less than half full borrows entries from a sibling, or merges with it if both fit in one node.
+	 * A merge takes a key out of the parent, which may underflow in turn, all the way up to the root. When the root
+	 * has a single child left, the child becomes the root. Pages of merged nodes go to the free list of the index
+	 * file, and are reused by later splits.
+   * @param key			Key to delete, pointer to integer/double/int64 (need not be aligned) or '\0' terminated char string
+   * @param rid			Record ID of the entry to delete, one key may have entries for many records
+   * @throws  NoSuchKeyFoundException If the index holds no entry with the key and the rid
+	**/
+	void deleteEntry(const void* key, const RecordId rid);
+
+
+  /**
+	 * Look up the first entry with the given key, in a single descent from the root. A miss is no error, so no
+	 * exception is thrown either way. Does not disturb an executing scan.
+   * @param key			Key to look up, pointer to integer/double/int64 (need not be aligned) or '\0' terminated char string
+   * @param outRid		Return the record id of the first entry with the key, unchanged if there is none
+   * @return True if the index holds an entry with the key
+	**/
+	bool lookup(const void* key, RecordId& outRid);
+
+
+  /**
+	 * Look up all entries with the given key, in a single descent from the root followed by the leaves on the right
+	 * as long as they hold the key. Like lookup, throws no exception on a miss.
+   * @param key			Key to look up, pointer to integer/double/int64 (need not be aligned) or '\0' terminated char string
+   * @param outRids		The record ids of the entries with the key are appended to this, in index order
+   * @return Number of entries with the key
+	**/
+	size_t lookupAll(const void* key, std::vector<RecordId>& outRids);
 
 
   /**
@@ -384,26 +1671,46 @@ class BTreeIndex {
 	 * greater than "a" and less than or equal to "d".
 	 * If another scan is already executing, that needs to be ended here.
 	 * Set up all the variables for scan. Start from root to find out the leaf page that contains the first RecordID
-	 * that satisfies the scan parameters. Keep that page pinned in the buffer pool.
-   * @param lowVal	Low value of range, pointer to integer / double / char string
-   * @param lowOp		Low operator (GT/GTE)
-   * @param highVal	High value of range, pointer to integer / double / char string
-   * @param highOp	High operator (LT/LTE)
+	 * that satisfies the scan parameters. Keep that page pinned in the buffer pool. A scan without a low bound
+	 * starts at the leftmost leaf straight away, so (NULL,GTE,NULL,LTE) walks the whole index in key order.
+   * @param lowVal	Low value of range, pointer to integer / double / char string, or NULL for no low bound
+   * @param lowOp		Low operator (GT/GTE), not used without a low value
+   * @param highVal	High value of range, pointer to integer / double / char string, or NULL for no high bound
+   * @param highOp	High operator (LT/LTE), not used without a high value
+   * @param order	ASCENDING to return the entries from the low value up, DESCENDING from the high value down, along
+   *              the left sibling links of the leaves
    * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
    * @throws  BadScanrangeException If lowVal > highval
 	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
 	**/
-	void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+	void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+	               const ScanOrder order = ASCENDING);
 
 
   /**
 	 * Fetch the record id of the next index entry that matches the scan.
-	 * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page, if any exists, to start scanning that page. Make sure to unpin any pages that are no longer required.
+	 * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page (the left sibling for a descending scan), if any exists, to start scanning that page. Make sure to unpin any pages that are no longer required.
    * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+   * @param outIncluded	If not NULL, the getIncludedBytes() bytes of the included columns of the entry are returned in
+   *              this, as passed to insertEntry, so the record need not be read
 	 * @throws ScanNotInitializedException If no scan has been initialized.
 	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
 	**/
-	void scanNext(RecordId& outRid);  // returned record id
+	void scanNext(RecordId& outRid, void* outIncluded = NULL);  // returned record id
+
+
+  /**
+	 * Fetch the record ids of the next index entries that match the scan, up to max of them. The entries of a leaf
+	 * which match are found with one binary search for the high bound, and their record ids are copied as a run.
+	 * Can be mixed with scanNext, both go on where the other stopped.
+   * @param out		Array of at least max record ids, filled with the record ids found
+   * @param max		Maximum number of record ids to return
+   * @param outIncluded	If not NULL, an array of max times getIncludedBytes() bytes, filled with the included bytes of
+   *              the entries found like by scanNext
+   * @return Number of record ids returned, less than max only once the scan is completed, 0 from then on
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	size_t scanNextBatch(RecordId* out, size_t max, void* outIncluded = NULL);
 
 
   /**
@@ -412,91 +1719,204 @@ class BTreeIndex {
 	**/
 	void endScan();
 
+  /**
+	 * Read ahead the given number of leaves during the scans of the index, like IndexCursor::setReadAhead.
+	 * Takes effect at the next startScan.
+	**/
+	void setReadAhead(int leaves) { scanCursor.setReadAhead(leaves); }
+
   /**
     * Initialize the non-leaf node, with size(number of keys) to be 0, level to be 0
     * @param page Pointer of the page needs initialization
     *
    **/
+	template <class T>
 	void initializeNonLeaf(Page* page);
 
 
   /**
-    * Initialize the leaf node, with size(number of keys) to be 0, rightSibPageNo to be Page::INVALID_NUMBER
+    * Initialize the leaf node, with size(number of keys) to be 0, rightSibPageNo and leftSibPageNo to be Page::INVALID_NUMBER
     * @param page Pointer of the page needs initialization
     *
    **/
+	template <class T>
 	void initializeLeaf(Page* page);
 
 
   /**
-    * Modify the specific leaf node, given the PageId and number of keys of the leaf node, the key&rid pair
-    * to insert at a given position.If the leaf node is not full before insertion, just insert the key&rid pair
-    * at the given position. If the leaf node is full before insertion, the leaf node splits to be a left leaf
-    * node and a right leaf node, through pushing up a copy of the middle key after insertion.
+    * Modify the specific leaf node, given the PageId, the pinned page and number of keys of the leaf node, the key&rid pair
+    * to insert at a given position. The leaf page is unpinned before returning. If the leaf node is not full before insertion, just insert the key&rid pair
+    * at the given position. If the leaf node is full before insertion, and its entries would take at most half the
+    * bytes as posting lists, it turns into a POSTING_LIST leaf instead of splitting. Otherwise the leaf node splits to be a left leaf
+    * node and a right leaf node, through pushing up a copy of the last key of the left node after insertion. A POSTING_LIST leaf
+    * node takes the pair through insertPostingEntry, position and total_key are not used then.
     * @param page_num The PageId of the leaf node needs insertion
+    * @param leaf_page The leaf page, already pinned by the caller
     * @param key The key for insertion
     * @param rid The RecordId for insertion
     * @param position The position for insertion
     * @param total_key The total number of keys in the leaf node
     * @param left_node_num Return the PageId of the left leaf node if split occurs, or the PageId of the current leaf node if not split
     * @param right_node_num Return the PageId of the right leaf node if split, or an invalid PageId if not split
-    * @param push_up_key Return the key for pushing up if the split occurs when inserting, or -1 if not split
+    * @param push_up_key Return the key for pushing up if the split occurs when inserting, unchanged if not split
+    * @param left_fill Fraction of the entries the left leaf node keeps if split, see splitFillAt
     *
    **/
-    void modifyLeafNode(PageId page_num, int key, RecordId rid, int position, int total_key, PageId& left_node_num, PageId& right_node_num, int& push_up_key);
+	template <class T>
+    void modifyLeafNode(PageId page_num, Page* leaf_page, T key, RecordId rid, int position, int total_key, PageId& left_node_num, PageId& right_node_num, T& push_up_key,
+                        double left_fill);
 
 
   /**
     * Modify the specific non-leaf node, given the pushing-up key. If the non-leaf node is not full before insertion,
     * then just insert the key into at the give position. If the leaf node is full before insertion, the non-leaf node
-    * splits to be a left non-leaf node and a right leaf node, through pushing up the middle key after insertion.
+    * splits to be a left non-leaf node and a right leaf node, through pushing up the key after the keys of the left node.
     * @param page_num The PageId of the non-leaf node which needs insertion
     * @param key The key for insertion
-    * @param left_child_num The PageId of the key's left child node, which could be either leaf node or non-leaf node
     * @param right_child_num The PageId of the key's right child node, which could be either leaf node or non-leaf node
     * @param position The position for insertion
     * @param total_key The number of keys of the non-leaf node before insertion
     * @param left_node_num Return the PageId of the left non-leaf node when a split occurs, or the non-leaf node itself when no split
     * @param right_node_num Return the PageId of the right non-leaf node when a split occurs, otherwise an invalid page number
-    * @param push_up_key Return the pushing-up key if the split occurs, otherwise -1
+    * @param push_up_key Return the pushing-up key if the split occurs, otherwise unchanged
+    * @param left_fill Fraction of the keys the left non-leaf node keeps if split, see splitFillAt
+   **/
+	template <class T>
+    void modifyNonLeafNode(PageId page_num, T key, PageId right_child_num, int position, int total_key,
+                           PageId& left_node_num, PageId& right_node_num, T& push_up_key, double left_fill);
+
+  /**
+    * Put a new root on top of the root, which split into the two given nodes, so the tree grows by one level. The
+    * header page of a concurrent index is locked by the caller.
+    * @param key The pushing-up key of the split
+   **/
+	template <class T>
+    void addRoot(T key, PageId left_child_num, PageId right_child_num);
+
+   /**
+    * Fraction of its entries a node keeps as the left node if it splits, when a key goes into it at the given position
+    * out of total_key. The node is at the given depth of a descent recorded in path, path.depth for the leaf. It
+    * is rightmostSplitFill if the key goes after all keys of the rightmost node of its level, otherwise splitFill.
+   **/
+    double splitFillAt(const NodePath& path, int depth, int position, int total_key) const;
+
+
+   /**
+    * Write the root page number and tree height kept in memory back to the meta page. Called whenever the root changes.
+    * The pages and entry count of the Bloom filter are written along.
+   **/
+    void writeMetaInfo();
+
+
+   /**
+    * Descend from the root to the leaf node which should hold the given key, and keep that leaf node pinned.
+    * Every non-leaf node passed through is recorded in path, so a split can be propagated upwards without
+    * another descent from the root
+    * @param key The key to search for
+    * @param path Return the non-leaf nodes from the root to the parent of the leaf node, may be NULL
+    * @param page_num Return the PageId of the leaf node
+    * @param leaf_page Return the pinned leaf page, which the caller needs to unpin
+    * @param upper Follow the first key greater than the given key instead, to the leaf node which holds the last
+    *              entry less than or equal to the key, unless that is the last entry of the leaf node on its left
    **/
-    void modifyNonLeafNode(PageId page_num, int key, PageId left_child_num, PageId right_child_num, int position, int total_key,
-                           PageId& left_node_num, PageId& right_node_num, int& push_up_key);
+	template <class T>
+    void descendToLeaf(T key, NodePath* path, PageId& page_num, Page*& leaf_page, bool upper = false);
 
 
    /**
     * Given the key for, find the leaf node and the position for insertion, as well as the number of keys in the leaf
-    * node before insertion
+    * node before insertion. Instantiated for int, double and int64_t keys.
     * @param key The key for insertion
     * @param page_num Return the PageId of the leaf node for insertion
     * @param position Return the position in the leaf node to insert
     * @param total_key Return the number of keys in the leaf node before insertion
    **/
-    void findLeafNode(int key, PageId& page_num, int& position, int& total_key);
+	template <class T>
+    void findLeafNode(T key, PageId& page_num, int& position, int& total_key);
 
 
    /**
-    * Given the PageId of a child node, which could be either leaf node or non-leaf node, get the its
-    * parent node and the position to insert a pushing-up key from the child node. If there is no parent node,
-    * means the child node is the root node, then the PageId of the parent node will be an invalid page number
-    * @param child_page_num The PageId of the child node
-    * @param key The pushing-up key from the leaf node
-    * @param parent_page_num Return the PageId of the parent node if applicable, otherwise return an invalid page number
-    * @param position Return the position in the parent node for insertion
-    * @param total_key Return the number of keys in the parent node before insertion
+    * Given the low bound of a range scan, get the first entry which satisfies it, and return
+    * the PageId of the page that the entry is currently in. If the low bound is past the last key of the
+    * leaf it descends to, the entry is looked up in the right sibling instead. The entry is checked against
+    * the high bound by the caller.
+    * @param low_value The low value for a range scan
+    * @param low_op The low operator, GT or GTE
+    * @param page_num Return the PageId of the node containing the first entry which satisfy this low bounding,
+    *                 or an invalid PageId if no entry satisfies it
+    * @param entry Return the position of the entry in the node
+    * @param path Return the non-leaf nodes from the root to the parent of the leaf node, may be NULL
    **/
-    void findParentNode(PageId child_page_num, int key, PageId& parent_page_num, int& position, int& total_key);
+	template <class T>
+    void findScanPage(T low_value, Operator low_op, PageId& page_num, int& entry, NodePath* path = NULL);
 
 
    /**
-    * Given the low value for a range scan, get the first entry which satisfy this low bounding, and return
-    * the PageId of the page that the entry is currently in
-    * @param low_value The low value for a range scan
-    * @param high_value The high value for a range scan
-    * @param page_num Return the PageId of the node containing the first entry which satisfy this low bounding
-    * @param entry Return the position of the entry in the node
+    * findScanPage for a descending scan, which locates the last entry which satisfies the high bound instead.
+    * The leaf node of the entry is found through a descent to the last entry less than (LT) or less than or equal
+    * to (LTE) the high value, and the entry may be the last entry of the leaf node on its left.
+   **/
+	template <class T>
+    void findScanPageDescending(T high_value, Operator high_op, PageId& page_num, int& entry, NodePath* path = NULL);
+
+
+   /**
+    * descendToLeaf for STRING keys, which keeps the found leaf pinned and records the non-leaf nodes passed through.
+    * @param key The key to search for
+    * @param keyLength Length of the key
+    * @param path Return the non-leaf nodes from the root to the parent of the leaf node, may be NULL
+    * @param page_num Return the PageId of the leaf node
+    * @param leaf_page Return the pinned leaf page, which the caller needs to unpin
+    * @param upper Follow the first key greater than the given key instead, like descendToLeaf
+   **/
+    void descendToLeafString(const char* key, int keyLength, NodePath* path, PageId& page_num, Page*& leaf_page,
+                             bool upper = false);
+
+
+   /**
+    * Split a full STRING leaf node while inserting a key&rid pair at the given position. The keys are divided where
+    * the left node takes about left_fill of the bytes, and a copy of the last key of the left node is pushed up. The leaf
+    * page is already pinned by the caller, both leaf pages are unpinned before returning.
+    * @param page_num The PageId of the leaf node, which becomes the left node
+    * @param leaf_page The leaf page, already pinned by the caller
+    * @param position The position for insertion
+    * @param key The key for insertion
+    * @param keyLength Length of the key
+    * @param rid The RecordId for insertion
+    * @param right_node_num Return the PageId of the new right leaf node
+    * @param push_up_key Return the key for pushing up
+    * @param left_fill Fraction of the bytes the left node takes, see splitFillAt
+   **/
+    void splitStringLeafNode(PageId page_num, Page* leaf_page, int position, const char* key, int keyLength, RecordId rid,
+                             PageId& right_node_num, std::string& push_up_key, double left_fill);
+
+
+   /**
+    * Insert a pushed-up key and the PageId of the right child of the key at the given position of a STRING non-leaf node.
+    * If the node has no room for the key, the node splits and the key after about left_fill of the bytes is pushed up.
+    * @param page_num The PageId of the non-leaf node which needs insertion
+    * @param position The position for insertion
+    * @param key The key for insertion, replaced with the key for pushing up if the split occurs
+    * @param right_child_num The PageId of the key's right child node
+    * @param right_node_num Return the PageId of the right non-leaf node when a split occurs, otherwise an invalid page number
+    * @param left_fill Fraction of the bytes the left node takes if split, see splitFillAt
+   **/
+    void modifyStringNonLeafNode(PageId page_num, int position, std::string& key, PageId right_child_num, PageId& right_node_num,
+                                 double left_fill);
+
+
+   /**
+    * findScanPage for STRING keys.
+   **/
+    void findScanPageString(const std::string& low_value, Operator low_op, PageId& page_num, int& entry,
+                            NodePath* path = NULL);
+
+
+   /**
+    * findScanPageDescending for STRING keys.
    **/
-    void findScanPage(int low_value, int high_value, PageId& page_num, int& entry);
+    void findScanPageDescendingString(const std::string& high_value, Operator high_op, PageId& page_num, int& entry,
+                                      NodePath* path = NULL);
 
 };
 
@@ -36,6 +36,9 @@ BufMgr::BufMgr(std::uint32_t bufs)
   hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
 
   clockHand = bufs - 1;
+  prefetchHints = 0;
+
+  pthread_rwlock_init(&latch, NULL);
 }
 
 
@@ -53,13 +56,15 @@ BufMgr::~BufMgr() {
 	delete hashTable;
   delete [] bufDescTable;
   delete [] bufPool;
+
+  pthread_rwlock_destroy(&latch);
 }
 
 void BufMgr::allocBuf(FrameId & frame) 
 {
   // perform first part of clock algorithm to search for 
   // open buffer frame
-  // Assumes non-concurrent access to buffer manager
+  // Called with the latch held exclusive
   std::uint32_t numScanned = 0;
   bool found = 0;
 
@@ -91,7 +96,6 @@ void BufMgr::allocBuf(FrameId & frame)
     else
     {
       // has been referenced, clear the bit
-      bufStats.accesses++;
       bufDescTable[clockHand].refbit = false;
     }
   }
@@ -123,17 +127,39 @@ void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
   // check to see if it is already in the buffer pool
   // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
   FrameId frameNo = 0;
+  bufStats.accesses++;
+  {
+    // A page in the buffer pool is pinned with the latch shared, so readers of different pages do not wait on each other
+    LatchGuard guard(latch, false);
+    try
+    {
+      hashTable->lookup(file, pageNo, frameNo);
+
+      // set the referenced bit
+      bufDescTable[frameNo].refbit = true;
+      bufDescTable[frameNo].pinCnt++;
+      page = &bufPool[frameNo];
+      return;
+    }
+    catch(const HashNotFoundException &e) //not in the buffer pool, must allocate a new page
+    {
+    }
+  }
+
+  LatchGuard guard(latch, true);
 	try
 	{
+    // Another thread may have read the page in between the two latches
   	hashTable->lookup(file, pageNo, frameNo);
 
-    // set the referenced bit
     bufDescTable[frameNo].refbit = true;
     bufDescTable[frameNo].pinCnt++;
     page = &bufPool[frameNo];
   }
-  catch(const HashNotFoundException &e) //not in the buffer pool, must allocate a new page
+  catch(const HashNotFoundException &e)
   {
+    notePrefetchHit(file, pageNo);
+
     // alloc a new frame
     allocBuf(frameNo);
 
@@ -152,25 +178,102 @@ void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 }
 
 
+void BufMgr::prefetchPage(File* file, const PageId pageNo)
+{
+  LatchGuard guard(latch, true);
+  FrameId frameNo = 0;
+  try
+  {
+    hashTable->lookup(file, pageNo, frameNo);
+    return;
+  }
+  catch(const HashNotFoundException &e)
+  {
+  }
+
+  std::pair<const File*, PageId> hint((const File*)file, pageNo);
+  if (!prefetchedPages.insert(std::make_pair(hint, prefetchHints)).second)
+  {
+    return;
+  }
+  prefetchOrder.push_back(std::make_pair(hint, prefetchHints++));
+  bufStats.prefetches++;
+  file->prefetchPage(pageNo);
+
+  // Keep the tracking bounded when pages read ahead are never requested, dropping the oldest hints
+  while (prefetchedPages.size() > numBufs)
+  {
+    std::map<std::pair<const File*, PageId>, std::uint64_t>::iterator it = prefetchedPages.find(prefetchOrder.front().first);
+    if (it != prefetchedPages.end() && it->second == prefetchOrder.front().second)
+    {
+      prefetchedPages.erase(it);
+    }
+    prefetchOrder.pop_front();
+  }
+  // Hints requested since stay behind in prefetchOrder, which must not outgrow the pages still tracked
+  if (prefetchOrder.size() > 2 * numBufs)
+  {
+    compactPrefetchOrder();
+  }
+}
+
+void BufMgr::compactPrefetchOrder()
+{
+  std::deque<std::pair<std::pair<const File*, PageId>, std::uint64_t> > live;
+  for (size_t i = 0; i < prefetchOrder.size(); i++)
+  {
+    std::map<std::pair<const File*, PageId>, std::uint64_t>::iterator it = prefetchedPages.find(prefetchOrder[i].first);
+    if (it != prefetchedPages.end() && it->second == prefetchOrder[i].second)
+    {
+      live.push_back(prefetchOrder[i]);
+    }
+  }
+  prefetchOrder.swap(live);
+}
+
+void BufMgr::notePrefetchHit(const File* file, const PageId pageNo)
+{
+  if (!prefetchedPages.empty() && prefetchedPages.erase(std::make_pair(file, pageNo)) > 0)
+  {
+    bufStats.prefetchHits++;
+  }
+}
+
+void BufMgr::forgetPrefetches(const File* file)
+{
+  std::map<std::pair<const File*, PageId>, std::uint64_t>::iterator it =
+    prefetchedPages.lower_bound(std::make_pair(file, (PageId)0));
+  while (it != prefetchedPages.end() && it->first.first == file)
+  {
+    prefetchedPages.erase(it++);
+  }
+}
+
 void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty) 
 {
+  LatchGuard guard(latch, false);
   // lookup in hashtable
   FrameId frameNo = 0;
   hashTable->lookup(file, pageNo, frameNo);
 
   if (dirty == true) bufDescTable[frameNo].dirty = dirty;
 
-  // make sure the page is actually pinned
-  if (bufDescTable[frameNo].pinCnt == 0)
+  // make sure the page is actually pinned, which another thread unpinning it too may change meanwhile
+  int pins = bufDescTable[frameNo].pinCnt;
+  do
   {
-  	throw PageNotPinnedException(file->filename(), pageNo, frameNo);
-  }
-  else bufDescTable[frameNo].pinCnt--;
+    if (pins == 0)
+    {
+      throw PageNotPinnedException(file->filename(), pageNo, frameNo);
+    }
+  } while (!bufDescTable[frameNo].pinCnt.compare_exchange_weak(pins, pins - 1));
 }
 
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
 {
+  LatchGuard guard(latch, true);
   FrameId frameNo;
+  bufStats.accesses++;
 
   // alloc a new frame
   allocBuf(frameNo);
@@ -189,6 +292,10 @@ void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
 
 void BufMgr::flushFile(const File* file) 
 {
+  LatchGuard guard(latch, true);
+  // The file may be closed after the flush, and another one opened at the same address
+  forgetPrefetches(file);
+
   for (std::uint32_t i = 0; i < numBufs; i++)
 	{
   	BufDesc* tmpbuf = &(bufDescTable[i]);
@@ -214,15 +321,25 @@ void BufMgr::flushFile(const File* file)
 
 void BufMgr::disposePage(File* file, const PageId pageNo)
 {
+  LatchGuard guard(latch, true);
 	//Deallocate from file altogether
-  //See if it is in the buffer pool
+  //See if it is in the buffer pool, a page which is not needs no frame cleared
   FrameId frameNo = 0;
-  hashTable->lookup(file, pageNo, frameNo);
+	try
+	{
+		hashTable->lookup(file, pageNo, frameNo);
+		if (bufDescTable[frameNo].pinCnt > 0)
+			throw PagePinnedException(file->filename(), pageNo, frameNo);
 
-	// clear the page
-	bufDescTable[frameNo].Clear();
+		// clear the page
+		bufDescTable[frameNo].Clear();
 
-	hashTable->remove(file, pageNo);
+		hashTable->remove(file, pageNo);
+	}
+	catch(const HashNotFoundException &e)
+	{
+	}
+  prefetchedPages.erase(std::make_pair((const File*)file, pageNo));
 
   // deallocate it in the file	
   file->deletePage(pageNo);
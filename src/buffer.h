@@ -10,6 +10,11 @@
 #include "file.h"
 #include "bufHashTbl.h"
 #include <iostream>
+#include <map>
+#include <deque>
+#include <atomic>
+#include <utility>
+#include <pthread.h>
 
 namespace badgerdb {
 
@@ -42,14 +47,14 @@ class BufDesc {
   FrameId	frameNo;
 
 	/**
-   * Number of times this page has been pinned
+   * Number of times this page has been pinned, changed by threads sharing the latch of BufMgr
 	 */
-  int pinCnt;
+  std::atomic<int> pinCnt;
 
 	/**
    * True if page is dirty;  false otherwise
 	 */
-  bool dirty;
+  std::atomic<bool> dirty;
 
 	/**
    * True if page is valid
@@ -59,7 +64,7 @@ class BufDesc {
 	/**
    * Has this buffer frame been reference recently
 	 */
-  bool refbit;
+  std::atomic<bool> refbit;
 
 	/**
    * Initialize buffer frame for a new user
@@ -123,9 +128,9 @@ class BufDesc {
 struct BufStats
 {
 	/**
-   * Total number of accesses to buffer pool
+   * Total number of accesses to buffer pool, counted by threads sharing the latch of BufMgr
 	 */
-  int accesses;
+  std::atomic<int> accesses;
 
 	/**
    * Number of pages read from disk (including allocs)
@@ -137,12 +142,22 @@ struct BufStats
 	 */
   int diskwrites;
 
+	/**
+   * Number of pages read ahead by prefetchPage, which were not in the buffer pool
+	 */
+  int prefetches;
+
+	/**
+   * Number of pages read ahead which were then requested through readPage
+	 */
+  int prefetchHits;
+
 	/**
    * Clear all values 
 	 */
   void clear()
   {
-		accesses = diskreads = diskwrites = 0;
+		accesses = diskreads = diskwrites = prefetches = prefetchHits = 0;
   }
       
 	/**
@@ -186,6 +201,63 @@ class BufMgr
 	 */
   BufStats bufStats;
 
+	/**
+   * Pages read ahead and not requested since, at most numBufs of them, each with the number of its hint
+	 */
+  std::map<std::pair<const File*, PageId>, std::uint64_t> prefetchedPages;
+
+	/**
+   * Hints given to prefetchPage, oldest first, so the oldest is the one dropped from prefetchedPages. Hints no longer
+   * in prefetchedPages, their page requested or forgotten since, are skipped when they come up
+	 */
+  std::deque<std::pair<std::pair<const File*, PageId>, std::uint64_t> > prefetchOrder;
+
+	/**
+   * Number of hints given to prefetchPage so far
+	 */
+  std::uint64_t prefetchHints;
+
+	/**
+   * Held shared to pin and unpin a page already in the buffer pool, and exclusive to change the hash table or which
+   * page a frame holds. A pinned page stays in its frame, so its contents are read and written without it
+	 */
+  pthread_rwlock_t latch;
+
+	/**
+   * Holds the latch of a BufMgr until it goes out of scope
+	 */
+  class LatchGuard
+  {
+   public:
+    LatchGuard(pthread_rwlock_t& rwlock, bool exclusive) : latch(rwlock)
+    {
+      if (exclusive) pthread_rwlock_wrlock(&latch);
+      else pthread_rwlock_rdlock(&latch);
+    }
+    ~LatchGuard() { pthread_rwlock_unlock(&latch); }
+
+   private:
+    LatchGuard(const LatchGuard&);
+    LatchGuard& operator=(const LatchGuard&);
+
+    pthread_rwlock_t& latch;
+  };
+
+	/**
+   * Count a hit if the page was read ahead and not requested since
+	 */
+  void notePrefetchHit(const File* file, const PageId pageNo);
+
+	/**
+   * Forget the pages of the file read ahead and not requested since
+	 */
+  void forgetPrefetches(const File* file);
+
+	/**
+   * Drop the hints of prefetchOrder which are no longer in prefetchedPages
+	 */
+  void compactPrefetchOrder();
+
 	/**
    * Advance clock to next frame in the buffer pool
 	 */
@@ -229,6 +301,17 @@ class BufMgr
 	 */
   void readPage(File* file, const PageId PageNo, Page*& page);
 
+	/**
+	 * Start reading the given page of the file in the background, for a readPage expected soon. The page is not
+	 * given a frame until it is read, but its disk read is already under way, through File::prefetchPage.
+	 * Nothing is done if the page is in the buffer pool already. Whether the read ahead page is requested
+	 * afterwards is counted in BufStats.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read ahead
+	 */
+  void prefetchPage(File* file, const PageId PageNo);
+
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
 	 *
@@ -266,6 +349,7 @@ class BufMgr
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number
+   * @throws  PagePinnedException If the page is pinned in the buffer pool
 	 */
   void disposePage(File* file, const PageId PageNo);
 
@@ -0,0 +1,63 @@
+/**
+ * @file composite_key.cpp
+ * @brief Normalized byte encoding of composite keys, made of several attributes compared one after the other. An
+ * encoded key compares with memcmp like the attributes compare lexicographically, and holds no '\0', so an index
+ * stores composite keys as STRING keys.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstring>
+#include "composite_key.h"
+
+namespace badgerdb
+{
+
+namespace
+{
+
+// Append an unsigned value most significant bits first, 7 bits per byte below a set high bit
+void appendGroups(std::string& key, std::uint64_t value, int count)
+{
+    for(int i = count - 1; i >= 0; i--){
+        key += (char)(0x80 | ((value >> (7 * i)) & 0x7F));
+    }
+}
+
+}
+
+void appendCompositeInt(std::string& key, int value)
+{
+    // Flipping the sign bit orders negative values before positive ones when compared unsigned
+    appendGroups(key, (std::uint32_t)value ^ 0x80000000u, COMPOSITEINTSIZE);
+}
+
+void appendCompositeInt64(std::string& key, std::int64_t value)
+{
+    appendGroups(key, (std::uint64_t)value ^ 0x8000000000000000ull, COMPOSITEINT64SIZE);
+}
+
+void appendCompositeDouble(std::string& key, double value)
+{
+    // Positive values only need the sign bit set, negative values all bits flipped so greater magnitudes come first
+    if(value == 0){
+        value = 0;
+    }
+    std::uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits = (bits & 0x8000000000000000ull) ? ~bits : (bits | 0x8000000000000000ull);
+    appendGroups(key, bits, COMPOSITEDOUBLESIZE);
+}
+
+void appendCompositeString(std::string& key, const char* value)
+{
+    int room = STRINGKEYMAXSIZE - (int)key.size();
+    for(int i = 0; i < room && value[i] != '\0'; i++){
+        key += value[i];
+    }
+}
+
+}
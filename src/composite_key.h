@@ -0,0 +1,88 @@
+/**
+ * @file composite_key.h
+ * @brief Normalized byte encoding of composite keys, made of several attributes compared one after the other. An
+ * encoded key compares with memcmp like the attributes compare lexicographically, and holds no '\0', so an index
+ * stores composite keys as STRING keys.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "string_node.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of bytes of an encoded INTEGER attribute. Every byte carries 7 bits of the value below a set high
+ * bit, which keeps the bytes in the order of the value and never '\0'.
+ */
+const int COMPOSITEINTSIZE = 5;
+
+/**
+ * @brief Number of bytes of an encoded INT64 attribute.
+ */
+const int COMPOSITEINT64SIZE = 10;
+
+/**
+ * @brief Number of bytes of an encoded DOUBLE attribute.
+ */
+const int COMPOSITEDOUBLESIZE = 10;
+
+/**
+ * @brief Append the encoding of an INTEGER attribute to a composite key.
+ */
+void appendCompositeInt(std::string& key, int value);
+
+/**
+ * @brief Append the encoding of an INT64 attribute to a composite key.
+ */
+void appendCompositeInt64(std::string& key, std::int64_t value);
+
+/**
+ * @brief Append the encoding of a DOUBLE attribute to a composite key. -0.0 is encoded like 0.0.
+ */
+void appendCompositeDouble(std::string& key, double value);
+
+/**
+ * @brief Append a STRING attribute to a composite key, up to its terminating '\0' and at most until the key has
+ * STRINGKEYMAXSIZE bytes. The bytes are kept as they are, so a STRING attribute can only be the last one of a key.
+ */
+void appendCompositeString(std::string& key, const char* value);
+
+/**
+ * @brief Composite key built from its attributes in the order of the key columns of an index, see
+ * IndexOptions::keyColumns. data() is passed to the index like a '\0' terminated STRING key; such an index is
+ * created with the byte offset of its first key column and STRING, and its file must be opened with the key columns
+ * it was built with. A key with fewer attributes than the key columns is a prefix, which a scan takes as a bound on
+ * the leading attributes only: LTE and GT take in or leave out every key which starts with it. An empty STRING as
+ * last attribute counts as left out.
+ */
+class CompositeKey{
+ public:
+	CompositeKey& add(int value) { appendCompositeInt(bytes, value); return *this; }
+	CompositeKey& add(std::int64_t value) { appendCompositeInt64(bytes, value); return *this; }
+	CompositeKey& add(double value) { appendCompositeDouble(bytes, value); return *this; }
+	CompositeKey& add(const char* value) { appendCompositeString(bytes, value); return *this; }
+
+  /**
+   * Encoded key, '\0' terminated.
+   */
+	const char* data() const { return bytes.c_str(); }
+
+  /**
+   * Number of bytes of the encoded key.
+   */
+	int length() const { return (int)bytes.size(); }
+
+ private:
+	std::string bytes;
+};
+
+}
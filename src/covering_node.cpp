@@ -0,0 +1,88 @@
+/**
+ * @file covering_node.cpp
+ * @brief Covering format of B+ tree leaf nodes for fixed size keys, where the bytes of the included columns of the
+ * relation are stored beside the key and record id of every entry, so a scan returns them without reading the record.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstring>
+#include "covering_node.h"
+
+namespace badgerdb
+{
+
+namespace
+{
+
+// Move the entries [first, keySize) of the node count positions to the right, or to the left if count is negative
+template <class T>
+void shiftCoveringEntries(CoveringLeafNode<T>* node, int first, int count)
+{
+    int moved = node->keySize - first;
+    int bytes = node->includedBytes;
+    memmove(node->keys() + first + count, node->keys() + first, moved * sizeof(T));
+    memmove(node->rids() + first + count, node->rids() + first, moved * sizeof(RecordId));
+    memmove(node->included() + (first + count) * bytes, node->included() + first * bytes, moved * bytes);
+    node->keySize += count;
+}
+
+}
+
+template <class T>
+void initializeCoveringLeaf(CoveringLeafNode<T>* node, int includedBytes)
+{
+    node->keySize = 0;
+    node->format = COVERING_LIST;
+    node->rightSibPageNo = Page::INVALID_NUMBER;
+    node->leftSibPageNo = Page::INVALID_NUMBER;
+    node->highKey = T();
+    node->includedBytes = includedBytes;
+    node->capacity = CoveringLeafNode<T>::capacityFor(includedBytes);
+}
+
+template <class T>
+void insertCoveringEntry(CoveringLeafNode<T>* node, int position, T key, RecordId rid, const char* included)
+{
+    shiftCoveringEntries(node, position, 1);
+    node->keys()[position] = key;
+    node->rids()[position] = rid;
+    memcpy(node->included() + position * node->includedBytes, included, node->includedBytes);
+}
+
+template <class T>
+void insertCoveringEntries(CoveringLeafNode<T>* node, int position, const CoveringLeafNode<T>* from, int first, int last)
+{
+    int count = last - first;
+    int bytes = node->includedBytes;
+    shiftCoveringEntries(node, position, count);
+    memcpy(node->keys() + position, from->keys() + first, count * sizeof(T));
+    memcpy(node->rids() + position, from->rids() + first, count * sizeof(RecordId));
+    memcpy(node->included() + position * bytes, from->included() + first * bytes, count * bytes);
+}
+
+template <class T>
+void removeCoveringEntries(CoveringLeafNode<T>* node, int first, int last)
+{
+    shiftCoveringEntries(node, last, first - last);
+}
+
+template void initializeCoveringLeaf<int>(CoveringLeafNode<int>*, int);
+template void insertCoveringEntry<int>(CoveringLeafNode<int>*, int, int, RecordId, const char*);
+template void insertCoveringEntries<int>(CoveringLeafNode<int>*, int, const CoveringLeafNode<int>*, int, int);
+template void removeCoveringEntries<int>(CoveringLeafNode<int>*, int, int);
+
+template void initializeCoveringLeaf<double>(CoveringLeafNode<double>*, int);
+template void insertCoveringEntry<double>(CoveringLeafNode<double>*, int, double, RecordId, const char*);
+template void insertCoveringEntries<double>(CoveringLeafNode<double>*, int, const CoveringLeafNode<double>*, int, int);
+template void removeCoveringEntries<double>(CoveringLeafNode<double>*, int, int);
+
+template void initializeCoveringLeaf<std::int64_t>(CoveringLeafNode<std::int64_t>*, int);
+template void insertCoveringEntry<std::int64_t>(CoveringLeafNode<std::int64_t>*, int, std::int64_t, RecordId, const char*);
+template void insertCoveringEntries<std::int64_t>(CoveringLeafNode<std::int64_t>*, int, const CoveringLeafNode<std::int64_t>*, int, int);
+template void removeCoveringEntries<std::int64_t>(CoveringLeafNode<std::int64_t>*, int, int);
+
+}
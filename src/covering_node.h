@@ -0,0 +1,116 @@
+/**
+ * @file covering_node.h
+ * @brief Covering format of B+ tree leaf nodes for fixed size keys, where the bytes of the included columns of the
+ * relation are stored beside the key and record id of every entry, so a scan returns them without reading the record.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "types.h"
+#include "page.h"
+#include "posting_node.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Structure for leaf nodes in the COVERING_LIST format, templated on the type of the key. The header has the
+ * layout of the header of LeafNode, so the siblings and the format of any leaf can be read through either structure.
+ * The data area holds the keys, then the record ids, then the included bytes of the entries, each array sized for
+ * the capacity of the node, which depends on the number of included bytes of an entry.
+*/
+template <class T>
+struct CoveringLeafNode{
+  /**
+   * Number of entries in the node.
+   */
+	int keySize;
+
+  /**
+   * Always COVERING_LIST.
+   */
+	LeafFormat format;
+
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Greatest key the leaf may hold, if it has a right sibling.
+   */
+	T highKey;
+
+  /**
+   * Number of bytes of the included columns of an entry.
+   */
+	int includedBytes;
+
+  /**
+   * Number of entries which fit in the node.
+   */
+	int capacity;
+
+  /**
+   * Size of the data area.
+   */
+	static const int DATASIZE = Page::SIZE - 4 * sizeof(int) - 2 * sizeof(PageId) - sizeof(T);
+
+  /**
+   * Keys, record ids and included bytes.
+   */
+	char data[ DATASIZE ];
+
+  /**
+   * Number of entries which fit in a node whose entries have the given number of included bytes.
+   */
+	static int capacityFor(int includedBytes) { return DATASIZE / (sizeof(T) + sizeof(RecordId) + includedBytes); }
+
+	T* keys() { return reinterpret_cast<T*>(data); }
+	const T* keys() const { return reinterpret_cast<const T*>(data); }
+	RecordId* rids() { return reinterpret_cast<RecordId*>(data + capacity * sizeof(T)); }
+	const RecordId* rids() const { return reinterpret_cast<const RecordId*>(data + capacity * sizeof(T)); }
+	char* included() { return data + capacity * (sizeof(T) + sizeof(RecordId)); }
+	const char* included() const { return data + capacity * (sizeof(T) + sizeof(RecordId)); }
+};
+
+static_assert(sizeof(CoveringLeafNode<int>) <= Page::SIZE && sizeof(CoveringLeafNode<double>) <= Page::SIZE &&
+              sizeof(CoveringLeafNode<std::int64_t>) <= Page::SIZE, "Covering leaf nodes must fit in a page.");
+
+/**
+ * @brief Initialize an empty covering leaf node without siblings, for entries with the given number of included bytes.
+ */
+template <class T>
+void initializeCoveringLeaf(CoveringLeafNode<T>* node, int includedBytes);
+
+/**
+ * @brief Insert an entry at the given position of a node which has room for it, shifting the entries on its right.
+ */
+template <class T>
+void insertCoveringEntry(CoveringLeafNode<T>* node, int position, T key, RecordId rid, const char* included);
+
+/**
+ * @brief Insert the entries [first, last) of another node at the given position of a node which has room for them,
+ * shifting the entries on their right. Both nodes have the same number of included bytes.
+ */
+template <class T>
+void insertCoveringEntries(CoveringLeafNode<T>* node, int position, const CoveringLeafNode<T>* from, int first, int last);
+
+/**
+ * @brief Remove the entries [first, last) of the node, shifting the entries on their right.
+ */
+template <class T>
+void removeCoveringEntries(CoveringLeafNode<T>* node, int first, int last);
+
+}
@@ -0,0 +1,332 @@
+/**
+ * @file external_sort.cpp
+ * @brief External merge sort of key&rid pairs, which spills sorted runs to a temporary file through the buffer
+ * manager once its memory budget is used up, and merges them back with a loser tree.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <thread>
+#include "external_sort.h"
+
+namespace badgerdb
+{
+
+namespace
+{
+
+// Slices smaller than this are not worth a thread of their own
+const size_t MINSLICESIZE = 4096;
+
+}
+
+template <class T>
+ExternalSorter<T>::ExternalSorter(BufMgr* bufMgrIn, const std::string& runFileName, size_t memoryBytes, int threadCount)
+{
+    this->bufMgr = bufMgrIn;
+    this->runFileName = runFileName;
+    this->runFile = NULL;
+    this->threadCount = threadCount > 0 ? threadCount : std::max(1, (int)std::thread::hardware_concurrency());
+    this->entryCount = 0;
+    this->writtenRunCount = 0;
+    this->mergePassCount = 0;
+    this->allocatedPageCount = 0;
+
+    // The buffer takes the whole budget while entries are added. Once they are all spilled, the budget holds a
+    // page of every run being merged, and the page being written by an intermediate merge
+    bufferCapacity = std::max(memoryBytes / sizeof(RIDKeyPair<T>), (size_t)SortRunPage<T>::CAPACITY);
+    fanIn = std::max(memoryBytes / sizeof(SortRunPage<T>), (size_t)3) - 1;
+}
+
+template <class T>
+ExternalSorter<T>::~ExternalSorter()
+{
+    if(runFile == NULL){
+        return;
+    }
+    try{
+        bufMgr->flushFile(runFile);
+        delete runFile;
+        runFile = NULL;
+        File::remove(runFileName);
+    }
+    catch(std::exception &e){
+        std::cout << "Error: fail to remove the sort runs" << std::endl;
+    }
+}
+
+template <class T>
+void ExternalSorter<T>::add(const RIDKeyPair<T>& entry)
+{
+    if(buffer.empty()){
+        buffer.reserve(bufferCapacity);
+    }
+    buffer.push_back(entry);
+    entryCount++;
+    if(buffer.size() >= bufferCapacity){
+        spillBuffer();
+    }
+}
+
+template <class T>
+void ExternalSorter<T>::sortBuffer()
+{
+    // Cut the buffer into one slice per thread and sort the slices at the same time, the calling thread
+    // sorting the first one
+    size_t slices = std::max((size_t)1, std::min((size_t)threadCount, buffer.size() / MINSLICESIZE));
+    sliceBounds.clear();
+    for(size_t i = 0; i <= slices; i++){
+        sliceBounds.push_back(buffer.size() * i / slices);
+    }
+    std::vector<std::thread> threads;
+    for(size_t i = 1; i < slices; i++){
+        threads.push_back(std::thread([this, i](){
+            std::sort(buffer.begin() + sliceBounds[i], buffer.begin() + sliceBounds[i + 1]);
+        }));
+    }
+    std::sort(buffer.begin() + sliceBounds[0], buffer.begin() + sliceBounds[1]);
+    for(size_t i = 0; i < threads.size(); i++){
+        threads[i].join();
+    }
+}
+
+template <class T>
+void ExternalSorter<T>::spillBuffer()
+{
+    if(runFile == NULL){
+        // A file left behind by a build which did not finish is of no use
+        if(File::exists(runFileName)){
+            File::remove(runFileName);
+        }
+        runFile = new BlobFile(runFileName, true);
+    }
+
+    // Every slice becomes a run of its own, the merge takes care of the rest
+    sortBuffer();
+    for(size_t i = 0; i + 1 < sliceBounds.size(); i++){
+        runs.push_back(Run());
+        for(size_t first = sliceBounds[i]; first < sliceBounds[i + 1]; first += SortRunPage<T>::CAPACITY){
+            int count = (int)std::min((size_t)SortRunPage<T>::CAPACITY, sliceBounds[i + 1] - first);
+            writeRunPage(runs.back(), &buffer[first], count);
+        }
+        writtenRunCount++;
+    }
+    buffer.clear();
+}
+
+template <class T>
+void ExternalSorter<T>::writeRunPage(Run& run, const RIDKeyPair<T>* entries, int count)
+{
+    PageId page_num;
+    Page* page;
+    if(!freePages.empty()){
+        page_num = freePages.back();
+        freePages.pop_back();
+        bufMgr->readPage(runFile, page_num, page);
+    }
+    else{
+        bufMgr->allocPage(runFile, page_num, page);
+        allocatedPageCount++;
+    }
+    SortRunPage<T>* run_page = reinterpret_cast<SortRunPage<T>*>(page);
+    run_page->entryCount = count;
+    std::copy(entries, entries + count, run_page->entries);
+    bufMgr->unPinPage(runFile, page_num, true);
+    run.pages.push_back(page_num);
+}
+
+template <class T>
+void ExternalSorter<T>::finish()
+{
+    cursors.clear();
+    if(runs.empty()){
+        // Everything fit in memory, merge the sorted slices of the buffer
+        sortBuffer();
+        for(size_t i = 0; i + 1 < sliceBounds.size(); i++){
+            RunCursor cursor;
+            cursor.current = buffer.data() + sliceBounds[i];
+            cursor.end = buffer.data() + sliceBounds[i + 1];
+            cursor.run = NULL;
+            cursor.nextPage = 0;
+            cursors.push_back(cursor);
+        }
+        startMerge();
+        return;
+    }
+
+    // Spill the rest too, and give the memory of the buffer back to the merge
+    if(!buffer.empty()){
+        spillBuffer();
+    }
+    std::vector<RIDKeyPair<T> >().swap(buffer);
+
+    // Merge groups of fanIn runs into longer runs until a single merge is left
+    while(runs.size() > fanIn){
+        std::vector<Run> merged;
+        for(size_t first = 0; first < runs.size(); first += fanIn){
+            merged.push_back(Run());
+            mergeRuns(first, std::min(runs.size(), first + fanIn), merged.back());
+            writtenRunCount++;
+        }
+        runs.swap(merged);
+        mergePassCount++;
+    }
+
+    startRunMerge(0, runs.size());
+}
+
+template <class T>
+void ExternalSorter<T>::mergeRuns(size_t first, size_t last, Run& out)
+{
+    startRunMerge(first, last);
+
+    std::vector<RIDKeyPair<T> > page;
+    page.reserve(SortRunPage<T>::CAPACITY);
+    RIDKeyPair<T> entry;
+    while(next(entry)){
+        page.push_back(entry);
+        if((int)page.size() == SortRunPage<T>::CAPACITY){
+            writeRunPage(out, page.data(), (int)page.size());
+            page.clear();
+        }
+    }
+    if(!page.empty()){
+        writeRunPage(out, page.data(), (int)page.size());
+    }
+}
+
+template <class T>
+void ExternalSorter<T>::startRunMerge(size_t first, size_t last)
+{
+    cursors.clear();
+    for(size_t i = first; i < last; i++){
+        RunCursor cursor;
+        cursor.current = NULL;
+        cursor.end = NULL;
+        cursor.run = &runs[i];
+        cursor.nextPage = 0;
+        cursors.push_back(cursor);
+    }
+    startMerge();
+}
+
+template <class T>
+void ExternalSorter<T>::startMerge()
+{
+    // Read the first page of every run only now, when the cursors do not move in memory anymore
+    for(size_t i = 0; i < cursors.size(); i++){
+        if(cursors[i].run != NULL){
+            loadNextPage(cursors[i]);
+        }
+    }
+    tree.assign(std::max((size_t)1, cursors.size()), 0);
+    if(cursors.size() > 1){
+        tree[0] = buildTree(1);
+    }
+}
+
+template <class T>
+void ExternalSorter<T>::loadNextPage(RunCursor& cursor)
+{
+    if(cursor.nextPage == cursor.run->pages.size()){
+        cursor.current = cursor.end = NULL;
+        return;
+    }
+
+    // Copy the page, so the run does not keep a frame of the buffer pool pinned
+    Page* page;
+    PageId page_num = cursor.run->pages[cursor.nextPage++];
+    bufMgr->readPage(runFile, page_num, page);
+    const SortRunPage<T>* run_page = reinterpret_cast<const SortRunPage<T>*>(page);
+    cursor.page.assign(run_page->entries, run_page->entries + run_page->entryCount);
+    bufMgr->unPinPage(runFile, page_num, false);
+    // The run is never read again past this page, which is free for the runs merged from it
+    freePages.push_back(page_num);
+    cursor.current = cursor.page.data();
+    cursor.end = cursor.current + cursor.page.size();
+}
+
+template <class T>
+bool ExternalSorter<T>::cursorLess(int a, int b) const
+{
+    // An exhausted cursor loses against every other cursor, equal entries go to the cursor on the left
+    const RunCursor& x = cursors[a];
+    const RunCursor& y = cursors[b];
+    if(x.current == x.end){
+        return false;
+    }
+    if(y.current == y.end){
+        return true;
+    }
+    if(*x.current < *y.current){
+        return true;
+    }
+    if(*y.current < *x.current){
+        return false;
+    }
+    return a < b;
+}
+
+template <class T>
+int ExternalSorter<T>::buildTree(int node)
+{
+    // Play the matches below the node, keep the loser in the node and return the winner
+    int k = (int)cursors.size();
+    if(node >= k){
+        return node - k;
+    }
+    int left = buildTree(2 * node);
+    int right = buildTree(2 * node + 1);
+    if(cursorLess(left, right)){
+        tree[node] = right;
+        return left;
+    }
+    tree[node] = left;
+    return right;
+}
+
+template <class T>
+void ExternalSorter<T>::popWinner()
+{
+    int winner = tree[0];
+    RunCursor& cursor = cursors[winner];
+    cursor.current++;
+    if(cursor.current == cursor.end && cursor.run != NULL){
+        loadNextPage(cursor);
+    }
+
+    // Replay the matches from the leaf of the cursor up to the root, only against the losers on the way
+    int k = (int)cursors.size();
+    for(int node = (winner + k) / 2; node >= 1; node /= 2){
+        if(cursorLess(tree[node], winner)){
+            std::swap(tree[node], winner);
+        }
+    }
+    tree[0] = winner;
+}
+
+template <class T>
+bool ExternalSorter<T>::next(RIDKeyPair<T>& entry)
+{
+    if(cursors.empty()){
+        return false;
+    }
+    const RunCursor& cursor = cursors[tree[0]];
+    if(cursor.current == cursor.end){
+        return false;
+    }
+    entry = *cursor.current;
+    popWinner();
+    return true;
+}
+
+template class ExternalSorter<int>;
+template class ExternalSorter<double>;
+template class ExternalSorter<std::int64_t>;
+template class ExternalSorter<PaddedStringKey>;
+
+}
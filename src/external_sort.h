@@ -0,0 +1,188 @@
+/**
+ * @file external_sort.h
+ * @brief External merge sort of key&rid pairs, which spills sorted runs to a temporary file through the buffer
+ * manager once its memory budget is used up, and merges them back with a loser tree.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Page of a sorted run written by ExternalSorter, the number of entries followed by the entries.
+ */
+template <class T>
+struct SortRunPage{
+  /**
+   * Number of entries which fit in a page.
+   */
+	static const int CAPACITY = ( Page::SIZE - sizeof( std::int64_t ) ) / sizeof( RIDKeyPair<T> );
+
+  /**
+   * Number of entries in the page.
+   */
+	int entryCount;
+
+  /**
+   * Entries, sorted.
+   */
+	RIDKeyPair<T> entries[ CAPACITY ];
+};
+
+/**
+ * @brief Sort key&rid pairs of type T, which may be more than fit in memory, and hand them out in order.
+ *
+ * Entries are collected in a buffer of at most memoryBytes. A full buffer is cut into one slice per thread, the
+ * slices are sorted in parallel and each is written as a sorted run to consecutive pages of a temporary BlobFile,
+ * created on the first spill. When all entries are added, finish() merges the runs with a loser tree as long as
+ * there are more runs than the budget has room for a page of each, and next() then streams the final merge. The
+ * runs written by a merge reuse the pages of the runs it has read, so the file stays about the size of the input
+ * whatever the number of passes. If nothing was spilled, the sorted slices in memory are merged directly and the
+ * temporary file is never created.
+ *
+ * The buffer manager is only used from the thread which calls add(), finish() and next(). Instantiated for int,
+ * double, int64_t and PaddedStringKey.
+ */
+template <class T>
+class ExternalSorter {
+
+ public:
+
+  /**
+   * Constructor.
+   * @param bufMgrIn      Buffer Manager Instance, through which the runs are written and read
+   * @param runFileName   Name of the temporary file of the runs, removed by the destructor
+   * @param memoryBytes   Memory budget of the sort buffer and of the merge, at least a page of entries is used
+   * @param threadCount   Number of threads sorting the slices of the buffer, 0 to use all cores
+   */
+	ExternalSorter(BufMgr* bufMgrIn, const std::string& runFileName, size_t memoryBytes, int threadCount);
+
+  /**
+   * Destructor. Drop the pages of the runs from the buffer pool and remove the temporary file.
+   * Does not throw.
+   */
+	~ExternalSorter();
+
+  /**
+   * Add an entry. Spills the buffer as sorted runs if it is full.
+   */
+	void add(const RIDKeyPair<T>& entry);
+
+  /**
+   * Sort what is left in the buffer and merge the runs down to a single merge. Call once after the last add().
+   */
+	void finish();
+
+  /**
+   * Get the next entry in sorted order.
+   * @param entry   Return the next entry
+   * @return False if all entries were returned
+   */
+	bool next(RIDKeyPair<T>& entry);
+
+  /**
+   * Number of entries added.
+   */
+	size_t size() const { return entryCount; }
+
+  /**
+   * Number of sorted runs written to the temporary file, including the runs written by intermediate merges.
+   */
+	int runsWritten() const { return writtenRunCount; }
+
+  /**
+   * Number of intermediate merge passes run by finish().
+   */
+	int mergePasses() const { return mergePassCount; }
+
+  /**
+   * Number of pages allocated in the temporary file.
+   */
+	int runPages() const { return allocatedPageCount; }
+
+ private:
+
+  /**
+   * A sorted run in the temporary file.
+   */
+	struct Run{
+		std::vector<PageId> pages;
+	};
+
+  /**
+   * Input of a merge, either a sorted slice of the buffer or a run read back a page at a time.
+   */
+	struct RunCursor{
+		const RIDKeyPair<T>* current;
+		const RIDKeyPair<T>* end;
+		const Run* run;
+		size_t nextPage;
+		std::vector<RIDKeyPair<T> > page;
+	};
+
+	BufMgr* bufMgr;
+	std::string runFileName;
+	BlobFile* runFile;
+	int threadCount;
+
+  /**
+   * Number of entries the buffer holds before it is spilled.
+   */
+	size_t bufferCapacity;
+
+  /**
+   * Number of runs merged at once, one page of each fits in the memory budget.
+   */
+	size_t fanIn;
+
+	std::vector<RIDKeyPair<T> > buffer;
+
+  /**
+   * Bounds of the sorted slices of the buffer, slice i being [sliceBounds[i], sliceBounds[i + 1]).
+   */
+	std::vector<size_t> sliceBounds;
+
+	std::vector<Run> runs;
+	size_t entryCount;
+	int writtenRunCount;
+	int mergePassCount;
+	int allocatedPageCount;
+
+  /**
+   * Pages of runs which were read back into a merge already, and are written again before new pages are allocated.
+   */
+	std::vector<PageId> freePages;
+
+  /**
+   * Merge inputs and the loser tree over them. tree[0] is the cursor with the smallest entry, tree[1, k) hold
+   * the cursor which lost the match at each inner node, where the children of node i are 2i and 2i + 1 and
+   * cursor c is leaf k + c.
+   */
+	std::vector<RunCursor> cursors;
+	std::vector<int> tree;
+
+	void sortBuffer();
+	void spillBuffer();
+	void writeRunPage(Run& run, const RIDKeyPair<T>* entries, int count);
+	void mergeRuns(size_t first, size_t last, Run& out);
+
+	void startRunMerge(size_t first, size_t last);
+	void startMerge();
+	void loadNextPage(RunCursor& cursor);
+	bool cursorLess(int a, int b) const;
+	int buildTree(int node);
+	void popWinner();
+};
+
+}
@@ -12,7 +12,10 @@
 #include <memory>
 #include <string>
 #include <cstdio>
+#include <cstring>
 #include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
@@ -64,7 +67,7 @@ PageId File::getFirstPageNo() {
   return header.first_used_page;
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
+File::File(const std::string& name, const bool create_new) : filename_(name), prefetch_fd_(-1) {
   openIfNeeded(create_new);
 
   if (create_new) {
@@ -103,6 +106,11 @@ void File::openIfNeeded(const bool create_new) {
 }
 
 void File::close() {
+  if (prefetch_fd_ >= 0) {
+    ::close(prefetch_fd_);
+    prefetch_fd_ = -1;
+  }
+
 	if(open_counts_[filename_] > 0)
   	--open_counts_[filename_];
 
@@ -115,6 +123,18 @@ void File::close() {
   }
 }
 
+void File::prefetchPage(const PageId page_number) const {
+#ifdef POSIX_FADV_WILLNEED
+  if (prefetch_fd_ < 0) {
+    prefetch_fd_ = ::open(filename_.c_str(), O_RDONLY);
+    if (prefetch_fd_ < 0) {
+      return;
+    }
+  }
+  posix_fadvise(prefetch_fd_, pagePosition(page_number), Page::SIZE, POSIX_FADV_WILLNEED);
+#endif
+}
+
 FileHeader File::readHeader() const {
   FileHeader header;
   stream_->seekg(0 /* pos */, std::ios::beg);
@@ -364,6 +384,18 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
   FileHeader header = readHeader();
 	Page new_page;
 
+	// Reuse the page at the head of the free list, whose first bytes hold the number of the next free page
+	if (header.num_free_pages > 0) {
+		new_page_number = header.first_free_page;
+		Page free_page = readPage(new_page_number);
+		memcpy(&header.first_free_page, reinterpret_cast<const char*>(&free_page), sizeof(PageId));
+		--header.num_free_pages;
+
+		writePage(new_page_number, new_page);
+		writeHeader(header);
+		return new_page;
+	}
+
 	new_page_number = header.num_pages;
 
 	if (header.first_used_page == Page::INVALID_NUMBER) {
@@ -391,9 +423,21 @@ void BlobFile::writePage(const PageId new_page_number, const Page& new_page) {
 	stream_->flush();
 }
 
-//delePage should not be called for a blob_file, not supported
 void BlobFile::deletePage(const PageId page_number) {
-	throw InvalidPageException(page_number, filename_);
+  FileHeader header = readHeader();
+	if (page_number == 0 || page_number >= header.num_pages) {
+		throw InvalidPageException(page_number, filename_);
+	}
+
+	// A blob page has no header of its own, so the page keeps the number of the next free page in its first bytes
+	// and goes to the head of the free list of the file
+	Page free_page;
+	memcpy(reinterpret_cast<char*>(&free_page), &header.first_free_page, sizeof(PageId));
+	header.first_free_page = page_number;
+	++header.num_free_pages;
+
+	writePage(page_number, free_page);
+	writeHeader(header);
 }
 
 }
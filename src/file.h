@@ -150,6 +150,15 @@ class File {
    */
   virtual void deletePage(const PageId page_number) = 0;
 
+  /**
+   * Asks the operating system to read the page in the background, so that a
+   * readPage shortly after finds it in memory instead of waiting for the disk.
+   * Only a hint: returns at once, and does nothing where it is not supported.
+   *
+   * @param page_number   Number of page to read ahead.
+   */
+  void prefetchPage(const PageId page_number) const;
+
   /**
    * Returns the name of the file this object represents.
    *
@@ -233,6 +242,12 @@ class File {
    */
   std::shared_ptr<std::fstream> stream_;
 
+  /**
+   * Descriptor through which prefetchPage gives its hints, opened on first
+   * use since the stream does not expose its own. -1 until then.
+   */
+  mutable int prefetch_fd_;
+
   friend class FileIterator;
 };
 
@@ -468,9 +483,11 @@ class BlobFile : public File {
   void writePage(const PageId page_number, const Page& new_page) override;
 
   /**
-   * Deletes a page from the file.
+   * Deletes a page from the file. The page goes to the free list of the file,
+   * and is handed out again by allocatePage().
    *
    * @param page_number   Number of page to delete.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
    */
   void deletePage(const PageId page_number) override;
 };
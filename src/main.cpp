@@ -16,8 +16,16 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <climits>
+#include <atomic>
+#include <fstream>
+#include <set>
+#include <thread>
 #include <vector>
 #include "btree.h"
+#include "node_search.h"
+#include "external_sort.h"
 #include "page.h"
 #include "filescan.h"
 #include "page_iterator.h"
@@ -31,6 +39,7 @@
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
 #include "exceptions/bad_index_info_exception.h"
+#include "exceptions/page_pinned_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -67,6 +76,13 @@ typedef struct tuple {
 	char s[64];
 } RECORD;
 
+// This is the structure for tuples in the relation of test 13, whose key does not fit in 32 bits
+
+typedef struct wideTuple {
+	int i;
+	std::int64_t l;
+} WIDE_RECORD;
+
 PageFile* file1;
 RecordId rid;
 RECORD record1;
@@ -84,9 +100,19 @@ void createRelationRandom();
 void myCreateRelationForward();
 void myCreateRelationBackward();
 void myCreateRelationInSpecialOrder();
+void createRelationLowCardinality();
 void myIntTests();
 void myIndexTests();
 void intTests();
+void doubleTests();
+int doubleScan(BTreeIndex *index, double lowVal, Operator lowOp, double highVal, Operator highOp);
+void stringTests();
+int stringScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+void createRelationLongStrings();
+void createRelationInt64();
+void createRelationTenants();
+std::int64_t int64Key(int value);
+int int64Scan(BTreeIndex *index, std::int64_t lowVal, Operator lowOp, std::int64_t highVal, Operator highOp);
 bool equalitySearch(BTreeIndex *index, int searchKey);
 void checkLeafNodesSequence(int relationSize);
 int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
@@ -101,6 +127,55 @@ void test7();
 void test8();
 void test9();
 void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
+void test31();
+void test32();
+void test33();
+void test34();
+int indexHeight(BTreeIndex *index);
+int countEntries(BTreeIndex *index, int lowVal, int highVal);
+long fileSize(const std::string& fileName);
+int recordKey(RecordId rid);
+void scanAll(BTreeIndex *index, const void* lowVal, Operator lowOp, const void* highVal, Operator highOp,
+             size_t batchSize, std::vector<RecordId>& rids, ScanOrder order = ASCENDING);
+void checkDescendingScans(BTreeIndex *index, const void* lowVal, const void* highVal);
+int checkLeafLinks(BTreeIndex *index, int lowKey);
+int countPostingLeaves(BTreeIndex *index);
+int countLeaves(BTreeIndex *index, LeafFormat format);
+int lookupEvery(BTreeIndex *index, int step, int& accesses);
+RecordId concurrentRid(int key);
+int insertAndLookUpConcurrently(BTreeIndex *index, int writers, int perWriter, int readers);
+int checkHighKeys(BTreeIndex *index);
+int insertInBatches(BTreeIndex *index, const std::vector<int>& keys, size_t batchSize);
+void lookUpAllKeys(BTreeIndex *index, int lowKey, int highKey, std::vector<std::vector<RecordId> >& rids);
+int checkNodeLinks(File *file, PageId pageNo, bool leaf, PageId rightNo, int highKey);
+bool keyHasOverflowPages(BTreeIndex *index, int key);
+int checkSplitLeaves(double splitFill, double rightmostSplitFill);
+void scanIncluded(BTreeIndex *index, const void* lowVal, const void* highVal, ScanOrder order, size_t batchSize,
+                  std::vector<double>& values);
+void checkBulkLoadedLeaves(double fillFactor);
+WIDE_RECORD wideRecord(RecordId rid);
+int checkTenantScan(BTreeIndex *index, const CompositeKey* low, Operator lowOp, const CompositeKey* high, Operator highOp,
+                    ScanOrder order);
 void errorTests();
 void deleteRelation();
 
@@ -173,6 +248,30 @@ int main(int argc, char **argv)
 	test8();
 	test9();
 	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
+	test21();
+	test22();
+	test23();
+	test24();
+	test25();
+	test26();
+	test27();
+	test28();
+	test29();
+	test30();
+	test31();
+	test32();
+	test33();
+	test34();
 	errorTests();
 
 	delete bufMgr;
@@ -252,7 +351,8 @@ void test6() {
 
 /**
   * Insert 20000 records in increasing order into an index file and check if each of the inserted key is on the desired
-  * position
+  * position. The index is built one insert at a time, so the expected positions are those left by splits of the
+  * rightmost leaf
   *
  **/
 void test7() {
@@ -261,7 +361,9 @@ void test7() {
 
 	myCreateRelationForward();
 
-	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	IndexOptions options;
+	options.bulkLoad = false;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
 	PageId pageNo;
 	int pos;
 	int total_key;
@@ -270,19 +372,19 @@ void test7() {
 	pageNo = currLeafPageNo;
 	int pageCnt = 0;
 
-	std::string outIndexName;
-	std::ostringstream idxStr;
-	idxStr << relationName << '.' << offsetof(tuple,i);
-	outIndexName = idxStr.str();
-	BlobFile *file = new BlobFile(outIndexName, false);
+	// Read leaf pages through the index's own file, so leaf pages still dirty in the buffer pool are seen
+	File *file = index.getIndexFile();
 
-	for (int i = 0; i < myRelationSize; i += (INTARRAYLEAFSIZE / 2 + 1)) {
+	// Every split of the rightmost leaf leaves rightmostSplitFill of the entries in the left leaf
+	const int leafKeys = (int)(options.rightmostSplitFill * INTARRAYLEAFSIZE) + 1;
+
+	for (int i = 0; i < myRelationSize; i += leafKeys) {
 		int posCnt = 0;
 
-		if (myRelationSize - pageCnt * (INTARRAYLEAFSIZE / 2 + 1) <= INTARRAYLEAFSIZE) {
-			for (int j = i; j < i + (myRelationSize - pageCnt * (INTARRAYLEAFSIZE / 2 + 1)); j++) {
+		if (myRelationSize - pageCnt * leafKeys <= INTARRAYLEAFSIZE) {
+			for (int j = i; j < i + (myRelationSize - pageCnt * leafKeys); j++) {
 				index.findLeafNode(j, pageNo, pos, total_key);
-				if (!(pageNo == currLeafPageNo && pos == posCnt && total_key == myRelationSize - pageCnt * (INTARRAYLEAFSIZE / 2 + 1))) {
+				if (!(pageNo == currLeafPageNo && pos == posCnt && total_key == myRelationSize - pageCnt * leafKeys)) {
 					std::cout << "Key " << j << " is at Page " << pageNo << " position " << pos << "\n";
 					std::cout << "Key " << j << " is at expected Page " << currLeafPageNo << " position " << posCnt << "\n";
 					std::cout << "findLeafNode fails to get the correct information of key " << j << " in current index file." << std::endl;
@@ -293,9 +395,9 @@ void test7() {
 			break;
 		}
 
-		for (int j = i; j < i + (INTARRAYLEAFSIZE / 2 + 1); j++) {
+		for (int j = i; j < i + leafKeys; j++) {
 			index.findLeafNode(j, pageNo, pos, total_key);
-			if (!(pageNo == currLeafPageNo && pos == posCnt && total_key == (INTARRAYLEAFSIZE / 2 + 1))) {
+			if (!(pageNo == currLeafPageNo && pos == posCnt && total_key == leafKeys)) {
 				std::cout << "Key " << j << " is at Page " << pageNo << " position " << pos << "\n";
 				std::cout << "Key " << j << " is at expected Page " << currLeafPageNo << " position " << posCnt << "\n";
 				std::cout << "findLeafNode fails to get the correct information of key " << j << " in current index file." << std::endl;
@@ -315,10 +417,6 @@ void test7() {
 
 	std::cout << "\nTest passed at line no:" << __LINE__ << "\n";
 
-	bufMgr->flushFile(file);
-	delete file;
-	file = NULL;
-
 	deleteRelation();
 }
 
@@ -365,221 +463,300 @@ void test10() {
 }
 
 /**
-  * Given the relationSize, this function builds a index file on current relation file. Then, it calls
-  * findLeafnode function to get the first leaf page. Relying on the fact that all leaf nodes are connected,
-  * this function iterates every key in the leaf nodes of the index file. If every key is on the correct
-  * position of correct leaf node. This function will not produce any output.
-  * @param relationSize the size of the relation file
+  * Check that every supported in-node search kernel returns the same lower and upper bound positions
+  * as a linear scan, on sorted key arrays with duplicates, of every size up to a full leaf node
   *
  **/
-void checkLeafNodesSequence(int relationSize) {
-
-	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
-	int pos;
-	int total_key;
-	PageId currLeafPageNo;
-	index.findLeafNode(0, currLeafPageNo, pos, total_key);
-
-	std::string outIndexName;
-	std::ostringstream idxStr;
-	idxStr << relationName << '.' << offsetof(tuple,i);
-	outIndexName = idxStr.str();
-	BlobFile *file = new BlobFile(outIndexName, false);
-
-	int keyToCheck = 0;
-
-	for (int i = 0; i < relationSize; i += total_key) {
-
-		Page* leaf_page;
-		bufMgr->readPage(file, currLeafPageNo, leaf_page);
-		bufMgr->unPinPage(file, currLeafPageNo, false);
-		LeafNodeInt* leaf_node = reinterpret_cast<LeafNodeInt*>(leaf_page);
-
-		for (int j = 0; j < leaf_node->keySize; j++) {
-			if (keyToCheck++ != leaf_node->keyArray[j]) {
-				std::cout << "Key " << leaf_node->keyArray[j] << " is at Page " << currLeafPageNo << " position " << j << std::endl;
-				std::cout << "The order of keys is not sorted correctly." << std::endl;
-				exit(1);
+void test11() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 11 begins" << std::endl;
+
+	const SearchKernel kernels[] = {SEARCH_BINARY, SEARCH_SSE4, SEARCH_AVX2};
+	std::vector<int> keys;
+	for (int n = 0; n <= INTARRAYLEAFSIZE; n++) {
+		// Keys 0, 0, 2, 3, 3, 5, ... so duplicates and gaps both occur
+		keys.resize(n);
+		for (int i = 0; i < n; i++) {
+			keys[i] = i - (i % 3 == 1);
+		}
+		const int* keyArray = keys.empty() ? NULL : &keys[0];
+		for (int key = -1; key <= n + 1; key++) {
+			int lower = lowerBoundKernel(SEARCH_LINEAR)(keyArray, n, key);
+			int upper = upperBoundKernel(SEARCH_LINEAR)(keyArray, n, key);
+			for (int k = 0; k < 3; k++) {
+				if (!searchKernelSupported(kernels[k])) {
+					continue;
+				}
+				if (lowerBoundKernel(kernels[k])(keyArray, n, key) != lower || upperBoundKernel(kernels[k])(keyArray, n, key) != upper) {
+					std::cout << "Search kernel " << searchKernelName(kernels[k]) << " fails on key " << key << " in " << n << " keys." << std::endl;
+					exit(1);
+				}
 			}
 		}
-
-		total_key = leaf_node->keySize;
-		currLeafPageNo = leaf_node->rightSibPageNo;
 	}
 
-	bufMgr->flushFile(file);
-	delete file;
-	file = NULL;
+	std::cout << "\nTest passed at line no:" << __LINE__ << "\n";
 }
 
 /**
-  * Create a relation file with records with keys from 0 to 19999 (in increasing order of keys)
+  * Insert 20000 records in a special order into an index file, close the index and open the existing index file
+  * again. The root page number and tree height are only kept in memory while the index is open, so check that they
+  * were written back to the meta page by running the index tests on the reopened index
   *
  **/
-void myCreateRelationForward() {
-    // destroy any old copies of relation file
+void test12() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 12 begins" << std::endl;
+	myCreateRelationInSpecialOrder();
+
+	// Remove any index file left over by the previous tests, so the index is built from this relation
 	try
 	{
-		File::remove(relationName);
+		File::remove(intIndexName);
 	}
 	catch(const FileNotFoundException &e)
 	{
 	}
 
-	file1 = new PageFile(relationName, true);
-
-	// initialize all of record1.s to keep purify happy
-	memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-	Page new_page = file1->allocatePage(new_page_number);
-
-	// Insert a bunch of tuples into the relation.
-	for(int i = 0; i < myRelationSize; i++ )
-		{
-		sprintf(record1.s, "%05d string record", i);
-		record1.i = i;
-		record1.d = (double)i;
-		std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
-
-			while(1)
-			{
-				try
-				{
-				new_page.insertRecord(new_data);
-					break;
-				}
-				catch(const InsufficientSpaceException &e)
-				{
-					file1->writePage(new_page_number, new_page);
-					new_page = file1->allocatePage(new_page_number);
-				}
-			}
-		}
-
-	file1->writePage(new_page_number, new_page);
-	std::cout << "Done create relation" << std::endl;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	}
+	myIndexTests();
+	deleteRelation();
 }
 
 /**
-  * Create a relation file with records with keys from 19999 to 0 (in decreasing order of keys)
+  * Insert 5000 records in random order, whose INT64 keys are spread far beyond the range of a 32-bit integer and
+  * share their low 32 bits, and check that range scans on an INT64 index return exactly the keys in range
   *
  **/
-void myCreateRelationBackward() {
-    // destroy any old copies of relation file
+void test13() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 13 begins" << std::endl;
+	createRelationInt64();
+
+	std::string int64IndexName;
+	{
+		BTreeIndex index(relationName, int64IndexName, bufMgr, offsetof(wideTuple,l), INT64);
+		checkPassFail(int64Scan(&index,int64Key(0),GTE,int64Key(relationSize-1),LTE), relationSize)
+		checkPassFail(int64Scan(&index,int64Key(100),GT,int64Key(200),LT), 99)
+		checkPassFail(int64Scan(&index,int64Key(100)-1,GT,int64Key(101),LT), 1)
+		checkPassFail(int64Scan(&index,7,GTE,7,LTE), 1)
+		checkPassFail(int64Scan(&index,0,GTE,((std::int64_t)1 << 32) * 10,LTE), 10)
+		checkPassFail(int64Scan(&index,int64Key(relationSize-1),GT,int64Key(relationSize-1) + 1,LTE), 0)
+	}
+
 	try
 	{
-		File::remove(relationName);
+		File::remove(int64IndexName);
 	}
 	catch(const FileNotFoundException &e)
 	{
 	}
+	deleteRelation();
+}
 
-	file1 = new PageFile(relationName, true);
-
-	// initialize all of record1.s to keep purify happy
-	memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-	Page new_page = file1->allocatePage(new_page_number);
+/**
+  * Insert 20000 records in random order, whose STRING keys share a 50 byte prefix, into a STRING index. Walk the
+  * leaf nodes from the leftmost one and check that every key is there in order, and that the common prefix is
+  * stored once per page, i.e. there are fewer leaf nodes than even completely full leaves of padded 64 byte keys
+  * would need
+  *
+ **/
+void test14() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 14 begins" << std::endl;
+	createRelationLongStrings();
 
-	// Insert a bunch of tuples into the relation.
-	for(int i = myRelationSize - 1; i >= 0; i-- )
-		{
-		sprintf(record1.s, "%05d string record", i);
-		record1.i = i;
-		record1.d = (double)i;
-		std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+	{
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		File *file = index.getIndexFile();
+
+		// Go down the leftmost children from the root to the leftmost leaf
+		Page* page;
+		bufMgr->readPage(file, 1, page);
+		IndexMetaInfo* meta = reinterpret_cast<IndexMetaInfo*>(page);
+		PageId pageNo = meta->rootPageNo;
+		int height = meta->height;
+		bufMgr->unPinPage(file, 1, false);
+		for (int level = height; level > 1; level--) {
+			bufMgr->readPage(file, pageNo, page);
+			PageId childNo = reinterpret_cast<StringNonLeafNode*>(page)->leftmostPageNo;
+			bufMgr->unPinPage(file, pageNo, false);
+			pageNo = childNo;
+		}
 
-			while(1)
-			{
-				try
-				{
-				new_page.insertRecord(new_data);
-					break;
-				}
-				catch(const InsufficientSpaceException &e)
-				{
-					file1->writePage(new_page_number, new_page);
-					new_page = file1->allocatePage(new_page_number);
+		int keyCount = 0;
+		int leafCount = 0;
+		char expected[STRINGKEYMAXSIZE];
+		while (pageNo != Page::INVALID_NUMBER) {
+			bufMgr->readPage(file, pageNo, page);
+			StringLeafNode* leaf = reinterpret_cast<StringLeafNode*>(page);
+			for (int j = 0; j < leaf->keySize; j++) {
+				sprintf(expected, "%s%05d", "customers/north-america/united-states/wisconsin/", keyCount++);
+				if (stringEntryKey(leaf, j) != expected) {
+					std::cout << "Key " << stringEntryKey(leaf, j) << " is at Page " << pageNo << " position " << j << std::endl;
+					std::cout << "The order of keys is not sorted correctly." << std::endl;
+					exit(1);
 				}
 			}
+			PageId nextNo = leaf->rightSibPageNo;
+			bufMgr->unPinPage(file, pageNo, false);
+			pageNo = nextNo;
+			leafCount++;
 		}
+		checkPassFail(keyCount, myRelationSize)
 
-	file1->writePage(new_page_number, new_page);
+		int paddedLeafCapacity = Page::SIZE / (STRINGKEYMAXSIZE + sizeof(RecordId));
+		bool fewerLeaves = leafCount < myRelationSize / paddedLeafCapacity;
+		std::cout << leafCount << " leaf nodes, " << myRelationSize / paddedLeafCapacity << " full leaf nodes of padded keys" << std::endl;
+		checkPassFail(fewerLeaves, true)
+	}
+
+	try
+	{
+		File::remove(stringIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	deleteRelation();
 }
 
 /**
-  * Create a relation file with records with keys from 0 to 19999 in a special ordering of keys.
-  * It inserts records in this order: 19999, 0, 19998, 1, ...... , 10000, 9999.
+  * Insert 20000 records in an special order into a relation, and build indexes on it with a bulk load at different
+  * fill factors. Check that the leaves are filled evenly up to the fill factor with all keys in order, that the
+  * index answers the usual scans, and that later inserts still go to the right place
   *
  **/
-void myCreateRelationInSpecialOrder() {
-	// destroy any old copies of relation file
+void test15() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 15 begins" << std::endl;
+	myCreateRelationInSpecialOrder();
+
+	checkBulkLoadedLeaves(1.0);
+	checkBulkLoadedLeaves(0.5);
+	checkBulkLoadedLeaves(0.05);
+
+	// Inserts into a full bulk loaded tree split its nodes like any other
 	try
 	{
-		File::remove(relationName);
+		File::remove(intIndexName);
 	}
 	catch(const FileNotFoundException &e)
 	{
 	}
-
-	file1 = new PageFile(relationName, true);
-
-	// initialize all of record1.s to keep purify happy
-	memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-	Page new_page = file1->allocatePage(new_page_number);
-
-	// Insert a bunch of tuples into the relation.
-	for(int i = myRelationSize - 1; i >= myRelationSize / 2; i--)
 	{
-		sprintf(record1.s, "%05d string record", i);
-		record1.i = i;
-		record1.d = (double)i;
-		std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
-
-		while(1)
+		IndexOptions options;
+		options.fillFactor = 1.0;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		for (int i = myRelationSize; i < myRelationSize + 2000; i++) {
+			RecordId newRid;
+			newRid.page_number = 1;
+			newRid.slot_number = 0;
+			newRid.padding = 0;
+			index.insertEntry(&i, newRid);
+		}
+		// The inserted rids point to no record, so count the scan results without reading the records
+		int lowVal = myRelationSize - 100;
+		int highVal = myRelationSize + 2000;
+		int numResults = 0;
+		index.startScan(&lowVal, GTE, &highVal, LT);
+		try
 		{
-			try
-			{
-				new_page.insertRecord(new_data);
-				break;
-			}
-			catch(const InsufficientSpaceException &e)
-			{
-				file1->writePage(new_page_number, new_page);
-				new_page = file1->allocatePage(new_page_number);
+			while (1) {
+				RecordId scanRid;
+				index.scanNext(scanRid);
+				numResults++;
 			}
 		}
-
-		sprintf(record1.s, "%05d string record", myRelationSize - 1 - i);
-		record1.i = myRelationSize - 1 - i;
-		record1.d = (double)(myRelationSize - 1 - i);
-		std::string new_data_2(reinterpret_cast<char*>(&record1), sizeof(record1));
-
-		while(1)
+		catch(const IndexScanCompletedException &e)
 		{
-			try
-			{
-				new_page.insertRecord(new_data_2);
-				break;
-			}
-			catch(const InsufficientSpaceException &e)
-			{
-				file1->writePage(new_page_number, new_page);
-				new_page = file1->allocatePage(new_page_number);
-			}
 		}
+		index.endScan();
+		checkPassFail(numResults, 2100)
 	}
 
-	file1->writePage(new_page_number, new_page);
+	// The fill factor must be within (0, 1]
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	try
+	{
+		IndexOptions options;
+		options.fillFactor = 0;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		std::cout << "BadIndexInfoException is not thrown for a fill factor of 0." << std::endl;
+		exit(1);
+	}
+	catch(const BadIndexInfoException &e)
+	{
+	}
+
+	myIndexTests();
+	deleteRelation();
 }
 
 /**
-  * Call myIntTests() and remove an existing index file
+  * Sort more entries than fit in a small sort memory, so sorted runs are spilled to disk and merged in more than one
+  * pass, and check that they come back in order. Then bulk load INTEGER and STRING indexes on 20000 records with the
+  * same small sort memory, and check them with the usual scans
   *
  **/
-void myIndexTests() {
-	myIntTests();
+void test16() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 16 begins" << std::endl;
+
+	{
+		// 64KB hold 8192 entries, or a page of each of 7 runs in a merge
+		const int entryCount = 100000;
+		ExternalSorter<int> sorter(bufMgr, "relA.sort", 64 * 1024, 4);
+		long long keySum = 0;
+		srand(16);
+		for (int i = 0; i < entryCount; i++) {
+			RIDKeyPair<int> entry;
+			RecordId entryRid;
+			entryRid.page_number = i;
+			entryRid.slot_number = 0;
+			entryRid.padding = 0;
+			entry.set(entryRid, rand() % 50000);
+			keySum += entry.key;
+			sorter.add(entry);
+		}
+		sorter.finish();
+		bool merged = sorter.mergePasses() > 0;
+		checkPassFail(merged, true)
+		// The merges write their runs over the pages of the runs they read, so the file holds about the input only
+		bool reused = sorter.runPages() < 2 * (entryCount / SortRunPage<int>::CAPACITY);
+		checkPassFail(reused, true)
+
+		int sortedCount = 0;
+		bool sorted = true;
+		RIDKeyPair<int> entry;
+		RIDKeyPair<int> previous;
+		while (sorter.next(entry)) {
+			if (sortedCount > 0 && entry < previous) {
+				sorted = false;
+			}
+			keySum -= entry.key;
+			previous = entry;
+			sortedCount++;
+		}
+		checkPassFail(sortedCount, entryCount)
+		checkPassFail(sorted, true)
+		checkPassFail(keySum, 0)
+	}
+	bool runFileRemoved = !File::exists("relA.sort");
+	checkPassFail(runFileRemoved, true)
+
+	myCreateRelationInSpecialOrder();
+	IndexOptions options;
+	options.sortMemory = 32 * 1024;
+	options.sortThreads = 2;
 	try
 	{
 		File::remove(intIndexName);
@@ -587,100 +764,3528 @@ void myIndexTests() {
 	catch(const FileNotFoundException &e)
 	{
 	}
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(intScan(&index,25,GT,40,LT), 14)
+		checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+		checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+		checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+		checkPassFail(intScan(&index,0,GTE,myRelationSize,LT), myRelationSize)
+	}
+	runFileRemoved = !File::exists(intIndexName + ".sort");
+	checkPassFail(runFileRemoved, true)
+	File::remove(intIndexName);
+
+	try
+	{
+		File::remove(stringIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+		checkPassFail(stringScan(&index,25,GT,40,LT), 14)
+		checkPassFail(stringScan(&index,996,GT,1001,LT), 4)
+		checkPassFail(stringScan(&index,3000,GTE,4000,LT), 1000)
+		checkPassFail(stringScan(&index,0,GTE,19999,LTE), myRelationSize)
+	}
+	File::remove(stringIndexName);
+	deleteRelation();
 }
 
 /**
-  * This function is developed based on intTests(). Except for run some range scan tests, it
-  * uses equalitySearch() to check if the index file has every key of records in the relation files
+  * Delete entries from INTEGER and STRING indexes on 20000 records, and check the scans after every round. Leaves and
+  * non-leaf nodes borrow from and merge with their siblings on the way, until the tree is a single leaf again. Check
+  * that deleting the same entries twice, or an entry which is not there, throws NoSuchKeyFoundException, that entries
+  * with the same key can be deleted across leaves, and that the pages freed by deletes are used again by inserts
   *
  **/
-void myIntTests() {
-	std::cout << "myIntTests begin" << std::endl;
-	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
-
-	checkPassFail(intScan(&index,25,GT,40,LT), 14)
-	checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
-	checkPassFail(intScan(&index,-3,GT,3,LT), 3)
-	checkPassFail(intScan(&index,996,GT,1001,LT), 4)
-	checkPassFail(intScan(&index,0,GT,1,LT), 0)
-	checkPassFail(intScan(&index,300,GT,400,LT), 99)
-	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
-
-	checkPassFail(intScan(&index,0,GTE,19999,LTE), 20000)
-	checkPassFail(intScan(&index,0,GT,19999,LTE), 19999)
-	checkPassFail(intScan(&index,0,GTE,19999,LT), 19999)
-	checkPassFail(intScan(&index,0,GT,19999,LT), 19998)
+void test17() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 17 begins" << std::endl;
+	myCreateRelationInSpecialOrder();
 
-	checkPassFail(intScan(&index,0,GTE,341,LTE), 342)
+	// Remember the rid of every record, the deletes need it
+	std::vector<RecordId> rids(myRelationSize);
+	{
+		FileScan fscan(relationName, bufMgr);
+		try
+		{
+			RecordId scanRid;
+			while(1)
+			{
+				fscan.scanNext(scanRid);
+				std::string recordStr = fscan.getRecord();
+				rids[reinterpret_cast<const RECORD*>(recordStr.c_str())->i] = scanRid;
+			}
+		}
+		catch(const EndOfFileException &e)
+		{
+		}
+	}
+
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		// Completely full leaves underflow after a few deletes, and borrow before they merge
+		IndexOptions options;
+		options.fillFactor = 1.0;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		int startHeight = indexHeight(&index);
+		for (int i = 0; i < myRelationSize; i += 2) {
+			index.deleteEntry(&i, rids[i]);
+		}
+		checkPassFail(intScan(&index,25,GT,40,LT), 7)
+		checkPassFail(intScan(&index,0,GTE,myRelationSize,LT), myRelationSize / 2)
+		checkPassFail(intScan(&index,996,GTE,1001,LT), 2)
+
+		int deletedKey = 40;
+		bool thrown = false;
+		try
+		{
+			index.deleteEntry(&deletedKey, rids[deletedKey]);
+		}
+		catch(const NoSuchKeyFoundException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		int presentKey = 41;
+		thrown = false;
+		try
+		{
+			index.deleteEntry(&presentKey, rids[presentKey + 2]);
+		}
+		catch(const NoSuchKeyFoundException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		checkPassFail(intScan(&index,40,GTE,41,LTE), 1)
+
+		for (int i = myRelationSize - 1; i > 0; i -= 2) {
+			index.deleteEntry(&i, rids[i]);
+		}
+		checkPassFail(intScan(&index,0,GTE,myRelationSize,LT), 0)
+		bool lower = indexHeight(&index) < startHeight;
+		checkPassFail(lower, true)
+		checkPassFail(indexHeight(&index), 1)
+
+		// The same inserts and deletes again need no pages beyond those freed by the first round
+		for (int i = 0; i < myRelationSize; i++) {
+			index.insertEntry(&i, rids[i]);
+		}
+		checkPassFail(intScan(&index,0,GTE,myRelationSize,LT), myRelationSize)
+		for (int i = 0; i < myRelationSize; i++) {
+			index.deleteEntry(&i, rids[i]);
+		}
+		long firstRoundSize = fileSize(intIndexName);
+		for (int i = 0; i < myRelationSize; i++) {
+			index.insertEntry(&i, rids[i]);
+		}
+		checkPassFail(fileSize(intIndexName), firstRoundSize)
+		checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+
+		// Entries with the same key spread over several leaves, delete them in random order. The rids point to
+		// no record, so only count them
+		const int duplicateKey = 7;
+		const int duplicateCount = 3 * INTARRAYLEAFSIZE;
+		std::vector<RecordId> duplicateRids;
+		for (int i = 0; i < duplicateCount; i++) {
+			RecordId newRid;
+			newRid.page_number = 1;
+			newRid.slot_number = i + 1;
+			newRid.padding = 0;
+			duplicateRids.push_back(newRid);
+			index.insertEntry(&duplicateKey, newRid);
+		}
+		checkPassFail(countEntries(&index,duplicateKey,duplicateKey), duplicateCount + 1)
+		srand(17);
+		for (int i = duplicateCount - 1; i > 0; i--) {
+			std::swap(duplicateRids[i], duplicateRids[rand() % (i + 1)]);
+		}
+		for (int i = 0; i < duplicateCount; i++) {
+			index.deleteEntry(&duplicateKey, duplicateRids[i]);
+		}
+		checkPassFail(intScan(&index,duplicateKey,GTE,duplicateKey,LTE), 1)
+		checkPassFail(intScan(&index,0,GTE,myRelationSize,LT), myRelationSize)
+	}
+	File::remove(intIndexName);
+
+	try
+	{
+		File::remove(stringIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		char key[STRINGKEYMAXSIZE];
+		for (int i = 0; i < myRelationSize; i++) {
+			if (i % 3 != 0) {
+				sprintf(key, "%05d string record", i);
+				index.deleteEntry(key, rids[i]);
+			}
+		}
+		checkPassFail(stringScan(&index,25,GT,40,LT), 5)
+		checkPassFail(stringScan(&index,0,GTE,19999,LTE), (myRelationSize + 2) / 3)
+
+		sprintf(key, "%05d string record", 26);
+		bool thrown = false;
+		try
+		{
+			index.deleteEntry(key, rids[26]);
+		}
+		catch(const NoSuchKeyFoundException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+
+		for (int i = 0; i < myRelationSize; i += 3) {
+			sprintf(key, "%05d string record", i);
+			index.deleteEntry(key, rids[i]);
+		}
+		checkPassFail(stringScan(&index,0,GTE,19999,LTE), 0)
+		checkPassFail(indexHeight(&index), 1)
+	}
+	File::remove(stringIndexName);
+	deleteRelation();
+}
+
+/**
+  * Look up every key of INTEGER, DOUBLE and STRING indexes on 20000 records, and keys which are not there, with
+  * lookup and lookupAll. Neither throws on a miss. Entries with the same key spread over several leaves are all
+  * returned, and a lookup leaves an executing scan where it was
+  *
+ **/
+void test18() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 18 begins" << std::endl;
+	myCreateRelationInSpecialOrder();
+
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		int hits = 0;
+		for (int i = 0; i < myRelationSize; i++) {
+			RecordId rid;
+			if (index.lookup(&i, rid) && recordKey(rid) == i) {
+				hits++;
+			}
+		}
+		checkPassFail(hits, myRelationSize)
+
+		int missingKeys[] = { -1, myRelationSize, myRelationSize + 100 };
+		int misses = 0;
+		for (int i = 0; i < 3; i++) {
+			RecordId rid;
+			std::vector<RecordId> rids;
+			if (!index.lookup(&missingKeys[i], rid) && index.lookupAll(&missingKeys[i], rids) == 0 && rids.empty()) {
+				misses++;
+			}
+		}
+		checkPassFail(misses, 3)
+
+		// Entries with the same key spread over several leaves. The rids point to no record, so only compare them
+		const int duplicateKey = 7;
+		const int duplicateCount = 3 * INTARRAYLEAFSIZE;
+		std::set<std::pair<PageId, SlotId> > inserted;
+		for (int i = 0; i < duplicateCount; i++) {
+			RecordId newRid;
+			newRid.page_number = 1;
+			newRid.slot_number = i + 1;
+			newRid.padding = 0;
+			index.insertEntry(&duplicateKey, newRid);
+			inserted.insert(std::make_pair(newRid.page_number, newRid.slot_number));
+		}
+		std::vector<RecordId> rids;
+		checkPassFail(index.lookupAll(&duplicateKey, rids), (size_t)duplicateCount + 1)
+		int matched = 0;
+		for (size_t i = 0; i < rids.size(); i++) {
+			if (inserted.count(std::make_pair(rids[i].page_number, rids[i].slot_number)) > 0 || recordKey(rids[i]) == duplicateKey) {
+				matched++;
+			}
+		}
+		checkPassFail(matched, duplicateCount + 1)
+
+		// A lookup in the middle of a scan
+		int lowVal = 100;
+		int highVal = 200;
+		index.startScan(&lowVal, GTE, &highVal, LT);
+		RecordId scanRid;
+		index.scanNext(scanRid);
+		RecordId rid;
+		int lookupKey = 5000;
+		bool found = index.lookup(&lookupKey, rid);
+		checkPassFail(found, true)
+		index.scanNext(scanRid);
+		checkPassFail(recordKey(scanRid), 101)
+		index.endScan();
+	}
+	File::remove(intIndexName);
+
+	try
+	{
+		File::remove(doubleIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE);
+		RecordId rid;
+		double key = 4321;
+		bool found = index.lookup(&key, rid) && recordKey(rid) == 4321;
+		checkPassFail(found, true)
+		key = 4321.5;
+		found = index.lookup(&key, rid);
+		checkPassFail(found, false)
+	}
+	File::remove(doubleIndexName);
+
+	try
+	{
+		File::remove(stringIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		char key[STRINGKEYMAXSIZE];
+		int hits = 0;
+		for (int i = 0; i < myRelationSize; i += 7) {
+			sprintf(key, "%05d string record", i);
+			RecordId rid;
+			if (index.lookup(key, rid) && recordKey(rid) == i) {
+				hits++;
+			}
+		}
+		checkPassFail(hits, (myRelationSize + 6) / 7)
+
+		RecordId rid;
+		bool found = index.lookup("00042 string recor", rid);
+		checkPassFail(found, false)
+		found = index.lookup("00042 string records", rid);
+		checkPassFail(found, false)
+		std::vector<RecordId> rids;
+		checkPassFail(index.lookupAll("00042 string record", rids), (size_t)1)
+	}
+	File::remove(stringIndexName);
+	deleteRelation();
+}
+
+/**
+  * Scan INTEGER, DOUBLE and STRING indexes on 20000 records with scanNextBatch at different batch sizes, and check
+  * that the batches return the same record ids in the same order as scanNext, including ranges whose entries with the
+  * same key spread over several leaves, and that a completed scan keeps returning empty batches
+  *
+ **/
+void test19() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 19 begins" << std::endl;
+	myCreateRelationInSpecialOrder();
+
+	const size_t batchSizes[] = { 1, 7, 1000, 100000 };
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		const int duplicateKey = 7;
+		for (int i = 0; i < 2 * INTARRAYLEAFSIZE; i++) {
+			RecordId newRid;
+			newRid.page_number = 1;
+			newRid.slot_number = i + 1;
+			newRid.padding = 0;
+			index.insertEntry(&duplicateKey, newRid);
+		}
+
+		int lowVals[] = { 25, 20, 996, 0, -5, 7, 7 };
+		Operator lowOps[] = { GT, GTE, GT, GTE, GTE, GTE, GT };
+		int highVals[] = { 40, 35, 1001, myRelationSize, -1, 7, 9 };
+		Operator highOps[] = { LT, LTE, LT, LT, LTE, LTE, LTE };
+		int sameResults = 0;
+		for (int r = 0; r < 7; r++) {
+			std::vector<RecordId> expected;
+			scanAll(&index, &lowVals[r], lowOps[r], &highVals[r], highOps[r], 0, expected);
+			for (int b = 0; b < 4; b++) {
+				std::vector<RecordId> batched;
+				scanAll(&index, &lowVals[r], lowOps[r], &highVals[r], highOps[r], batchSizes[b], batched);
+				if (batched == expected) {
+					sameResults++;
+				}
+			}
+		}
+		checkPassFail(sameResults, 28)
+
+		std::vector<RecordId> rids;
+		scanAll(&index, &lowVals[3], lowOps[3], &highVals[3], highOps[3], 1000, rids);
+		checkPassFail(rids.size(), (size_t)myRelationSize + 2 * INTARRAYLEAFSIZE)
+
+		// Batches and single entries go on where the other stopped
+		int lowVal = 100;
+		int highVal = 200;
+		RecordId batch[10];
+		RecordId scanRid;
+		index.startScan(&lowVal, GTE, &highVal, LTE);
+		checkPassFail(index.scanNextBatch(batch, 10), (size_t)10)
+		checkPassFail(recordKey(batch[9]), 109)
+		index.scanNext(scanRid);
+		checkPassFail(recordKey(scanRid), 110)
+		checkPassFail(index.scanNextBatch(batch, 10), (size_t)10)
+		checkPassFail(recordKey(batch[0]), 111)
+		index.endScan();
+	}
+	File::remove(intIndexName);
+
+	try
+	{
+		File::remove(doubleIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE);
+		double lowVal = 1000.5;
+		double highVal = 3000;
+		int sameResults = 0;
+		std::vector<RecordId> expected;
+		scanAll(&index, &lowVal, GT, &highVal, LTE, 0, expected);
+		for (int b = 0; b < 4; b++) {
+			std::vector<RecordId> batched;
+			scanAll(&index, &lowVal, GT, &highVal, LTE, batchSizes[b], batched);
+			if (batched == expected) {
+				sameResults++;
+			}
+		}
+		checkPassFail(expected.size(), (size_t)2000)
+		checkPassFail(sameResults, 4)
+	}
+	File::remove(doubleIndexName);
+
+	try
+	{
+		File::remove(stringIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		char lowVal[STRINGKEYMAXSIZE];
+		char highVal[STRINGKEYMAXSIZE];
+		sprintf(lowVal, "%05d string record", 25);
+		sprintf(highVal, "%05d string record", 4000);
+		int sameResults = 0;
+		std::vector<RecordId> expected;
+		scanAll(&index, lowVal, GT, highVal, LT, 0, expected);
+		for (int b = 0; b < 4; b++) {
+			std::vector<RecordId> batched;
+			scanAll(&index, lowVal, GT, highVal, LT, batchSizes[b], batched);
+			if (batched == expected) {
+				sameResults++;
+			}
+		}
+		checkPassFail(expected.size(), (size_t)3974)
+		checkPassFail(sameResults, 4)
+	}
+	File::remove(stringIndexName);
+	deleteRelation();
+}
+
+/**
+  * Run several scans on the same index at once through IndexCursor objects and the index's own scan, interleaving
+  * their calls, and check that each returns its own range. Check that restarting a cursor or destroying it releases
+  * its pages, that a delete ends the scans of all cursors, and that a cursor left scanning when the index is
+  * destroyed can still be destroyed
+  *
+ **/
+void test20() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 20 begins" << std::endl;
+	myCreateRelationInSpecialOrder();
+
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	IndexCursor* leftover;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		IndexCursor first(&index);
+		IndexCursor second(&index);
+		int lowVals[] = { 100, 5000, 19990 };
+		int highVals[] = { 200, 5500, 19999 };
+		first.startScan(&lowVals[0], GTE, &highVals[0], LT);
+		second.startScan(&lowVals[1], GT, &highVals[1], LTE);
+		index.startScan(&lowVals[2], GTE, &highVals[2], LTE);
+
+		// Take one entry from each scan in turn, until all of them are completed
+		int nextKeys[] = { 100, 5001, 19990 };
+		int endKeys[] = { 200, 5501, 20000 };
+		int inOrder = 0;
+		int completed = 0;
+		while (completed < 3) {
+			completed = 0;
+			for (int s = 0; s < 3; s++) {
+				if (nextKeys[s] == endKeys[s]) {
+					completed++;
+					continue;
+				}
+				RecordId rid;
+				if (s == 0) {
+					first.scanNext(rid);
+				} else if (s == 1) {
+					second.scanNext(rid);
+				} else {
+					index.scanNext(rid);
+				}
+				if (recordKey(rid) == nextKeys[s]++) {
+					inOrder++;
+				}
+			}
+		}
+		checkPassFail(inOrder, 100 + 500 + 10)
+
+		bool thrown = false;
+		try
+		{
+			RecordId rid;
+			second.scanNext(rid);
+		}
+		catch(const IndexScanCompletedException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		RecordId batch[600];
+		checkPassFail(first.scanNextBatch(batch, 600), (size_t)0)
+
+		// Restarting a scan releases the pages of the one before, ending one cursor leaves the others running
+		first.startScan(&lowVals[1], GTE, &highVals[1], LT);
+		second.endScan();
+		checkPassFail(first.scanNextBatch(batch, 600), (size_t)500)
+		checkPassFail(recordKey(batch[499]), 5499)
+		checkPassFail(second.isScanning(), false)
+		index.endScan();
+		first.endScan();
+		{
+			IndexCursor scoped(&index);
+			scoped.startScan(&lowVals[0], GTE, &highVals[1], LT);
+			RecordId rid;
+			scoped.scanNext(rid);
+		}
+		bufMgr->flushFile(index.getIndexFile());
+
+		// A delete ends all scans, as it may merge away the leaves they are on
+		first.startScan(&lowVals[0], GTE, &highVals[0], LT);
+		second.startScan(&lowVals[1], GTE, &highVals[1], LT);
+		int deletedKey = 150;
+		RecordId deletedRid;
+		index.lookup(&deletedKey, deletedRid);
+		index.deleteEntry(&deletedKey, deletedRid);
+		bool ended = !first.isScanning() && !second.isScanning();
+		checkPassFail(ended, true)
+		thrown = false;
+		try
+		{
+			RecordId rid;
+			first.scanNext(rid);
+		}
+		catch(const ScanNotInitializedException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		checkPassFail(intScan(&index,100,GTE,200,LT), 99)
+
+		leftover = new IndexCursor(&index);
+		leftover->startScan(&lowVals[0], GTE, &highVals[0], LT);
+	}
+	delete leftover;
+	File::remove(intIndexName);
+	deleteRelation();
+}
+
+/**
+  * Scan indexes bulk loaded at a fill factor of 0.05, whose leaves are many more than the frames of the buffer pool,
+  * from end to end, with the index's own scan and with several cursors at once. Only the leaf a scan is on stays
+  * pinned, and none once the scan is completed
+  *
+ **/
+void test21() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 21 begins" << std::endl;
+	myCreateRelationInSpecialOrder();
+
+	IndexOptions options;
+	options.fillFactor = 0.05;
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(intScan(&index,0,GTE,myRelationSize,LT), myRelationSize)
+		checkPassFail(intScan(&index,25,GT,19000,LTE), 18975)
+
+		// Three cursors take batches in turn, each over all keys
+		IndexCursor* cursors[3];
+		int lowVal = 0;
+		int highVal = myRelationSize;
+		for (int c = 0; c < 3; c++) {
+			cursors[c] = new IndexCursor(&index);
+			cursors[c]->startScan(&lowVal, GTE, &highVal, LT);
+		}
+		int nextKeys[] = { 0, 0, 0 };
+		int inOrder = 0;
+		bool scanning = true;
+		while (scanning) {
+			scanning = false;
+			for (int c = 0; c < 3; c++) {
+				RecordId batch[50];
+				size_t count = cursors[c]->scanNextBatch(batch, 50);
+				for (size_t i = 0; i < count; i++) {
+					if (recordKey(batch[i]) == nextKeys[c]++) {
+						inOrder++;
+					}
+				}
+				scanning = scanning || count > 0;
+			}
+		}
+		checkPassFail(inOrder, 3 * myRelationSize)
+
+		// Completed scans hold no page until they are ended, a scan half way holds its leaf
+		bufMgr->flushFile(index.getIndexFile());
+		cursors[0]->startScan(&lowVal, GTE, &highVal, LT);
+		RecordId batch[10000];
+		cursors[0]->scanNextBatch(batch, 10000);
+		bool pinned = false;
+		try
+		{
+			bufMgr->flushFile(index.getIndexFile());
+		}
+		catch(const PagePinnedException &e)
+		{
+			pinned = true;
+		}
+		checkPassFail(pinned, true)
+		for (int c = 0; c < 3; c++) {
+			delete cursors[c];
+		}
+		bufMgr->flushFile(index.getIndexFile());
+	}
+	File::remove(intIndexName);
+
+	try
+	{
+		File::remove(stringIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+		checkPassFail(stringScan(&index,0,GTE,19999,LTE), myRelationSize)
+		checkPassFail(stringScan(&index,1000,GT,18000,LT), 16999)
+	}
+	File::remove(stringIndexName);
+	deleteRelation();
+}
+
+/**
+  * Scan indexes bulk loaded at a fill factor of 0.05 with leaves read ahead, starting with none of their pages in the
+  * buffer pool. Every leaf read ahead of a scan which runs to its end is used by it, also when the high bound stops
+  * the scan half way through the index, while a scan ended early leaves some unused. Splits under a scan stop its
+  * read ahead without changing what it returns
+  *
+ **/
+void test22() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 22 begins" << std::endl;
+	myCreateRelationInSpecialOrder();
+
+	IndexOptions options;
+	options.fillFactor = 0.05;
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		bool prefetched;
+		index.setReadAhead(8);
+		bufMgr->flushFile(index.getIndexFile());
+		bufMgr->clearBufStats();
+		checkPassFail(intScan(&index,0,GTE,myRelationSize,LT), myRelationSize)
+		prefetched = bufMgr->getBufStats().prefetches > 0;
+		checkPassFail(prefetched, true)
+		checkPassFail(bufMgr->getBufStats().prefetchHits, bufMgr->getBufStats().prefetches)
+
+		// The high bound stops the read ahead at the last leaf the scan gets to
+		IndexCursor cursor(&index);
+		cursor.setReadAhead(16);
+		int lowVal = 1000;
+		int highVal = 5000;
+		bufMgr->flushFile(index.getIndexFile());
+		bufMgr->clearBufStats();
+		cursor.startScan(&lowVal, GTE, &highVal, LT);
+		RecordId batch[100];
+		int nextKey = lowVal;
+		int inOrder = 0;
+		size_t count;
+		while ((count = cursor.scanNextBatch(batch, 100)) > 0) {
+			for (size_t i = 0; i < count; i++) {
+				if (recordKey(batch[i]) == nextKey++) {
+					inOrder++;
+				}
+			}
+		}
+		checkPassFail(inOrder, highVal - lowVal)
+		prefetched = bufMgr->getBufStats().prefetches > 0;
+		checkPassFail(prefetched, true)
+		checkPassFail(bufMgr->getBufStats().prefetchHits, bufMgr->getBufStats().prefetches)
+		cursor.endScan();
+
+		// A scan ended early leaves leaves read ahead unused
+		lowVal = 0;
+		highVal = myRelationSize;
+		bufMgr->flushFile(index.getIndexFile());
+		bufMgr->clearBufStats();
+		cursor.startScan(&lowVal, GTE, &highVal, LT);
+		cursor.scanNextBatch(batch, 100);
+		cursor.endScan();
+		bool unused = bufMgr->getBufStats().prefetchHits < bufMgr->getBufStats().prefetches;
+		checkPassFail(unused, true)
+
+		// Duplicates inserted ahead of the scan split a leaf, the scan still returns them all in order
+		cursor.startScan(&lowVal, GTE, &highVal, LT);
+		int taken = 0;
+		int lastKey = -1;
+		inOrder = 0;
+		for (int i = 0; i < 50; i++) {
+			count = cursor.scanNextBatch(batch, 100);
+			for (size_t j = 0; j < count; j++) {
+				int key = recordKey(batch[j]);
+				inOrder += (key >= lastKey);
+				lastKey = key;
+			}
+			taken += (int)count;
+		}
+		int duplicateKey = 19000;
+		RecordId duplicateRid;
+		index.lookup(&duplicateKey, duplicateRid);
+		int startHeight = indexHeight(&index);
+		for (int i = 0; i < 1000; i++) {
+			index.insertEntry(&duplicateKey, duplicateRid);
+		}
+		while ((count = cursor.scanNextBatch(batch, 100)) > 0) {
+			for (size_t j = 0; j < count; j++) {
+				int key = recordKey(batch[j]);
+				inOrder += (key >= lastKey);
+				lastKey = key;
+			}
+			taken += (int)count;
+		}
+		checkPassFail(taken, myRelationSize + 1000)
+		checkPassFail(inOrder, myRelationSize + 1000)
+		checkPassFail(indexHeight(&index), startHeight)
+		bool used = bufMgr->getBufStats().prefetchHits <= bufMgr->getBufStats().prefetches;
+		checkPassFail(used, true)
+	}
+	File::remove(intIndexName);
+
+	try
+	{
+		File::remove(stringIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+		bool prefetched;
+		index.setReadAhead(8);
+		bufMgr->flushFile(index.getIndexFile());
+		bufMgr->clearBufStats();
+		checkPassFail(stringScan(&index,1000,GT,18000,LT), 16999)
+		prefetched = bufMgr->getBufStats().prefetches > 0;
+		checkPassFail(prefetched, true)
+		checkPassFail(bufMgr->getBufStats().prefetchHits, bufMgr->getBufStats().prefetches)
+	}
+	File::remove(stringIndexName);
+	deleteRelation();
+}
+
+/**
+  * Descending scans return the entries of ascending scans in reverse, for all bounds of an int index and a string
+  * index built by inserts, with scanNext and batches and with leaves read ahead. A top-N query stops after reading
+  * a single leaf. The left sibling links stay the reverse of the right sibling links through splits, duplicates
+  * spanning leaves and the merges of deletes
+  *
+ **/
+void test23() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 23 begins" << std::endl;
+	myCreateRelationInSpecialOrder();
+
+	IndexOptions options;
+	options.bulkLoad = false;
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		int leaves = checkLeafLinks(&index, 0);
+		bool split = leaves > 1;
+		checkPassFail(split, true)
+		int bounds[][2] = { {0, myRelationSize}, {25, 19000}, {5000, 5000}, {-10, 3}, {19990, 30000}, {681, 1362} };
+		for (int b = 0; b < 6; b++) {
+			checkDescendingScans(&index, &bounds[b][0], &bounds[b][1]);
+		}
+
+		// A top-N query reads the leaf with the largest keys, and ends before moving to its left sibling
+		int height = indexHeight(&index);
+		int lowVal = 0;
+		int highVal = myRelationSize;
+		RecordId batch[10];
+		bufMgr->flushFile(index.getIndexFile());
+		bufMgr->clearBufStats();
+		index.startScan(&lowVal, GTE, &highVal, LT, DESCENDING);
+		size_t count = index.scanNextBatch(batch, 10);
+		index.endScan();
+		bool fewReads = bufMgr->getBufStats().diskreads <= height + 1;
+		checkPassFail(fewReads, true)
+		int inOrder = 0;
+		for (size_t i = 0; i < count; i++) {
+			inOrder += (recordKey(batch[i]) == myRelationSize - 1 - (int)i);
+		}
+		checkPassFail(inOrder, 10)
+
+		// Descending scans read leaves ahead from right to left, and use every one of them
+		index.setReadAhead(8);
+		bufMgr->flushFile(index.getIndexFile());
+		bufMgr->clearBufStats();
+		lowVal = 3000;
+		highVal = 15000;
+		checkDescendingScans(&index, &lowVal, &highVal);
+		bool prefetched = bufMgr->getBufStats().prefetches > 0;
+		checkPassFail(prefetched, true)
+		checkPassFail(bufMgr->getBufStats().prefetchHits, bufMgr->getBufStats().prefetches)
+		index.setReadAhead(0);
+
+		// Duplicates spanning several leaves are returned from the last one inserted
+		int duplicateKey = 5000;
+		RecordId duplicateRid;
+		index.lookup(&duplicateKey, duplicateRid);
+		for (int i = 0; i < 2000; i++) {
+			index.insertEntry(&duplicateKey, duplicateRid);
+		}
+		leaves = checkLeafLinks(&index, 0);
+		lowVal = 4990;
+		highVal = 5010;
+		std::vector<RecordId> rids;
+		scanAll(&index, &lowVal, GTE, &highVal, LTE, 0, rids, DESCENDING);
+		checkPassFail((int)rids.size(), 2021)
+		checkDescendingScans(&index, &duplicateKey, &duplicateKey);
+		checkDescendingScans(&index, &lowVal, &highVal);
+
+		// Deletes merge leaves, the links stay consistent
+		for (int i = 0; i < myRelationSize; i += 2) {
+			RecordId rid;
+			if (index.lookup(&i, rid)) {
+				index.deleteEntry(&i, rid);
+			}
+		}
+		bool merged = checkLeafLinks(&index, 1) < leaves;
+		checkPassFail(merged, true)
+		lowVal = 0;
+		highVal = myRelationSize;
+		checkDescendingScans(&index, &lowVal, &highVal);
+		lowVal = 4999;
+		highVal = 5001;
+		rids.clear();
+		scanAll(&index, &lowVal, GT, &highVal, LT, 0, rids, DESCENDING);
+		checkPassFail((int)rids.size(), 2000)
+	}
+	File::remove(intIndexName);
+
+	try
+	{
+		File::remove(stringIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+		int bounds[][2] = { {0, 19999}, {1000, 18000}, {7777, 7777}, {19990, 19999} };
+		for (int b = 0; b < 4; b++) {
+			char lowValStr[100];
+			char highValStr[100];
+			sprintf(lowValStr, "%05d string record", bounds[b][0]);
+			sprintf(highValStr, "%05d string record", bounds[b][1]);
+			checkDescendingScans(&index, lowValStr, highValStr);
+		}
+
+		// The top 5 keys come first
+		char lowValStr[] = "";
+		char highValStr[] = "~";
+		index.startScan(lowValStr, GTE, highValStr, LTE, DESCENDING);
+		int inOrder = 0;
+		for (int i = 0; i < 5; i++) {
+			RecordId rid;
+			index.scanNext(rid);
+			inOrder += (recordKey(rid) == myRelationSize - 1 - i);
+		}
+		index.endScan();
+		checkPassFail(inOrder, 5)
+	}
+	File::remove(stringIndexName);
+	deleteRelation();
+}
+
+/**
+  * Scans without a low bound, a high bound or both, over an int index holding INT_MIN and INT_MAX as well. A scan
+  * without a low bound reads no page but the leftmost leaf to start, also after the index is opened again, and
+  * bounds at INT_MIN and INT_MAX do not overflow. Descending scans start at the rightmost leaf without a high bound
+  *
+ **/
+void test24() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 24 begins" << std::endl;
+	myCreateRelationInSpecialOrder();
+
+	IndexOptions options;
+	options.bulkLoad = false;
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	RecordId minRid;
+	RecordId maxRid;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		int minKey = INT_MIN;
+		int maxKey = INT_MAX;
+		int key = 1;
+		index.lookup(&key, minRid);
+		key = 2;
+		index.lookup(&key, maxRid);
+		index.insertEntry(&minKey, minRid);
+		index.insertEntry(&maxKey, maxRid);
+
+		// The whole index in key order, from INT_MIN to INT_MAX
+		std::vector<RecordId> rids;
+		scanAll(&index, NULL, GTE, NULL, LTE, 0, rids);
+		checkPassFail((int)rids.size(), myRelationSize + 2)
+		int inOrder = (rids.front() == minRid) + (rids.back() == maxRid);
+		for (int i = 1; i + 1 < (int)rids.size(); i++) {
+			inOrder += (recordKey(rids[i]) == i - 1);
+		}
+		checkPassFail(inOrder, myRelationSize + 2)
+		checkDescendingScans(&index, NULL, NULL);
+
+		// Bounds at the ends of the key type
+		int belowMax = INT_MAX - 1;
+		int aboveMin = INT_MIN + 1;
+		rids.clear();
+		scanAll(&index, &belowMax, GT, NULL, LTE, 0, rids);
+		bool onlyMax = rids.size() == 1 && rids[0] == maxRid;
+		checkPassFail(onlyMax, true)
+		rids.clear();
+		scanAll(&index, NULL, GTE, &aboveMin, LT, 0, rids);
+		bool onlyMin = rids.size() == 1 && rids[0] == minRid;
+		checkPassFail(onlyMin, true)
+		rids.clear();
+		scanAll(&index, &maxKey, GT, NULL, LTE, 0, rids);
+		checkPassFail((int)rids.size(), 0)
+		rids.clear();
+		scanAll(&index, NULL, GTE, &minKey, LT, 7, rids, DESCENDING);
+		checkPassFail((int)rids.size(), 0)
+		rids.clear();
+		scanAll(&index, &minKey, GT, &maxKey, LT, 100, rids);
+		checkPassFail((int)rids.size(), myRelationSize)
+		int lowVal = 5000;
+		checkDescendingScans(&index, &lowVal, NULL);
+		checkDescendingScans(&index, NULL, &lowVal);
+
+		// The operator of a missing bound is not used
+		rids.clear();
+		scanAll(&index, NULL, LT, &lowVal, LTE, 0, rids);
+		checkPassFail((int)rids.size(), 5002)
+
+		// Leaves are read ahead of a full scan from the path down the left edge
+		index.setReadAhead(8);
+		bufMgr->flushFile(index.getIndexFile());
+		bufMgr->clearBufStats();
+		rids.clear();
+		scanAll(&index, NULL, GTE, NULL, LTE, 100, rids);
+		checkPassFail((int)rids.size(), myRelationSize + 2)
+		bool prefetched = bufMgr->getBufStats().prefetches > 0;
+		checkPassFail(prefetched, true)
+		checkPassFail(bufMgr->getBufStats().prefetchHits, bufMgr->getBufStats().prefetches)
+	}
+	{
+		// The leftmost leaf is read back from the meta page
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		bufMgr->clearBufStats();
+		index.startScan(NULL, GTE, NULL, LTE);
+		checkPassFail(bufMgr->getBufStats().accesses, 1)
+		RecordId rid;
+		index.scanNext(rid);
+		bool first = rid == minRid;
+		checkPassFail(first, true)
+		index.endScan();
+		std::vector<RecordId> rids;
+		scanAll(&index, NULL, GTE, NULL, LTE, 0, rids, DESCENDING);
+		bool last = rids.size() == (size_t)myRelationSize + 2 && rids[0] == maxRid;
+		checkPassFail(last, true)
+	}
+	File::remove(intIndexName);
+
+	try
+	{
+		File::remove(stringIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		std::vector<RecordId> rids;
+		scanAll(&index, NULL, GTE, NULL, LTE, 0, rids);
+		int inOrder = 0;
+		for (int i = 0; i < (int)rids.size(); i++) {
+			inOrder += (recordKey(rids[i]) == i);
+		}
+		checkPassFail(inOrder, myRelationSize)
+		char lowValStr[100];
+		sprintf(lowValStr, "%05d string record", 15000);
+		checkDescendingScans(&index, NULL, NULL);
+		checkDescendingScans(&index, lowValStr, NULL);
+		checkDescendingScans(&index, NULL, lowValStr);
+		rids.clear();
+		scanAll(&index, lowValStr, GT, NULL, LTE, 0, rids);
+		checkPassFail((int)rids.size(), myRelationSize - 15001)
+	}
+	File::remove(stringIndexName);
+	deleteRelation();
+}
+
+/**
+  * Posting list leaves over a relation with few distinct keys, built by inserts and by a bulk load. Leaves turn
+  * into posting lists, the hot key keeps its record ids in overflow pages, and lookups and scans in both orders
+  * return every entry, the record ids of a key in order. Deletes down to one entry per key turn the leaves back
+  * into entry lists and merge them
+  *
+ **/
+void test25() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 25 begins" << std::endl;
+	createRelationLowCardinality();
+
+	std::vector<RecordId> insertedRids;
+	for (int bulk = 0; bulk < 2; bulk++) {
+		IndexOptions options;
+		options.bulkLoad = (bulk == 1);
+		try
+		{
+			File::remove(intIndexName);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+
+		// A few leaves hold the 20000 entries, nearly all of them as posting lists
+		int leaves = checkLeafLinks(&index, INT_MIN);
+		bool fewLeaves = leaves < 10;
+		checkPassFail(fewLeaves, true)
+		bool postingLeaves = countPostingLeaves(&index) + 1 >= leaves;
+		checkPassFail(postingLeaves, true)
+		checkPassFail(keyHasOverflowPages(&index, 1000), true)
+		checkPassFail(keyHasOverflowPages(&index, 7), false)
+
+		// Every key has its entries, in record id order
+		int found = 0;
+		int sorted = 0;
+		for (int key = 0; key <= 1000; key++) {
+			std::vector<RecordId> rids;
+			found += (int)index.lookupAll(&key, rids);
+			sorted += std::is_sorted(rids.begin(), rids.end(), ridLess);
+			RecordId rid;
+			if (index.lookup(&key, rid) && rid != rids[0]) {
+				std::cout << "lookup of key " << key << " does not return its first record id" << std::endl;
+				exit(1);
+			}
+		}
+		checkPassFail(found, myRelationSize)
+		checkPassFail(sorted, 1001)
+		int key = 1000;
+		std::vector<RecordId> rids;
+		checkPassFail((int)index.lookupAll(&key, rids), myRelationSize / 5)
+		key = 10;
+		checkPassFail((int)index.lookupAll(&key, rids), 0)
+
+		// Scans step through the postings like through entries, and both builds hold the same entries in the same order
+		rids.clear();
+		scanAll(&index, NULL, GTE, NULL, LTE, 0, rids);
+		checkPassFail((int)rids.size(), myRelationSize)
+		int inOrder = 0;
+		for (int i = 1; i < (int)rids.size(); i++) {
+			int previous = recordKey(rids[i - 1]);
+			int current = recordKey(rids[i]);
+			inOrder += previous < current || (previous == current && ridLess(rids[i - 1], rids[i]));
+		}
+		checkPassFail(inOrder, myRelationSize - 1)
+		if (bulk == 0) {
+			insertedRids = rids;
+		}
+		bool sameEntries = rids == insertedRids;
+		checkPassFail(sameEntries, true)
+		int lowVal = 7;
+		int highVal = 1000;
+		rids.clear();
+		scanAll(&index, &lowVal, GT, &highVal, LT, 7, rids);
+		checkPassFail((int)rids.size(), 34 * 400)
+		rids.clear();
+		scanAll(&index, &lowVal, GTE, &highVal, LTE, 0, rids, DESCENDING);
+		checkPassFail((int)rids.size(), 35 * 400 + myRelationSize / 5)
+		int bounds[][2] = { {0, 1000}, {3, 7}, {1000, 1000}, {7, 1000}, {12, 48} };
+		for (int b = 0; b < 5; b++) {
+			checkDescendingScans(&index, &bounds[b][0], &bounds[b][1]);
+		}
+		checkDescendingScans(&index, NULL, NULL);
+
+		// The hot key takes more entries in its overflow pages, and loses them again
+		key = 3;
+		std::vector<RecordId> moreRids;
+		index.lookupAll(&key, moreRids);
+		key = 1000;
+		for (size_t i = 0; i < moreRids.size(); i++) {
+			index.insertEntry(&key, moreRids[i]);
+		}
+		rids.clear();
+		index.lookupAll(&key, rids);
+		checkPassFail((int)rids.size(), myRelationSize / 5 + 400)
+		checkPassFail(std::is_sorted(rids.begin(), rids.end(), ridLess), true)
+		checkDescendingScans(&index, &key, &key);
+		for (size_t i = 0; i < moreRids.size(); i++) {
+			index.deleteEntry(&key, moreRids[i]);
+		}
+		rids.clear();
+		checkPassFail((int)index.lookupAll(&key, rids), myRelationSize / 5)
+
+		// An entry of another key is not found under this one
+		bool notFound = false;
+		try
+		{
+			index.deleteEntry(&key, moreRids[0]);
+		}
+		catch(const NoSuchKeyFoundException &e)
+		{
+			notFound = true;
+		}
+		checkPassFail(notFound, true)
+
+		// Deletes down to one entry per key turn the leaves back into entry lists, which merge into one leaf
+		for (key = 0; key <= 1000; key++) {
+			rids.clear();
+			index.lookupAll(&key, rids);
+			for (size_t i = (key == 1000) ? 0 : 1; i < rids.size(); i++) {
+				index.deleteEntry(&key, rids[i]);
+			}
+		}
+		checkPassFail(checkLeafLinks(&index, INT_MIN), 1)
+		checkPassFail(countPostingLeaves(&index), 0)
+		rids.clear();
+		scanAll(&index, NULL, GTE, NULL, LTE, 0, rids);
+		checkPassFail((int)rids.size(), 40)
+		checkDescendingScans(&index, NULL, NULL);
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+}
+
+/**
+  * Split points. Inserts in ascending key order split the rightmost nodes unevenly and fill far fewer leaves than even
+  * splits, inserts in descending order keep splitting evenly unless the general split fill is lowered, and STRING
+  * indexes split their rightmost nodes by bytes the same way. Split fills outside (0, 1) are refused
+  *
+ **/
+void test26() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 26 begins" << std::endl;
+
+	// Appends leave the left nodes 90% full instead of half full
+	myCreateRelationForward();
+	int evenLeaves = checkSplitLeaves(0.5, 0.5);
+	int appendLeaves = checkSplitLeaves(0.5, 0.9);
+	bool fewerLeaves = appendLeaves * 3 < evenLeaves * 2;
+	checkPassFail(fewerLeaves, true)
+
+	long stringSizes[2];
+	double rightmostFills[] = { 0.5, 0.9 };
+	for (int f = 0; f < 2; f++) {
+		try
+		{
+			File::remove(stringIndexName);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+		{
+			IndexOptions options;
+			options.bulkLoad = false;
+			options.rightmostSplitFill = rightmostFills[f];
+			BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+			std::vector<RecordId> rids;
+			scanAll(&index, NULL, GTE, NULL, LTE, 0, rids);
+			int inOrder = 0;
+			for (int i = 0; i < (int)rids.size(); i++) {
+				inOrder += (recordKey(rids[i]) == i);
+			}
+			checkPassFail(inOrder, myRelationSize)
+			char lowValStr[100];
+			sprintf(lowValStr, "%05d string record", 12345);
+			checkDescendingScans(&index, lowValStr, NULL);
+		}
+		stringSizes[f] = fileSize(stringIndexName);
+	}
+	bool smallerFile = stringSizes[1] * 3 < stringSizes[0] * 2;
+	checkPassFail(smallerFile, true)
+	File::remove(stringIndexName);
+	deleteRelation();
+
+	// Descending inserts always go to the leftmost leaf, which splits by the general split fill
+	myCreateRelationBackward();
+	int backwardLeaves = checkSplitLeaves(0.5, 0.9);
+	checkPassFail(backwardLeaves, evenLeaves)
+	int prependLeaves = checkSplitLeaves(0.1, 0.9);
+	fewerLeaves = prependLeaves * 3 < evenLeaves * 2;
+	checkPassFail(fewerLeaves, true)
+
+	// Split fills must be within (0, 1)
+	double badFills[][2] = { {0, 0.9}, {1, 0.9}, {0.5, 0}, {0.5, 1} };
+	for (int b = 0; b < 4; b++) {
+		try
+		{
+			File::remove(intIndexName);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+		try
+		{
+			IndexOptions options;
+			options.splitFill = badFills[b][0];
+			options.rightmostSplitFill = badFills[b][1];
+			BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+			std::cout << "BadIndexInfoException is not thrown for split fills " << badFills[b][0] << " and "
+			          << badFills[b][1] << "." << std::endl;
+			exit(1);
+		}
+		catch(const BadIndexInfoException &e)
+		{
+		}
+	}
+	deleteRelation();
+}
+
+/**
+  * Covering indexes. An INTEGER index includes the d column, which holds the key, and scans in both orders, one entry
+  * or a batch at a time, return it along with the record ids. Inserts and deletes keep the included bytes beside
+  * their entries through splits and merges. An index file is only opened with the columns it was built with, and
+  * columns which cannot be included are refused
+  *
+ **/
+void test27() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 27 begins" << std::endl;
+	myCreateRelationForward();
+
+	IndexOptions options;
+	IncludedColumn column = { (int)offsetof(tuple,d), (int)sizeof(double) };
+	options.includedColumns.push_back(column);
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(index.getIncludedBytes(), (int)sizeof(double))
+
+		// Every entry returns the d of its record, in key order
+		std::vector<double> expected;
+		for (int i = 0; i < myRelationSize; i++) {
+			expected.push_back(i);
+		}
+		std::vector<double> values;
+		scanIncluded(&index, NULL, NULL, ASCENDING, 0, values);
+		bool sameValues = values == expected;
+		checkPassFail(sameValues, true)
+		scanIncluded(&index, NULL, NULL, ASCENDING, 1000, values);
+		sameValues = values == expected;
+		checkPassFail(sameValues, true)
+		std::reverse(expected.begin(), expected.end());
+		scanIncluded(&index, NULL, NULL, DESCENDING, 7, values);
+		sameValues = values == expected;
+		checkPassFail(sameValues, true)
+		int lowVal = 5000;
+		int highVal = 5999;
+		scanIncluded(&index, &lowVal, &highVal, DESCENDING, 0, values);
+		bool rangeValues = values.size() == 1000 && values.front() == 5999 && values.back() == 5000;
+		checkPassFail(rangeValues, true)
+		checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+		checkDescendingScans(&index, &lowVal, &highVal);
+		checkDescendingScans(&index, NULL, NULL);
+		int key = 1234;
+		std::vector<RecordId> rids;
+		checkPassFail((int)index.lookupAll(&key, rids), 1)
+
+		// Entries inserted after the records, behind them and in between them, carry their own included bytes
+		int leaves = checkLeafLinks(&index, 0);
+		for (int i = myRelationSize; i < myRelationSize + 2000; i++) {
+			RecordId rid;
+			rid.page_number = 1;
+			rid.slot_number = (std::uint16_t)(i - myRelationSize + 1);
+			rid.padding = 0;
+			double d = i;
+			index.insertEntry(&i, rid, &d);
+		}
+		for (int i = 0; i < 2000; i++) {
+			key = i * 10;
+			RecordId rid;
+			rid.page_number = 2;
+			rid.slot_number = (std::uint16_t)(i + 1);
+			rid.padding = 0;
+			double d = key + 0.5;
+			index.insertEntry(&key, rid, &d);
+		}
+		scanIncluded(&index, NULL, NULL, ASCENDING, 100, values);
+		checkPassFail((int)values.size(), myRelationSize + 4000)
+		int inOrder = 0;
+		int halves = 0;
+		for (int i = 0; i < (int)values.size(); i++) {
+			inOrder += (i == 0 || (int)values[i - 1] <= (int)values[i]);
+			halves += (values[i] != (int)values[i]);
+		}
+		checkPassFail(inOrder, myRelationSize + 4000)
+		checkPassFail(halves, 2000)
+		std::vector<double> descending;
+		scanIncluded(&index, NULL, NULL, DESCENDING, 0, descending);
+		std::reverse(descending.begin(), descending.end());
+		sameValues = values == descending;
+		checkPassFail(sameValues, true)
+		bool moreLeaves = checkLeafLinks(&index, 0) > leaves;
+		checkPassFail(moreLeaves, true)
+
+		// Deletes take the entries and their included bytes out, and merge the leaves
+		for (int i = 0; i < 2000; i++) {
+			key = i * 10;
+			RecordId rid;
+			rid.page_number = 2;
+			rid.slot_number = (std::uint16_t)(i + 1);
+			rid.padding = 0;
+			index.deleteEntry(&key, rid);
+		}
+		for (key = 0; key < 15000; key++) {
+			RecordId rid;
+			index.lookup(&key, rid);
+			index.deleteEntry(&key, rid);
+		}
+		expected.clear();
+		for (int i = 15000; i < myRelationSize + 2000; i++) {
+			expected.push_back(i);
+		}
+		scanIncluded(&index, NULL, NULL, ASCENDING, 0, values);
+		sameValues = values == expected;
+		checkPassFail(sameValues, true)
+		bool fewerLeaves = checkLeafLinks(&index, 0) < leaves;
+		checkPassFail(fewerLeaves, true)
+
+		// An entry of a covering index needs its included bytes
+		bool refused = false;
+		try
+		{
+			index.insertEntry(&key, rids[0]);
+		}
+		catch(const BadIndexInfoException &e)
+		{
+			refused = true;
+		}
+		checkPassFail(refused, true)
+	}
+	{
+		// The index file is opened again with its included columns
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		std::vector<double> values;
+		int lowVal = myRelationSize;
+		scanIncluded(&index, &lowVal, NULL, ASCENDING, 0, values);
+		bool tailValues = values.size() == 2000 && values.front() == myRelationSize;
+		checkPassFail(tailValues, true)
+	}
+
+	// Opening the index file without the included columns, or including other columns, is refused
+	IndexOptions otherOptions[3];
+	IncludedColumn otherColumn = { (int)offsetof(tuple,s), 8 };
+	otherOptions[1].includedColumns.push_back(otherColumn);
+	otherOptions[2].includedColumns.push_back(column);
+	otherOptions[2].includedColumns.push_back(otherColumn);
+	for (int o = 0; o < 3; o++) {
+		bool refused = false;
+		try
+		{
+			BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, otherOptions[o]);
+		}
+		catch(const BadIndexInfoException &e)
+		{
+			refused = true;
+		}
+		checkPassFail(refused, true)
+	}
+	File::remove(intIndexName);
+
+	// STRING keys, too many included bytes and empty columns cannot be included
+	IndexOptions badOptions[3];
+	badOptions[0].includedColumns.push_back(column);
+	IncludedColumn wideColumn = { 0, MAXINCLUDEDBYTES + 1 };
+	badOptions[1].includedColumns.push_back(wideColumn);
+	IncludedColumn emptyColumn = { (int)offsetof(tuple,d), 0 };
+	badOptions[2].includedColumns.push_back(emptyColumn);
+	Datatype badTypes[] = { STRING, INTEGER, INTEGER };
+	int badOffsets[] = { (int)offsetof(tuple,s), (int)offsetof(tuple,i), (int)offsetof(tuple,i) };
+	for (int b = 0; b < 3; b++) {
+		std::string indexName = (badTypes[b] == STRING) ? stringIndexName : intIndexName;
+		try
+		{
+			File::remove(indexName);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+		bool refused = false;
+		try
+		{
+			BTreeIndex index(relationName, indexName, bufMgr, badOffsets[b], badTypes[b], badOptions[b]);
+		}
+		catch(const BadIndexInfoException &e)
+		{
+			refused = true;
+		}
+		checkPassFail(refused, true)
+	}
+	deleteRelation();
+}
+
+void test28() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 28 begins" << std::endl;
+
+	// Encoded keys compare like their columns, one after the other, and hold no '\0'
+	double doubles[] = { -1e300, -2.5, -0.0, 0.0, 1e-300, 2.5, 1e300 };
+	int ordered = 0;
+	for (int a = 0; a < 7; a++) {
+		for (int b = 0; b < 7; b++) {
+			CompositeKey keyA, keyB;
+			keyA.add(doubles[a]).add(INT_MIN + a).add("x");
+			keyB.add(doubles[b]).add(INT_MIN + a).add("xy");
+			int c = strcmp(keyA.data(), keyB.data());
+			bool same = (doubles[a] < doubles[b]) ? c < 0 : (doubles[a] > doubles[b]) ? c > 0 : c < 0;
+			ordered += same && keyA.length() == (int)strlen(keyA.data());
+		}
+	}
+	checkPassFail(ordered, 49)
+	std::int64_t int64s[] = { LLONG_MIN, -1, 0, 1, LLONG_MAX };
+	ordered = 0;
+	for (int a = 0; a < 5; a++) {
+		for (int b = 0; b < 5; b++) {
+			CompositeKey keyA, keyB;
+			keyA.add(-1).add(int64s[a]);
+			keyB.add(-1).add(int64s[b]);
+			int c = strcmp(keyA.data(), keyB.data());
+			ordered += (a < b) ? c < 0 : (a > b) ? c > 0 : c == 0;
+		}
+	}
+	checkPassFail(ordered, 25)
+
+	// Records of 8 tenants, whose timestamps are 100 apart within a tenant
+	createRelationTenants();
+	IndexOptions options;
+	KeyColumn tenantColumn = { (int)offsetof(wideTuple,i), INTEGER };
+	KeyColumn timeColumn = { (int)offsetof(wideTuple,l), INT64 };
+	options.keyColumns.push_back(tenantColumn);
+	options.keyColumns.push_back(timeColumn);
+	const int perTenant = relationSize / 8;
+	std::string compositeIndexName;
+	for (int b = 0; b < 2; b++) {
+		options.bulkLoad = (b == 0);
+		try
+		{
+			File::remove(relationName + ".0.8");
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+		BTreeIndex index(relationName, compositeIndexName, bufMgr, offsetof(wideTuple,i), STRING, options);
+
+		// A prefix of the tenant alone bounds all timestamps of the tenants
+		CompositeKey tenant;
+		tenant.add(-2);
+		checkPassFail(checkTenantScan(&index, &tenant, GTE, &tenant, LTE, ASCENDING), perTenant)
+		checkPassFail(checkTenantScan(&index, &tenant, GTE, &tenant, LTE, DESCENDING), perTenant)
+		checkPassFail(checkTenantScan(&index, &tenant, GT, NULL, LTE, ASCENDING), 5 * perTenant)
+		checkPassFail(checkTenantScan(&index, NULL, GTE, &tenant, LT, DESCENDING), 2 * perTenant)
+		checkPassFail(checkTenantScan(&index, NULL, GTE, &tenant, LTE, ASCENDING), 3 * perTenant)
+		checkPassFail(checkTenantScan(&index, &tenant, GT, &tenant, LTE, ASCENDING), 0)
+
+		// The timestamps of one tenant within a window
+		CompositeKey from, to;
+		from.add(-2).add((std::int64_t)-1000);
+		to.add(-2).add((std::int64_t)1000);
+		checkPassFail(checkTenantScan(&index, &from, GTE, &to, LTE, ASCENDING), 21)
+		checkPassFail(checkTenantScan(&index, &from, GT, &to, LT, DESCENDING), 19)
+		CompositeKey lastTenant;
+		lastTenant.add(3);
+		checkPassFail(checkTenantScan(&index, &from, GTE, &lastTenant, LT, ASCENDING), 4 * perTenant + 335)
+
+		// Full keys are looked up, deleted and inserted like STRING keys
+		CompositeKey key;
+		key.add(-2).add((std::int64_t)0);
+		RecordId rid;
+		index.lookup(key.data(), rid);
+		WIDE_RECORD record = wideRecord(rid);
+		bool sameKey = record.i == -2 && record.l == 0;
+		checkPassFail(sameKey, true)
+		index.deleteEntry(key.data(), rid);
+		checkPassFail(checkTenantScan(&index, &from, GTE, &to, LTE, ASCENDING), 20)
+		index.insertEntry(key.data(), rid);
+		checkPassFail(checkTenantScan(&index, &from, GTE, &to, LTE, ASCENDING), 21)
+		checkPassFail(checkTenantScan(&index, &tenant, GTE, &tenant, LTE, DESCENDING), perTenant)
+	}
+	checkPassFail(compositeIndexName, relationName + ".0.8")
+
+	// The index file keeps its key columns, and key columns of other types are refused
+	{
+		BTreeIndex index(relationName, compositeIndexName, bufMgr, offsetof(wideTuple,i), STRING, options);
+		checkPassFail(checkTenantScan(&index, NULL, GTE, NULL, LTE, DESCENDING), relationSize)
+	}
+	IndexOptions otherOptions = options;
+	otherOptions.keyColumns[1].type = DOUBLE;
+	bool refused = false;
+	try
+	{
+		BTreeIndex index(relationName, compositeIndexName, bufMgr, offsetof(wideTuple,i), STRING, otherOptions);
+	}
+	catch(const BadIndexInfoException &e)
+	{
+		refused = true;
+	}
+	checkPassFail(refused, true)
+	File::remove(compositeIndexName);
+
+	// A STRING before the last column, key columns taking more than a STRING key and a key not declared STRING
+	IndexOptions badOptions[3];
+	KeyColumn nameColumn = { (int)offsetof(wideTuple,l), STRING };
+	badOptions[0].keyColumns.push_back(nameColumn);
+	badOptions[0].keyColumns.push_back(tenantColumn);
+	for (int c = 0; c < 7; c++) {
+		badOptions[1].keyColumns.push_back(timeColumn);
+	}
+	badOptions[1].keyColumns[0] = tenantColumn;
+	badOptions[2].keyColumns = options.keyColumns;
+	Datatype badTypes[] = { STRING, STRING, INTEGER };
+	int badOffsets[] = { (int)offsetof(wideTuple,l), (int)offsetof(wideTuple,i), (int)offsetof(wideTuple,i) };
+	for (int b = 0; b < 3; b++) {
+		bool refused = false;
+		try
+		{
+			std::string indexName;
+			BTreeIndex index(relationName, indexName, bufMgr, badOffsets[b], badTypes[b], badOptions[b]);
+		}
+		catch(const BadIndexInfoException &e)
+		{
+			refused = true;
+		}
+		checkPassFail(refused, true)
+	}
+	deleteRelation();
+}
+
+void test29() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 29 begins" << std::endl;
+	myCreateRelationForward();
+
+	IndexOptions options;
+	options.bloomBitsPerKey = 10;
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	int filterPages;
+	const int insertedKeys = 4 * myRelationSize;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		filterPages = index.getBloomFilterPages();
+		bool hasFilter = filterPages > 0;
+		checkPassFail(hasFilter, true)
+
+		// Every key of the index passes the filter, and most keys which are not in the index are ruled out
+		int found = 0;
+		for (int i = 0; i < myRelationSize; i++) {
+			RecordId rid;
+			found += index.lookup(&i, rid);
+		}
+		checkPassFail(found, myRelationSize)
+		checkPassFail((int)index.getBloomFilterStats().rejected, 0)
+		for (int i = myRelationSize; i < 3 * myRelationSize; i++) {
+			RecordId rid;
+			found += index.lookup(&i, rid);
+		}
+		checkPassFail(found, myRelationSize)
+		const BloomFilterStats& stats = index.getBloomFilterStats();
+		checkPassFail((int)stats.lookups, 3 * myRelationSize)
+		checkPassFail((int)(stats.rejected + stats.falsePositives), 2 * myRelationSize)
+		bool fewFalsePositives = stats.falsePositiveRate() < 0.02;
+		checkPassFail(fewFalsePositives, true)
+
+		// A scan of a single key is ruled out like a lookup, a scan of a range is not
+		size_t rejected = stats.rejected;
+		int notFound = 0;
+		for (int i = -1000; i < 0; i++) {
+			try
+			{
+				index.startScan(&i, GTE, &i, LTE);
+			}
+			catch(const NoSuchKeyFoundException &e)
+			{
+				notFound++;
+			}
+		}
+		checkPassFail(notFound, 1000)
+		bool scansRejected = stats.rejected - rejected > 950;
+		checkPassFail(scansRejected, true)
+		checkPassFail(intScan(&index, 25, GTE, 25, LTE), 1)
+		checkPassFail(intScan(&index, -25, GTE, 25, LTE), 26)
+
+		// Inserts outgrow the filter, which is built again larger, and every inserted key passes it
+		for (int i = 3 * myRelationSize; i < 3 * myRelationSize + insertedKeys; i++) {
+			RecordId rid;
+			rid.page_number = 1 + i / 1000;
+			rid.slot_number = (std::uint16_t)(1 + i % 1000);
+			rid.padding = 0;
+			index.insertEntry(&i, rid);
+		}
+		bool largerFilter = index.getBloomFilterPages() > 2 * filterPages;
+		checkPassFail(largerFilter, true)
+		filterPages = index.getBloomFilterPages();
+		found = 0;
+		for (int i = 3 * myRelationSize; i < 3 * myRelationSize + insertedKeys; i++) {
+			RecordId rid;
+			found += index.lookup(&i, rid);
+		}
+		checkPassFail(found, insertedKeys)
+	}
+	{
+		// The index file keeps its filter, without the option
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.getBloomFilterPages(), filterPages)
+		std::vector<RecordId> rids;
+		int found = 0;
+		for (int i = -2 * myRelationSize; i < 0; i++) {
+			found += (int)index.lookupAll(&i, rids);
+		}
+		checkPassFail(found, 0)
+		bool fewFalsePositives = index.getBloomFilterStats().falsePositiveRate() < 0.03;
+		checkPassFail(fewFalsePositives, true)
+		int key = 3 * myRelationSize + insertedKeys - 1;
+		checkPassFail((int)index.lookupAll(&key, rids), 1)
+	}
+	File::remove(intIndexName);
+
+	// -0.0 is the same DOUBLE key as 0.0, and STRING keys pass the filter up to their terminating '\0'
+	try
+	{
+		File::remove(doubleIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	try
+	{
+		File::remove(stringIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex doubleIndex(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE, options);
+		double zero = -0.0;
+		RecordId rid;
+		checkPassFail(doubleIndex.lookup(&zero, rid), true)
+		BTreeIndex stringIndex(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+		char key[100];
+		sprintf(key, "%05d string record", 42);
+		checkPassFail(stringIndex.lookup(key, rid), true)
+		int found = 0;
+		for (int i = myRelationSize; i < 2 * myRelationSize; i++) {
+			sprintf(key, "%05d string record", i);
+			found += stringIndex.lookup(key, rid);
+		}
+		checkPassFail(found, 0)
+		bool fewFalsePositives = stringIndex.getBloomFilterStats().falsePositiveRate() < 0.02;
+		checkPassFail(fewFalsePositives, true)
+	}
+	File::remove(doubleIndexName);
+	File::remove(stringIndexName);
+
+	// The filter holds full composite keys, a scan of a prefix does not consult it
+	deleteRelation();
+	createRelationTenants();
+	IndexOptions compositeOptions = options;
+	KeyColumn tenantColumn = { (int)offsetof(wideTuple,i), INTEGER };
+	KeyColumn timeColumn = { (int)offsetof(wideTuple,l), INT64 };
+	compositeOptions.keyColumns.push_back(tenantColumn);
+	compositeOptions.keyColumns.push_back(timeColumn);
+	std::string compositeIndexName;
+	try
+	{
+		File::remove(relationName + ".0.8");
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, compositeIndexName, bufMgr, offsetof(wideTuple,i), STRING, compositeOptions);
+		CompositeKey tenant;
+		tenant.add(1);
+		checkPassFail(checkTenantScan(&index, &tenant, GTE, &tenant, LTE, ASCENDING), relationSize / 8)
+		checkPassFail((int)index.getBloomFilterStats().lookups, 0)
+		CompositeKey key;
+		key.add(1).add((std::int64_t)-100);
+		checkPassFail(checkTenantScan(&index, &key, GTE, &key, LTE, DESCENDING), 1)
+		checkPassFail((int)index.getBloomFilterStats().lookups, 1)
+	}
+	File::remove(compositeIndexName);
+
+	// A filter takes between 0 and MAXBLOOMBITSPERKEY bits per key
+	int badBits[] = { -1, MAXBLOOMBITSPERKEY + 1 };
+	for (int b = 0; b < 2; b++) {
+		IndexOptions badOptions;
+		badOptions.bloomBitsPerKey = badBits[b];
+		bool refused = false;
+		try
+		{
+			BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(wideTuple,i), INTEGER, badOptions);
+		}
+		catch(const BadIndexInfoException &e)
+		{
+			refused = true;
+		}
+		checkPassFail(refused, true)
+	}
+	deleteRelation();
+}
+
+void test30() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 30 begins" << std::endl;
+
+	// Every unpack kernel unpacks values of every width like the scalar one
+	{
+		unsigned char packed[800 + PACKEDSLACKBYTES];
+		for (size_t b = 0; b < sizeof(packed); b++) {
+			packed[b] = (unsigned char)(b * 37 + 11);
+		}
+		std::uint32_t expected[199];
+		std::uint32_t actual[199];
+		int mismatches = 0;
+		for (int bits = 0; bits <= 32; bits++) {
+			unpackKernel(UNPACK_SCALAR)(packed, bits, 199, expected);
+			unpackKernel(UNPACK_AVX2)(packed, bits, 199, actual);
+			mismatches += memcmp(expected, actual, sizeof(expected)) != 0;
+			unpackBits(packed, bits, 199, actual);
+			mismatches += memcmp(expected, actual, sizeof(expected)) != 0;
+		}
+		checkPassFail(mismatches, 0)
+		unpackKernel(UNPACK_SCALAR)(packed, 8, 199, expected);
+		checkPassFail((int)expected[5], (int)packed[5])
+	}
+
+	myCreateRelationForward();
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	int plainLeaves;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		plainLeaves = checkLeafLinks(&index, 0);
+	}
+	File::remove(intIndexName);
+
+	// Dense keys of records read in order pack into a third fewer leaves, which scan like plain ones
+	IndexOptions options;
+	options.packedLeaves = true;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		int packedLeaves = checkLeafLinks(&index, 0);
+		checkPassFail(countLeaves(&index, PACKED_LIST), packedLeaves)
+		bool fewerLeaves = 3 * packedLeaves <= 2 * plainLeaves;
+		checkPassFail(fewerLeaves, true)
+		checkPassFail(intScan(&index,25,GT,40,LT), 14)
+		checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+		checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+		checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+		checkPassFail(intScan(&index,0,GT,1,LT), 0)
+		checkPassFail(intScan(&index,300,GT,400,LT), 99)
+		checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+
+		int low = -1;
+		int high = myRelationSize;
+		std::vector<RecordId> rids;
+		scanAll(&index, &low, GT, &high, LT, 0, rids);
+		checkPassFail((int)rids.size(), myRelationSize)
+		int misplaced = 0;
+		for (size_t k = 0; k < rids.size(); k++) {
+			misplaced += recordKey(rids[k]) != (int)k;
+		}
+		checkPassFail(misplaced, 0)
+		checkDescendingScans(&index, &low, &high);
+
+		int found = 0;
+		for (int i = 0; i < myRelationSize; i++) {
+			RecordId rid;
+			found += index.lookup(&i, rid) && recordKey(rid) == i;
+		}
+		checkPassFail(found, myRelationSize)
+	}
+	File::remove(intIndexName);
+
+	// Inserts and deletes unpack and pack the leaves again, which merge once deletes empty them
+	IndexOptions insertOptions = options;
+	insertOptions.bulkLoad = false;
+	const int kept = (myRelationSize + 2) / 3;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, insertOptions);
+		int leaves = checkLeafLinks(&index, 0);
+		checkPassFail(countLeaves(&index, PACKED_LIST), leaves)
+		for (int i = 0; i < myRelationSize; i++) {
+			if (i % 3 != 0) {
+				RecordId rid;
+				index.lookup(&i, rid);
+				index.deleteEntry(&i, rid);
+			}
+		}
+		checkPassFail(countEntries(&index, 0, myRelationSize), kept)
+		bool merged = checkLeafLinks(&index, 0) < leaves;
+		checkPassFail(merged, true)
+
+		// A record id far from the others widens the page numbers of its leaf, which splits where both halves fit
+		RecordId far;
+		far.page_number = 3000000000u;
+		far.slot_number = 7;
+		far.padding = 0;
+		for (int i = 0; i < myRelationSize; i += 3) {
+			int key = i + 1;
+			index.insertEntry(&key, far);
+		}
+		checkPassFail(countEntries(&index, 0, myRelationSize), 2 * kept)
+		checkPassFail(countLeaves(&index, PACKED_LIST), checkLeafLinks(&index, 0))
+		std::vector<RecordId> rids;
+		int key = 301;
+		checkPassFail((int)index.lookupAll(&key, rids), 1)
+		bool farRid = rids[0] == far;
+		checkPassFail(farRid, true)
+		key = 300;
+		RecordId rid;
+		bool nearRid = index.lookup(&key, rid) && recordKey(rid) == 300;
+		checkPassFail(nearRid, true)
+	}
+	{
+		// The leaves keep their format when the index is opened again without the option
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		for (int i = myRelationSize; i < myRelationSize + 5000; i++) {
+			RecordId rid;
+			rid.page_number = 1 + i / 100;
+			rid.slot_number = (std::uint16_t)(1 + i % 100);
+			rid.padding = 0;
+			index.insertEntry(&i, rid);
+		}
+		checkPassFail(countEntries(&index, myRelationSize, 2 * myRelationSize), 5000)
+		checkPassFail(countLeaves(&index, PACKED_LIST), checkLeafLinks(&index, 0))
+	}
+	File::remove(intIndexName);
+
+	// DOUBLE keys pack like their values and pass a Bloom filter built from the packed leaves
+	try
+	{
+		File::remove(doubleIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		IndexOptions doubleOptions = options;
+		doubleOptions.bloomBitsPerKey = 10;
+		BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE, doubleOptions);
+		checkPassFail(doubleScan(&index,25,GT,40,LT), 14)
+		checkPassFail(doubleScan(&index,-3,GT,3,LT), 3)
+		checkPassFail(doubleScan(&index,3000,GTE,4000,LT), 1000)
+		double zero = -0.0;
+		RecordId rid;
+		bool zeroFound = index.lookup(&zero, rid) && recordKey(rid) == 0;
+		checkPassFail(zeroFound, true)
+		int found = 0;
+		for (int i = 0; i < myRelationSize; i++) {
+			double key = i;
+			found += index.lookup(&key, rid);
+		}
+		checkPassFail(found, myRelationSize)
+		checkPassFail((int)index.getBloomFilterStats().rejected, 0)
+	}
+	File::remove(doubleIndexName);
+
+	// Repeating keys stay entries, never posting lists
+	deleteRelation();
+	createRelationLowCardinality();
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(countPostingLeaves(&index), 0)
+		checkPassFail(countLeaves(&index, PACKED_LIST), checkLeafLinks(&index, INT_MIN))
+		std::vector<RecordId> rids;
+		int key = 1000;
+		checkPassFail((int)index.lookupAll(&key, rids), myRelationSize / 5)
+		checkPassFail(countEntries(&index, 0, 49), myRelationSize - myRelationSize / 5)
+	}
+	File::remove(intIndexName);
+
+	// INT64 keys of more than 32 bits are unpacked one at a time
+	deleteRelation();
+	createRelationInt64();
+	std::string int64IndexName;
+	{
+		BTreeIndex index(relationName, int64IndexName, bufMgr, offsetof(wideTuple,l), INT64, options);
+		checkPassFail(int64Scan(&index,int64Key(0),GTE,int64Key(relationSize-1),LTE), relationSize)
+		checkPassFail(int64Scan(&index,int64Key(100),GT,int64Key(200),LT), 99)
+		checkPassFail(int64Scan(&index,int64Key(100)-1,GT,int64Key(101),LT), 1)
+		checkPassFail(int64Scan(&index,7,GTE,7,LTE), 1)
+		checkPassFail(int64Scan(&index,0,GTE,((std::int64_t)1 << 32) * 10,LTE), 10)
+	}
+	File::remove(int64IndexName);
+
+	// Only fixed size keys without included columns pack their leaves
+	bool refused = false;
+	try
+	{
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+	}
+	catch(const BadIndexInfoException &e)
+	{
+		refused = true;
+	}
+	checkPassFail(refused, true)
+	IndexOptions coveringOptions = options;
+	IncludedColumn column = { (int)offsetof(wideTuple,i), (int)sizeof(int) };
+	coveringOptions.includedColumns.push_back(column);
+	refused = false;
+	try
+	{
+		BTreeIndex index(relationName, int64IndexName, bufMgr, offsetof(wideTuple,l), INT64, coveringOptions);
+	}
+	catch(const BadIndexInfoException &e)
+	{
+		refused = true;
+	}
+	checkPassFail(refused, true)
+	deleteRelation();
+}
+
+void test31() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 31 begins" << std::endl;
+
+	myCreateRelationForward();
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	// Nodes filled to a tenth make a tree of three levels, whose two upper levels are resident, so a lookup reads
+	// only its leaf from the buffer pool
+	const int step = 7;
+	const int lookups = (myRelationSize + step - 1) / step;
+	IndexOptions options;
+	options.fillFactor = 0.1;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(indexHeight(&index), 3)
+		int accesses;
+		checkPassFail(lookupEvery(&index, step, accesses), lookups)
+		checkPassFail(index.getResidentLevels(), 2)
+		checkPassFail(accesses, lookups)
+		checkPassFail(intScan(&index,25,GT,40,LT), 14)
+		checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+	}
+	{
+		// With one resident level a lookup reads its leaf and the parent of the leaf, without any all three levels
+		IndexOptions oneLevel = options;
+		oneLevel.residentLevels = 1;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, oneLevel);
+		int accesses;
+		checkPassFail(lookupEvery(&index, step, accesses), lookups)
+		checkPassFail(index.getResidentLevels(), 1)
+		checkPassFail(index.getResidentNodes(), 1)
+		checkPassFail(accesses, 2 * lookups)
+	}
+	{
+		IndexOptions noLevel = options;
+		noLevel.residentLevels = 0;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, noLevel);
+		int accesses;
+		checkPassFail(lookupEvery(&index, step, accesses), lookups)
+		checkPassFail(index.getResidentLevels(), 0)
+		checkPassFail(accesses, 3 * lookups)
+	}
+	{
+		// Inserts to the right of all keys split the rightmost leaf, and patch the copy of its parent, so lookups
+		// still read only their leaf
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		RecordId first;
+		index.lookup(&step, first);
+		int nodes = index.getResidentNodes();
+		RecordId added;
+		added.page_number = 1;
+		added.slot_number = 1;
+		added.padding = 0;
+		for (int i = myRelationSize; i < 2 * myRelationSize; i++) {
+			index.insertEntry(&i, added);
+		}
+		checkPassFail(index.getResidentNodes(), nodes)
+		int found = 0;
+		bufMgr->clearBufStats();
+		for (int i = myRelationSize; i < 2 * myRelationSize; i += step) {
+			RecordId rid;
+			found += index.lookup(&i, rid);
+		}
+		checkPassFail(found, lookups)
+		checkPassFail(bufMgr->getBufStats().accesses, lookups)
+		checkPassFail(countEntries(&index, 0, 2 * myRelationSize), 2 * myRelationSize)
+
+		// Deletes merge leaves and the non-leaf nodes above them, and the copies follow
+		for (int i = 0; i < 2 * myRelationSize; i++) {
+			if (i % step != 0) {
+				RecordId deleted;
+				index.lookup(&i, deleted);
+				index.deleteEntry(&i, deleted);
+			}
+		}
+		int accesses;
+		checkPassFail(lookupEvery(&index, step, accesses), lookups)
+		bool shrunk = index.getResidentNodes() < nodes;
+		checkPassFail(shrunk, true)
+		checkPassFail(accesses, lookups * (indexHeight(&index) - index.getResidentLevels()))
+		checkPassFail(countEntries(&index, 0, 2 * myRelationSize), (2 * myRelationSize + step - 1) / step)
+
+		// Deleting all but one key takes the tree down to a single leaf, through root collapses
+		for (int i = 1; i < 2 * myRelationSize; i++) {
+			RecordId deleted;
+			if (index.lookup(&i, deleted)) {
+				index.deleteEntry(&i, deleted);
+			}
+		}
+		checkPassFail(countEntries(&index, 0, 2 * myRelationSize), 1)
+		checkPassFail(lookupEvery(&index, myRelationSize, accesses), 1)
+		checkPassFail(index.getResidentLevels(), indexHeight(&index) - 1)
+	}
+	File::remove(intIndexName);
+
+	// A tree grown by inserts from a single leaf gets its copies when the root splits, and patches them on every
+	// later split of a leaf
+	try
+	{
+		File::remove(doubleIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		IndexOptions insertOptions;
+		insertOptions.bulkLoad = false;
+		BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE, insertOptions);
+		checkPassFail(indexHeight(&index), 2)
+		int found = 0;
+		for (int i = 0; i < myRelationSize; i++) {
+			double key = i;
+			RecordId rid;
+			found += index.lookup(&key, rid);
+		}
+		checkPassFail(found, myRelationSize)
+		checkPassFail(index.getResidentLevels(), 1)
+		checkPassFail(doubleScan(&index,25,GT,40,LT), 14)
+		checkPassFail(doubleScan(&index,3000,GTE,4000,LT), 1000)
+	}
+	File::remove(doubleIndexName);
+
+	// STRING nodes are always read from the buffer pool
+	try
+	{
+		File::remove(stringIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		checkPassFail(stringScan(&index,25,GT,40,LT), 14)
+		checkPassFail(index.getResidentLevels(), 0)
+	}
+	File::remove(stringIndexName);
+
+	// The number of resident levels must be between 0 and MAXTREEHEIGHT
+	int refused = 0;
+	int badLevels[] = { -1, MAXTREEHEIGHT + 1 };
+	for (int b = 0; b < 2; b++) {
+		IndexOptions badOptions;
+		badOptions.residentLevels = badLevels[b];
+		try
+		{
+			BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, badOptions);
+		}
+		catch(const BadIndexInfoException &e)
+		{
+			refused++;
+		}
+	}
+	checkPassFail(refused, 2)
+	deleteRelation();
+}
+
+void test32() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 32 begins" << std::endl;
+
+	myCreateRelationForward();
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	// Writers insert keys to the right of the relation from several threads at once, splitting leaves and the
+	// non-leaf nodes above them and changing the resident copies, while readers keep finding every key of the relation
+	const int writers = 8;
+	const int perWriter = 5000;
+	const int inserted = writers * perWriter;
+	const int duplicates = (inserted + 9) / 10;
+	IndexOptions options;
+	options.fillFactor = 0.1;
+	options.concurrent = true;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(indexHeight(&index), 3)
+		checkPassFail(insertAndLookUpConcurrently(&index, writers, perWriter, 4), 0)
+		checkPassFail(countEntries(&index, -1, myRelationSize + inserted), myRelationSize + inserted + duplicates)
+		checkPassFail(index.getResidentLevels(), 2)
+		int accesses;
+		checkPassFail(lookupEvery(&index, 7, accesses), (myRelationSize + 6) / 7)
+		bool linked = checkLeafLinks(&index, -1) > 0;
+		checkPassFail(linked, true)
+	}
+	{
+		// The index file written by the concurrent inserts opens like any other
+		IndexOptions plain;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, plain);
+		checkPassFail(countEntries(&index, -1, myRelationSize + inserted), myRelationSize + inserted + duplicates)
+		std::vector<RecordId> rids;
+		int key = -1;
+		checkPassFail(index.lookupAll(&key, rids), duplicates)
+	}
+	File::remove(intIndexName);
+
+	// Built by inserts from a single packed leaf, the root splits too, and lookups read the packed leaves locked
+	{
+		IndexOptions packedOptions = options;
+		packedOptions.bulkLoad = false;
+		packedOptions.packedLeaves = true;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, packedOptions);
+		checkPassFail(indexHeight(&index), 2)
+		checkPassFail(insertAndLookUpConcurrently(&index, writers, perWriter, 4), 0)
+		checkPassFail(countEntries(&index, -1, myRelationSize + inserted), myRelationSize + inserted + duplicates)
+		checkPassFail(countLeaves(&index, ENTRY_LIST), 0)
+		int accesses;
+		checkPassFail(lookupEvery(&index, 7, accesses), (myRelationSize + 6) / 7)
+	}
+	File::remove(intIndexName);
+
+	// STRING keys and a Bloom filter are not supported by a concurrent index
+	int refused = 0;
+	try
+	{
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+	}
+	catch(const BadIndexInfoException &e)
+	{
+		refused++;
+	}
+	try
+	{
+		IndexOptions bloomOptions = options;
+		bloomOptions.bloomBitsPerKey = 10;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, bloomOptions);
+	}
+	catch(const BadIndexInfoException &e)
+	{
+		refused++;
+	}
+	checkPassFail(refused, 2)
+	deleteRelation();
+}
+
+/**
+  * Every node links to the node on its right on its level, and has as its high key the key separating the two in
+  * their parents: bulk loaded, built by inserts in any order, with packed and posting list leaves, after deletes
+  * merge and redistribute nodes, and after concurrent inserts split nodes side by side
+  *
+ **/
+void test33() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 33 begins" << std::endl;
+	myCreateRelationInSpecialOrder();
+
+	for (int variant = 0; variant < 3; variant++) {
+		try
+		{
+			File::remove(intIndexName);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+		IndexOptions options;
+		options.bulkLoad = (variant == 0);
+		options.fillFactor = 0.1;
+		options.packedLeaves = (variant == 2);
+		{
+			BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+			bool tall = indexHeight(&index) >= 2;
+			checkPassFail(tall, true)
+			checkPassFail(checkHighKeys(&index), 0)
+
+			// Deletes take away most keys, from the left and from the middle of every leaf
+			std::vector<RecordId> rids(myRelationSize);
+			for (int i = 0; i < myRelationSize; i++) {
+				if ((i % 4 != 0 || i < myRelationSize / 2) && index.lookup(&i, rids[i])) {
+					index.deleteEntry(&i, rids[i]);
+				}
+			}
+			checkPassFail(checkHighKeys(&index), 0)
+			checkPassFail(intScan(&index,0,GTE,myRelationSize,LT), myRelationSize / 8)
+
+			// And inserts split the nodes again
+			for (int i = 0; i < myRelationSize; i++) {
+				if (i % 4 != 0 || i < myRelationSize / 2) {
+					index.insertEntry(&i, rids[i]);
+				}
+			}
+			checkPassFail(checkHighKeys(&index), 0)
+			checkPassFail(intScan(&index,0,GTE,myRelationSize,LT), myRelationSize)
+		}
+		File::remove(intIndexName);
+	}
+	deleteRelation();
+
+	// Posting list leaves have high keys like any other leaf
+	createRelationLowCardinality();
+	{
+		IndexOptions options;
+		options.bulkLoad = false;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		bool postingLeaves = countPostingLeaves(&index) > 0;
+		checkPassFail(postingLeaves, true)
+		checkPassFail(checkHighKeys(&index), 0)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+
+	// Concurrent inserts split leaves and the non-leaf nodes above them at once, moving right to the parent a
+	// split one level down is added to
+	myCreateRelationForward();
+	{
+		IndexOptions options;
+		options.fillFactor = 0.1;
+		options.concurrent = true;
+		options.residentLevels = 1;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(insertAndLookUpConcurrently(&index, 16, 4000, 4), 0)
+		bool tall = indexHeight(&index) >= 3;
+		checkPassFail(tall, true)
+		checkPassFail(checkHighKeys(&index), 0)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+}
+
+/**
+  * Batches of entries go into the index like the same entries inserted one at a time: every key of the relation a
+  * second time, splitting every leaf into several at once, keys beyond it at the right end, and batches of one key.
+  * The entries of a key come in the same order as from insertEntry, and the leaves keep their links and high keys.
+  * Packed leaves, a Bloom filter and a concurrent index take batches too
+  *
+ **/
+void test34() {
+	std::cout << "--------------------" << std::endl;
+	std::cout << "My test: test 34 begins" << std::endl;
+	myCreateRelationForward();
+
+	// Every key again and keys up to twice the relation size, in a shuffled order, once by insertEntry and then in
+	// batches, and 700 more entries of one key. Then keys below and above all others, each end taking thousands
+	std::vector<int> keys;
+	for (int i = 0; i < myRelationSize * 2; i++) {
+		keys.push_back(i % (myRelationSize * 3 / 2));
+	}
+	std::vector<int> endKeys;
+	for (int i = 1; i <= 5000; i++) {
+		endKeys.push_back(-i);
+		endKeys.push_back(myRelationSize * 2 + i);
+	}
+	srand(34);
+	for (int i = (int)keys.size() - 1; i > 0; i--) {
+		std::swap(keys[i], keys[rand() % (i + 1)]);
+	}
+	for (int i = (int)endKeys.size() - 1; i > 0; i--) {
+		std::swap(endKeys[i], endKeys[rand() % (i + 1)]);
+	}
+	for (int variant = 0; variant < 3; variant++) {
+		IndexOptions options;
+		options.packedLeaves = (variant == 1);
+		options.bloomBitsPerKey = (variant == 2) ? 10 : 0;
+		std::vector<std::vector<RecordId> > expected;
+		{
+			BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+			checkPassFail(insertInBatches(&index, keys, 1), (int)keys.size())
+			checkPassFail(insertInBatches(&index, std::vector<int>(700, 5000), 1), 700)
+			lookUpAllKeys(&index, 0, myRelationSize * 3 / 2, expected);
+		}
+		File::remove(intIndexName);
+		{
+			BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+			int leaves = checkLeafLinks(&index, 0);
+			checkPassFail(insertInBatches(&index, keys, 10000), (int)keys.size())
+			bool moreLeaves = checkLeafLinks(&index, 0) > leaves;
+			checkPassFail(moreLeaves, true)
+			checkPassFail(checkHighKeys(&index), 0)
+			checkPassFail(countEntries(&index, 0, myRelationSize * 2), myRelationSize + (int)keys.size())
+
+			// An empty batch inserts nothing, and a batch of one key goes after the entries already in
+			checkPassFail(insertInBatches(&index, std::vector<int>(), 10), 0)
+			checkPassFail(insertInBatches(&index, std::vector<int>(700, 5000), 700), 700)
+			checkPassFail(checkHighKeys(&index), 0)
+			std::vector<std::vector<RecordId> > found;
+			lookUpAllKeys(&index, 0, myRelationSize * 3 / 2, found);
+			bool sameOrder = found == expected;
+			checkPassFail(sameOrder, true)
+
+			// The leftmost and the rightmost leaves split into many leaves at once
+			leaves = checkLeafLinks(&index, -myRelationSize);
+			checkPassFail(insertInBatches(&index, endKeys, endKeys.size()), (int)endKeys.size())
+			bool manyMoreLeaves = checkLeafLinks(&index, -myRelationSize) >= leaves + (options.packedLeaves ? 2 : 10);
+			checkPassFail(manyMoreLeaves, true)
+			checkPassFail(checkHighKeys(&index), 0)
+			checkPassFail(countEntries(&index, -myRelationSize, myRelationSize * 3),
+			              myRelationSize + (int)keys.size() + 700 + (int)endKeys.size())
+			if (variant == 2) {
+				int missing = myRelationSize * 3;
+				RecordId rid;
+				checkPassFail(index.lookup(&missing, rid), false)
+				bool filtered = index.getBloomFilterStats().rejected > 0;
+				checkPassFail(filtered, true)
+			}
+		}
+		File::remove(intIndexName);
+	}
+
+	// A concurrent index takes the entries of a batch one at a time
+	{
+		IndexOptions options;
+		options.concurrent = true;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(insertInBatches(&index, keys, 10000), (int)keys.size())
+		checkPassFail(countEntries(&index, 0, myRelationSize * 2), myRelationSize + (int)keys.size())
+		checkPassFail(checkHighKeys(&index), 0)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+}
+
+/**
+  * Look up every step-th key of the relation of myCreateRelationForward, count the buffer pool accesses of the
+  * lookups alone into accesses, and return the number of keys found with their record. A first lookup, which is not
+  * counted, builds the resident levels if they are not
+  *
+ **/
+int lookupEvery(BTreeIndex *index, int step, int& accesses)
+{
+	std::vector<int> keys;
+	std::vector<RecordId> rids;
+	RecordId first;
+	index->lookup(&step, first);
+	bufMgr->clearBufStats();
+	for (int i = 0; i < myRelationSize; i += step) {
+		RecordId rid;
+		if (index->lookup(&i, rid)) {
+			keys.push_back(i);
+			rids.push_back(rid);
+		}
+	}
+	accesses = bufMgr->getBufStats().accesses;
+	int found = 0;
+	for (size_t k = 0; k < keys.size(); k++) {
+		found += recordKey(rids[k]) == keys[k];
+	}
+	return found;
+}
+
+/**
+  * Record id inserted with the given key by insertAndLookUpConcurrently.
+  *
+ **/
+RecordId concurrentRid(int key)
+{
+	RecordId rid;
+	rid.page_number = key / 100 + 1;
+	rid.slot_number = key % 100 + 1;
+	rid.padding = 0;
+	return rid;
+}
+
+/**
+  * Insert the keys from myRelationSize on, perWriter of them from each of writers threads, every thread its keys in
+  * a scrambled order and every tenth key a second time under the key -1, while readers threads look up the keys of
+  * the relation of myCreateRelationForward over and over, and the entries with the key -1. Then look up every key
+  * inserted. Return the number of keys of the relation a reader missed, of lookups of the key -1 which found fewer
+  * entries than one before, and of inserted keys not found with their record id.
+  *
+ **/
+int insertAndLookUpConcurrently(BTreeIndex *index, int writers, int perWriter, int readers)
+{
+	std::atomic<int> writing(writers);
+	std::vector<int> misses(readers, 0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < writers; t++) {
+		threads.push_back(std::thread([index, t, writers, perWriter, &writing]() {
+			int duplicate = -1;
+			for (int j = 0; j < perWriter; j++) {
+				int key = myRelationSize + (j * 97) % perWriter * writers + t;
+				index->insertEntry(&key, concurrentRid(key));
+				if (key % 10 == 0) {
+					index->insertEntry(&duplicate, concurrentRid(key));
+				}
+			}
+			writing--;
+		}));
+	}
+	for (int r = 0; r < readers; r++) {
+		threads.push_back(std::thread([index, r, readers, &writing, &misses]() {
+			size_t duplicates = 0;
+			for (int i = r; writing > 0 || i < myRelationSize; i = (i + readers) % (myRelationSize + readers)) {
+				if (i >= myRelationSize) {
+					std::vector<RecordId> rids;
+					int duplicate = -1;
+					size_t found = index->lookupAll(&duplicate, rids);
+					misses[r] += found < duplicates || found != rids.size();
+					duplicates = found;
+					continue;
+				}
+				RecordId rid;
+				misses[r] += !index->lookup(&i, rid);
+			}
+		}));
+	}
+	for (size_t t = 0; t < threads.size(); t++) {
+		threads[t].join();
+	}
+
+	int missed = 0;
+	for (int r = 0; r < readers; r++) {
+		missed += misses[r];
+	}
+	for (int key = myRelationSize; key < myRelationSize + writers * perWriter; key++) {
+		RecordId rid;
+		missed += !index->lookup(&key, rid) || !(rid == concurrentRid(key));
+	}
+	return missed;
+}
+
+/**
+  * Walk an INTEGER index from its root and return the number of nodes whose right link or high key is not the one
+  * their parents give them
+  *
+ **/
+int checkHighKeys(BTreeIndex *index)
+{
+	File *file = index->getIndexFile();
+	Page* page;
+	bufMgr->readPage(file, 1, page);
+	const IndexMetaInfo* meta = reinterpret_cast<const IndexMetaInfo*>(page);
+	PageId rootNo = meta->rootPageNo;
+	bool rootIsLeaf = meta->height == 1;
+	bufMgr->unPinPage(file, 1, false);
+	return checkNodeLinks(file, rootNo, rootIsLeaf, Page::INVALID_NUMBER, 0);
+}
+
+/**
+  * checkHighKeys for the node in the given page and the nodes below it. A node other than the last child of its
+  * parent links to the next child and has the key between them as its high key, and the last child has those of its
+  * parent, linking to the first child of the node on the right of its parent. The last node of a level has no high
+  * key
+  *
+ **/
+int checkNodeLinks(File *file, PageId pageNo, bool leaf, PageId rightNo, int highKey)
+{
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	if (leaf) {
+		const LeafNodeInt* leaf_node = reinterpret_cast<const LeafNodeInt*>(page);
+		int wrong = leaf_node->rightSibPageNo != rightNo || (rightNo != Page::INVALID_NUMBER && leaf_node->highKey != highKey);
+		bufMgr->unPinPage(file, pageNo, false);
+		return wrong;
+	}
+	const NonLeafNodeInt* node = reinterpret_cast<const NonLeafNodeInt*>(page);
+	int wrong = node->rightSibPageNo != rightNo || (rightNo != Page::INVALID_NUMBER && node->highKey != highKey);
+	std::vector<int> keys(node->keyArray, node->keyArray + node->keySize);
+	std::vector<PageId> children(node->pageNoArray, node->pageNoArray + node->keySize + 1);
+	bool childrenAreLeaves = node->level == 1;
+	bufMgr->unPinPage(file, pageNo, false);
+
+	PageId nextFirstNo = Page::INVALID_NUMBER;
+	if (rightNo != Page::INVALID_NUMBER) {
+		bufMgr->readPage(file, rightNo, page);
+		nextFirstNo = reinterpret_cast<const NonLeafNodeInt*>(page)->pageNoArray[0];
+		bufMgr->unPinPage(file, rightNo, false);
+	}
+	for (size_t i = 0; i < children.size(); i++) {
+		bool last = i == keys.size();
+		wrong += checkNodeLinks(file, children[i], childrenAreLeaves, last ? nextFirstNo : children[i + 1],
+		                        last ? highKey : keys[i]);
+	}
+	return wrong;
+}
+
+/**
+  * Insert the keys in batches of the given size, in their order, with the record ids of concurrentRid. Return the
+  * number of keys found by lookup afterwards
+  *
+ **/
+int insertInBatches(BTreeIndex *index, const std::vector<int>& keys, size_t batchSize)
+{
+	std::vector<KeyRid> batch;
+	for (size_t i = 0; i < keys.size(); i += batchSize) {
+		batch.clear();
+		for (size_t j = i; j < keys.size() && j < i + batchSize; j++) {
+			KeyRid entry = { &keys[j], concurrentRid(keys[j]), NULL };
+			batch.push_back(entry);
+		}
+		index->insertBatch(batch.data(), batch.size());
+	}
+	int found = 0;
+	for (size_t i = 0; i < keys.size(); i++) {
+		RecordId rid;
+		found += index->lookup(&keys[i], rid);
+	}
+	return found;
+}
+
+/**
+  * Collect the record ids lookupAll returns for every key from lowKey to highKey, in order
+  *
+ **/
+void lookUpAllKeys(BTreeIndex *index, int lowKey, int highKey, std::vector<std::vector<RecordId> >& rids)
+{
+	rids.clear();
+	for (int key = lowKey; key <= highKey; key++) {
+		rids.push_back(std::vector<RecordId>());
+		index->lookupAll(&key, rids.back());
+	}
+}
+
+/**
+  * Read a record of the relation of createRelationInt64 or createRelationTenants
+  *
+ **/
+WIDE_RECORD wideRecord(RecordId rid)
+{
+	Page *curPage;
+	bufMgr->readPage(file1, rid.page_number, curPage);
+	WIDE_RECORD record;
+	memcpy(&record, curPage->getRecord(rid).data(), sizeof(WIDE_RECORD));
+	bufMgr->unPinPage(file1, rid.page_number, false);
+	return record;
+}
+
+/**
+  * Scan an index on the (tenant, timestamp) key of createRelationTenants in the given order, check that the records
+  * come in that order of their keys and return their number
+  *
+ **/
+int checkTenantScan(BTreeIndex *index, const CompositeKey* low, Operator lowOp, const CompositeKey* high, Operator highOp,
+                    ScanOrder order)
+{
+	std::vector<RecordId> rids;
+	scanAll(index, low ? low->data() : NULL, lowOp, high ? high->data() : NULL, highOp, 0, rids, order);
+	for (size_t r = 1; r < rids.size(); r++) {
+		WIDE_RECORD a = wideRecord(rids[r - 1]);
+		WIDE_RECORD b = wideRecord(rids[r]);
+		bool ascending = a.i < b.i || (a.i == b.i && a.l < b.l);
+		if (ascending != (order == ASCENDING)) {
+			std::cout << "Composite keys are scanned in the wrong order." << std::endl;
+			exit(1);
+		}
+	}
+	return (int)rids.size();
+}
+
+/**
+  * Scan an index which includes a DOUBLE column between the given bounds, both included, one entry at a time if
+  * batchSize is 0, otherwise in batches, and return the included values of the entries in scan order
+  *
+ **/
+void scanIncluded(BTreeIndex *index, const void* lowVal, const void* highVal, ScanOrder order, size_t batchSize,
+                  std::vector<double>& values)
+{
+	values.clear();
+	index->startScan(lowVal, GTE, highVal, LTE, order);
+	if (batchSize == 0) {
+		try
+		{
+			while (1) {
+				RecordId rid;
+				double value;
+				index->scanNext(rid, &value);
+				values.push_back(value);
+			}
+		}
+		catch(const IndexScanCompletedException &e)
+		{
+		}
+	}
+	else {
+		std::vector<RecordId> rids(batchSize);
+		std::vector<double> batch(batchSize);
+		size_t count;
+		while ((count = index->scanNextBatch(rids.data(), batchSize, batch.data())) > 0) {
+			values.insert(values.end(), batch.begin(), batch.begin() + count);
+		}
+	}
+	index->endScan();
+}
+
+/**
+  * Build an INTEGER index on the relation by inserts with the given split fills, check it with scans in both orders
+  * and return its number of leaves
+  *
+ **/
+int checkSplitLeaves(double splitFill, double rightmostSplitFill)
+{
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	int leaves;
+	{
+		IndexOptions options;
+		options.bulkLoad = false;
+		options.splitFill = splitFill;
+		options.rightmostSplitFill = rightmostSplitFill;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		leaves = checkLeafLinks(&index, 0);
+		checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+		checkPassFail(intScan(&index, 0, GTE, myRelationSize, LT), myRelationSize)
+		int lowVal = 15000;
+		int highVal = 19990;
+		checkDescendingScans(&index, &lowVal, &highVal);
+		checkDescendingScans(&index, NULL, NULL);
+	}
+	File::remove(intIndexName);
+	return leaves;
+}
+
+/**
+  * Scan the index for all four combinations of the operators on the given bounds, in both orders, with scanNext
+  * and with batches of a few entries. The descending scan must return the record ids of the ascending scan in
+  * reverse order
+  *
+ **/
+void checkDescendingScans(BTreeIndex *index, const void* lowVal, const void* highVal)
+{
+	Operator lowOps[] = { GT, GTE };
+	Operator highOps[] = { LT, LTE };
+	size_t batchSizes[] = { 0, 7 };
+	for (int l = 0; l < 2; l++) {
+		for (int h = 0; h < 2; h++) {
+			for (int b = 0; b < 2; b++) {
+				std::vector<RecordId> ascending;
+				std::vector<RecordId> descending;
+				scanAll(index, lowVal, lowOps[l], highVal, highOps[h], batchSizes[b], ascending);
+				scanAll(index, lowVal, lowOps[l], highVal, highOps[h], batchSizes[b], descending, DESCENDING);
+				std::reverse(descending.begin(), descending.end());
+				if (!(ascending == descending)) {
+					std::cout << "Descending scan returns " << descending.size() << " entries in the wrong order, "
+					          << ascending.size() << " ascending." << std::endl;
+					exit(1);
+				}
+			}
+		}
+	}
+	std::cout << "Descending scans Passed." << std::endl;
+}
+
+/**
+  * Walk the leaves of an INTEGER index from the one holding lowKey to the rightmost one, checking that the left
+  * sibling of every leaf is the leaf before it, and back to the leftmost one along the left sibling links
+  * @return the number of leaves
+  *
+ **/
+int checkLeafLinks(BTreeIndex *index, int lowKey)
+{
+	int pos;
+	int total_key;
+	PageId pageNo;
+	index->findLeafNode(lowKey, pageNo, pos, total_key);
+	File *file = index->getIndexFile();
+
+	// The leftmost leaf has no left sibling
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	PageId leftNo = reinterpret_cast<LeafNodeInt*>(page)->leftSibPageNo;
+	bufMgr->unPinPage(file, pageNo, false);
+	if (leftNo != Page::INVALID_NUMBER) {
+		std::cout << "Leaf " << pageNo << " is the leftmost leaf, but has a left sibling " << leftNo << std::endl;
+		exit(1);
+	}
+
+	std::vector<PageId> leaves;
+	PageId prevNo = Page::INVALID_NUMBER;
+	while (pageNo != Page::INVALID_NUMBER) {
+		bufMgr->readPage(file, pageNo, page);
+		LeafNodeInt* leaf_node = reinterpret_cast<LeafNodeInt*>(page);
+		if (leaf_node->leftSibPageNo != prevNo) {
+			std::cout << "Leaf " << pageNo << " has left sibling " << leaf_node->leftSibPageNo << ", expected " << prevNo << std::endl;
+			exit(1);
+		}
+		leaves.push_back(pageNo);
+		prevNo = pageNo;
+		pageNo = leaf_node->rightSibPageNo;
+		bufMgr->unPinPage(file, prevNo, false);
+	}
+
+	size_t walked = 0;
+	pageNo = leaves.back();
+	while (pageNo != Page::INVALID_NUMBER) {
+		if (walked == leaves.size() || leaves[leaves.size() - 1 - walked] != pageNo) {
+			std::cout << "Left sibling links do not lead back through leaf " << pageNo << std::endl;
+			exit(1);
+		}
+		walked++;
+		bufMgr->readPage(file, pageNo, page);
+		PageId nextNo = reinterpret_cast<LeafNodeInt*>(page)->leftSibPageNo;
+		bufMgr->unPinPage(file, pageNo, false);
+		pageNo = nextNo;
+	}
+	checkPassFail((int)walked, (int)leaves.size())
+	return (int)leaves.size();
+}
+
+/**
+  * Count the leaves of an INTEGER index in the POSTING_LIST format, from the leftmost one
+  *
+ **/
+int countPostingLeaves(BTreeIndex *index)
+{
+	return countLeaves(index, POSTING_LIST);
+}
+
+/**
+  * Count the leaves of an INTEGER index in the given format, from the leftmost one
+  *
+ **/
+int countLeaves(BTreeIndex *index, LeafFormat format)
+{
+	int pos;
+	int total_key;
+	PageId pageNo;
+	index->findLeafNode(INT_MIN, pageNo, pos, total_key);
+	File *file = index->getIndexFile();
+	int leaves = 0;
+	while (pageNo != Page::INVALID_NUMBER) {
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		LeafNodeInt* leaf_node = reinterpret_cast<LeafNodeInt*>(page);
+		leaves += (leaf_node->format == format);
+		PageId nextNo = leaf_node->rightSibPageNo;
+		bufMgr->unPinPage(file, pageNo, false);
+		pageNo = nextNo;
+	}
+	return leaves;
+}
+
+/**
+  * Check whether the key is in a POSTING_LIST leaf of an INTEGER index, with its record ids in overflow pages
+  *
+ **/
+bool keyHasOverflowPages(BTreeIndex *index, int key)
+{
+	int pos;
+	int total_key;
+	PageId pageNo;
+	index->findLeafNode(key, pageNo, pos, total_key);
+	File *file = index->getIndexFile();
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	const PostingLeafNode<int>* posting_node = reinterpret_cast<const PostingLeafNode<int>*>(page);
+	bool overflow = false;
+	if (posting_node->format == POSTING_LIST) {
+		int slot = postingLowerBound(posting_node, key);
+		overflow = slot < posting_node->keySize && posting_node->slots()[slot].key == key &&
+		           posting_node->slots()[slot].overflowPageNo != Page::INVALID_NUMBER;
+	}
+	bufMgr->unPinPage(file, pageNo, false);
+	return overflow;
+}
+
+/**
+  * Build an index with a bulk load at the given fill factor, and walk its leaves from the leftmost one. The keys must
+  * be spread evenly over as few leaves as the fill factor of INTARRAYLEAFSIZE allows, and must be 0 to
+  * myRelationSize - 1 in order
+  * @param fillFactor the fill factor of the bulk load
+  *
+ **/
+void checkBulkLoadedLeaves(double fillFactor) {
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	IndexOptions options;
+	options.fillFactor = fillFactor;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+	int pos;
+	int total_key;
+	PageId currLeafPageNo;
+	index.findLeafNode(0, currLeafPageNo, pos, total_key);
+	File *file = index.getIndexFile();
+
+	int perLeaf = std::max(1, (int)(INTARRAYLEAFSIZE * fillFactor));
+	int leafCount = (myRelationSize + perLeaf - 1) / perLeaf;
+	int keyToCheck = 0;
+	while (currLeafPageNo != Page::INVALID_NUMBER) {
+		Page* leaf_page;
+		bufMgr->readPage(file, currLeafPageNo, leaf_page);
+		LeafNodeInt* leaf_node = reinterpret_cast<LeafNodeInt*>(leaf_page);
+		if (leaf_node->keySize != myRelationSize / leafCount && leaf_node->keySize != myRelationSize / leafCount + 1) {
+			std::cout << "Leaf " << currLeafPageNo << " holds " << leaf_node->keySize << " keys, expected " << myRelationSize / leafCount << std::endl;
+			exit(1);
+		}
+		for (int j = 0; j < leaf_node->keySize; j++) {
+			if (keyToCheck++ != leaf_node->keyArray[j]) {
+				std::cout << "Key " << leaf_node->keyArray[j] << " is at Page " << currLeafPageNo << " position " << j << std::endl;
+				std::cout << "The order of keys is not sorted correctly." << std::endl;
+				exit(1);
+			}
+		}
+		PageId nextPageNo = leaf_node->rightSibPageNo;
+		bufMgr->unPinPage(file, currLeafPageNo, false);
+		currLeafPageNo = nextPageNo;
+	}
+	checkPassFail(keyToCheck, myRelationSize)
+	checkPassFail(intScan(&index,25,GT,40,LT), 14)
+	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+}
+
+/**
+  * Given the relationSize, this function builds a index file on current relation file. Then, it calls
+  * findLeafnode function to get the first leaf page. Relying on the fact that all leaf nodes are connected,
+  * this function iterates every key in the leaf nodes of the index file. If every key is on the correct
+  * position of correct leaf node. This function will not produce any output.
+  * @param relationSize the size of the relation file
+  *
+ **/
+void checkLeafNodesSequence(int relationSize) {
+
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	int pos;
+	int total_key;
+	PageId currLeafPageNo;
+	index.findLeafNode(0, currLeafPageNo, pos, total_key);
+
+	// Read leaf pages through the index's own file, so leaf pages still dirty in the buffer pool are seen
+	File *file = index.getIndexFile();
+
+	int keyToCheck = 0;
+
+	for (int i = 0; i < relationSize; i += total_key) {
+
+		Page* leaf_page;
+		bufMgr->readPage(file, currLeafPageNo, leaf_page);
+		bufMgr->unPinPage(file, currLeafPageNo, false);
+		LeafNodeInt* leaf_node = reinterpret_cast<LeafNodeInt*>(leaf_page);
+
+		for (int j = 0; j < leaf_node->keySize; j++) {
+			if (keyToCheck++ != leaf_node->keyArray[j]) {
+				std::cout << "Key " << leaf_node->keyArray[j] << " is at Page " << currLeafPageNo << " position " << j << std::endl;
+				std::cout << "The order of keys is not sorted correctly." << std::endl;
+				exit(1);
+			}
+		}
+
+		total_key = leaf_node->keySize;
+		currLeafPageNo = leaf_node->rightSibPageNo;
+	}
+}
+
+/**
+  * Create a relation file with records with keys from 0 to 19999 (in increasing order of keys)
+  *
+ **/
+void myCreateRelationForward() {
+    // destroy any old copies of relation file
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	file1 = new PageFile(relationName, true);
+
+	// initialize all of record1.s to keep purify happy
+	memset(record1.s, ' ', sizeof(record1.s));
+	PageId new_page_number;
+	Page new_page = file1->allocatePage(new_page_number);
+
+	// Insert a bunch of tuples into the relation.
+	for(int i = 0; i < myRelationSize; i++ )
+		{
+		sprintf(record1.s, "%05d string record", i);
+		record1.i = i;
+		record1.d = (double)i;
+		std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+
+			while(1)
+			{
+				try
+				{
+				new_page.insertRecord(new_data);
+					break;
+				}
+				catch(const InsufficientSpaceException &e)
+				{
+					file1->writePage(new_page_number, new_page);
+					new_page = file1->allocatePage(new_page_number);
+				}
+			}
+		}
+
+	file1->writePage(new_page_number, new_page);
+	std::cout << "Done create relation" << std::endl;
+}
+
+/**
+  * Create a relation file with records with keys from 19999 to 0 (in decreasing order of keys)
+  *
+ **/
+void myCreateRelationBackward() {
+    // destroy any old copies of relation file
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	file1 = new PageFile(relationName, true);
+
+	// initialize all of record1.s to keep purify happy
+	memset(record1.s, ' ', sizeof(record1.s));
+	PageId new_page_number;
+	Page new_page = file1->allocatePage(new_page_number);
+
+	// Insert a bunch of tuples into the relation.
+	for(int i = myRelationSize - 1; i >= 0; i-- )
+		{
+		sprintf(record1.s, "%05d string record", i);
+		record1.i = i;
+		record1.d = (double)i;
+		std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+
+			while(1)
+			{
+				try
+				{
+				new_page.insertRecord(new_data);
+					break;
+				}
+				catch(const InsufficientSpaceException &e)
+				{
+					file1->writePage(new_page_number, new_page);
+					new_page = file1->allocatePage(new_page_number);
+				}
+			}
+		}
+
+	file1->writePage(new_page_number, new_page);
+}
+
+/**
+  * Create a relation file with records with keys from 0 to 19999 in a special ordering of keys.
+  * It inserts records in this order: 19999, 0, 19998, 1, ...... , 10000, 9999.
+  *
+ **/
+void myCreateRelationInSpecialOrder() {
+	// destroy any old copies of relation file
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	file1 = new PageFile(relationName, true);
+
+	// initialize all of record1.s to keep purify happy
+	memset(record1.s, ' ', sizeof(record1.s));
+	PageId new_page_number;
+	Page new_page = file1->allocatePage(new_page_number);
+
+	// Insert a bunch of tuples into the relation.
+	for(int i = myRelationSize - 1; i >= myRelationSize / 2; i--)
+	{
+		sprintf(record1.s, "%05d string record", i);
+		record1.i = i;
+		record1.d = (double)i;
+		std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+
+		while(1)
+		{
+			try
+			{
+				new_page.insertRecord(new_data);
+				break;
+			}
+			catch(const InsufficientSpaceException &e)
+			{
+				file1->writePage(new_page_number, new_page);
+				new_page = file1->allocatePage(new_page_number);
+			}
+		}
+
+		sprintf(record1.s, "%05d string record", myRelationSize - 1 - i);
+		record1.i = myRelationSize - 1 - i;
+		record1.d = (double)(myRelationSize - 1 - i);
+		std::string new_data_2(reinterpret_cast<char*>(&record1), sizeof(record1));
+
+		while(1)
+		{
+			try
+			{
+				new_page.insertRecord(new_data_2);
+				break;
+			}
+			catch(const InsufficientSpaceException &e)
+			{
+				file1->writePage(new_page_number, new_page);
+				new_page = file1->allocatePage(new_page_number);
+			}
+		}
+	}
+
+	file1->writePage(new_page_number, new_page);
+}
+
+/**
+  * Create a relation file with few distinct keys: key 1000 for every fifth record, and i % 50 for the others, so
+  * keys 0 to 49 which are not multiples of 5 have 400 records each
+  *
+ **/
+void createRelationLowCardinality() {
+	// destroy any old copies of relation file
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	file1 = new PageFile(relationName, true);
+
+	// initialize all of record1.s to keep purify happy
+	memset(record1.s, ' ', sizeof(record1.s));
+	PageId new_page_number;
+	Page new_page = file1->allocatePage(new_page_number);
+
+	// Insert a bunch of tuples into the relation.
+	for(int i = 0; i < myRelationSize; i++)
+	{
+		sprintf(record1.s, "%05d string record", i);
+		record1.i = (i % 5 == 0) ? 1000 : i % 50;
+		record1.d = (double)i;
+		std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+
+		while(1)
+		{
+			try
+			{
+				new_page.insertRecord(new_data);
+				break;
+			}
+			catch(const InsufficientSpaceException &e)
+			{
+				file1->writePage(new_page_number, new_page);
+				new_page = file1->allocatePage(new_page_number);
+			}
+		}
+	}
+
+	file1->writePage(new_page_number, new_page);
+}
+
+/**
+  * Call myIntTests() and remove an existing index file
+  *
+ **/
+void myIndexTests() {
+	myIntTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+}
+
+/**
+  * This function is developed based on intTests(). Except for run some range scan tests, it
+  * uses equalitySearch() to check if the index file has every key of records in the relation files
+  *
+ **/
+void myIntTests() {
+	std::cout << "myIntTests begin" << std::endl;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+	checkPassFail(intScan(&index,25,GT,40,LT), 14)
+	checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+	checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+	checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+	checkPassFail(intScan(&index,0,GT,1,LT), 0)
+	checkPassFail(intScan(&index,300,GT,400,LT), 99)
+	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+
+	checkPassFail(intScan(&index,0,GTE,19999,LTE), 20000)
+	checkPassFail(intScan(&index,0,GT,19999,LTE), 19999)
+	checkPassFail(intScan(&index,0,GTE,19999,LT), 19999)
+	checkPassFail(intScan(&index,0,GT,19999,LT), 19998)
+
+	checkPassFail(intScan(&index,0,GTE,341,LTE), 342)
+
+	// run some random scan tests
+	checkPassFail(intScan(&index,182,GTE,287,LTE), 106)
+	checkPassFail(intScan(&index,-1232,GTE,-445,LTE), 0)
+	checkPassFail(intScan(&index,-1000,GTE,10000,LTE), 10001)
+	checkPassFail(intScan(&index,123,GT,700,LTE), 577)
+	checkPassFail(intScan(&index,100,GT,300,LT), 199)
+	checkPassFail(intScan(&index,50,GT,70,LT), 19)
+	checkPassFail(intScan(&index,11000,GT,12321,LTE), 1321)
+
+	for (int i = 0; i < myRelationSize; i++) {
+		if (!equalitySearch(&index, i)) {
+			std::cout << "Equality search of key " << i << " fails." << std::endl;
+			exit(1);
+			break;
+		}
+	}
+}
+
+/**
+  * This equality search is simply calling range scan in an index file with low operator GTE
+  * and high operator LTE, and the lower bound equals to the higher bound in this scan.Suppose
+  * we want to find a key X in the index file. We want to find something which is less than or
+  * equal to X and bigger than or equal to X, which is the same as saying we want to find something
+  * equal to X
+  *
+ **/
+bool equalitySearch(BTreeIndex * index, int searchKey) {
+	try
+	{
+		index->startScan(&searchKey, GTE, &searchKey, LTE);
+	}
+	catch(const NoSuchKeyFoundException &e)
+	{
+		std::cout << "No Key Found satisfying the equality search criteria." << std::endl;
+		return false;
+	}
+
+	RecordId currRid;
+	Page *currPage;
+	index->scanNext(currRid);
+	bufMgr->readPage(file1, currRid.page_number, currPage);
+	RECORD myRec = *(reinterpret_cast<const RECORD*>(currPage->getRecord(currRid).data()));
+	bufMgr->unPinPage(file1, currRid.page_number, false);
+
+	try
+	{
+		index->scanNext(currRid);
+		std::cout << "The scan ends but IndexScanCompletedException is not thrown." << std::endl;
+		return false;
+	}
+	catch(const IndexScanCompletedException &e)
+	{
+	}
+
+	index->endScan();
+	if (myRec.i == searchKey)
+		return true;
+	else
+		return false;
+}
+
+// -----------------------------------------------------------------------------
+// createRelationForward
+// -----------------------------------------------------------------------------
+
+void createRelationForward()
+{
+	std::vector<RecordId> ridVec;
+  // destroy any old copies of relation file
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+  file1 = new PageFile(relationName, true);
+
+  // initialize all of record1.s to keep purify happy
+  memset(record1.s, ' ', sizeof(record1.s));
+	PageId new_page_number;
+  Page new_page = file1->allocatePage(new_page_number);
+
+  // Insert a bunch of tuples into the relation.
+  for(int i = 0; i < relationSize; i++ )
+	{
+    sprintf(record1.s, "%05d string record", i);
+    record1.i = i;
+    record1.d = (double)i;
+    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+
+		while(1)
+		{
+			try
+			{
+    		new_page.insertRecord(new_data);
+				break;
+			}
+			catch(const InsufficientSpaceException &e)
+			{
+				file1->writePage(new_page_number, new_page);
+  			new_page = file1->allocatePage(new_page_number);
+			}
+		}
+  }
+
+	file1->writePage(new_page_number, new_page);
+}
+
+// -----------------------------------------------------------------------------
+// createRelationBackward
+// -----------------------------------------------------------------------------
+
+void createRelationBackward()
+{
+  // destroy any old copies of relation file
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+  file1 = new PageFile(relationName, true);
+
+  // initialize all of record1.s to keep purify happy
+  memset(record1.s, ' ', sizeof(record1.s));
+	PageId new_page_number;
+  Page new_page = file1->allocatePage(new_page_number);
+
+  // Insert a bunch of tuples into the relation.
+  for(int i = relationSize - 1; i >= 0; i-- )
+	{
+    sprintf(record1.s, "%05d string record", i);
+    record1.i = i;
+    record1.d = i;
+
+    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
+
+		while(1)
+		{
+			try
+			{
+    		new_page.insertRecord(new_data);
+				break;
+			}
+			catch(const InsufficientSpaceException &e)
+			{
+				file1->writePage(new_page_number, new_page);
+  			new_page = file1->allocatePage(new_page_number);
+			}
+		}
+  }
+
+	file1->writePage(new_page_number, new_page);
+}
+
+// -----------------------------------------------------------------------------
+// createRelationRandom
+// -----------------------------------------------------------------------------
+
+void createRelationRandom()
+{
+  // destroy any old copies of relation file
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+  file1 = new PageFile(relationName, true);
+
+  // initialize all of record1.s to keep purify happy
+  memset(record1.s, ' ', sizeof(record1.s));
+	PageId new_page_number;
+  Page new_page = file1->allocatePage(new_page_number);
+
+  // insert records in random order
+
+  std::vector<int> intvec(relationSize);
+  for( int i = 0; i < relationSize; i++ )
+  {
+    intvec[i] = i;
+  }
+
+  long pos;
+  int val;
+	int i = 0;
+  while( i < relationSize )
+  {
+    pos = random() % (relationSize-i);
+    val = intvec[pos];
+    sprintf(record1.s, "%05d string record", val);
+    record1.i = val;
+    record1.d = val;
+
+    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
+
+		while(1)
+		{
+			try
+			{
+    		new_page.insertRecord(new_data);
+				break;
+			}
+			catch(const InsufficientSpaceException &e)
+			{
+      	file1->writePage(new_page_number, new_page);
+  			new_page = file1->allocatePage(new_page_number);
+			}
+		}
 
-	// run some random scan tests
-	checkPassFail(intScan(&index,182,GTE,287,LTE), 106)
-	checkPassFail(intScan(&index,-1232,GTE,-445,LTE), 0)
-	checkPassFail(intScan(&index,-1000,GTE,10000,LTE), 10001)
-	checkPassFail(intScan(&index,123,GT,700,LTE), 577)
-	checkPassFail(intScan(&index,100,GT,300,LT), 199)
-	checkPassFail(intScan(&index,50,GT,70,LT), 19)
-	checkPassFail(intScan(&index,11000,GT,12321,LTE), 1321)
+		int temp = intvec[relationSize-1-i];
+		intvec[relationSize-1-i] = intvec[pos];
+		intvec[pos] = temp;
+		i++;
+  }
 
-	for (int i = 0; i < myRelationSize; i++) {
-		if (!equalitySearch(&index, i)) {
-			std::cout << "Equality search of key " << i << " fails." << std::endl;
-			exit(1);
-			break;
-		}
-	}
+	file1->writePage(new_page_number, new_page);
 }
 
-/**
-  * This equality search is simply calling range scan in an index file with low operator GTE
-  * and high operator LTE, and the lower bound equals to the higher bound in this scan.Suppose
-  * we want to find a key X in the index file. We want to find something which is less than or
-  * equal to X and bigger than or equal to X, which is the same as saying we want to find something
-  * equal to X
-  *
- **/
-bool equalitySearch(BTreeIndex * index, int searchKey) {
+// -----------------------------------------------------------------------------
+// createRelationInt64
+// -----------------------------------------------------------------------------
+
+void createRelationInt64()
+{
+  // destroy any old copies of relation file
 	try
 	{
-		index->startScan(&searchKey, GTE, &searchKey, LTE);
+		File::remove(relationName);
 	}
-	catch(const NoSuchKeyFoundException &e)
+	catch(const FileNotFoundException &e)
 	{
-		std::cout << "No Key Found satisfying the equality search criteria." << std::endl;
-		return false;
 	}
+  file1 = new PageFile(relationName, true);
 
-	RecordId currRid;
-	Page *currPage;
-	index->scanNext(currRid);
-	bufMgr->readPage(file1, currRid.page_number, currPage);
-	RECORD myRec = *(reinterpret_cast<const RECORD*>(currPage->getRecord(currRid).data()));
-	bufMgr->unPinPage(file1, currRid.page_number, false);
+	PageId new_page_number;
+  Page new_page = file1->allocatePage(new_page_number);
+
+  // insert records in random order
+  std::vector<int> intvec(relationSize);
+  for( int i = 0; i < relationSize; i++ )
+  {
+    intvec[i] = i;
+  }
+
+	for( int i = 0; i < relationSize; i++ )
+	{
+		long pos = random() % (relationSize-i);
+		WIDE_RECORD wideRecord;
+		wideRecord.i = intvec[pos];
+		wideRecord.l = int64Key(intvec[pos]);
+		std::string new_data(reinterpret_cast<char*>(&wideRecord), sizeof(WIDE_RECORD));
+
+		while(1)
+		{
+			try
+			{
+				new_page.insertRecord(new_data);
+				break;
+			}
+			catch(const InsufficientSpaceException &e)
+			{
+				file1->writePage(new_page_number, new_page);
+				new_page = file1->allocatePage(new_page_number);
+			}
+		}
+
+		std::swap(intvec[relationSize-1-i], intvec[pos]);
+	}
+
+	file1->writePage(new_page_number, new_page);
+}
+
+// -----------------------------------------------------------------------------
+// createRelationTenants
+// -----------------------------------------------------------------------------
 
+void createRelationTenants()
+{
+  // destroy any old copies of relation file
 	try
 	{
-		index->scanNext(currRid);
-		std::cout << "The scan ends but IndexScanCompletedException is not thrown." << std::endl;
-		return false;
+		File::remove(relationName);
 	}
-	catch(const IndexScanCompletedException &e)
+	catch(const FileNotFoundException &e)
 	{
 	}
+  file1 = new PageFile(relationName, true);
 
-	index->endScan();
-	if (myRec.i == searchKey)
-		return true;
-	else
-		return false;
+	PageId new_page_number;
+  Page new_page = file1->allocatePage(new_page_number);
+
+  // insert records in random order, record k belongs to tenant k % 8 - 4 at timestamp (k / 8 - 300) * 100
+  std::vector<int> intvec(relationSize);
+  for( int i = 0; i < relationSize; i++ )
+  {
+    intvec[i] = i;
+  }
+
+	for( int i = 0; i < relationSize; i++ )
+	{
+		long pos = random() % (relationSize-i);
+		WIDE_RECORD wideRecord;
+		wideRecord.i = intvec[pos] % 8 - 4;
+		wideRecord.l = (std::int64_t)(intvec[pos] / 8 - 300) * 100;
+		std::string new_data(reinterpret_cast<char*>(&wideRecord), sizeof(WIDE_RECORD));
+
+		while(1)
+		{
+			try
+			{
+				new_page.insertRecord(new_data);
+				break;
+			}
+			catch(const InsufficientSpaceException &e)
+			{
+				file1->writePage(new_page_number, new_page);
+				new_page = file1->allocatePage(new_page_number);
+			}
+		}
+
+		intvec[pos] = intvec[relationSize-1-i];
+	}
+
+	file1->writePage(new_page_number, new_page);
 }
 
 // -----------------------------------------------------------------------------
-// createRelationForward
+// createRelationLongStrings
 // -----------------------------------------------------------------------------
 
-void createRelationForward()
+void createRelationLongStrings()
 {
-	std::vector<RecordId> ridVec;
   // destroy any old copies of relation file
 	try
 	{
@@ -689,7 +4294,6 @@ void createRelationForward()
 	catch(const FileNotFoundException &e)
 	{
 	}
-
   file1 = new PageFile(relationName, true);
 
   // initialize all of record1.s to keep purify happy
@@ -697,181 +4301,383 @@ void createRelationForward()
 	PageId new_page_number;
   Page new_page = file1->allocatePage(new_page_number);
 
-  // Insert a bunch of tuples into the relation.
-  for(int i = 0; i < relationSize; i++ )
+  // insert records in random order
+  std::vector<int> intvec(myRelationSize);
+  for( int i = 0; i < myRelationSize; i++ )
+  {
+    intvec[i] = i;
+  }
+
+	for( int i = 0; i < myRelationSize; i++ )
 	{
-    sprintf(record1.s, "%05d string record", i);
-    record1.i = i;
-    record1.d = (double)i;
-    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+		long pos = random() % (myRelationSize-i);
+		int val = intvec[pos];
+		sprintf(record1.s, "%s%05d", "customers/north-america/united-states/wisconsin/", val);
+		record1.i = val;
+		record1.d = val;
+		std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
 
 		while(1)
 		{
 			try
 			{
-    		new_page.insertRecord(new_data);
+				new_page.insertRecord(new_data);
 				break;
 			}
 			catch(const InsufficientSpaceException &e)
 			{
 				file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
+				new_page = file1->allocatePage(new_page_number);
+			}
+		}
+
+		std::swap(intvec[myRelationSize-1-i], intvec[pos]);
+	}
+
+	file1->writePage(new_page_number, new_page);
+}
+
+/**
+  * Key of the record with the given value in the relation of test 13. Keys are 2^32 apart, from below -2^32
+  * to far above 2^32, and all of them have 7 in their low 32 bits.
+  *
+ **/
+std::int64_t int64Key(int value)
+{
+	return (std::int64_t)(value - relationSize / 2) * ((std::int64_t)1 << 32) + 7;
+}
+
+// -----------------------------------------------------------------------------
+// indexTests
+// -----------------------------------------------------------------------------
+
+void indexTests()
+{
+  intTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+
+  doubleTests();
+	try
+	{
+		File::remove(doubleIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+
+  stringTests();
+	try
+	{
+		File::remove(stringIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+}
+
+// -----------------------------------------------------------------------------
+// intTests
+// -----------------------------------------------------------------------------
+
+void intTests()
+{
+  std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+	// run some tests
+	checkPassFail(intScan(&index,25,GT,40,LT), 14)
+	checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+	checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+	checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+	checkPassFail(intScan(&index,0,GT,1,LT), 0)
+	checkPassFail(intScan(&index,300,GT,400,LT), 99)
+	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+}
+
+int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+  RecordId scanRid;
+	Page *curPage;
+
+  std::cout << "Scan for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+  int numResults = 0;
+
+	try
+	{
+  	index->startScan(&lowVal, lowOp, &highVal, highOp);
+	}
+	catch(const NoSuchKeyFoundException &e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	while(1)
+	{
+		try
+		{
+			index->scanNext(scanRid);
+			bufMgr->readPage(file1, scanRid.page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+			bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+			if( numResults < 5 )
+			{
+				std::cout << "at:" << scanRid.page_number << "," << scanRid.slot_number;
+				std::cout << " -->:" << myRec.i << ":" << myRec.d << ":" << myRec.s << ":" <<std::endl;
+			}
+			else if( numResults == 5 )
+			{
+				std::cout << "..." << std::endl;
 			}
 		}
+		catch(const IndexScanCompletedException &e)
+		{
+			break;
+		}
+
+		numResults++;
+	}
+
+  if( numResults >= 5 )
+  {
+    std::cout << "Number of results: " << numResults << std::endl;
   }
+  index->endScan();
+  std::cout << std::endl;
 
-	file1->writePage(new_page_number, new_page);
+	return numResults;
 }
 
 // -----------------------------------------------------------------------------
-// createRelationBackward
+// countEntries, indexHeight, fileSize, recordKey, scanAll
 // -----------------------------------------------------------------------------
 
-void createRelationBackward()
+/**
+  * Count the entries with keys in [lowVal, highVal] without reading their records, whose rids may point to no record
+  *
+ **/
+int countEntries(BTreeIndex *index, int lowVal, int highVal)
 {
-  // destroy any old copies of relation file
+	int numResults = 0;
 	try
 	{
-		File::remove(relationName);
+		index->startScan(&lowVal, GTE, &highVal, LTE);
 	}
-	catch(const FileNotFoundException &e)
+	catch(const NoSuchKeyFoundException &e)
 	{
+		return 0;
 	}
-  file1 = new PageFile(relationName, true);
+	try
+	{
+		while (1) {
+			RecordId scanRid;
+			index->scanNext(scanRid);
+			numResults++;
+		}
+	}
+	catch(const IndexScanCompletedException &e)
+	{
+	}
+	index->endScan();
+	return numResults;
+}
 
-  // initialize all of record1.s to keep purify happy
-  memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-  Page new_page = file1->allocatePage(new_page_number);
+/**
+  * Read the height of the tree from the meta page of the index
+  *
+ **/
+int indexHeight(BTreeIndex *index)
+{
+	File *file = index->getIndexFile();
+	Page* page;
+	bufMgr->readPage(file, 1, page);
+	int height = reinterpret_cast<IndexMetaInfo*>(page)->height;
+	bufMgr->unPinPage(file, 1, false);
+	return height;
+}
 
-  // Insert a bunch of tuples into the relation.
-  for(int i = relationSize - 1; i >= 0; i-- )
-	{
-    sprintf(record1.s, "%05d string record", i);
-    record1.i = i;
-    record1.d = i;
+/**
+  * Size of a file in bytes
+  *
+ **/
+long fileSize(const std::string& fileName)
+{
+	std::ifstream stream(fileName.c_str(), std::ios::binary | std::ios::ate);
+	return (long)stream.tellg();
+}
 
-    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
+/**
+  * Read the INTEGER key of the record with the given rid in the relation
+  *
+ **/
+int recordKey(RecordId rid)
+{
+	Page *curPage;
+	bufMgr->readPage(file1, rid.page_number, curPage);
+	RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(rid).data()));
+	bufMgr->unPinPage(file1, rid.page_number, false);
+	return myRec.i;
+}
 
-		while(1)
+/**
+  * Collect the record ids of a scan, with scanNext if batchSize is 0, otherwise with scanNextBatch. A batch shorter
+  * than batchSize must complete the scan, so the next batch must be empty
+  *
+ **/
+void scanAll(BTreeIndex *index, const void* lowVal, Operator lowOp, const void* highVal, Operator highOp,
+             size_t batchSize, std::vector<RecordId>& rids, ScanOrder order)
+{
+	try
+	{
+		index->startScan(lowVal, lowOp, highVal, highOp, order);
+	}
+	catch(const NoSuchKeyFoundException &e)
+	{
+		return;
+	}
+
+	if (batchSize == 0) {
+		try
 		{
-			try
-			{
-    		new_page.insertRecord(new_data);
-				break;
-			}
-			catch(const InsufficientSpaceException &e)
-			{
-				file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
+			while (1) {
+				RecordId scanRid;
+				index->scanNext(scanRid);
+				rids.push_back(scanRid);
 			}
 		}
-  }
-
-	file1->writePage(new_page_number, new_page);
+		catch(const IndexScanCompletedException &e)
+		{
+		}
+	}
+	else {
+		std::vector<RecordId> batch(batchSize);
+		size_t count;
+		do {
+			count = index->scanNextBatch(batch.data(), batchSize);
+			rids.insert(rids.end(), batch.begin(), batch.begin() + count);
+		} while (count == batchSize);
+		if (index->scanNextBatch(batch.data(), batchSize) != 0) {
+			std::cout << "scanNextBatch returns more record ids after a short batch." << std::endl;
+			exit(1);
+		}
+	}
+	index->endScan();
 }
 
 // -----------------------------------------------------------------------------
-// createRelationRandom
+// doubleTests
 // -----------------------------------------------------------------------------
 
-void createRelationRandom()
+void doubleTests()
 {
-  // destroy any old copies of relation file
-	try
-	{
-		File::remove(relationName);
-	}
-	catch(const FileNotFoundException &e)
-	{
-	}
-  file1 = new PageFile(relationName, true);
+  std::cout << "Create a B+ Tree index on the double field" << std::endl;
+  BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE);
 
-  // initialize all of record1.s to keep purify happy
-  memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-  Page new_page = file1->allocatePage(new_page_number);
+	// run some tests
+	checkPassFail(doubleScan(&index,25,GT,40,LT), 14)
+	checkPassFail(doubleScan(&index,20,GTE,35,LTE), 16)
+	checkPassFail(doubleScan(&index,-3,GT,3,LT), 3)
+	checkPassFail(doubleScan(&index,996,GT,1001,LT), 4)
+	checkPassFail(doubleScan(&index,0,GT,1,LT), 0)
+	checkPassFail(doubleScan(&index,300,GT,400,LT), 99)
+	checkPassFail(doubleScan(&index,3000,GTE,4000,LT), 1000)
+	// Bounds between keys, which an INTEGER scan cannot express
+	checkPassFail(doubleScan(&index,24.5,GT,40.5,LT), 16)
+	checkPassFail(doubleScan(&index,0.25,GTE,0.75,LTE), 0)
+}
 
-  // insert records in random order
+int doubleScan(BTreeIndex * index, double lowVal, Operator lowOp, double highVal, Operator highOp)
+{
+  RecordId scanRid;
+	Page *curPage;
 
-  std::vector<int> intvec(relationSize);
-  for( int i = 0; i < relationSize; i++ )
-  {
-    intvec[i] = i;
-  }
+  std::cout << "Scan for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
 
-  long pos;
-  int val;
-	int i = 0;
-  while( i < relationSize )
-  {
-    pos = random() % (relationSize-i);
-    val = intvec[pos];
-    sprintf(record1.s, "%05d string record", val);
-    record1.i = val;
-    record1.d = val;
+  int numResults = 0;
 
-    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
+	try
+	{
+  	index->startScan(&lowVal, lowOp, &highVal, highOp);
+	}
+	catch(const NoSuchKeyFoundException &e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
 
-		while(1)
+	while(1)
+	{
+		try
 		{
-			try
+			index->scanNext(scanRid);
+			bufMgr->readPage(file1, scanRid.page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+			bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+			if( numResults < 5 )
 			{
-    		new_page.insertRecord(new_data);
-				break;
+				std::cout << "at:" << scanRid.page_number << "," << scanRid.slot_number;
+				std::cout << " -->:" << myRec.i << ":" << myRec.d << ":" << myRec.s << ":" <<std::endl;
 			}
-			catch(const InsufficientSpaceException &e)
+			else if( numResults == 5 )
 			{
-      	file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
+				std::cout << "..." << std::endl;
 			}
 		}
+		catch(const IndexScanCompletedException &e)
+		{
+			break;
+		}
 
-		int temp = intvec[relationSize-1-i];
-		intvec[relationSize-1-i] = intvec[pos];
-		intvec[pos] = temp;
-		i++;
-  }
-
-	file1->writePage(new_page_number, new_page);
-}
-
-// -----------------------------------------------------------------------------
-// indexTests
-// -----------------------------------------------------------------------------
-
-void indexTests()
-{
-  intTests();
-	try
-	{
-		File::remove(intIndexName);
+		numResults++;
 	}
-  catch(const FileNotFoundException &e)
+
+  if( numResults >= 5 )
   {
+    std::cout << "Number of results: " << numResults << std::endl;
   }
+  index->endScan();
+  std::cout << std::endl;
+
+	return numResults;
 }
 
 // -----------------------------------------------------------------------------
-// intTests
+// stringTests
 // -----------------------------------------------------------------------------
 
-void intTests()
+void stringTests()
 {
-  std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  std::cout << "Create a B+ Tree index on the string field" << std::endl;
+  BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
 
 	// run some tests
-	checkPassFail(intScan(&index,25,GT,40,LT), 14)
-	checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
-	checkPassFail(intScan(&index,-3,GT,3,LT), 3)
-	checkPassFail(intScan(&index,996,GT,1001,LT), 4)
-	checkPassFail(intScan(&index,0,GT,1,LT), 0)
-	checkPassFail(intScan(&index,300,GT,400,LT), 99)
-	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+	checkPassFail(stringScan(&index,25,GT,40,LT), 14)
+	checkPassFail(stringScan(&index,20,GTE,35,LTE), 16)
+	checkPassFail(stringScan(&index,-3,GT,3,LT), 3)
+	checkPassFail(stringScan(&index,996,GT,1001,LT), 4)
+	checkPassFail(stringScan(&index,0,GT,1,LT), 0)
+	checkPassFail(stringScan(&index,300,GT,400,LT), 99)
+	checkPassFail(stringScan(&index,3000,GTE,4000,LT), 1000)
 }
 
-int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+int stringScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
 {
   RecordId scanRid;
 	Page *curPage;
@@ -882,11 +4688,16 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
   if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
   std::cout << std::endl;
 
+	char lowValStr[100];
+	sprintf(lowValStr,"%05d string record",lowVal);
+	char highValStr[100];
+	sprintf(highValStr,"%05d string record",highVal);
+
   int numResults = 0;
 
 	try
 	{
-  	index->startScan(&lowVal, lowOp, &highVal, highOp);
+  	index->startScan(lowValStr, lowOp, highValStr, highOp);
 	}
 	catch(const NoSuchKeyFoundException &e)
 	{
@@ -931,6 +4742,62 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
 	return numResults;
 }
 
+int int64Scan(BTreeIndex * index, std::int64_t lowVal, Operator lowOp, std::int64_t highVal, Operator highOp)
+{
+  RecordId scanRid;
+	Page *curPage;
+
+  std::cout << "Scan for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+  int numResults = 0;
+
+	try
+	{
+  	index->startScan(&lowVal, lowOp, &highVal, highOp);
+	}
+	catch(const NoSuchKeyFoundException &e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	while(1)
+	{
+		try
+		{
+			index->scanNext(scanRid);
+			bufMgr->readPage(file1, scanRid.page_number, curPage);
+			WIDE_RECORD myRec = *(reinterpret_cast<const WIDE_RECORD*>(curPage->getRecord(scanRid).data()));
+			bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+			// Every record returned must hold a key in range, with the key of its value
+			bool aboveLow = lowOp == GT ? myRec.l > lowVal : myRec.l >= lowVal;
+			bool belowHigh = highOp == LT ? myRec.l < highVal : myRec.l <= highVal;
+			if( !aboveLow || !belowHigh || myRec.l != int64Key(myRec.i) )
+			{
+				std::cout << "Scan returns key " << myRec.l << " of value " << myRec.i << " out of the scan range." << std::endl;
+				exit(1);
+			}
+		}
+		catch(const IndexScanCompletedException &e)
+		{
+			break;
+		}
+
+		numResults++;
+	}
+
+  std::cout << "Number of results: " << numResults << std::endl;
+  index->endScan();
+  std::cout << std::endl;
+
+	return numResults;
+}
+
 // -----------------------------------------------------------------------------
 // errorTests
 // -----------------------------------------------------------------------------
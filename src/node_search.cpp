@@ -0,0 +1,258 @@
+/**
+ * @file node_search.cpp
+ * @brief In-node key search kernels used by the B+ tree to locate a key inside a sorted key array.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "node_search.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BADGERDB_X86_SEARCH
+#include <immintrin.h>
+#endif
+
+namespace badgerdb
+{
+
+namespace
+{
+
+// Number of keys left to the SIMD compares once the binary search has narrowed the range.
+// One cache line (16 keys) for SSE4.1 and two cache lines (32 keys) for AVX2.
+const int SSE4_WINDOW = 16;
+const int AVX2_WINDOW = 32;
+
+// -----------------------------------------------------------------------------
+// Scalar helpers
+// -----------------------------------------------------------------------------
+
+// True if the search position lies to the right of the probe. For a lower bound that is probe < key,
+// for an upper bound that is probe <= key.
+template <bool Upper>
+inline bool goesRight(int probe, int key)
+{
+    return Upper ? probe <= key : probe < key;
+}
+
+// Branch-free binary search which narrows [base, base + len) until at most window keys are left.
+// Every key before the returned base goes to the left of the search position, every key at or
+// after base + len goes to the right of it.
+template <bool Upper>
+inline const int* narrow(const int* base, int& len, int key, int window)
+{
+    while(len > window){
+        int half = len / 2;
+        base = goesRight<Upper>(base[half], key) ? base + half : base;
+        len -= half;
+    }
+    return base;
+}
+
+// Count keys which go to the left of the search position, without branching on the comparison
+template <bool Upper>
+inline int countScalar(const int* base, int len, int key)
+{
+    int count = 0;
+    for(int i = 0; i < len; i++){
+        count += goesRight<Upper>(base[i], key);
+    }
+    return count;
+}
+
+template <bool Upper>
+int linearSearch(const int* keys, int n, int key)
+{
+    // The loop used by the original index code: stop at the first key on the right of the position
+    int i;
+    for(i = 0; i < n; i++){
+        if(!goesRight<Upper>(keys[i], key)){
+            break;
+        }
+    }
+    return i;
+}
+
+template <bool Upper>
+int binarySearch(const int* keys, int n, int key)
+{
+    int len = n;
+    const int* base = narrow<Upper>(keys, len, key, 1);
+    return (int)(base - keys) + countScalar<Upper>(base, len, key);
+}
+
+#ifdef BADGERDB_X86_SEARCH
+
+// -----------------------------------------------------------------------------
+// SSE4.1 kernel
+// -----------------------------------------------------------------------------
+
+template <bool Upper>
+__attribute__((target("sse4.1,popcnt")))
+int sse4Search(const int* keys, int n, int key)
+{
+    int len = n;
+    const int* base = narrow<Upper>(keys, len, key, SSE4_WINDOW);
+
+    const __m128i needle = _mm_set1_epi32(key);
+    int count = 0;
+    int i = 0;
+    for(; i + 4 <= len; i += 4){
+        __m128i probe = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base + i));
+        // Lower bound counts probe < key, upper bound counts probe <= key, i.e. 4 - (probe > key)
+        __m128i mask = Upper ? _mm_cmpgt_epi32(probe, needle) : _mm_cmpgt_epi32(needle, probe);
+        int bits = __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(mask)));
+        count += Upper ? 4 - bits : bits;
+    }
+    count += countScalar<Upper>(base + i, len - i, key);
+    return (int)(base - keys) + count;
+}
+
+// -----------------------------------------------------------------------------
+// AVX2 kernel
+// -----------------------------------------------------------------------------
+
+template <bool Upper>
+__attribute__((target("avx2,popcnt")))
+int avx2Search(const int* keys, int n, int key)
+{
+    int len = n;
+    const int* base = narrow<Upper>(keys, len, key, AVX2_WINDOW);
+
+    const __m256i needle = _mm256_set1_epi32(key);
+    int count = 0;
+    int i = 0;
+    for(; i + 8 <= len; i += 8){
+        __m256i probe = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(base + i));
+        __m256i mask = Upper ? _mm256_cmpgt_epi32(probe, needle) : _mm256_cmpgt_epi32(needle, probe);
+        int bits = __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(mask)));
+        count += Upper ? 8 - bits : bits;
+    }
+    count += countScalar<Upper>(base + i, len - i, key);
+    return (int)(base - keys) + count;
+}
+
+#endif
+
+// -----------------------------------------------------------------------------
+// Runtime dispatch
+// -----------------------------------------------------------------------------
+
+bool cpuSupports(SearchKernel kernel)
+{
+    switch(kernel){
+    case SEARCH_LINEAR:
+    case SEARCH_BINARY:
+        return true;
+#ifdef BADGERDB_X86_SEARCH
+    case SEARCH_SSE4:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt");
+    case SEARCH_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#endif
+    default:
+        return false;
+    }
+}
+
+template <bool Upper>
+IntSearchFunction kernelFunction(SearchKernel kernel)
+{
+    if(!cpuSupports(kernel)){
+        return &binarySearch<Upper>;
+    }
+    switch(kernel){
+    case SEARCH_LINEAR:
+        return &linearSearch<Upper>;
+#ifdef BADGERDB_X86_SEARCH
+    case SEARCH_SSE4:
+        return &sse4Search<Upper>;
+    case SEARCH_AVX2:
+        return &avx2Search<Upper>;
+#endif
+    default:
+        return &binarySearch<Upper>;
+    }
+}
+
+SearchKernel detectKernel()
+{
+    if(cpuSupports(SEARCH_AVX2)){
+        return SEARCH_AVX2;
+    }
+    if(cpuSupports(SEARCH_SSE4)){
+        return SEARCH_SSE4;
+    }
+    return SEARCH_BINARY;
+}
+
+// The binary kernel is constant-initialized, so a search issued before dynamic initialization
+// still works; the selector below upgrades both pointers once the CPU features are known.
+SearchKernel activeKernel = SEARCH_BINARY;
+IntSearchFunction lowerBoundFunction = &binarySearch<false>;
+IntSearchFunction upperBoundFunction = &binarySearch<true>;
+
+struct KernelSelector
+{
+    KernelSelector()
+    {
+        activeKernel = detectKernel();
+        lowerBoundFunction = kernelFunction<false>(activeKernel);
+        upperBoundFunction = kernelFunction<true>(activeKernel);
+    }
+} kernelSelector;
+
+}
+
+int lowerBoundInt(const int* keys, int n, int key)
+{
+    return lowerBoundFunction(keys, n, key);
+}
+
+int upperBoundInt(const int* keys, int n, int key)
+{
+    return upperBoundFunction(keys, n, key);
+}
+
+IntSearchFunction lowerBoundKernel(SearchKernel kernel)
+{
+    return kernelFunction<false>(kernel);
+}
+
+IntSearchFunction upperBoundKernel(SearchKernel kernel)
+{
+    return kernelFunction<true>(kernel);
+}
+
+bool searchKernelSupported(SearchKernel kernel)
+{
+    return cpuSupports(kernel);
+}
+
+SearchKernel activeSearchKernel()
+{
+    return activeKernel;
+}
+
+const char* searchKernelName(SearchKernel kernel)
+{
+    switch(kernel){
+    case SEARCH_LINEAR:
+        return "linear";
+    case SEARCH_BINARY:
+        return "binary";
+    case SEARCH_SSE4:
+        return "sse4.1";
+    case SEARCH_AVX2:
+        return "avx2";
+    default:
+        return "unknown";
+    }
+}
+
+}
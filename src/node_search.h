@@ -0,0 +1,133 @@
+/**
+ * @file node_search.h
+ * @brief In-node key search kernels used by the B+ tree to locate a key inside a sorted key array.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+namespace badgerdb
+{
+
+/**
+ * @brief Kernels available for searching a sorted INTEGER key array.
+ */
+enum SearchKernel
+{
+	SEARCH_LINEAR = 0,	/* Scan keys one at a time from the left */
+	SEARCH_BINARY = 1,	/* Branch-free binary search */
+	SEARCH_SSE4 = 2,		/* Branch-free binary search narrowed to a window counted with SSE4.1 compares */
+	SEARCH_AVX2 = 3		/* Branch-free binary search narrowed to a window counted with AVX2 compares */
+};
+
+/**
+ * @brief Return the position of the first key which is greater than or equal to the given key,
+ * or n if there is no such key. The kernel is picked once at start-up from the CPU features.
+ * @param keys Sorted key array
+ * @param n Number of keys in the array
+ * @param key The key to search for
+ */
+int lowerBoundInt(const int* keys, int n, int key);
+
+/**
+ * @brief Return the position of the first key which is strictly greater than the given key,
+ * or n if there is no such key. The kernel is picked once at start-up from the CPU features.
+ * @param keys Sorted key array
+ * @param n Number of keys in the array
+ * @param key The key to search for
+ */
+int upperBoundInt(const int* keys, int n, int key);
+
+/**
+ * @brief Signature shared by all INTEGER search kernels.
+ */
+typedef int (*IntSearchFunction)(const int* keys, int n, int key);
+
+/**
+ * @brief Get the lower bound function of the given kernel. Falls back to SEARCH_BINARY
+ * if the kernel is not supported by the CPU.
+ */
+IntSearchFunction lowerBoundKernel(SearchKernel kernel);
+
+/**
+ * @brief Get the upper bound function of the given kernel. Falls back to SEARCH_BINARY
+ * if the kernel is not supported by the CPU.
+ */
+IntSearchFunction upperBoundKernel(SearchKernel kernel);
+
+/**
+ * @brief Check whether the given kernel can run on this CPU.
+ */
+bool searchKernelSupported(SearchKernel kernel);
+
+/**
+ * @brief Kernel picked at start-up for lowerBoundInt() and upperBoundInt().
+ */
+SearchKernel activeSearchKernel();
+
+/**
+ * @brief Human readable name of a kernel, for benchmark output.
+ */
+const char* searchKernelName(SearchKernel kernel);
+
+/**
+ * @brief Return the position of the first key which is greater than or equal to the given key, for any
+ * key type with operator<. Branch-free binary search; INTEGER keys use the SIMD kernels instead.
+ * @param keys Sorted key array
+ * @param n Number of keys in the array
+ * @param key The key to search for
+ */
+template <class T>
+inline int lowerBound(const T* keys, int n, const T& key)
+{
+	const T* base = keys;
+	int len = n;
+	while(len > 1){
+		int half = len / 2;
+		base = (base[half] < key) ? base + half : base;
+		len -= half;
+	}
+	return (int)(base - keys) + (n > 0 && *base < key);
+}
+
+/**
+ * @brief Return the position of the first key which is strictly greater than the given key, for any
+ * key type with operator<. Branch-free binary search; INTEGER keys use the SIMD kernels instead.
+ * @param keys Sorted key array
+ * @param n Number of keys in the array
+ * @param key The key to search for
+ */
+template <class T>
+inline int upperBound(const T* keys, int n, const T& key)
+{
+	const T* base = keys;
+	int len = n;
+	while(len > 1){
+		int half = len / 2;
+		base = !(key < base[half]) ? base + half : base;
+		len -= half;
+	}
+	return (int)(base - keys) + (n > 0 && !(key < *base));
+}
+
+/**
+ * @brief INTEGER overload of lowerBound, which goes through the kernel picked at start-up.
+ */
+inline int lowerBound(const int* keys, int n, const int& key)
+{
+	return lowerBoundInt(keys, n, key);
+}
+
+/**
+ * @brief INTEGER overload of upperBound, which goes through the kernel picked at start-up.
+ */
+inline int upperBound(const int* keys, int n, const int& key)
+{
+	return upperBoundInt(keys, n, key);
+}
+
+}
@@ -0,0 +1,100 @@
+/**
+ * @file node_versions.cpp
+ * @brief Version counters of the nodes of an index, for optimistic lock coupling.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <thread>
+#include "node_versions.h"
+
+namespace badgerdb
+{
+
+namespace
+{
+
+const std::size_t chunkCount = (std::size_t)1 << (32 - VERSIONCHUNKBITS);
+const std::size_t chunkSize = (std::size_t)1 << VERSIONCHUNKBITS;
+
+}
+
+NodeVersions::NodeVersions()
+{
+    chunks = new std::atomic<std::atomic<std::uint64_t>*>[chunkCount];
+    for(std::size_t i = 0; i < chunkCount; i++){
+        chunks[i].store(NULL, std::memory_order_relaxed);
+    }
+}
+
+NodeVersions::~NodeVersions()
+{
+    for(std::size_t i = 0; i < chunkCount; i++){
+        delete [] chunks[i].load(std::memory_order_relaxed);
+    }
+    delete [] chunks;
+}
+
+std::atomic<std::uint64_t>& NodeVersions::counter(PageId pageNo)
+{
+    std::atomic<std::atomic<std::uint64_t>*>& slot = chunks[pageNo >> VERSIONCHUNKBITS];
+    std::atomic<std::uint64_t>* chunk = slot.load(std::memory_order_acquire);
+    if(chunk == NULL){
+        // Threads allocating the same chunk at once keep the one stored first
+        std::atomic<std::uint64_t>* fresh = new std::atomic<std::uint64_t>[chunkSize];
+        for(std::size_t i = 0; i < chunkSize; i++){
+            fresh[i].store(0, std::memory_order_relaxed);
+        }
+        if(slot.compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel)){
+            chunk = fresh;
+        }
+        else{
+            delete [] fresh;
+        }
+    }
+    return chunk[pageNo & (chunkSize - 1)];
+}
+
+const std::atomic<std::uint64_t>* NodeVersions::find(PageId pageNo) const
+{
+    const std::atomic<std::uint64_t>* chunk = chunks[pageNo >> VERSIONCHUNKBITS].load(std::memory_order_acquire);
+    return chunk == NULL ? NULL : &chunk[pageNo & (chunkSize - 1)];
+}
+
+std::uint64_t NodeVersions::read(PageId pageNo) const
+{
+    // A counter not allocated yet is 0, so reading one, even of a page number a torn read made up, allocates nothing
+    const std::atomic<std::uint64_t>* version = find(pageNo);
+    return version == NULL ? 0 : version->load(std::memory_order_acquire);
+}
+
+bool NodeVersions::validate(PageId pageNo, std::uint64_t version) const
+{
+    // The reads of the node must not move past the check
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const std::atomic<std::uint64_t>* current = find(pageNo);
+    return (current == NULL ? 0 : current->load(std::memory_order_relaxed)) == version;
+}
+
+void NodeVersions::lock(PageId pageNo)
+{
+    std::atomic<std::uint64_t>& version = counter(pageNo);
+    while(1){
+        std::uint64_t current = version.load(std::memory_order_relaxed);
+        if(!locked(current) && version.compare_exchange_weak(current, current + 1, std::memory_order_acquire)){
+            std::atomic_thread_fence(std::memory_order_release);
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void NodeVersions::unlock(PageId pageNo)
+{
+    counter(pageNo).fetch_add(1, std::memory_order_release);
+}
+
+}
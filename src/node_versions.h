@@ -0,0 +1,85 @@
+/**
+ * @file node_versions.h
+ * @brief Version counters of the nodes of an index, for optimistic lock coupling. A reader notes the version of a
+ * node before it reads the node, and checks that the version is still the same once it has what it needs, instead of
+ * locking the node; if a writer changed the node in between, the reader reads it again. A writer locks a node by making
+ * its version odd, and unlocks it by making it even again, one higher than before.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "types.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief The counters are kept in chunks of 2^VERSIONCHUNKBITS pages, allocated when a page of the chunk is first
+ * used, so they cover every page number.
+ */
+const int VERSIONCHUNKBITS = 16;
+
+/**
+ * @brief Version counters of every page of an index file. The counters of a page never move once allocated, so
+ * threads use them without any other synchronization.
+ */
+class NodeVersions
+{
+ public:
+	NodeVersions();
+	~NodeVersions();
+
+  /**
+   * Version of the node in the given page, odd while a writer holds the node.
+   */
+	std::uint64_t read(PageId pageNo) const;
+
+  /**
+   * True if the node still has the given version, so everything read of it since the version was read is
+   * consistent.
+   */
+	bool validate(PageId pageNo, std::uint64_t version) const;
+
+  /**
+   * Lock the node, waiting for a writer holding it to unlock it.
+   */
+	void lock(PageId pageNo);
+
+  /**
+   * Unlock the node, which then has a new version.
+   */
+	void unlock(PageId pageNo);
+
+  /**
+   * True if a writer held the node when it had the given version.
+   */
+	static bool locked(std::uint64_t version) { return (version & 1) != 0; }
+
+ private:
+	NodeVersions(const NodeVersions&);
+	NodeVersions& operator=(const NodeVersions&);
+
+  /**
+   * Counter of the page, allocating its chunk if needed.
+   */
+	std::atomic<std::uint64_t>& counter(PageId pageNo);
+
+  /**
+   * Counter of the page, NULL if its chunk is not allocated yet.
+   */
+	const std::atomic<std::uint64_t>* find(PageId pageNo) const;
+
+  /**
+   * Chunks of counters, indexed by the high bits of the page number.
+   */
+	std::atomic<std::atomic<std::uint64_t>*>* chunks;
+};
+
+}
@@ -0,0 +1,449 @@
+/**
+ * @file packed_node.cpp
+ * @brief Packed format of B+ tree leaf nodes for fixed size keys, where the keys and the page and slot numbers of the
+ * record ids are frame-of-reference encoded: every value is stored as its distance to the smallest value of its
+ * column in the node, bit-packed with as many bits as the greatest distance takes. Dense keys and clustered record
+ * ids then take a few bits an entry instead of the bytes of LeafNode, and a scan unpacks a node with a SIMD kernel.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <vector>
+#include "packed_node.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BADGERDB_X86_UNPACK
+#include <immintrin.h>
+#endif
+
+namespace badgerdb
+{
+
+namespace
+{
+
+// Widest values the AVX2 kernel unpacks, whose bits and the up to 7 bits before them in their first byte fit in the
+// 32 bits it gathers
+const int AVX2_MAXBITS = 25;
+
+// Number of bits needed for the distances up to the given one
+int bitWidth(std::uint64_t range)
+{
+    int bits = 0;
+    while(range != 0){
+        range >>= 1;
+        bits++;
+    }
+    return bits;
+}
+
+int packedBytes(int count, int bits)
+{
+    return (int)(((std::int64_t)count * bits + 7) / 8);
+}
+
+// The bits of a value are stored from the lowest one on, starting at bit position * bits of the array. A value
+// spans at most 9 bytes, which are read and written as a word and the byte after it
+std::uint64_t readPacked(const unsigned char* in, int bits, int position)
+{
+    if(bits == 0){
+        return 0;
+    }
+    std::uint64_t bit = (std::uint64_t)position * bits;
+    const unsigned char* bytes = in + (bit >> 3);
+    int shift = (int)(bit & 7);
+    std::uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    std::uint64_t value = word >> shift;
+    if(shift + bits > 64){
+        value |= (std::uint64_t)bytes[8] << (64 - shift);
+    }
+    return bits == 64 ? value : value & ((1ull << bits) - 1);
+}
+
+// The array must be zeroed before the first value is written
+void writePacked(unsigned char* out, int bits, int position, std::uint64_t value)
+{
+    if(bits == 0){
+        return;
+    }
+    std::uint64_t bit = (std::uint64_t)position * bits;
+    unsigned char* bytes = out + (bit >> 3);
+    int shift = (int)(bit & 7);
+    std::uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    word |= value << shift;
+    memcpy(bytes, &word, sizeof(word));
+    if(shift + bits > 64){
+        bytes[8] |= (unsigned char)(value >> (64 - shift));
+    }
+}
+
+template <class T>
+const unsigned char* pageData(const PackedLeafNode<T>* node)
+{
+    return node->data + packedBytes(node->keySize, node->keyBits);
+}
+
+template <class T>
+const unsigned char* slotData(const PackedLeafNode<T>* node)
+{
+    return pageData(node) + packedBytes(node->keySize, node->pageBits);
+}
+
+// -----------------------------------------------------------------------------
+// Unpack kernels
+// -----------------------------------------------------------------------------
+
+void scalarUnpack(const unsigned char* in, int bits, int count, std::uint32_t* out)
+{
+    for(int i = 0; i < count; i++){
+        out[i] = (std::uint32_t)readPacked(in, bits, i);
+    }
+}
+
+#ifdef BADGERDB_X86_UNPACK
+
+__attribute__((target("avx2")))
+void avx2Unpack(const unsigned char* in, int bits, int count, std::uint32_t* out)
+{
+    if(bits == 0 || bits > AVX2_MAXBITS){
+        scalarUnpack(in, bits, count, out);
+        return;
+    }
+
+    // Every lane gathers the 32 bits from the first byte of its value on, and shifts the value down to bit 0
+    const __m256i mask = _mm256_set1_epi32((int)((1u << bits) - 1));
+    const __m256i low_bits = _mm256_set1_epi32(7);
+    const __m256i step = _mm256_set1_epi32(8 * bits);
+    __m256i bit = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(bits));
+    int i = 0;
+    for(; i + 8 <= count; i += 8){
+        __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(in), _mm256_srli_epi32(bit, 3), 1);
+        __m256i values = _mm256_and_si256(_mm256_srlv_epi32(words, _mm256_and_si256(bit, low_bits)), mask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), values);
+        bit = _mm256_add_epi32(bit, step);
+    }
+    for(; i < count; i++){
+        out[i] = (std::uint32_t)readPacked(in, bits, i);
+    }
+}
+
+#endif
+
+// -----------------------------------------------------------------------------
+// Runtime dispatch
+// -----------------------------------------------------------------------------
+
+bool cpuSupports(UnpackKernel kernel)
+{
+    switch(kernel){
+    case UNPACK_SCALAR:
+        return true;
+#ifdef BADGERDB_X86_UNPACK
+    case UNPACK_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+UnpackFunction kernelFunction(UnpackKernel kernel)
+{
+    if(!cpuSupports(kernel)){
+        return &scalarUnpack;
+    }
+    switch(kernel){
+#ifdef BADGERDB_X86_UNPACK
+    case UNPACK_AVX2:
+        return &avx2Unpack;
+#endif
+    default:
+        return &scalarUnpack;
+    }
+}
+
+// The scalar kernel is constant-initialized, so a node unpacked before dynamic initialization still decodes; the
+// selector below upgrades the pointer once the CPU features are known
+UnpackKernel activeKernel = UNPACK_SCALAR;
+UnpackFunction unpackFunction = &scalarUnpack;
+
+struct KernelSelector
+{
+    KernelSelector()
+    {
+        activeKernel = cpuSupports(UNPACK_AVX2) ? UNPACK_AVX2 : UNPACK_SCALAR;
+        unpackFunction = kernelFunction(activeKernel);
+    }
+} kernelSelector;
+
+}
+
+void unpackBits(const unsigned char* in, int bits, int count, std::uint32_t* out)
+{
+    unpackFunction(in, bits, count, out);
+}
+
+UnpackFunction unpackKernel(UnpackKernel kernel)
+{
+    return kernelFunction(kernel);
+}
+
+bool unpackKernelSupported(UnpackKernel kernel)
+{
+    return cpuSupports(kernel);
+}
+
+UnpackKernel activeUnpackKernel()
+{
+    return activeKernel;
+}
+
+const char* unpackKernelName(UnpackKernel kernel)
+{
+    switch(kernel){
+    case UNPACK_SCALAR:
+        return "scalar";
+    case UNPACK_AVX2:
+        return "avx2";
+    default:
+        return "unknown";
+    }
+}
+
+template <class T>
+void PackedBounds<T>::add(T key, const RecordId& rid)
+{
+    std::uint64_t value = packedKeyValue(key);
+    keyMin = std::min(keyMin, value);
+    keyMax = std::max(keyMax, value);
+    pageMin = std::min(pageMin, rid.page_number);
+    pageMax = std::max(pageMax, rid.page_number);
+    slotMin = std::min(slotMin, rid.slot_number);
+    slotMax = std::max(slotMax, rid.slot_number);
+    count++;
+}
+
+template <class T>
+void PackedBounds<T>::add(const PackedBounds& other)
+{
+    keyMin = std::min(keyMin, other.keyMin);
+    keyMax = std::max(keyMax, other.keyMax);
+    pageMin = std::min(pageMin, other.pageMin);
+    pageMax = std::max(pageMax, other.pageMax);
+    slotMin = std::min(slotMin, other.slotMin);
+    slotMax = std::max(slotMax, other.slotMax);
+    count += other.count;
+}
+
+template <class T>
+int PackedBounds<T>::bytes() const
+{
+    if(count == 0){
+        return PACKEDSLACKBYTES;
+    }
+    return packedBytes(count, bitWidth(keyMax - keyMin)) + packedBytes(count, bitWidth(pageMax - pageMin)) +
+           packedBytes(count, bitWidth(slotMax - slotMin)) + PACKEDSLACKBYTES;
+}
+
+template <class T>
+void initializePackedLeaf(PackedLeafNode<T>* node)
+{
+    node->keySize = 0;
+    node->format = PACKED_LIST;
+    node->rightSibPageNo = Page::INVALID_NUMBER;
+    node->leftSibPageNo = Page::INVALID_NUMBER;
+    node->highKey = T();
+    node->keyBase = 0;
+    node->pageBase = 0;
+    node->slotBase = 0;
+    node->keyBits = 0;
+    node->pageBits = 0;
+    node->slotBits = 0;
+}
+
+template <class T>
+bool encodePackedLeaf(PackedLeafNode<T>* node, const T* keys, const RecordId* rids, int count)
+{
+    PackedBounds<T> bounds;
+    for(int i = 0; i < count; i++){
+        bounds.add(keys[i], rids[i]);
+    }
+    if(!bounds.fits()){
+        return false;
+    }
+    node->keySize = count;
+    node->format = PACKED_LIST;
+    node->keyBase = count > 0 ? bounds.keyMin : 0;
+    node->pageBase = count > 0 ? bounds.pageMin : 0;
+    node->slotBase = count > 0 ? bounds.slotMin : 0;
+    node->keyBits = count > 0 ? bitWidth(bounds.keyMax - bounds.keyMin) : 0;
+    node->pageBits = count > 0 ? bitWidth(bounds.pageMax - bounds.pageMin) : 0;
+    node->slotBits = count > 0 ? bitWidth(bounds.slotMax - bounds.slotMin) : 0;
+    memset(node->data, 0, bounds.bytes());
+    unsigned char* page_data = node->data + packedBytes(count, node->keyBits);
+    unsigned char* slot_data = page_data + packedBytes(count, node->pageBits);
+    for(int i = 0; i < count; i++){
+        writePacked(node->data, node->keyBits, i, packedKeyValue(keys[i]) - node->keyBase);
+        writePacked(page_data, node->pageBits, i, rids[i].page_number - node->pageBase);
+        writePacked(slot_data, node->slotBits, i, rids[i].slot_number - node->slotBase);
+    }
+    return true;
+}
+
+template <class T>
+void decodePackedLeaf(const PackedLeafNode<T>* node, T* keys, RecordId* rids)
+{
+    // Keys of at most 32 bits and the record ids go through the unpack kernel, wider keys are read one at a time
+    std::uint32_t values[ PackedLeafNode<T>::MAXENTRIES ];
+    int count = node->keySize;
+    if(node->keyBits <= 32){
+        unpackBits(node->data, node->keyBits, count, values);
+        for(int i = 0; i < count; i++){
+            packedKeyFromValue(node->keyBase + values[i], keys[i]);
+        }
+    }
+    else{
+        for(int i = 0; i < count; i++){
+            packedKeyFromValue(node->keyBase + readPacked(node->data, node->keyBits, i), keys[i]);
+        }
+    }
+    unpackBits(pageData(node), node->pageBits, count, values);
+    for(int i = 0; i < count; i++){
+        rids[i].page_number = node->pageBase + values[i];
+        rids[i].padding = 0;
+    }
+    unpackBits(slotData(node), node->slotBits, count, values);
+    for(int i = 0; i < count; i++){
+        rids[i].slot_number = (SlotId)(node->slotBase + values[i]);
+    }
+}
+
+template <class T>
+T packedKey(const PackedLeafNode<T>* node, int position)
+{
+    T key;
+    packedKeyFromValue(node->keyBase + readPacked(node->data, node->keyBits, position), key);
+    return key;
+}
+
+template <class T>
+RecordId packedRid(const PackedLeafNode<T>* node, int position)
+{
+    RecordId rid;
+    rid.page_number = node->pageBase + (PageId)readPacked(pageData(node), node->pageBits, position);
+    rid.slot_number = (SlotId)(node->slotBase + readPacked(slotData(node), node->slotBits, position));
+    rid.padding = 0;
+    return rid;
+}
+
+template <class T>
+int packedLowerBound(const PackedLeafNode<T>* node, T key)
+{
+    int low = 0;
+    int high = node->keySize;
+    while(low < high){
+        int middle = low + (high - low) / 2;
+        if(packedKey(node, middle) < key){
+            low = middle + 1;
+        }
+        else{
+            high = middle;
+        }
+    }
+    return low;
+}
+
+template <class T>
+int packedUpperBound(const PackedLeafNode<T>* node, T key)
+{
+    int low = 0;
+    int high = node->keySize;
+    while(low < high){
+        int middle = low + (high - low) / 2;
+        if(key < packedKey(node, middle)){
+            high = middle;
+        }
+        else{
+            low = middle + 1;
+        }
+    }
+    return low;
+}
+
+template <class T>
+int packedNodeUsedBytes(const PackedLeafNode<T>* node)
+{
+    return packedBytes(node->keySize, node->keyBits) + packedBytes(node->keySize, node->pageBits) +
+           packedBytes(node->keySize, node->slotBits) + PACKEDSLACKBYTES;
+}
+
+template <class T>
+int choosePackedSplit(const T* keys, const RecordId* rids, int count, double leftFill)
+{
+    // The bounds of every prefix and every suffix of the entries tell in constant time whether a split fits
+    std::vector<PackedBounds<T> > prefix(count + 1);
+    std::vector<PackedBounds<T> > suffix(count + 1);
+    for(int i = 0; i < count; i++){
+        prefix[i + 1] = prefix[i];
+        prefix[i + 1].add(keys[i], rids[i]);
+    }
+    for(int i = count - 1; i >= 0; i--){
+        suffix[i] = suffix[i + 1];
+        suffix[i].add(keys[i], rids[i]);
+    }
+
+    // Like an entry list, the left node keeps leftFill of the entries, half of them rounded up for an even split
+    int split = std::min(count - 1, std::max(1, (int)(leftFill * (count - 1)) + 1));
+    for(int distance = 0; distance < count; distance++){
+        int candidates[2] = {split - distance, split + distance};
+        for(int i = 0; i < 2; i++){
+            int c = candidates[i];
+            if(c >= 1 && c < count && prefix[c].fits() && suffix[c].fits()){
+                return c;
+            }
+        }
+    }
+    return split;
+}
+
+template struct PackedBounds<int>;
+template void initializePackedLeaf<int>(PackedLeafNode<int>*);
+template bool encodePackedLeaf<int>(PackedLeafNode<int>*, const int*, const RecordId*, int);
+template void decodePackedLeaf<int>(const PackedLeafNode<int>*, int*, RecordId*);
+template int packedKey<int>(const PackedLeafNode<int>*, int);
+template RecordId packedRid<int>(const PackedLeafNode<int>*, int);
+template int packedLowerBound<int>(const PackedLeafNode<int>*, int);
+template int packedUpperBound<int>(const PackedLeafNode<int>*, int);
+template int packedNodeUsedBytes<int>(const PackedLeafNode<int>*);
+template int choosePackedSplit<int>(const int*, const RecordId*, int, double);
+
+template struct PackedBounds<double>;
+template void initializePackedLeaf<double>(PackedLeafNode<double>*);
+template bool encodePackedLeaf<double>(PackedLeafNode<double>*, const double*, const RecordId*, int);
+template void decodePackedLeaf<double>(const PackedLeafNode<double>*, double*, RecordId*);
+template double packedKey<double>(const PackedLeafNode<double>*, int);
+template RecordId packedRid<double>(const PackedLeafNode<double>*, int);
+template int packedLowerBound<double>(const PackedLeafNode<double>*, double);
+template int packedUpperBound<double>(const PackedLeafNode<double>*, double);
+template int packedNodeUsedBytes<double>(const PackedLeafNode<double>*);
+template int choosePackedSplit<double>(const double*, const RecordId*, int, double);
+
+template struct PackedBounds<std::int64_t>;
+template void initializePackedLeaf<std::int64_t>(PackedLeafNode<std::int64_t>*);
+template bool encodePackedLeaf<std::int64_t>(PackedLeafNode<std::int64_t>*, const std::int64_t*, const RecordId*, int);
+template void decodePackedLeaf<std::int64_t>(const PackedLeafNode<std::int64_t>*, std::int64_t*, RecordId*);
+template std::int64_t packedKey<std::int64_t>(const PackedLeafNode<std::int64_t>*, int);
+template RecordId packedRid<std::int64_t>(const PackedLeafNode<std::int64_t>*, int);
+template int packedLowerBound<std::int64_t>(const PackedLeafNode<std::int64_t>*, std::int64_t);
+template int packedUpperBound<std::int64_t>(const PackedLeafNode<std::int64_t>*, std::int64_t);
+template int packedNodeUsedBytes<std::int64_t>(const PackedLeafNode<std::int64_t>*);
+template int choosePackedSplit<std::int64_t>(const std::int64_t*, const RecordId*, int, double);
+
+}
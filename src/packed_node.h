@@ -0,0 +1,290 @@
+/**
+ * @file packed_node.h
+ * @brief Packed format of B+ tree leaf nodes for fixed size keys, where the keys and the page and slot numbers of the
+ * record ids are frame-of-reference encoded: every value is stored as its distance to the smallest value of its
+ * column in the node, bit-packed with as many bits as the greatest distance takes. Dense keys and clustered record
+ * ids then take a few bits an entry instead of the bytes of LeafNode, and a scan unpacks a node with a SIMD kernel;
+ * every change unpacks and packs the node again. Repeated keys stay entries, never posting lists. Only indexes on
+ * INTEGER, DOUBLE and INT64 keys without included columns pack their leaves, see IndexOptions::packedLeaves, and an
+ * index file keeps the format of its leaves whatever the option is when it is opened again.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "types.h"
+#include "page.h"
+#include "posting_node.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of bytes left free after the packed values of a node, so a kernel may read whole words past the
+ * last value.
+ */
+const int PACKEDSLACKBYTES = 16;
+
+/**
+ * @brief Structure for leaf nodes in the PACKED_LIST format, templated on the type of the key. The header has the
+ * layout of the header of LeafNode, so the siblings and the format of any leaf can be read through either structure.
+ * The data area holds the packed keys, then the packed page numbers, then the packed slot numbers, each starting on
+ * a byte. The padding of the record ids is not stored.
+*/
+template <class T>
+struct PackedLeafNode{
+  /**
+   * Number of entries in the node.
+   */
+	int keySize;
+
+  /**
+   * Always PACKED_LIST.
+   */
+	LeafFormat format;
+
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Greatest key the leaf may hold, if it has a right sibling.
+   */
+	T highKey;
+
+  /**
+   * Smallest key of the node, as its packedKeyValue.
+   */
+	std::uint64_t keyBase;
+
+  /**
+   * Smallest page number of the record ids of the node.
+   */
+	PageId pageBase;
+
+  /**
+   * Smallest slot number of the record ids of the node.
+   */
+	SlotId slotBase;
+
+  /**
+   * Bits of a packed key, page number and slot number.
+   */
+	unsigned char keyBits;
+	unsigned char pageBits;
+	unsigned char slotBits;
+
+  /**
+   * Size of the data area.
+   */
+	static const int DATASIZE = Page::SIZE - 2 * sizeof(int) - 3 * sizeof(PageId) - sizeof(std::uint64_t) -
+	                            sizeof(SlotId) - 3 - (sizeof(T) + 7) / 8 * 8;
+
+  /**
+   * Number of entries which fit in a node whatever their keys and record ids are.
+   */
+	static const int SAFEENTRIES = (DATASIZE - PACKEDSLACKBYTES - 3) * 8 / (8 * (sizeof(T) + sizeof(PageId) + sizeof(SlotId)));
+
+  /**
+   * Number of entries a node holds at most. A full node with one more entry splits into halves of at most
+   * SAFEENTRIES entries, which always fit.
+   */
+	static const int MAXENTRIES = 2 * SAFEENTRIES - 1;
+
+  /**
+   * Packed keys, page numbers and slot numbers.
+   */
+	unsigned char data[ DATASIZE ];
+};
+
+static_assert(sizeof(PackedLeafNode<int>) <= Page::SIZE && sizeof(PackedLeafNode<double>) <= Page::SIZE &&
+              sizeof(PackedLeafNode<std::int64_t>) <= Page::SIZE, "Packed leaf nodes must fit in a page.");
+
+/**
+ * @brief A key as an unsigned number in the order of the keys, so close keys are close numbers. Signed keys have
+ * their sign bit flipped, DOUBLE keys are ordered like their values, with -0.0 just before 0.0.
+ */
+inline std::uint64_t packedKeyValue(int key)
+{
+	return (std::uint32_t)key ^ 0x80000000u;
+}
+
+inline std::uint64_t packedKeyValue(std::int64_t key)
+{
+	return (std::uint64_t)key ^ 0x8000000000000000ull;
+}
+
+inline std::uint64_t packedKeyValue(double key)
+{
+	std::uint64_t bits;
+	memcpy(&bits, &key, sizeof(bits));
+	return (bits & 0x8000000000000000ull) ? ~bits : (bits | 0x8000000000000000ull);
+}
+
+/**
+ * @brief The key of a packedKeyValue.
+ */
+inline void packedKeyFromValue(std::uint64_t value, int& key)
+{
+	key = (int)((std::uint32_t)value ^ 0x80000000u);
+}
+
+inline void packedKeyFromValue(std::uint64_t value, std::int64_t& key)
+{
+	key = (std::int64_t)(value ^ 0x8000000000000000ull);
+}
+
+inline void packedKeyFromValue(std::uint64_t value, double& key)
+{
+	std::uint64_t bits = (value & 0x8000000000000000ull) ? (value & ~0x8000000000000000ull) : ~value;
+	memcpy(&key, &bits, sizeof(key));
+}
+
+/**
+ * @brief Smallest and greatest values of every column of entries going into a packed node, which decide how many
+ * bytes the node needs for them. Entries are added one at a time, so a node being filled knows when the next entry
+ * no longer fits.
+ */
+template <class T>
+struct PackedBounds{
+	std::uint64_t keyMin;
+	std::uint64_t keyMax;
+	PageId pageMin;
+	PageId pageMax;
+	SlotId slotMin;
+	SlotId slotMax;
+
+  /**
+   * Number of entries added.
+   */
+	int count;
+
+	PackedBounds() : keyMin(~0ull), keyMax(0), pageMin(~(PageId)0), pageMax(0), slotMin(~(SlotId)0), slotMax(0),
+	                 count(0) {}
+
+	void add(T key, const RecordId& rid);
+	void add(const PackedBounds& other);
+
+  /**
+   * Number of bytes of the data area the entries take, with the slack.
+   */
+	int bytes() const;
+
+  /**
+   * True if the entries fit in one node.
+   */
+	bool fits() const { return count <= PackedLeafNode<T>::MAXENTRIES && bytes() <= PackedLeafNode<T>::DATASIZE; }
+};
+
+/**
+ * @brief Initialize an empty packed leaf node without siblings.
+ */
+template <class T>
+void initializePackedLeaf(PackedLeafNode<T>* node);
+
+/**
+ * @brief Write count entries, sorted by key, into the node. Only keySize, format, the bases, the widths and the data
+ * area are written, the caller sets the siblings.
+ * @return False, with the node unchanged, if the entries do not fit
+ */
+template <class T>
+bool encodePackedLeaf(PackedLeafNode<T>* node, const T* keys, const RecordId* rids, int count);
+
+/**
+ * @brief Unpack all entries of the node into keys and rids, which have room for keySize entries.
+ */
+template <class T>
+void decodePackedLeaf(const PackedLeafNode<T>* node, T* keys, RecordId* rids);
+
+/**
+ * @brief Key of the entry at the given position of the node, unpacked alone.
+ */
+template <class T>
+T packedKey(const PackedLeafNode<T>* node, int position);
+
+/**
+ * @brief Record id of the entry at the given position of the node, unpacked alone.
+ */
+template <class T>
+RecordId packedRid(const PackedLeafNode<T>* node, int position);
+
+/**
+ * @brief Return the position of the first entry of the node whose key is greater than or equal to the given key,
+ * unpacking only the keys a binary search probes.
+ */
+template <class T>
+int packedLowerBound(const PackedLeafNode<T>* node, T key);
+
+/**
+ * @brief Return the position of the first entry of the node whose key is strictly greater than the given key.
+ */
+template <class T>
+int packedUpperBound(const PackedLeafNode<T>* node, T key);
+
+/**
+ * @brief Number of bytes of the data area in use, with the slack.
+ */
+template <class T>
+int packedNodeUsedBytes(const PackedLeafNode<T>* node);
+
+/**
+ * @brief Choose where to split count sorted entries which do not fit in one node, entries [0, split) going to the
+ * left node and [split, count) to the right one. The split closest to the given fraction of the entries is taken
+ * among those whose halves both fit. At least two entries are needed.
+ */
+template <class T>
+int choosePackedSplit(const T* keys, const RecordId* rids, int count, double leftFill);
+
+/**
+ * @brief Kernels available for unpacking bit-packed values.
+ */
+enum UnpackKernel
+{
+	UNPACK_SCALAR = 0,	/* One value at a time, from the 64 bits around it */
+	UNPACK_AVX2 = 1		/* Eight values at a time with AVX2 gathers and shifts, for values of at most 25 bits */
+};
+
+/**
+ * @brief Signature shared by all unpack kernels: unpack count values of the given number of bits, at most 32, packed
+ * from the first bit of in on, into out. in must be followed by PACKEDSLACKBYTES readable bytes.
+ */
+typedef void (*UnpackFunction)(const unsigned char* in, int bits, int count, std::uint32_t* out);
+
+/**
+ * @brief Unpack values with the kernel picked once at start-up from the CPU features.
+ */
+void unpackBits(const unsigned char* in, int bits, int count, std::uint32_t* out);
+
+/**
+ * @brief Get the function of the given kernel. Falls back to UNPACK_SCALAR if the kernel is not supported by the CPU.
+ */
+UnpackFunction unpackKernel(UnpackKernel kernel);
+
+/**
+ * @brief Check whether the given kernel can run on this CPU.
+ */
+bool unpackKernelSupported(UnpackKernel kernel);
+
+/**
+ * @brief Kernel picked at start-up for unpackBits().
+ */
+UnpackKernel activeUnpackKernel();
+
+/**
+ * @brief Human readable name of a kernel, for benchmark output.
+ */
+const char* unpackKernelName(UnpackKernel kernel);
+
+}
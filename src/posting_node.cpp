@@ -0,0 +1,347 @@
+/**
+ * @file posting_node.cpp
+ * @brief Posting list format of B+ tree leaf nodes for fixed size keys, where every key is stored once with the
+ * sorted record ids of its entries, and a key with many entries keeps its record ids in overflow pages.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "posting_node.h"
+
+namespace badgerdb
+{
+
+namespace
+{
+
+// A record id as one number, which grows along with the order of ridLess
+std::uint64_t ridValue(const RecordId& rid)
+{
+    return ((std::uint64_t)rid.page_number << 16) | rid.slot_number;
+}
+
+int varintBytes(std::uint64_t value)
+{
+    int bytes = 1;
+    while(value >= 0x80){
+        value >>= 7;
+        bytes++;
+    }
+    return bytes;
+}
+
+// Number of bytes of the record ids kept in the node, 0 if they are or will be in overflow pages
+template <class T>
+int inlineRidBytes(const Posting<T>& posting)
+{
+    if(posting.overflowPageNo != Page::INVALID_NUMBER){
+        return 0;
+    }
+    int bytes = ridListBytes(posting.rids.data(), (int)posting.rids.size());
+    return bytes > PostingLeafNode<T>::INLINEBYTES ? 0 : bytes;
+}
+
+// Number of bytes of the data area taken by a posting, its slot and the record ids kept in the node
+template <class T>
+int postingBytes(const Posting<T>& posting)
+{
+    return sizeof(PostingSlot<T>) + inlineRidBytes(posting);
+}
+
+template <class T, bool Upper>
+int postingSearch(const PostingLeafNode<T>* node, T key)
+{
+    const PostingSlot<T>* slots = node->slots();
+    int low = 0;
+    int len = node->keySize;
+    while(len > 0){
+        int half = len / 2;
+        bool right = Upper ? !(key < slots[low + half].key) : slots[low + half].key < key;
+        if(right){
+            low += half + 1;
+            len -= half + 1;
+        }
+        else{
+            len = half;
+        }
+    }
+    return low;
+}
+
+}
+
+int ridListBytes(const RecordId* rids, int count)
+{
+    int bytes = 0;
+    std::uint64_t previous = 0;
+    for(int i = 0; i < count; i++){
+        std::uint64_t value = ridValue(rids[i]);
+        bytes += varintBytes(value - previous);
+        previous = value;
+    }
+    return bytes;
+}
+
+int ridDeltaBytes(const RecordId& previous, const RecordId& rid)
+{
+    return varintBytes(ridValue(rid) - ridValue(previous));
+}
+
+int encodeRidList(const RecordId* rids, int count, char* out)
+{
+    unsigned char* p = reinterpret_cast<unsigned char*>(out);
+    std::uint64_t previous = 0;
+    for(int i = 0; i < count; i++){
+        std::uint64_t value = ridValue(rids[i]);
+        std::uint64_t delta = value - previous;
+        previous = value;
+        while(delta >= 0x80){
+            *p++ = (unsigned char)(delta | 0x80);
+            delta >>= 7;
+        }
+        *p++ = (unsigned char)delta;
+    }
+    return (int)(p - reinterpret_cast<unsigned char*>(out));
+}
+
+void decodeRidList(const char* in, int count, std::vector<RecordId>& rids)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(in);
+    std::uint64_t value = 0;
+    for(int i = 0; i < count; i++){
+        std::uint64_t delta = 0;
+        int shift = 0;
+        while(*p & 0x80){
+            delta |= (std::uint64_t)(*p++ & 0x7f) << shift;
+            shift += 7;
+        }
+        delta |= (std::uint64_t)(*p++) << shift;
+        value += delta;
+        RecordId rid;
+        rid.page_number = (PageId)(value >> 16);
+        rid.slot_number = (SlotId)(value & 0xffff);
+        rid.padding = 0;
+        rids.push_back(rid);
+    }
+}
+
+int ridsFitting(const RecordId* rids, int count, int limit)
+{
+    int bytes = 0;
+    std::uint64_t previous = 0;
+    for(int i = 0; i < count; i++){
+        std::uint64_t value = ridValue(rids[i]);
+        bytes += varintBytes(value - previous);
+        if(bytes > limit){
+            return i;
+        }
+        previous = value;
+    }
+    return count;
+}
+
+template <class T>
+int postingLowerBound(const PostingLeafNode<T>* node, T key)
+{
+    return postingSearch<T, false>(node, key);
+}
+
+template <class T>
+int postingUpperBound(const PostingLeafNode<T>* node, T key)
+{
+    return postingSearch<T, true>(node, key);
+}
+
+template <class T>
+int postingEntryIndex(const PostingLeafNode<T>* node, int slot)
+{
+    int index = 0;
+    for(int i = 0; i < slot; i++){
+        index += node->slots()[i].ridCount;
+    }
+    return index;
+}
+
+template <class T>
+int postingNodeUsedBytes(const PostingLeafNode<T>* node)
+{
+    int bytes = node->keySize * sizeof(PostingSlot<T>);
+    for(int i = 0; i < node->keySize; i++){
+        bytes += node->slots()[i].ridBytes;
+    }
+    return bytes;
+}
+
+template <class T>
+void decodePostingLeaf(const PostingLeafNode<T>* node, std::vector<Posting<T> >& postings)
+{
+    postings.resize(node->keySize);
+    for(int i = 0; i < node->keySize; i++){
+        const PostingSlot<T>& slot = node->slots()[i];
+        postings[i].key = slot.key;
+        postings[i].ridCount = slot.ridCount;
+        postings[i].overflowPageNo = slot.overflowPageNo;
+        postings[i].rids.clear();
+        if(slot.overflowPageNo == Page::INVALID_NUMBER){
+            decodeRidList(node->ridData() + slot.ridOffset, slot.ridCount, postings[i].rids);
+        }
+    }
+}
+
+template <class T>
+void groupPostings(const T* keys, const RecordId* rids, int count, std::vector<Posting<T> >& postings)
+{
+    postings.clear();
+    for(int i = 0; i < count; i++){
+        if(postings.empty() || postings.back().key < keys[i]){
+            postings.push_back(Posting<T>());
+            postings.back().key = keys[i];
+            postings.back().ridCount = 0;
+            postings.back().overflowPageNo = Page::INVALID_NUMBER;
+        }
+        postings.back().rids.push_back(rids[i]);
+        postings.back().ridCount++;
+    }
+
+    // Entries of one key are in the order they were inserted in
+    for(size_t i = 0; i < postings.size(); i++){
+        std::sort(postings[i].rids.begin(), postings[i].rids.end(), ridLess);
+    }
+}
+
+template <class T>
+void addPostingEntry(std::vector<Posting<T> >& postings, T key, RecordId rid)
+{
+    size_t i = 0;
+    while(i < postings.size() && postings[i].key < key){
+        i++;
+    }
+    if(i == postings.size() || key < postings[i].key){
+        Posting<T> posting;
+        posting.key = key;
+        posting.ridCount = 0;
+        posting.overflowPageNo = Page::INVALID_NUMBER;
+        postings.insert(postings.begin() + i, posting);
+    }
+    std::vector<RecordId>& rids = postings[i].rids;
+    rids.insert(std::upper_bound(rids.begin(), rids.end(), rid, ridLess), rid);
+    postings[i].ridCount++;
+}
+
+template <class T>
+int postingEntryCount(const std::vector<Posting<T> >& postings, int first, int last)
+{
+    int count = 0;
+    for(int i = first; i < last; i++){
+        count += postings[i].ridCount;
+    }
+    return count;
+}
+
+template <class T>
+int postingLeafBytes(const std::vector<Posting<T> >& postings, int first, int last)
+{
+    int bytes = 0;
+    for(int i = first; i < last; i++){
+        bytes += postingBytes(postings[i]);
+    }
+    return bytes;
+}
+
+template <class T>
+bool encodePostingLeaf(PostingLeafNode<T>* node, const std::vector<Posting<T> >& postings, int first, int last)
+{
+    // Count the record ids kept in the node in full, in case a caller did not move them to overflow pages
+    int bytes = (last - first) * sizeof(PostingSlot<T>);
+    for(int i = first; i < last; i++){
+        if(postings[i].overflowPageNo == Page::INVALID_NUMBER){
+            bytes += ridListBytes(postings[i].rids.data(), (int)postings[i].rids.size());
+        }
+    }
+    if(bytes > PostingLeafNode<T>::DATASIZE){
+        return false;
+    }
+
+    node->keySize = last - first;
+    node->format = POSTING_LIST;
+    char* rid_data = node->ridData();
+    int offset = 0;
+    for(int i = first; i < last; i++){
+        const Posting<T>& posting = postings[i];
+        PostingSlot<T>& slot = node->slots()[i - first];
+        slot.key = posting.key;
+        slot.ridCount = posting.ridCount;
+        slot.overflowPageNo = posting.overflowPageNo;
+        slot.ridOffset = (unsigned short)offset;
+        slot.ridBytes = 0;
+        if(posting.overflowPageNo == Page::INVALID_NUMBER){
+            slot.ridBytes = (unsigned short)encodeRidList(posting.rids.data(), (int)posting.rids.size(), rid_data + offset);
+            offset += slot.ridBytes;
+        }
+    }
+    return true;
+}
+
+template <class T>
+int choosePostingSplit(const std::vector<Posting<T> >& postings, double leftFill)
+{
+    // Take the split which leaves the left half closest to its share of the bytes, each half keeping at least one
+    // posting
+    int n = (int)postings.size();
+    int total = postingLeafBytes(postings, 0, n);
+    int best = 1;
+    double best_difference = total;
+    int left = 0;
+    for(int split = 1; split < n; split++){
+        left += postingBytes(postings[split - 1]);
+        double difference = std::abs(total * leftFill - left);
+        if(difference < best_difference){
+            best = split;
+            best_difference = difference;
+        }
+    }
+    return best;
+}
+
+template int postingLowerBound<int>(const PostingLeafNode<int>*, int);
+template int postingUpperBound<int>(const PostingLeafNode<int>*, int);
+template int postingEntryIndex<int>(const PostingLeafNode<int>*, int);
+template int postingNodeUsedBytes<int>(const PostingLeafNode<int>*);
+template void decodePostingLeaf<int>(const PostingLeafNode<int>*, std::vector<Posting<int> >&);
+template void groupPostings<int>(const int*, const RecordId*, int, std::vector<Posting<int> >&);
+template void addPostingEntry<int>(std::vector<Posting<int> >&, int, RecordId);
+template int postingEntryCount<int>(const std::vector<Posting<int> >&, int, int);
+template int postingLeafBytes<int>(const std::vector<Posting<int> >&, int, int);
+template bool encodePostingLeaf<int>(PostingLeafNode<int>*, const std::vector<Posting<int> >&, int, int);
+template int choosePostingSplit<int>(const std::vector<Posting<int> >&, double);
+
+template int postingLowerBound<double>(const PostingLeafNode<double>*, double);
+template int postingUpperBound<double>(const PostingLeafNode<double>*, double);
+template int postingEntryIndex<double>(const PostingLeafNode<double>*, int);
+template int postingNodeUsedBytes<double>(const PostingLeafNode<double>*);
+template void decodePostingLeaf<double>(const PostingLeafNode<double>*, std::vector<Posting<double> >&);
+template void groupPostings<double>(const double*, const RecordId*, int, std::vector<Posting<double> >&);
+template void addPostingEntry<double>(std::vector<Posting<double> >&, double, RecordId);
+template int postingEntryCount<double>(const std::vector<Posting<double> >&, int, int);
+template int postingLeafBytes<double>(const std::vector<Posting<double> >&, int, int);
+template bool encodePostingLeaf<double>(PostingLeafNode<double>*, const std::vector<Posting<double> >&, int, int);
+template int choosePostingSplit<double>(const std::vector<Posting<double> >&, double);
+
+template int postingLowerBound<std::int64_t>(const PostingLeafNode<std::int64_t>*, std::int64_t);
+template int postingUpperBound<std::int64_t>(const PostingLeafNode<std::int64_t>*, std::int64_t);
+template int postingEntryIndex<std::int64_t>(const PostingLeafNode<std::int64_t>*, int);
+template int postingNodeUsedBytes<std::int64_t>(const PostingLeafNode<std::int64_t>*);
+template void decodePostingLeaf<std::int64_t>(const PostingLeafNode<std::int64_t>*, std::vector<Posting<std::int64_t> >&);
+template void groupPostings<std::int64_t>(const std::int64_t*, const RecordId*, int, std::vector<Posting<std::int64_t> >&);
+template void addPostingEntry<std::int64_t>(std::vector<Posting<std::int64_t> >&, std::int64_t, RecordId);
+template int postingEntryCount<std::int64_t>(const std::vector<Posting<std::int64_t> >&, int, int);
+template int postingLeafBytes<std::int64_t>(const std::vector<Posting<std::int64_t> >&, int, int);
+template bool encodePostingLeaf<std::int64_t>(PostingLeafNode<std::int64_t>*, const std::vector<Posting<std::int64_t> >&, int, int);
+template int choosePostingSplit<std::int64_t>(const std::vector<Posting<std::int64_t> >&, double);
+
+}
@@ -0,0 +1,296 @@
+/**
+ * @file posting_node.h
+ * @brief Posting list format of B+ tree leaf nodes for fixed size keys, where every key is stored once with the
+ * sorted record ids of its entries, and a key with many entries keeps its record ids in overflow pages.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "types.h"
+#include "page.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Layout of the entries of a leaf node for fixed size keys, kept in the header every leaf format shares.
+ */
+enum LeafFormat
+{
+	ENTRY_LIST = 0,	/* A key and a record id per entry, see LeafNode */
+	POSTING_LIST = 1,	/* Every key once, followed by the record ids of its entries, see PostingLeafNode */
+	COVERING_LIST = 2,	/* A key, a record id and the included columns per entry, see CoveringLeafNode */
+	PACKED_LIST = 3	/* Keys and record ids frame-of-reference encoded and bit-packed, see PackedLeafNode */
+};
+
+/**
+ * @brief Slot of a key in a posting list leaf node.
+ */
+template <class T>
+struct PostingSlot{
+  /**
+   * The key.
+   */
+	T key;
+
+  /**
+   * Number of entries with the key, i.e. of record ids in the node or in the overflow pages.
+   */
+	int ridCount;
+
+  /**
+   * First overflow page holding the record ids of the key, or an invalid page number if they are in the node.
+   */
+	PageId overflowPageNo;
+
+  /**
+   * Offset of the encoded record ids of the key in the record id area of the node, if they are in the node.
+   */
+	unsigned short ridOffset;
+
+  /**
+   * Number of bytes of the encoded record ids of the key in the node, 0 if they are in overflow pages.
+   */
+	unsigned short ridBytes;
+};
+
+/**
+ * @brief Structure for leaf nodes in the POSTING_LIST format, templated on the type of the key. The header has the
+ * layout of the header of LeafNode, so the siblings and the format of any leaf can be read through either
+ * structure. The data area holds the slots, sorted by key, followed by the record id area, where the sorted record
+ * ids of every slot which keeps them in the node are encoded by encodeRidList, slot after slot.
+*/
+template <class T>
+struct PostingLeafNode{
+	typedef PostingSlot<T> Slot;
+
+  /**
+   * Number of keys, i.e. of slots, in the node.
+   */
+	int keySize;
+
+  /**
+   * Always POSTING_LIST.
+   */
+	LeafFormat format;
+
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Greatest key the leaf may hold, if it has a right sibling.
+   */
+	T highKey;
+
+  /**
+   * Size of the data area.
+   */
+	static const int DATASIZE = Page::SIZE - 2 * sizeof(int) - 2 * sizeof(PageId) - sizeof(T);
+
+  /**
+   * A key whose encoded record ids take more bytes than this keeps them in overflow pages, so a node always has room
+   * for a few keys.
+   */
+	static const int INLINEBYTES = DATASIZE / 4;
+
+  /**
+   * Slots and record ids.
+   */
+	char data[ DATASIZE ];
+
+	Slot* slots() { return reinterpret_cast<Slot*>(data); }
+	const Slot* slots() const { return reinterpret_cast<const Slot*>(data); }
+	char* ridData() { return data + keySize * sizeof(Slot); }
+	const char* ridData() const { return data + keySize * sizeof(Slot); }
+};
+
+/**
+ * @brief Overflow page of the record ids of a key. The pages of a key are chained from the first one on, and every
+ * page holds a run of the sorted record ids, encoded by encodeRidList.
+ */
+struct PostingOverflowPage{
+  /**
+   * Size of the data area.
+   */
+	static const int DATASIZE = Page::SIZE - 2 * sizeof(int) - sizeof(PageId) - sizeof(RecordId);
+
+  /**
+   * Number of record ids in the page.
+   */
+	int ridCount;
+
+  /**
+   * Number of bytes of the data area in use.
+   */
+	int byteCount;
+
+  /**
+   * Page number of the next overflow page of the key, or an invalid page number for the last one.
+   */
+	PageId nextPageNo;
+
+  /**
+   * Greatest record id of the page, so an insert finds its page without decoding the pages before it.
+   */
+	RecordId lastRid;
+
+  /**
+   * Encoded record ids.
+   */
+	char data[ DATASIZE ];
+};
+
+static_assert(sizeof(PostingLeafNode<int>) <= Page::SIZE && sizeof(PostingLeafNode<double>) <= Page::SIZE &&
+              sizeof(PostingLeafNode<std::int64_t>) <= Page::SIZE && sizeof(PostingOverflowPage) <= Page::SIZE,
+              "Posting list pages must fit in a page.");
+
+/**
+ * @brief A key and its record ids, decoded from a leaf node of either format to be changed and written back.
+ */
+template <class T>
+struct Posting{
+  /**
+   * The key.
+   */
+	T key;
+
+  /**
+   * Number of entries with the key.
+   */
+	int ridCount;
+
+  /**
+   * First overflow page holding the record ids, or an invalid page number if they are in rids.
+   */
+	PageId overflowPageNo;
+
+  /**
+   * Record ids of the key, sorted, unless they are in overflow pages.
+   */
+	std::vector<RecordId> rids;
+};
+
+/**
+ * @brief Order of record ids within a posting list, by page number and then slot number.
+ */
+inline bool ridLess(const RecordId& a, const RecordId& b)
+{
+	return a.page_number != b.page_number ? a.page_number < b.page_number : a.slot_number < b.slot_number;
+}
+
+/**
+ * @brief Number of bytes encodeRidList takes for the sorted record ids.
+ */
+int ridListBytes(const RecordId* rids, int count);
+
+/**
+ * @brief Number of bytes encodeRidList takes for a record id which follows the given one in a list.
+ */
+int ridDeltaBytes(const RecordId& previous, const RecordId& rid);
+
+/**
+ * @brief Encode sorted record ids compactly. Every record id is stored as the difference of its page and slot number
+ * to those of the record id before it, in a variable number of bytes, 7 bits to a byte. The record ids of a key
+ * mostly sit close together in the relation, so most of them take one or two bytes.
+ * @return Number of bytes written
+ */
+int encodeRidList(const RecordId* rids, int count, char* out);
+
+/**
+ * @brief Decode count record ids written by encodeRidList and append them to rids.
+ */
+void decodeRidList(const char* in, int count, std::vector<RecordId>& rids);
+
+/**
+ * @brief Number of the sorted record ids, from the first on, whose encoding fits within the given number of bytes.
+ */
+int ridsFitting(const RecordId* rids, int count, int limit);
+
+/**
+ * @brief Return the position of the first slot of the node whose key is greater than or equal to the given key.
+ */
+template <class T>
+int postingLowerBound(const PostingLeafNode<T>* node, T key);
+
+/**
+ * @brief Return the position of the first slot of the node whose key is strictly greater than the given key.
+ */
+template <class T>
+int postingUpperBound(const PostingLeafNode<T>* node, T key);
+
+/**
+ * @brief Number of entries of the slots before the given slot, i.e. position of the first entry of the slot when
+ * the node is read as a list of entries.
+ */
+template <class T>
+int postingEntryIndex(const PostingLeafNode<T>* node, int slot);
+
+/**
+ * @brief Number of bytes of the data area in use by the slots and the record ids kept in the node.
+ */
+template <class T>
+int postingNodeUsedBytes(const PostingLeafNode<T>* node);
+
+/**
+ * @brief Decode the slots and the record ids kept in the node. Record ids in overflow pages are not read.
+ */
+template <class T>
+void decodePostingLeaf(const PostingLeafNode<T>* node, std::vector<Posting<T> >& postings);
+
+/**
+ * @brief Group count entries, sorted by key, into one posting per key, with the record ids of a key sorted.
+ */
+template <class T>
+void groupPostings(const T* keys, const RecordId* rids, int count, std::vector<Posting<T> >& postings);
+
+/**
+ * @brief Add an entry to the sorted postings, whose posting of the key, if any, keeps its record ids in rids.
+ */
+template <class T>
+void addPostingEntry(std::vector<Posting<T> >& postings, T key, RecordId rid);
+
+/**
+ * @brief Number of entries of the postings [first, last).
+ */
+template <class T>
+int postingEntryCount(const std::vector<Posting<T> >& postings, int first, int last);
+
+/**
+ * @brief Number of bytes of the data area needed to store the postings [first, last) in one posting list node.
+ * A posting whose record ids take more than PostingLeafNode::INLINEBYTES counts as keeping them in overflow pages,
+ * where they go before the node is written.
+ */
+template <class T>
+int postingLeafBytes(const std::vector<Posting<T> >& postings, int first, int last);
+
+/**
+ * @brief Write the postings [first, last) into the node. Only keySize, format and the data area are written, the
+ * caller sets the siblings. Postings which keep their record ids in rids must not take more than INLINEBYTES.
+ * @return False, with the node unchanged, if the postings do not fit
+ */
+template <class T>
+bool encodePostingLeaf(PostingLeafNode<T>* node, const std::vector<Posting<T> >& postings, int first, int last);
+
+/**
+ * @brief Choose where to split the postings of an overflowing node, postings [0, split) going to the left node and
+ * [split, n) to the right node, with the left half taking about the given fraction of the bytes. At least two
+ * postings are needed.
+ */
+template <class T>
+int choosePostingSplit(const std::vector<Posting<T> >& postings, double leftFill);
+
+}
@@ -0,0 +1,112 @@
+/**
+ * @file resident_levels.cpp
+ * @brief Decoded copies of the non-leaf nodes of the top levels of a B+ tree on fixed size keys, kept in memory so a
+ * descent searches them without going through the buffer pool.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include "resident_levels.h"
+
+namespace badgerdb
+{
+
+namespace
+{
+
+std::size_t roundToAlignment(std::size_t bytes)
+{
+    return (bytes + RESIDENTALIGNMENT - 1) / RESIDENTALIGNMENT * RESIDENTALIGNMENT;
+}
+
+}
+
+ResidentLevels::ResidentLevels()
+    : isBuilt(false), levelCount(0), nodeTotal(0), maxKeys(0), changes(0), baseOffset(0), keyBytes(0), keyStride(0),
+      slotBytes(0)
+{
+}
+
+void ResidentLevels::clear()
+{
+    // The room stays, a concurrent reader may still be searching it
+    beginChange();
+    isBuilt = false;
+    levelCount = 0;
+    nodeTotal = 0;
+    positions.clear();
+    endChange();
+}
+
+void ResidentLevels::grow(int keyBytes, int keyCapacity, int nodeCount)
+{
+    // Every slot is a whole number of cache lines, so once the first one is aligned all of them are
+    std::size_t stride = roundToAlignment((std::size_t)keyBytes * keyCapacity);
+    std::size_t bytes = roundToAlignment(stride + sizeof(PageId) * (keyCapacity + 1));
+    if((int)nodes.size() >= nodeCount && slotBytes == bytes){
+        return;
+    }
+    this->keyBytes = keyBytes;
+    keyStride = stride;
+    slotBytes = bytes;
+    maxKeys = keyCapacity;
+    arena.assign(slotBytes * nodeCount + RESIDENTALIGNMENT, 0);
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(arena.data());
+    baseOffset = roundToAlignment(address) - address;
+    nodes.assign(nodeCount, ResidentNode());
+}
+
+void ResidentLevels::reserve(int keyBytes, int keyCapacity)
+{
+    grow(keyBytes, keyCapacity, MAXRESIDENTNODES);
+}
+
+void ResidentLevels::reset(int keyBytes, int keyCapacity, int nodeCount, int levelCount)
+{
+    // The copies stay changing until finish
+    beginChange();
+    isBuilt = false;
+    grow(keyBytes, keyCapacity, nodeCount);
+    nodeTotal = nodeCount;
+    positions.clear();
+    this->levelCount = levelCount;
+}
+
+void ResidentLevels::finish()
+{
+    isBuilt = true;
+    endChange();
+}
+
+void ResidentLevels::setNode(int node, PageId pageNo, int firstChild, const void* keys, int keySize,
+                             const PageId* childPageNos)
+{
+    nodes[node].pageNo = pageNo;
+    nodes[node].firstChild = firstChild;
+    positions[pageNo] = node;
+    nodes[node].keySize = keySize;
+    memcpy(slot(node), keys, keyBytes * keySize);
+    memcpy(slot(node) + keyStride, childPageNos, sizeof(PageId) * (keySize + 1));
+}
+
+void ResidentLevels::patchNode(int node, const void* keys, int keySize, const PageId* childPageNos)
+{
+    beginChange();
+    nodes[node].keySize = keySize;
+    memcpy(slot(node), keys, keyBytes * keySize);
+    memcpy(slot(node) + keyStride, childPageNos, sizeof(PageId) * (keySize + 1));
+    endChange();
+}
+
+int ResidentLevels::find(PageId pageNo) const
+{
+    std::unordered_map<PageId, int>::const_iterator found = positions.find(pageNo);
+    return found == positions.end() ? -1 : found->second;
+}
+
+}
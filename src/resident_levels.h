@@ -0,0 +1,206 @@
+/**
+ * @file resident_levels.h
+ * @brief Decoded copies of the non-leaf nodes of the top levels of a B+ tree on fixed size keys, kept in memory so a
+ * descent searches them without going through the buffer pool. The nodes are laid out level by level from the left,
+ * and the children of a node follow each other on the level below, so like in a CSB+ tree a node only records where
+ * its first child is. The keys of every node start on a cache line, and its child page numbers follow them.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include "types.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of bytes of a cache line, on which the keys of every resident node start.
+ */
+const int RESIDENTALIGNMENT = 64;
+
+/**
+ * @brief Maximum number of resident nodes. A level is only made resident if all of its nodes fit along with the
+ * levels above it, so the two top levels of a tree of up to about half a million leaves take a few megabytes.
+ */
+const int MAXRESIDENTNODES = 1024;
+
+/**
+ * @brief Copies of the top levels of a tree. The copies are built from the root down, after which the index patches
+ * a copy of the bottom resident level when its node changes, and clears all of them when a node above changes, since
+ * that may add or take away resident nodes. Every change makes the version of the copies odd while it lasts, so a
+ * concurrent index searches them like a node, validating the version afterwards.
+ */
+class ResidentLevels
+{
+ public:
+	ResidentLevels();
+
+  /**
+   * Drop all copies, so they are built again before the next descent.
+   */
+	void clear();
+
+  /**
+   * True once the copies are built, even if no level is resident, until they are cleared.
+   */
+	bool built() const { return isBuilt; }
+
+  /**
+   * Number of resident levels, counted from the root.
+   */
+	int levels() const { return levelCount; }
+
+  /**
+   * Number of resident nodes.
+   */
+	int nodeCount() const { return nodeTotal; }
+
+  /**
+   * Make room for the given number of nodes making up the given number of levels, with at most keyCapacity keys of
+   * keyBytes bytes each. The nodes are then set one after the other, level by level from the left, and the copies
+   * are changing until finish.
+   */
+	void reset(int keyBytes, int keyCapacity, int nodeCount, int levelCount);
+
+  /**
+   * Mark the copies built once all nodes are set after reset.
+   */
+	void finish();
+
+  /**
+   * Make room for MAXRESIDENTNODES nodes up front. The room of the copies only grows, so once reserved, building them
+   * again never moves them, and a reader searching them while they change reads nothing but the copies.
+   */
+	void reserve(int keyBytes, int keyCapacity);
+
+  /**
+   * Version of the copies, odd while they change.
+   */
+	std::uint64_t version() const { return changes.load(std::memory_order_acquire); }
+
+  /**
+   * True if the copies still have the given version, so everything read of them since is consistent.
+   */
+	bool validate(std::uint64_t version) const
+	{
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return changes.load(std::memory_order_relaxed) == version;
+	}
+
+  /**
+   * True if the copies were changing when they had the given version.
+   */
+	static bool changing(std::uint64_t version) { return (version & 1) != 0; }
+
+  /**
+   * Number of nodes there is room for.
+   */
+	int capacity() const { return (int)nodes.size(); }
+
+  /**
+   * Greatest number of keys of a node.
+   */
+	int keyCapacity() const { return maxKeys; }
+
+  /**
+   * Copy a node into the given position.
+   * @param pageNo Page number of the node
+   * @param firstChild Position of the copy of the first child, -1 if the node is on the bottom resident level
+   * @param keys The keySize keys of the node
+   * @param childPageNos The keySize + 1 page numbers of its children
+   */
+	void setNode(int node, PageId pageNo, int firstChild, const void* keys, int keySize, const PageId* childPageNos);
+
+  /**
+   * Copy the keys and children of a node on the bottom resident level again after it changed.
+   */
+	void patchNode(int node, const void* keys, int keySize, const PageId* childPageNos);
+
+  /**
+   * Position of the copy of the node in the given page, -1 if it is not resident.
+   */
+	int find(PageId pageNo) const;
+
+  /**
+   * True if the children of the node are not resident.
+   */
+	bool onBottomLevel(int node) const { return nodes[node].firstChild < 0; }
+
+	PageId pageNo(int node) const { return nodes[node].pageNo; }
+
+	int keySize(int node) const { return nodes[node].keySize; }
+
+  /**
+   * Keys of the node, which start on a cache line.
+   */
+	template <class T>
+	const T* keys(int node) const { return reinterpret_cast<const T*>(slot(node)); }
+
+  /**
+   * Page numbers of the children of the node.
+   */
+	const PageId* childPageNos(int node) const { return reinterpret_cast<const PageId*>(slot(node) + keyStride); }
+
+  /**
+   * Position of the copy of the child at the given position of the node, -1 if its children are not resident.
+   */
+	int child(int node, int position) const
+	{
+		return nodes[node].firstChild < 0 ? -1 : nodes[node].firstChild + position;
+	}
+
+ private:
+	struct ResidentNode{
+		PageId pageNo;
+		int keySize;
+		int firstChild;
+	};
+
+	const unsigned char* slot(int node) const { return &arena[baseOffset + node * slotBytes]; }
+	unsigned char* slot(int node) { return &arena[baseOffset + node * slotBytes]; }
+
+  /**
+   * Make room for the given number of nodes of at most keyCapacity keys of keyBytes bytes, if there is less.
+   */
+	void grow(int keyBytes, int keyCapacity, int nodeCount);
+
+  /**
+   * Start and end a change, making the version odd and then even again.
+   */
+	void beginChange() { changes.fetch_add(1, std::memory_order_relaxed); std::atomic_thread_fence(std::memory_order_release); }
+	void endChange() { changes.fetch_add(1, std::memory_order_release); }
+
+	bool isBuilt;
+	int levelCount;
+	int nodeTotal;
+	int maxKeys;
+	std::atomic<std::uint64_t> changes;
+
+  /**
+   * Nodes, the first nodeTotal of which are in use.
+   */
+	std::vector<ResidentNode> nodes;
+	std::unordered_map<PageId, int> positions;
+
+  /**
+   * Slots of the nodes, each holding keyStride bytes of keys and then the child page numbers, from baseOffset on,
+   * which is the first cache line of the arena.
+   */
+	std::vector<unsigned char> arena;
+	std::size_t baseOffset;
+	std::size_t keyBytes;
+	std::size_t keyStride;
+	std::size_t slotBytes;
+};
+
+}
@@ -0,0 +1,358 @@
+/**
+ * @file string_node.cpp
+ * @brief Slotted page format of B+ tree nodes for STRING keys, with variable length keys and a common
+ * prefix stored once per page.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstring>
+#include <algorithm>
+#include "string_node.h"
+
+namespace badgerdb
+{
+
+namespace
+{
+
+// Common prefix of the sorted keys [first, last), which is the common prefix of the first and the last key
+int rangePrefixLength(const std::vector<std::string>& keys, int first, int last)
+{
+    if(last - first < 2){
+        return 0;
+    }
+    return commonPrefixLength(keys[first], keys[last - 1]);
+}
+
+// Payload of a slot, the RecordId in a leaf node and the right child in a non-leaf node
+RecordId payloadOf(const StringLeafSlot& slot)
+{
+    return slot.rid;
+}
+
+PageId payloadOf(const StringNonLeafSlot& slot)
+{
+    return slot.pageNo;
+}
+
+void setPayload(StringLeafSlot& slot, RecordId rid)
+{
+    slot.rid = rid;
+}
+
+void setPayload(StringNonLeafSlot& slot, PageId pageNo)
+{
+    slot.pageNo = pageNo;
+}
+
+template <class Node>
+const char* prefixOf(const Node* node)
+{
+    return node->data + Node::DATASIZE - node->prefixLength;
+}
+
+template <class Node, bool Upper>
+int stringSearch(const Node* node, const char* key, int keyLength)
+{
+    // Compare the key with the common prefix first. A key which does not start with the prefix is smaller
+    // or greater than every key in the node
+    int prefixLength = node->prefixLength;
+    int c = memcmp(key, prefixOf(node), std::min(keyLength, prefixLength));
+    if(c < 0 || (c == 0 && keyLength < prefixLength)){
+        return 0;
+    }
+    if(c > 0){
+        return node->keySize;
+    }
+
+    // Binary search over the slots, comparing the rest of the key with the key suffixes only
+    const char* rest = key + prefixLength;
+    int restLength = keyLength - prefixLength;
+    const typename Node::Slot* slots = node->slots();
+    int low = 0;
+    int len = node->keySize;
+    while(len > 0){
+        int half = len / 2;
+        const typename Node::Slot& slot = slots[low + half];
+        int cmp = compareStringKeys(node->data + slot.offset, slot.length, rest, restLength);
+        if(Upper ? cmp <= 0 : cmp < 0){
+            low += half + 1;
+            len -= half + 1;
+        }
+        else{
+            len = half;
+        }
+    }
+    return low;
+}
+
+// Number of bytes needed by the sorted keys [first, last) with the given common prefix, per key
+// the slot and the key suffix, and the prefix once
+template <class Node>
+int bytesWithPrefix(const std::vector<std::string>& keys, int first, int last, int prefixLength)
+{
+    int bytes = prefixLength;
+    for(int i = first; i < last; i++){
+        bytes += sizeof(typename Node::Slot) + (int)keys[i].size() - prefixLength;
+    }
+    return bytes;
+}
+
+// Pick the split, among the candidates [lowest, highest], for which both halves fit and the larger half is
+// the smallest, the left half weighed by leftFill and the right half by the rest, so the halves come out at about
+// leftFill and 1 - leftFill of the bytes. The halves of a candidate are the keys [0, split) and [split + rightOffset, n)
+template <class Node>
+int chooseSplit(const std::vector<std::string>& keys, int lowest, int highest, int rightOffset, double leftFill)
+{
+    int n = (int)keys.size();
+    int best = -1;
+    double bestBytes = 0;
+    for(int split = lowest; split <= highest; split++){
+        int leftBytes = stringNodeBytes<Node>(keys, 0, split);
+        int rightBytes = stringNodeBytes<Node>(keys, split + rightOffset, n);
+        double larger = std::max(leftBytes * (1 - leftFill), rightBytes * leftFill);
+        if(std::max(leftBytes, rightBytes) <= Node::DATASIZE && (best < 0 || larger < bestBytes)){
+            best = split;
+            bestBytes = larger;
+        }
+    }
+    return best;
+}
+
+}
+
+int commonPrefixLength(const std::string& a, const std::string& b)
+{
+    int length = (int)std::min(a.size(), b.size());
+    int i = 0;
+    while(i < length && a[i] == b[i]){
+        i++;
+    }
+    return i;
+}
+
+int stringKeyLength(const char* key)
+{
+    return (int)strnlen(key, STRINGKEYMAXSIZE);
+}
+
+int compareStringKeys(const char* a, int aLength, const char* b, int bLength)
+{
+    int c = memcmp(a, b, std::min(aLength, bLength));
+    if(c != 0){
+        return c;
+    }
+    return aLength - bLength;
+}
+
+void initializeStringLeaf(StringLeafNode* node)
+{
+    node->keySize = 0;
+    node->rightSibPageNo = Page::INVALID_NUMBER;
+    node->leftSibPageNo = Page::INVALID_NUMBER;
+    node->prefixLength = 0;
+    node->heapStart = StringLeafNode::DATASIZE;
+}
+
+void initializeStringNonLeaf(StringNonLeafNode* node, int level)
+{
+    node->keySize = 0;
+    node->level = level;
+    node->leftmostPageNo = Page::INVALID_NUMBER;
+    node->prefixLength = 0;
+    node->heapStart = StringNonLeafNode::DATASIZE;
+}
+
+template <class Node>
+int stringLowerBound(const Node* node, const char* key, int keyLength)
+{
+    return stringSearch<Node, false>(node, key, keyLength);
+}
+
+template <class Node>
+int stringUpperBound(const Node* node, const char* key, int keyLength)
+{
+    return stringSearch<Node, true>(node, key, keyLength);
+}
+
+template <class Node>
+int compareStringEntry(const Node* node, int position, const char* key, int keyLength)
+{
+    int prefixLength = node->prefixLength;
+    int c = memcmp(prefixOf(node), key, std::min(keyLength, prefixLength));
+    if(c != 0){
+        return c;
+    }
+    if(keyLength < prefixLength){
+        return 1;
+    }
+    const typename Node::Slot& slot = node->slots()[position];
+    return compareStringKeys(node->data + slot.offset, slot.length, key + prefixLength, keyLength - prefixLength);
+}
+
+template <class Node>
+std::string stringEntryKey(const Node* node, int position)
+{
+    const typename Node::Slot& slot = node->slots()[position];
+    std::string key(prefixOf(node), node->prefixLength);
+    key.append(node->data + slot.offset, slot.length);
+    return key;
+}
+
+template <class Node>
+bool insertStringEntry(Node* node, int position, const char* key, int keyLength, typename Node::Payload payload)
+{
+    typedef typename Node::Slot Slot;
+    int prefixLength = node->prefixLength;
+
+    // If the key starts with the common prefix, append its suffix to the heap and shift the slots on its right
+    if(keyLength >= prefixLength && memcmp(key, prefixOf(node), prefixLength) == 0){
+        int suffixLength = keyLength - prefixLength;
+        int freeBytes = node->heapStart - node->keySize * (int)sizeof(Slot);
+        if((int)sizeof(Slot) + suffixLength > freeBytes){
+            return false;
+        }
+        Slot* slots = node->slots();
+        memmove(&slots[position + 1], &slots[position], (node->keySize - position) * sizeof(Slot));
+        node->heapStart -= suffixLength;
+        memcpy(node->data + node->heapStart, key + prefixLength, suffixLength);
+        slots[position].offset = node->heapStart;
+        slots[position].length = suffixLength;
+        setPayload(slots[position], payload);
+        node->keySize++;
+        return true;
+    }
+
+    // Otherwise the prefix of the node gets shorter, rebuild the node with the key if everything still fits
+    std::vector<std::string> keys;
+    std::vector<typename Node::Payload> payloads;
+    decodeStringNode(node, keys, payloads);
+    keys.insert(keys.begin() + position, std::string(key, keyLength));
+    payloads.insert(payloads.begin() + position, payload);
+    return encodeStringNode(node, keys, payloads, 0, (int)keys.size());
+}
+
+template <class Node>
+void removeStringEntry(Node* node, int position)
+{
+    std::vector<std::string> keys;
+    std::vector<typename Node::Payload> payloads;
+    decodeStringNode(node, keys, payloads);
+    keys.erase(keys.begin() + position);
+    payloads.erase(payloads.begin() + position);
+    encodeStringNode(node, keys, payloads, 0, (int)keys.size());
+}
+
+template <class Node>
+int stringNodeUsedBytes(const Node* node)
+{
+    return Node::DATASIZE - node->heapStart + node->keySize * (int)sizeof(typename Node::Slot);
+}
+
+template <class Node>
+void decodeStringNode(const Node* node, std::vector<std::string>& keys, std::vector<typename Node::Payload>& payloads)
+{
+    keys.resize(node->keySize);
+    payloads.resize(node->keySize);
+    for(int i = 0; i < node->keySize; i++){
+        keys[i] = stringEntryKey(node, i);
+        payloads[i] = payloadOf(node->slots()[i]);
+    }
+}
+
+template <class Node>
+int stringNodeBytes(const std::vector<std::string>& keys, int first, int last)
+{
+    return bytesWithPrefix<Node>(keys, first, last, rangePrefixLength(keys, first, last));
+}
+
+template <class Node>
+bool encodeStringNode(Node* node, const std::vector<std::string>& keys,
+                      const std::vector<typename Node::Payload>& payloads, int first, int last)
+{
+    typedef typename Node::Slot Slot;
+    int prefixLength = rangePrefixLength(keys, first, last);
+    if(bytesWithPrefix<Node>(keys, first, last, prefixLength) > Node::DATASIZE){
+        return false;
+    }
+
+    // The prefix goes to the very end of the data area, the key suffixes below it
+    int heapStart = Node::DATASIZE - prefixLength;
+    if(prefixLength > 0){
+        memcpy(node->data + heapStart, keys[first].data(), prefixLength);
+    }
+    Slot* slots = node->slots();
+    for(int i = first; i < last; i++){
+        int suffixLength = (int)keys[i].size() - prefixLength;
+        heapStart -= suffixLength;
+        memcpy(node->data + heapStart, keys[i].data() + prefixLength, suffixLength);
+        Slot& slot = slots[i - first];
+        slot.offset = heapStart;
+        slot.length = suffixLength;
+        setPayload(slot, payloads[i]);
+    }
+    node->keySize = last - first;
+    node->prefixLength = prefixLength;
+    node->heapStart = heapStart;
+    return true;
+}
+
+template <class Node>
+int stringKeysFitting(const std::vector<std::string>& keys, int first, int last, int limit)
+{
+    // The common prefix of the keys [first, i] is the common prefix of the first key and key i, so the bytes of
+    // the node can be kept up to date one key at a time
+    int keyBytes = 0;
+    int count = 1;
+    for(int i = first; i < last; i++){
+        keyBytes += sizeof(typename Node::Slot) + (int)keys[i].size();
+        int prefixLength = (i > first) ? commonPrefixLength(keys[first], keys[i]) : 0;
+        int bytes = keyBytes - (i - first + 1) * prefixLength + prefixLength;
+        if(bytes > limit){
+            break;
+        }
+        count = i - first + 1;
+    }
+    return count;
+}
+
+int chooseStringLeafSplit(const std::vector<std::string>& keys, double leftFill)
+{
+    // Both leaf nodes keep at least one key, the right node starts at the split
+    return chooseSplit<StringLeafNode>(keys, 1, (int)keys.size() - 1, 0, leftFill);
+}
+
+int chooseStringNonLeafSplit(const std::vector<std::string>& keys, double leftFill)
+{
+    // The key at the split moves up, both non-leaf nodes keep at least one key
+    return chooseSplit<StringNonLeafNode>(keys, 1, (int)keys.size() - 2, 1, leftFill);
+}
+
+template int stringLowerBound<StringLeafNode>(const StringLeafNode*, const char*, int);
+template int stringLowerBound<StringNonLeafNode>(const StringNonLeafNode*, const char*, int);
+template int stringUpperBound<StringLeafNode>(const StringLeafNode*, const char*, int);
+template int stringUpperBound<StringNonLeafNode>(const StringNonLeafNode*, const char*, int);
+template int compareStringEntry<StringLeafNode>(const StringLeafNode*, int, const char*, int);
+template int compareStringEntry<StringNonLeafNode>(const StringNonLeafNode*, int, const char*, int);
+template std::string stringEntryKey<StringLeafNode>(const StringLeafNode*, int);
+template std::string stringEntryKey<StringNonLeafNode>(const StringNonLeafNode*, int);
+template bool insertStringEntry<StringLeafNode>(StringLeafNode*, int, const char*, int, RecordId);
+template bool insertStringEntry<StringNonLeafNode>(StringNonLeafNode*, int, const char*, int, PageId);
+template void removeStringEntry<StringLeafNode>(StringLeafNode*, int);
+template void removeStringEntry<StringNonLeafNode>(StringNonLeafNode*, int);
+template int stringNodeUsedBytes<StringLeafNode>(const StringLeafNode*);
+template int stringNodeUsedBytes<StringNonLeafNode>(const StringNonLeafNode*);
+template void decodeStringNode<StringLeafNode>(const StringLeafNode*, std::vector<std::string>&, std::vector<RecordId>&);
+template void decodeStringNode<StringNonLeafNode>(const StringNonLeafNode*, std::vector<std::string>&, std::vector<PageId>&);
+template int stringNodeBytes<StringLeafNode>(const std::vector<std::string>&, int, int);
+template int stringNodeBytes<StringNonLeafNode>(const std::vector<std::string>&, int, int);
+template bool encodeStringNode<StringLeafNode>(StringLeafNode*, const std::vector<std::string>&, const std::vector<RecordId>&, int, int);
+template int stringKeysFitting<StringLeafNode>(const std::vector<std::string>&, int, int, int);
+template int stringKeysFitting<StringNonLeafNode>(const std::vector<std::string>&, int, int, int);
+template bool encodeStringNode<StringNonLeafNode>(StringNonLeafNode*, const std::vector<std::string>&, const std::vector<PageId>&, int, int);
+
+}
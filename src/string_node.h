@@ -0,0 +1,308 @@
+/**
+ * @file string_node.h
+ * @brief Slotted page format of B+ tree nodes for STRING keys, with variable length keys and a common
+ * prefix stored once per page.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "types.h"
+#include "page.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Maximum number of bytes of a STRING key. A STRING attribute is read up to its terminating '\0',
+ * or up to this many bytes, like a char s[64] column.
+ */
+const int STRINGKEYMAXSIZE = 64;
+
+/**
+ * @brief Slot directory entry of a STRING leaf node.
+ */
+struct StringLeafSlot{
+  /**
+   * Offset of the key suffix, i.e. the key without the common prefix of the page, in the data area.
+   */
+	unsigned short offset;
+
+  /**
+   * Length of the key suffix.
+   */
+	unsigned short length;
+
+  /**
+   * RecordId of the key.
+   */
+	RecordId rid;
+};
+
+/**
+ * @brief Slot directory entry of a STRING non-leaf node.
+ */
+struct StringNonLeafSlot{
+  /**
+   * Offset of the key suffix, i.e. the key without the common prefix of the page, in the data area.
+   */
+	unsigned short offset;
+
+  /**
+   * Length of the key suffix.
+   */
+	unsigned short length;
+
+  /**
+   * Page number of the child on the right of the key.
+   */
+	PageId pageNo;
+};
+
+/**
+ * @brief Structure for all leaf nodes when the key is of STRING type.
+ * The data area holds the slot directory, sorted by key, growing from its start, and the key heap growing
+ * from its end. The common prefix of all keys of the page sits at the very end of the data area, and the heap
+ * only holds the rest of every key.
+*/
+struct StringLeafNode{
+	typedef StringLeafSlot Slot;
+	typedef RecordId Payload;
+
+  /**
+   * Number of keys in the node
+   */
+	int keySize;
+
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Length of the common prefix of all keys in the node.
+   */
+	unsigned short prefixLength;
+
+  /**
+   * Offset of the lowest byte in use by the key heap (including the prefix) in the data area.
+   */
+	unsigned short heapStart;
+
+  /**
+   * Size of the data area.
+   */
+	static const int DATASIZE = Page::SIZE - 3 * sizeof(int) - 2 * sizeof(unsigned short);
+
+  /**
+   * Slot directory and key heap.
+   */
+	char data[ DATASIZE ];
+
+	Slot* slots() { return reinterpret_cast<Slot*>(data); }
+	const Slot* slots() const { return reinterpret_cast<const Slot*>(data); }
+};
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of STRING type. Same layout as StringLeafNode,
+ * where the slot of a key holds the child on its right, and the leftmost child is kept in the header.
+*/
+struct StringNonLeafNode{
+	typedef StringNonLeafSlot Slot;
+	typedef PageId Payload;
+
+  /**
+   * Number of keys in the node
+   */
+	int keySize;
+
+  /**
+   * Level of the node in the tree, 1 if the children are leaf nodes.
+   */
+	int level;
+
+  /**
+   * Page number of the leftmost child, on the left of all keys.
+   */
+	PageId leftmostPageNo;
+
+  /**
+   * Length of the common prefix of all keys in the node.
+   */
+	unsigned short prefixLength;
+
+  /**
+   * Offset of the lowest byte in use by the key heap (including the prefix) in the data area.
+   */
+	unsigned short heapStart;
+
+  /**
+   * Size of the data area.
+   */
+	static const int DATASIZE = Page::SIZE - 3 * sizeof(int) - 2 * sizeof(unsigned short);
+
+  /**
+   * Slot directory and key heap.
+   */
+	char data[ DATASIZE ];
+
+	Slot* slots() { return reinterpret_cast<Slot*>(data); }
+	const Slot* slots() const { return reinterpret_cast<const Slot*>(data); }
+};
+
+static_assert(sizeof(StringLeafNode) <= Page::SIZE && sizeof(StringNonLeafNode) <= Page::SIZE,
+              "STRING nodes must fit in a page.");
+
+/**
+ * @brief Length of a STRING key, up to its terminating '\0' and at most STRINGKEYMAXSIZE.
+ */
+int stringKeyLength(const char* key);
+
+/**
+ * @brief Compare two byte strings like memcmp, where a proper prefix is smaller than the longer string.
+ * @return Negative, zero or positive if a is smaller than, equal to or greater than b
+ */
+int compareStringKeys(const char* a, int aLength, const char* b, int bLength);
+
+/**
+ * @brief A STRING key padded with '\0' up to STRINGKEYMAXSIZE bytes, so it can be copied and compared like a fixed
+ * size key, e.g. by the external sort of a bulk load. A key holds no '\0' of its own, so padded keys compare like
+ * the keys themselves.
+ */
+struct PaddedStringKey{
+  /**
+   * Bytes of the key, followed by '\0' up to the end.
+   */
+	char bytes[ STRINGKEYMAXSIZE ];
+
+	int length() const { return stringKeyLength(bytes); }
+};
+
+inline bool operator<(const PaddedStringKey& a, const PaddedStringKey& b)
+{
+	return memcmp(a.bytes, b.bytes, STRINGKEYMAXSIZE) < 0;
+}
+
+inline bool operator!=(const PaddedStringKey& a, const PaddedStringKey& b)
+{
+	return memcmp(a.bytes, b.bytes, STRINGKEYMAXSIZE) != 0;
+}
+
+/**
+ * @brief Length of the common prefix of two keys.
+ */
+int commonPrefixLength(const std::string& a, const std::string& b);
+
+/**
+ * @brief Initialize an empty STRING leaf node without siblings.
+ */
+void initializeStringLeaf(StringLeafNode* node);
+
+/**
+ * @brief Initialize an empty STRING non-leaf node at the given level.
+ */
+void initializeStringNonLeaf(StringNonLeafNode* node, int level);
+
+/**
+ * @brief Return the position of the first key in the node which is greater than or equal to the given key.
+ * The key is compared against the common prefix once, and only against the key suffixes afterwards.
+ */
+template <class Node>
+int stringLowerBound(const Node* node, const char* key, int keyLength);
+
+/**
+ * @brief Return the position of the first key in the node which is strictly greater than the given key.
+ */
+template <class Node>
+int stringUpperBound(const Node* node, const char* key, int keyLength);
+
+/**
+ * @brief Compare the key at the given position of the node with the given key.
+ * @return Negative, zero or positive if the key in the node is smaller than, equal to or greater than the given key
+ */
+template <class Node>
+int compareStringEntry(const Node* node, int position, const char* key, int keyLength);
+
+/**
+ * @brief Get the full key, prefix included, at the given position of the node.
+ */
+template <class Node>
+std::string stringEntryKey(const Node* node, int position);
+
+/**
+ * @brief Insert a key and its payload at the given position. The key goes straight into the free space if it
+ * starts with the common prefix of the node, otherwise the node is rebuilt with a shorter prefix.
+ * @return False, with the node unchanged, if the node has no room for the key
+ */
+template <class Node>
+bool insertStringEntry(Node* node, int position, const char* key, int keyLength, typename Node::Payload payload);
+
+/**
+ * @brief Remove the key and payload at the given position. The node is rebuilt, so the bytes of the key are
+ * reclaimed and the common prefix may get longer.
+ */
+template <class Node>
+void removeStringEntry(Node* node, int position);
+
+/**
+ * @brief Number of bytes of the data area in use by the slots, the key suffixes and the common prefix.
+ */
+template <class Node>
+int stringNodeUsedBytes(const Node* node);
+
+/**
+ * @brief Decode all keys, prefix included, and payloads of the node.
+ */
+template <class Node>
+void decodeStringNode(const Node* node, std::vector<std::string>& keys, std::vector<typename Node::Payload>& payloads);
+
+/**
+ * @brief Number of bytes of the data area needed to store the sorted keys [first, last) in one node.
+ */
+template <class Node>
+int stringNodeBytes(const std::vector<std::string>& keys, int first, int last);
+
+/**
+ * @brief Write the sorted keys [first, last) and their payloads into the node, with their common prefix stored
+ * once. Only keySize, prefixLength, heapStart and the data area are written, the caller sets the other fields.
+ * @return False, with the node unchanged, if the keys do not fit
+ */
+template <class Node>
+bool encodeStringNode(Node* node, const std::vector<std::string>& keys,
+                      const std::vector<typename Node::Payload>& payloads, int first, int last);
+
+/**
+ * @brief Number of the sorted keys [first, last), starting at first, which fit in one node within the given number
+ * of bytes of the data area. At least one key is counted, even if it alone does not fit.
+ */
+template <class Node>
+int stringKeysFitting(const std::vector<std::string>& keys, int first, int last, int limit);
+
+/**
+ * @brief Choose where to split the sorted keys of an overflowing leaf node, keys [0, split) going to the left
+ * node and [split, n) to the right node. Both halves fit, and the left node takes as close to the given fraction
+ * of the bytes as possible, by default half of them.
+ */
+int chooseStringLeafSplit(const std::vector<std::string>& keys, double leftFill = 0.5);
+
+/**
+ * @brief Choose the key pushed up when splitting the sorted keys of an overflowing non-leaf node, keys
+ * [0, split) going to the left node and (split, n) to the right node. Both halves fit, and the left node takes as
+ * close to the given fraction of the bytes as possible, by default half of them.
+ */
+int chooseStringNonLeafSplit(const std::vector<std::string>& keys, double leftFill = 0.5);
+
+}